@@ -0,0 +1,1211 @@
+#include "../src/parking.h"
+#include "../src/plate_index.h"
+#include "../src/tariff.h"
+#include "../src/command_ring.h"
+#include "../src/timer_wheel.h"
+#include "../src/lane_policy.h"
+
+// 核心路径微基准测试
+//
+// 每个测试输出一行JSON（JSON Lines），便于脚本比较不同版本的结果，例如：
+//   {"bench":"push_pop","variant":"indexed","n":1000,"depth":-1,"ops":2000,"reps":5,
+//    "ns_per_op":35.1,"min_ns_per_op":33.8,"ops_per_sec":28490028}
+// ns_per_op 为各轮的中位数，min_ns_per_op 为最快一轮。depth 仅对 leaveCar 有意义，其余为 -1。
+//
+// 用法: bench [--quick] [--reps N] [--filter 名称] [--state-file 路径] [--verify-plates] [--verify-timers]
+//        [--verify-lane]
+//
+// --verify-plates 不做计时，核对车牌检查和比较的各个实现结果一致，不一致时返回1。
+// --verify-timers 不做计时，用随机的设置、取消和推进核对时间轮与逐个比较的参考实现一致，不一致时返回1。
+// --verify-lane 不做计时，用随机的入队、出队和取消核对优先级便道与逐个比较的参考实现一致，不一致时返回1。
+
+#define MAX_REPS 32
+
+static int reps = 5;
+static bool quick = false;
+static const char *filter = NULL;
+static const char *statePath = "bench_state.dat";
+static volatile double sink; // 防止编译器优化掉被测调用
+
+// 单调时钟（纳秒）
+static double nowNanoseconds(void) {
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// 生成第i个车牌号（京A + 5位字母数字），最多约4500万个互不相同
+static void makePlate(char *buffer, long i) {
+    static const char alphabet[] = "0123456789ABCDEFGHJKLMNPQRSTUVWXYZ";
+    char tail[6];
+    for (int k = 4; k >= 0; k--) {
+        tail[k] = alphabet[i % 34];
+        i /= 34;
+    }
+    tail[5] = '\0';
+    snprintf(buffer, MAX_PLATE_LEN, "京A%s", tail);
+}
+
+static bool selected(const char *bench) {
+    return filter == NULL || strstr(bench, filter) != NULL;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// 运行 reps 轮（之前先预热一轮），输出一行结果；fn 返回本轮执行的操作次数
+static void runCase(const char *bench, const char *variant, long n, long depth,
+                    long (*fn)(void *), void *ctx) {
+    double samples[MAX_REPS];
+    long ops = fn(ctx);
+    for (int r = 0; r < reps; r++) {
+        double start = nowNanoseconds();
+        ops = fn(ctx);
+        double elapsed = nowNanoseconds() - start;
+        samples[r] = ops > 0 ? elapsed / (double)ops : 0.0;
+    }
+    qsort(samples, (size_t)reps, sizeof(double), compareDoubles);
+    double median = samples[reps / 2];
+
+    printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"n\":%ld,\"depth\":%ld,\"ops\":%ld,\"reps\":%d,"
+           "\"ns_per_op\":%.1f,\"min_ns_per_op\":%.1f,\"ops_per_sec\":%.0f}\n",
+           bench, variant, n, depth, ops, reps, median, samples[0],
+           median > 0 ? 1e9 / median : 0.0);
+    fflush(stdout);
+}
+
+// 被测的停车场环境
+typedef struct {
+    ParkingStack lot;
+    ParkingStack tempLot;
+    WaitingQueue lane;
+    PlateIndex index;
+    SystemStats stats;
+    char (*plates)[MAX_PLATE_LEN];
+    long n;
+    long ops;    // 查找类测试每轮的操作次数
+    long depth;  // leaveCar测试中离开车辆距栈顶的深度
+} Fixture;
+
+static bool setupFixture(Fixture *f, long n, LotModel model, bool indexed) {
+    memset(f, 0, sizeof(Fixture));
+    f->n = n;
+    f->plates = malloc((size_t)n * sizeof(*f->plates));
+    if (f->plates == NULL ||
+        initStack(&f->lot, (int)n) != SUCCESS ||
+        setLotModel(&f->lot, model) != SUCCESS ||
+        initStack(&f->tempLot, (int)n) != SUCCESS) {
+        return false;
+    }
+    initQueue(&f->lane);
+    initSystem(NULL, &f->stats);
+    if (indexed) {
+        if (initPlateIndex(&f->index, (int)n * 2) != SUCCESS) {
+            return false;
+        }
+        attachPlateIndex(&f->lot, &f->lane, &f->index);
+    }
+    for (long i = 0; i < n; i++) {
+        makePlate(f->plates[i], i);
+    }
+    return true;
+}
+
+static void fillLot(Fixture *f) {
+    for (long i = 0; i < f->n; i++) {
+        push(&f->lot, createCar(f->plates[i]));
+    }
+}
+
+static void teardownFixture(Fixture *f) {
+    if (f->lot.index != NULL) {
+        attachPlateIndex(&f->lot, &f->lane, NULL);
+        freePlateIndex(&f->index);
+    }
+    clearQueue(&f->lane);
+    freeStack(&f->lot);
+    freeStack(&f->tempLot);
+    free(f->plates);
+}
+
+// ---- push / pop ----
+
+static long benchPushPop(void *ctx) {
+    Fixture *f = ctx;
+    for (long i = 0; i < f->n; i++) {
+        push(&f->lot, createCar(f->plates[i]));
+    }
+    for (long i = 0; i < f->n; i++) {
+        Car car = pop(&f->lot);
+        sink += (double)car.arriveTime;
+    }
+    return f->n * 2;
+}
+
+// ---- enqueue / dequeue ----
+
+static long benchEnqueueDequeue(void *ctx) {
+    Fixture *f = ctx;
+    for (long i = 0; i < f->n; i++) {
+        enqueue(&f->lane, createCar(f->plates[i]));
+    }
+    for (long i = 0; i < f->n; i++) {
+        Car car = dequeue(&f->lane);
+        sink += (double)car.arriveTime;
+    }
+    return f->n * 2;
+}
+
+// ---- 命令队列：连续放入一批再一次取出 ----
+
+typedef struct {
+    CommandRing ring;
+    void *items[1024];
+    long burst;
+} RingFixture;
+
+static long benchCommandRing(void *ctx) {
+    RingFixture *f = ctx;
+    for (int round = 0; round < 1000; round++) {
+        for (long i = 0; i < f->burst; i++) {
+            commandRingPush(&f->ring, &f->items[i]);
+        }
+        sink += commandRingDrain(&f->ring, f->items, (int)f->burst);
+    }
+    return 1000 * f->burst;
+}
+
+// ---- isCarExists / findCarPosition（一半命中，一半不命中） ----
+
+static long benchIsCarExists(void *ctx) {
+    Fixture *f = ctx;
+    char missing[MAX_PLATE_LEN];
+    long hits = 0;
+    for (long i = 0; i < f->ops; i++) {
+        const char *plate = f->plates[(i * 7919) % f->n];
+        if (i & 1) {
+            makePlate(missing, f->n + i);
+            plate = missing;
+        }
+        hits += isCarExists(&f->lot, &f->lane, plate);
+    }
+    sink += (double)hits;
+    return f->ops;
+}
+
+static long benchFindCarPosition(void *ctx) {
+    Fixture *f = ctx;
+    char missing[MAX_PLATE_LEN];
+    long total = 0;
+    for (long i = 0; i < f->ops; i++) {
+        const char *plate = f->plates[(i * 7919) % f->n];
+        if (i & 1) {
+            makePlate(missing, f->n + i);
+            plate = missing;
+        }
+        total += findCarPosition(&f->lot, plate);
+    }
+    sink += (double)total;
+    return f->ops;
+}
+
+// ---- leaveCar（离开后立即以同一车牌重新进入，停车场保持满载） ----
+
+static long benchLeaveCar(void *ctx) {
+    Fixture *f = ctx;
+    char plate[MAX_PLATE_LEN];
+    time_t now = f->stats.startTime;
+    for (long i = 0; i < f->ops; i++) {
+        // 栈模式下车辆离开后回到栈顶，所以每轮按位置取当前的车牌号
+        int position = f->lot.top - (int)f->depth;
+        while (!isSlotOccupied(&f->lot, position)) {
+            position--;
+        }
+        formatPlate(f->lot.data[position].plate, plate, sizeof(plate));
+        now += 3600;
+        leaveCarAt(&f->lot, &f->tempLot, &f->lane, plate, &f->stats, now);
+        parkCarAt(&f->lot, &f->lane, plate, &f->stats, now);
+    }
+    return f->ops;
+}
+
+// ---- isValidPlateNumber ----
+
+typedef struct {
+    char (*plates)[MAX_PLATE_LEN];
+    long count;
+    long ops;
+} PlateSet;
+
+static long benchIsValidPlate(void *ctx) {
+    PlateSet *set = ctx;
+    long valid = 0;
+    for (long i = 0; i < set->ops; i++) {
+        valid += isValidPlateNumber(set->plates[i % set->count]);
+    }
+    sink += (double)valid;
+    return set->ops;
+}
+
+// ---- calculateFee ----
+
+typedef struct {
+    Car *cars;
+    long count;
+    long ops;
+    const Tariff *tariff;
+} FeeSet;
+
+static long benchCalculateFee(void *ctx) {
+    FeeSet *set = ctx;
+    double total = 0.0;
+    for (long i = 0; i < set->ops; i++) {
+        total += calculateFeeWith(set->tariff, set->cars[i % set->count]);
+    }
+    sink += total;
+    return set->ops;
+}
+
+// ---- saveSystemState / loadSystemState ----
+
+static long benchSave(void *ctx) {
+    Fixture *f = ctx;
+    char tempPath[300];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", statePath);
+    // 与 saveSystemState 相同：写临时文件、刷盘后替换
+    if (!saveSystemStateTo(tempPath, &f->lot, &f->lane, &f->stats, 0) ||
+        !replaceFile(tempPath, statePath)) {
+        return 0;
+    }
+    return 1;
+}
+
+static long benchLoad(void *ctx) {
+    Fixture *f = ctx;
+    uint64_t journalSeq;
+    // 与 loadSystemState 相同：先清空当前状态
+    clearStack(&f->lot);
+    clearQueue(&f->lane);
+    clearPlateIndex(f->lot.index);
+    return loadSystemStateFrom(statePath, &f->lot, &f->lane, &f->stats, &journalSeq) ? 1 : 0;
+}
+
+// ---- 各组测试 ----
+
+static void runCommandRing(void) {
+    static const long bursts[] = { 1, 64, 1024 };
+    if (!selected("command_ring")) {
+        return;
+    }
+    for (int b = 0; b < 3; b++) {
+        RingFixture *f = malloc(sizeof(RingFixture));
+        if (f != NULL && initCommandRing(&f->ring, 1024) == SUCCESS) {
+            f->burst = bursts[b];
+            runCase("command_ring", "push_drain", bursts[b], -1, benchCommandRing, f);
+            freeCommandRing(&f->ring);
+        }
+        free(f);
+    }
+}
+
+static void runStackQueue(void) {
+    static const long sizes[] = { 10, 1000, 100000 };
+    for (int s = 0; s < 3; s++) {
+        long n = sizes[s];
+        if (quick && n > 1000) {
+            continue;
+        }
+        Fixture f;
+        if (selected("push_pop")) {
+            if (setupFixture(&f, n, LOT_MODEL_STACK, true)) {
+                runCase("push_pop", "stack", n, -1, benchPushPop, &f);
+            }
+            teardownFixture(&f);
+            if (setupFixture(&f, n, LOT_MODEL_BAYS, true)) {
+                runCase("push_pop", "bays", n, -1, benchPushPop, &f);
+            }
+            teardownFixture(&f);
+        }
+        if (selected("enqueue_dequeue")) {
+            if (setupFixture(&f, n, LOT_MODEL_STACK, true)) {
+                runCase("enqueue_dequeue", "indexed", n, -1, benchEnqueueDequeue, &f);
+            }
+            teardownFixture(&f);
+            LanePolicy policy;
+            initLanePolicy(&policy);
+            setActiveLanePolicy(&policy);
+            if (setupFixture(&f, n, LOT_MODEL_STACK, true)) {
+                runCase("enqueue_dequeue", "priority", n, -1, benchEnqueueDequeue, &f);
+            }
+            teardownFixture(&f);
+            setActiveLanePolicy(NULL);
+        }
+    }
+}
+
+static void runLookups(void) {
+    static const long sizes[] = { 10, 1000, 100000 };
+    for (int s = 0; s < 3; s++) {
+        long n = sizes[s];
+        if (quick && n > 1000) {
+            continue;
+        }
+        for (int indexed = 1; indexed >= 0; indexed--) {
+            Fixture f;
+            if (!setupFixture(&f, n, LOT_MODEL_STACK, indexed)) {
+                teardownFixture(&f);
+                continue;
+            }
+            fillLot(&f);
+            // 线性查找的代价与n成正比，按n缩减操作次数
+            f.ops = indexed ? 200000 : (20000000 / n < 200000 ? 20000000 / n : 200000);
+            if (quick) {
+                f.ops /= 10;
+            }
+            const char *variant = indexed ? "indexed" : "linear";
+            if (selected("isCarExists")) {
+                runCase("isCarExists", variant, n, -1, benchIsCarExists, &f);
+            }
+            if (selected("findCarPosition")) {
+                runCase("findCarPosition", variant, n, -1, benchFindCarPosition, &f);
+            }
+            teardownFixture(&f);
+        }
+    }
+}
+
+static void runLeaveCar(void) {
+    static const long sizes[] = { 10, 1000, 10000 };
+    if (!selected("leaveCar")) {
+        return;
+    }
+    setReceiptOutput(false);
+    for (int s = 0; s < 3; s++) {
+        long n = sizes[s];
+        if (quick && n > 1000) {
+            continue;
+        }
+        long depths[3] = { 0, n / 2, n - 1 }; // 栈顶、中间、栈底
+        for (int model = LOT_MODEL_STACK; model <= LOT_MODEL_BAYS; model++) {
+            for (int d = 0; d < 3; d++) {
+                Fixture f;
+                if (setupFixture(&f, n, (LotModel)model, true)) {
+                    fillLot(&f);
+                    f.depth = depths[d];
+                    // 栈模式每次离开要挪动depth辆车，按深度缩减操作次数
+                    f.ops = model == LOT_MODEL_STACK ? 2000000 / (depths[d] + 1) : 200000;
+                    if (f.ops > 200000) {
+                        f.ops = 200000;
+                    }
+                    if (f.ops < 20) {
+                        f.ops = 20;
+                    }
+                    if (quick) {
+                        f.ops = f.ops / 10 + 1;
+                    }
+                    runCase("leaveCar", model == LOT_MODEL_STACK ? "stack" : "bays", n, depths[d],
+                            benchLeaveCar, &f);
+                }
+                teardownFixture(&f);
+            }
+        }
+    }
+    setReceiptOutput(true);
+}
+
+static void runPlateValidation(void) {
+    if (!selected("isValidPlateNumber")) {
+        return;
+    }
+    PlateSet set;
+    set.count = 1024;
+    set.ops = quick ? 100000 : 1000000;
+    set.plates = malloc((size_t)set.count * sizeof(*set.plates));
+    if (set.plates == NULL) {
+        return;
+    }
+    // 四分之三有效，四分之一无效（小写、过短、缺少省份简称）
+    for (long i = 0; i < set.count; i++) {
+        makePlate(set.plates[i], i * 104729);
+        switch (i % 8) {
+            case 1: set.plates[i][3] = 'a'; break;
+            case 3: set.plates[i][6] = '\0'; break;
+            case 5: memmove(set.plates[i], set.plates[i] + 3, MAX_PLATE_LEN - 3); break;
+            default: break;
+        }
+        if (i % 16 == 7) {
+            snprintf(set.plates[i], MAX_PLATE_LEN, "粤B%05ldD", i % 100000); // 新能源车牌
+        }
+    }
+    runCase("isValidPlateNumber", "mixed", set.count, -1, benchIsValidPlate, &set);
+    free(set.plates);
+}
+
+// ---- 车牌尾部检查 / 车牌比较 ----
+
+typedef struct {
+    char (*plates)[MAX_PLATE_LEN];
+    size_t *lengths;
+    PackedPlate *packed;
+    long count;
+    long ops;
+    bool (*tailCheck)(const char *, size_t);
+} PlateOpsSet;
+
+static long benchPlateTail(void *ctx) {
+    PlateOpsSet *set = ctx;
+    long valid = 0;
+    for (long i = 0; i < set->ops; i++) {
+        long k = i % set->count;
+        valid += set->tailCheck(set->plates[k] + 4, set->lengths[k] - 4);
+    }
+    sink += (double)valid;
+    return set->ops;
+}
+
+static long benchPackedEquals(void *ctx) {
+    PlateOpsSet *set = ctx;
+    long equal = 0;
+    for (long i = 0; i < set->ops; i++) {
+        equal += set->packed[i % set->count] == set->packed[(i * 7) % set->count];
+    }
+    sink += (double)equal;
+    return set->ops;
+}
+
+static long benchComparePlateNumbers(void *ctx) {
+    PlateOpsSet *set = ctx;
+    long equal = 0;
+    for (long i = 0; i < set->ops; i++) {
+        equal += comparePlateNumbers(set->plates[i % set->count], set->plates[(i * 7) % set->count]);
+    }
+    sink += (double)equal;
+    return set->ops;
+}
+
+static void runPlateOps(void) {
+    PlateOpsSet set;
+    set.count = 1024;
+    set.ops = quick ? 100000 : 1000000;
+    set.plates = malloc((size_t)set.count * sizeof(*set.plates));
+    set.lengths = malloc((size_t)set.count * sizeof(size_t));
+    set.packed = malloc((size_t)set.count * sizeof(PackedPlate));
+    if (set.plates == NULL || set.lengths == NULL || set.packed == NULL) {
+        free(set.plates);
+        free(set.lengths);
+        free(set.packed);
+        return;
+    }
+    for (long i = 0; i < set.count; i++) {
+        makePlate(set.plates[i], i % 512 * 104729); // 每个车牌号出现两次，比较时有命中
+        set.lengths[i] = strlen(set.plates[i]);
+        set.packed[i] = encodePlate(set.plates[i], MAX_PLATE_LEN - 1);
+    }
+    if (selected("plateTailIsAlnum")) {
+        set.tailCheck = plateTailIsAlnumScalar;
+        runCase("plateTailIsAlnum", "scalar", set.count, -1, benchPlateTail, &set);
+        set.tailCheck = plateTailIsAlnumSwar;
+        runCase("plateTailIsAlnum", "swar", set.count, -1, benchPlateTail, &set);
+#ifdef __SSE2__
+        set.tailCheck = plateTailIsAlnumSse2;
+        runCase("plateTailIsAlnum", "sse2", set.count, -1, benchPlateTail, &set);
+#endif
+    }
+    if (selected("plateEquals")) {
+        runCase("plateEquals", "packed", set.count, -1, benchPackedEquals, &set);
+        runCase("plateEquals", "string", set.count, -1, benchComparePlateNumbers, &set);
+    }
+    free(set.plates);
+    free(set.lengths);
+    free(set.packed);
+}
+
+// ---- --verify-plates ----
+
+// 可复现的伪随机数（xorshift）
+static uint64_t verifyRandom(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// 核对一段尾部：各实现的结果必须与逐字节的参考实现一致
+static bool checkTail(const char *text, size_t length, long *checks) {
+    bool expected = plateTailIsAlnumScalar(text, length);
+    bool ok = plateTailIsAlnumSwar(text, length) == expected;
+#ifdef __SSE2__
+    ok = ok && plateTailIsAlnumSse2(text, length) == expected;
+#endif
+    ok = ok && plateTailIsAlnum(text, length) == expected;
+    (*checks)++;
+    if (!ok) {
+        fprintf(stderr, "尾部检查不一致: 长度 %zu, 参考结果 %d, 字节:", length, expected);
+        for (size_t i = 0; i < length; i++) {
+            fprintf(stderr, " %02X", (unsigned char)text[i]);
+        }
+        fprintf(stderr, "\n");
+    }
+    return ok;
+}
+
+static int verifyPlates(void) {
+    static const char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    // 区间边界附近的字节和非ASCII字节
+    static const unsigned char edges[] = { '/', '0', '9', ':', '@', 'A', 'Z', '[', 'a', 'z', 0x00, 0x7F, 0x80, 0xB0, 0xE4, 0xFF };
+    char text[MAX_PLATE_LEN];
+    long checks = 0;
+    long failures = 0;
+    uint64_t state = 0x2545F4914F6CDD1Dull;
+
+    // 每个长度、每个位置上的每个字节值（其余位置为有效字符）
+    for (size_t length = 0; length < MAX_PLATE_LEN; length++) {
+        for (size_t i = 0; i < length; i++) {
+            text[i] = alphabet[(i * 7) % 36];
+        }
+        failures += !checkTail(text, length, &checks);
+        for (size_t position = 0; position < length; position++) {
+            char saved = text[position];
+            for (int value = 0; value < 256; value++) {
+                text[position] = (char)value;
+                failures += !checkTail(text, length, &checks);
+            }
+            text[position] = saved;
+        }
+    }
+
+    // 随机组合：大部分为有效字符，夹杂边界字节
+    for (long n = 0; n < 1000000; n++) {
+        size_t length = (size_t)(verifyRandom(&state) % MAX_PLATE_LEN);
+        for (size_t i = 0; i < length; i++) {
+            uint64_t r = verifyRandom(&state);
+            text[i] = (r & 15) == 0 ? (char)edges[(r >> 4) % sizeof(edges)] : alphabet[(r >> 4) % 36];
+        }
+        failures += !checkTail(text, length, &checks);
+    }
+
+    // 压缩编码：还原后与原字符串逐字节相同，编码相等当且仅当字符串相等，按编码推断的车辆类别与按字符串相同
+    //（省份简称在表内或表外、尾部可打包或含小写字母和符号、长度跨过打包上限，经常出现相同或只差一个字符的车牌号）
+    static const char *const heads[] = { "", "京", "粤", "使", "港" };
+    static const char tails[] = "AB09Z";
+    for (long n = 0; n < 1000000; n++) {
+        char a[MAX_PLATE_LEN];
+        char b[MAX_PLATE_LEN];
+        uint64_t r = verifyRandom(&state);
+        size_t headLength = strlen(heads[r % 5]);
+        size_t lengthA = headLength + (size_t)((r >> 3) % (PLATE_PACKED_MAX_TAIL + 5));
+        memcpy(a, heads[r % 5], headLength);
+        for (size_t i = headLength; i < lengthA; i++) {
+            uint64_t c = verifyRandom(&state);
+            a[i] = (c & 63) == 0 ? "a-"[(c >> 6) & 1] : tails[(c >> 8) % 5];
+        }
+        a[lengthA] = '\0';
+        memcpy(b, a, sizeof(a));
+        if ((r >> 8) & 1 && lengthA > headLength) {
+            b[headLength + (r >> 9) % (lengthA - headLength)] = tails[(r >> 20) % 5];
+        }
+        if ((r >> 24) & 1) {
+            b[(r >> 25) % (lengthA + 1)] = '\0';
+        }
+
+        char decoded[MAX_PLATE_LEN];
+        PackedPlate packedA = encodePlate(a, MAX_PLATE_LEN - 1);
+        PackedPlate packedB = encodePlate(b, MAX_PLATE_LEN - 1);
+        size_t length = formatPlate(packedA, decoded, sizeof(decoded));
+        bool expected = strcmp(a, b) == 0;
+        checks++;
+        if (packedA == PLATE_NONE || length != strlen(a) || strcmp(decoded, a) != 0 ||
+            lookupPlate(a, MAX_PLATE_LEN - 1) != packedA || (packedA == packedB) != expected ||
+            comparePlateNumbers(a, b) != expected || classifyPlate(packedA) != classifyVehicle(a)) {
+            fprintf(stderr, "车牌编码不一致: \"%s\" \"%s\" -> \"%s\"\n", a, b, decoded);
+            failures++;
+        }
+    }
+
+#ifdef __SSE2__
+    const char *paths = "scalar/swar/sse2";
+#else
+    const char *paths = "scalar/swar";
+#endif
+    printf("{\"verify\":\"plates\",\"paths\":\"%s\",\"checks\":%ld,\"failures\":%ld}\n", paths, checks, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+// ---- 时间轮 ----
+
+// 已有 n 个计时器（到期时间分布在一天内）时，每次操作推进1秒、设置一个新计时器并取消一个旧计时器
+typedef struct {
+    TimerWheel wheel;
+    long n;
+    long ops;
+    long serial;      // 下一个计时器的车牌编号
+    long oldest;      // 最早设置、尚未取消的计时器编号
+    uint64_t state;
+} TimerSet;
+
+static PackedPlate timerPlate(long i) {
+    char plate[MAX_PLATE_LEN];
+    makePlate(plate, i);
+    return encodePlate(plate, MAX_PLATE_LEN - 1);
+}
+
+static long benchTimerChurn(void *ctx) {
+    TimerSet *set = ctx;
+    for (long i = 0; i < set->ops; i++) {
+        timerWheelAdvance(&set->wheel, set->wheel.now + 1);
+        time_t expires = set->wheel.now + 60 + (time_t)(verifyRandom(&set->state) % 86400);
+        timerWheelArm(&set->wheel, timerPlate(set->serial++), TIMER_MAX_STAY, expires);
+        timerWheelCancelAll(&set->wheel, timerPlate(set->oldest++));
+    }
+    sink += (double)set->wheel.count;
+    return set->ops;
+}
+
+static void runTimerWheel(void) {
+    static const long sizes[] = { 10, 1000, 100000 };
+    if (!selected("timerWheel")) {
+        return;
+    }
+    for (int s = 0; s < 3; s++) {
+        TimerSet set;
+        set.n = sizes[s];
+        set.ops = quick ? 100000 : 1000000;
+        set.serial = 0;
+        set.oldest = 0;
+        set.state = 0x9E3779B97F4A7C15ull;
+        if (initTimerWheel(&set.wheel, 1700000000, (int)set.n) != SUCCESS) {
+            continue;
+        }
+        // 取消的是最早设置的计时器，其中一部分已经触发，取消时找不到（与离场前已超时的车辆相同）
+        while (set.serial < set.n) {
+            time_t expires = set.wheel.now + 60 + (time_t)(verifyRandom(&set.state) % 86400);
+            timerWheelArm(&set.wheel, timerPlate(set.serial++), TIMER_MAX_STAY, expires);
+        }
+        runCase("timerWheel", "churn", set.n, -1, benchTimerChurn, &set);
+        freeTimerWheel(&set.wheel);
+    }
+}
+
+// ---- --verify-timers ----
+
+// 参考实现：逐个比较的计时器表
+typedef struct {
+    PackedPlate plate;
+    TimerKind kind;
+    time_t expires;
+    time_t armedAt;   // 设置时时间轮的当前时间
+    bool active;
+} ReferenceTimer;
+
+typedef struct {
+    ReferenceTimer *timers;
+    long count;
+    long failures;
+    const TimerWheel *wheel;
+} TimerCheck;
+
+// 到期回调：必须是参考表中尚未触发的计时器，在到期时间（设置时已到期的在下一秒）触发，且按时间顺序
+static void checkTimerFired(void *context, TimerKind kind, PackedPlate plate, time_t expires) {
+    TimerCheck *check = context;
+    for (long i = 0; i < check->count; i++) {
+        ReferenceTimer *t = &check->timers[i];
+        if (t->active && t->plate == plate && t->kind == kind) {
+            t->active = false;
+            time_t due = t->expires > t->armedAt ? t->expires : t->armedAt + 1;
+            if (t->expires != expires || check->wheel->now != due) {
+                fprintf(stderr, "计时器触发时间不一致: 到期 %lld/%lld，触发于 %lld\n", (long long)t->expires,
+                        (long long)expires, (long long)check->wheel->now);
+                check->failures++;
+            }
+            return;
+        }
+    }
+    fprintf(stderr, "触发了不存在的计时器\n");
+    check->failures++;
+}
+
+static int verifyTimers(void) {
+    enum { PLATES = 512 };
+    TimerWheel wheel;
+    TimerCheck check;
+    ReferenceTimer timers[PLATES * TIMER_KIND_COUNT];
+    PackedPlate plates[PLATES];
+    uint64_t state = 0x2545F4914F6CDD1Dull;
+    long checks = 0;
+
+    memset(&check, 0, sizeof(check));
+    memset(timers, 0, sizeof(timers));
+    check.timers = timers;
+    check.count = PLATES * TIMER_KIND_COUNT;
+    for (int i = 0; i < PLATES; i++) {
+        plates[i] = timerPlate(i);
+        for (int k = 0; k < TIMER_KIND_COUNT; k++) {
+            timers[i * TIMER_KIND_COUNT + k].plate = plates[i];
+            timers[i * TIMER_KIND_COUNT + k].kind = (TimerKind)k;
+        }
+    }
+    if (initTimerWheel(&wheel, 1700000000, 4) != SUCCESS) { // 故意从很小的节点池开始，覆盖扩容
+        return 1;
+    }
+    wheel.callback = checkTimerFired;
+    wheel.context = &check;
+    check.wheel = &wheel;
+
+    for (long n = 0; n < 200000; n++) {
+        uint64_t r = verifyRandom(&state);
+        ReferenceTimer *t = &timers[(r >> 8) % (PLATES * TIMER_KIND_COUNT)];
+        switch (r % 8) {
+            case 0:
+            case 1:
+            case 2: {
+                // 到期时间：已过期、几秒内、几小时内、几个月后或超出时间轮的范围
+                uint64_t d = verifyRandom(&state);
+                static const time_t spans[] = { 1, 64, 4096, 20000, 262144, 16777216, 100000000 };
+                time_t expires = wheel.now - 2 + (time_t)(d % (uint64_t)spans[(d >> 40) % 7]);
+                timerWheelArm(&wheel, t->plate, t->kind, expires);
+                t->active = true;
+                t->expires = expires;
+                t->armedAt = wheel.now;
+                break;
+            }
+            case 3: {
+                bool cancelled = timerWheelCancel(&wheel, t->plate, t->kind);
+                if (cancelled != t->active) {
+                    fprintf(stderr, "取消结果不一致\n");
+                    check.failures++;
+                }
+                t->active = false;
+                break;
+            }
+            case 4:
+                timerWheelCancelAll(&wheel, t->plate);
+                for (int k = 0; k < TIMER_KIND_COUNT; k++) {
+                    timers[(t - timers) / TIMER_KIND_COUNT * TIMER_KIND_COUNT + k].active = false;
+                }
+                break;
+            default: {
+                // 推进：大多数几秒，偶尔跳过几小时到几个月
+                uint64_t d = verifyRandom(&state);
+                static const time_t jumps[] = { 2, 8, 70, 5000, 300000, 20000000 };
+                timerWheelAdvance(&wheel, wheel.now + (time_t)(d % (uint64_t)jumps[(d >> 40) % 6]));
+                // 推进后参考表中到期时间不晚于当前时间、且设置时尚未到期的计时器都应已触发
+                long active = 0;
+                for (long i = 0; i < check.count; i++) {
+                    if (!timers[i].active) {
+                        continue;
+                    }
+                    active++;
+                    if (timers[i].expires <= wheel.now && timers[i].expires > timers[i].armedAt) {
+                        fprintf(stderr, "计时器没有按时触发: %lld <= %lld\n", (long long)timers[i].expires,
+                                (long long)wheel.now);
+                        check.failures++;
+                        timers[i].active = false;
+                    } else if (timers[i].expires <= timers[i].armedAt && wheel.now > timers[i].armedAt) {
+                        fprintf(stderr, "已过期的计时器没有在下一秒触发\n");
+                        check.failures++;
+                        timers[i].active = false;
+                    }
+                }
+                if (active != (long)wheel.count) {
+                    fprintf(stderr, "计时器数量不一致: %ld != %u\n", active, wheel.count);
+                    check.failures++;
+                }
+                checks++;
+                break;
+            }
+        }
+    }
+    freeTimerWheel(&wheel);
+    printf("{\"verify\":\"timers\",\"checks\":%ld,\"failures\":%ld}\n", checks, check.failures);
+    return check.failures == 0 ? 0 : 1;
+}
+
+// ---- 优先级便道 ----
+
+// 写一个便道优先级文件：前 count 个车牌号中每4辆有3辆登记为月租、充电或无障碍车辆
+static bool writeSampleLanePolicy(const char *path, long count) {
+    static const char *classes[] = { "permit", "charger", "accessible" };
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fputs("[boost]\npermit = 30\ncharger = 15\naccessible = 60\n[vehicles]\n", file);
+    for (long i = 0; i < count; i++) {
+        if (i % 4 != 0) {
+            char plate[MAX_PLATE_LEN];
+            makePlate(plate, i);
+            fprintf(file, "%s = %s\n", plate, classes[i % 4 - 1]);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+// 每秒到达一辆车，再按车牌号取消每8辆中的1辆（未入场离开），其余按优先级出队
+static long benchLaneCancel(void *ctx) {
+    Fixture *f = ctx;
+    time_t base = 1700000000;
+    for (long i = 0; i < f->n; i++) {
+        Car car = createCar(f->plates[i]);
+        car.arriveTime = base + (time_t)i;
+        enqueue(&f->lane, car);
+    }
+    long ops = f->n;
+    for (long i = 3; i < f->n; i += 8) {
+        int position = findQueuePosition(&f->lane, lookupPlate(f->plates[i], MAX_PLATE_LEN - 1));
+        if (position >= 0) {
+            Car car = removeQueueAt(&f->lane, position);
+            sink += (double)car.arriveTime;
+            ops++;
+        }
+    }
+    while (!isQueueEmpty(&f->lane)) {
+        Car car = dequeue(&f->lane);
+        sink += (double)car.arriveTime;
+        ops++;
+    }
+    return ops;
+}
+
+static void runLanePriority(void) {
+    static const long sizes[] = { 10, 1000, 100000 };
+    if (!selected("lane_cancel")) {
+        return;
+    }
+    char policyPath[300];
+    snprintf(policyPath, sizeof(policyPath), "%s.lane", statePath);
+    LanePolicy policy;
+    initLanePolicy(&policy);
+    if (!writeSampleLanePolicy(policyPath, 4096) || !loadLanePolicy(&policy, policyPath)) {
+        remove(policyPath);
+        return;
+    }
+    remove(policyPath);
+
+    for (int s = 0; s < 3; s++) {
+        long n = sizes[s];
+        if (quick && n > 1000) {
+            continue;
+        }
+        Fixture f;
+        // 先进先出便道按车牌取消需要移动后面的车辆，只测较小的规模
+        if (n <= 1000) {
+            setActiveLanePolicy(NULL);
+            if (setupFixture(&f, n, LOT_MODEL_STACK, true)) {
+                runCase("lane_cancel", "fifo", n, -1, benchLaneCancel, &f);
+            }
+            teardownFixture(&f);
+        }
+        setActiveLanePolicy(&policy);
+        if (setupFixture(&f, n, LOT_MODEL_STACK, true)) {
+            runCase("lane_cancel", "priority", n, -1, benchLaneCancel, &f);
+        }
+        teardownFixture(&f);
+        setActiveLanePolicy(NULL);
+    }
+    freeLanePolicy(&policy);
+}
+
+// ---- --verify-lane ----
+
+// 参考实现：逐个比较的便道
+typedef struct {
+    Car car;
+    int id;           // 车牌号编号
+    int64_t key;
+    uint64_t seq;
+} ReferenceLaneCar;
+
+static bool referenceBefore(const ReferenceLaneCar *a, const ReferenceLaneCar *b) {
+    return a->key < b->key || (a->key == b->key && a->seq < b->seq);
+}
+
+// 参考实现中下一辆出队的车辆
+static long referenceHead(const ReferenceLaneCar *cars, long count) {
+    long best = -1;
+    for (long i = 0; i < count; i++) {
+        if (best < 0 || referenceBefore(&cars[i], &cars[best])) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static int verifyLane(void) {
+    enum { PLATES = 600 };
+    char plates[PLATES][MAX_PLATE_LEN];
+    bool waiting[PLATES];
+    ReferenceLaneCar reference[PLATES];
+    long count = 0;
+    uint64_t seq = 0;
+    uint64_t state = 0x5851F42D4C957F2Dull;
+    long checks = 0;
+    long failures = 0;
+
+    char policyPath[300];
+    snprintf(policyPath, sizeof(policyPath), "%s.lane", statePath);
+    LanePolicy policy;
+    initLanePolicy(&policy);
+    bool loaded = writeSampleLanePolicy(policyPath, PLATES / 2); // 后一半车牌未登记，按普通车辆排队
+    loaded = loaded && loadLanePolicy(&policy, policyPath);
+    remove(policyPath);
+    if (!loaded) {
+        return 1;
+    }
+
+    PlateIndex index;
+    WaitingQueue lane;
+    ParkingStack lot;
+    if (initPlateIndex(&index, PLATES * 2) != SUCCESS || initStack(&lot, 1) != SUCCESS) {
+        return 1;
+    }
+    setActiveLanePolicy(&policy);
+    initQueue(&lane);
+    attachPlateIndex(&lot, &lane, &index);
+    for (int i = 0; i < PLATES; i++) {
+        makePlate(plates[i], i);
+        waiting[i] = false;
+    }
+
+    time_t now = 1700000000;
+    for (long n = 0; n < 200000; n++) {
+        uint64_t r = verifyRandom(&state);
+        now += (time_t)(r >> 48) % 300;
+        int p = (int)((r >> 8) % PLATES);
+        switch (r % 8) {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+                // 到达：已在便道上的车辆不再入队
+                if (!waiting[p]) {
+                    Car car = createCar(plates[p]);
+                    car.arriveTime = now;
+                    if (enqueue(&lane, car) != SUCCESS) {
+                        failures++;
+                        break;
+                    }
+                    reference[count].car = car;
+                    reference[count].id = p;
+                    reference[count].key = (int64_t)now - policy.boostSeconds[laneClassOf(&policy, car.plate)];
+                    reference[count].seq = seq++;
+                    count++;
+                    waiting[p] = true;
+                }
+                break;
+            case 4:
+            case 5: {
+                long head = referenceHead(reference, count);
+                Car car = dequeue(&lane);
+                if (head < 0 ? car.plate != PLATE_NONE : car.plate != reference[head].car.plate) {
+                    fprintf(stderr, "出队车辆不一致\n");
+                    failures++;
+                }
+                if (head >= 0) {
+                    waiting[reference[head].id] = false;
+                    reference[head] = reference[--count];
+                }
+                break;
+            }
+            default: {
+                // 未入场离开：按车牌号取消，不在便道上时应找不到
+                int position = findQueuePosition(&lane, lookupPlate(plates[p], MAX_PLATE_LEN - 1));
+                if ((position >= 0) != waiting[p]) {
+                    fprintf(stderr, "便道查找结果不一致: %s\n", plates[p]);
+                    failures++;
+                    break;
+                }
+                if (position >= 0) {
+                    Car car = removeQueueAt(&lane, position);
+                    if (car.plate != lookupPlate(plates[p], MAX_PLATE_LEN - 1)) {
+                        fprintf(stderr, "取消的车辆不一致: %s\n", plates[p]);
+                        failures++;
+                    }
+                    for (long i = 0; i < count; i++) {
+                        if (reference[i].car.plate == car.plate) {
+                            reference[i] = reference[--count];
+                            break;
+                        }
+                    }
+                    waiting[p] = false;
+                }
+                break;
+            }
+        }
+
+        // 每隔一段核对完整的出队顺序和索引中记录的堆下标
+        if (n % 64 == 0) {
+            if (getQueueCount(&lane) != count) {
+                fprintf(stderr, "便道车辆数不一致: %d != %ld\n", getQueueCount(&lane), count);
+                failures++;
+            }
+            int *order = queuePromotionOrder(&lane);
+            bool used[PLATES];
+            memset(used, 0, sizeof(used));
+            for (long i = 0; i < count && order != NULL; i++) {
+                long expected = -1;
+                for (long j = 0; j < count; j++) {
+                    if (!used[j] && (expected < 0 || referenceBefore(&reference[j], &reference[expected]))) {
+                        expected = j;
+                    }
+                }
+                used[expected] = true;
+                if (queueAt(&lane, order[i])->plate != reference[expected].car.plate) {
+                    fprintf(stderr, "便道出队顺序不一致（第 %ld 位）\n", i);
+                    failures++;
+                    break;
+                }
+            }
+            free(order);
+            for (int i = 0; i < getQueueCount(&lane); i++) {
+                PlateIndexEntry *entry = plateIndexFind(&index, queueAt(&lane, i)->plate);
+                if (entry == NULL || entry->location != PLATE_IN_LANE || entry->slot != i) {
+                    fprintf(stderr, "索引中的便道下标不一致\n");
+                    failures++;
+                    break;
+                }
+            }
+            checks++;
+        }
+    }
+
+    attachPlateIndex(&lot, &lane, NULL);
+    clearQueue(&lane);
+    freeStack(&lot);
+    freePlateIndex(&index);
+    setActiveLanePolicy(NULL);
+    freeLanePolicy(&policy);
+    printf("{\"verify\":\"lane\",\"checks\":%ld,\"failures\":%ld}\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+// 写一个按时段计费的示例方案文件
+static bool writeSampleTariff(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fputs("[standard]\n"
+          "free_minutes = 15\n"
+          "billing_unit = 30\n"
+          "daily_cap = 80\n"
+          "rate = all 00:00-24:00 10\n"
+          "rate = weekday 20:00-08:00 4\n"
+          "rate = weekend 00:00-24:00 6\n"
+          "[new_energy]\n"
+          "free_minutes = 60\n"
+          "rate = all 00:00-24:00 5\n", file);
+    return fclose(file) == 0;
+}
+
+static void runCalculateFee(void) {
+    if (!selected("calculateFee")) {
+        return;
+    }
+    FeeSet set;
+    set.count = 4096;
+    set.ops = quick ? 100000 : 1000000;
+    set.cars = malloc((size_t)set.count * sizeof(Car));
+    if (set.cars == NULL) {
+        return;
+    }
+    // 停车时长从几分钟到三天不等
+    time_t base = 1700000000;
+    for (long i = 0; i < set.count; i++) {
+        char plate[MAX_PLATE_LEN];
+        makePlate(plate, i);
+        set.cars[i] = createCar(plate);
+        set.cars[i].arriveTime = base + (time_t)(i * 977 % 604800);
+        set.cars[i].leaveTime = set.cars[i].arriveTime + (time_t)(i * 7919 % 259200) + 60;
+    }
+
+    set.tariff = NULL;
+    runCase("calculateFee", "builtin", set.count, -1, benchCalculateFee, &set);
+
+    Tariff tariff;
+    if (initFlatTariff(&tariff, HOURLY_RATE) == SUCCESS) {
+        set.tariff = &tariff;
+        runCase("calculateFee", "flat", set.count, -1, benchCalculateFee, &set);
+        freeTariff(&tariff);
+    }
+
+    char tariffPath[300];
+    snprintf(tariffPath, sizeof(tariffPath), "%s.tariff", statePath);
+    if (writeSampleTariff(tariffPath) && loadTariff(&tariff, tariffPath, HOURLY_RATE)) {
+        set.tariff = &tariff;
+        runCase("calculateFee", "time_of_use", set.count, -1, benchCalculateFee, &set);
+        freeTariff(&tariff);
+    }
+    remove(tariffPath);
+    free(set.cars);
+}
+
+static void runPersistence(void) {
+    static const long sizes[] = { 10, 1000, 100000 };
+    for (int s = 0; s < 3; s++) {
+        long n = sizes[s];
+        if (quick && n > 1000) {
+            continue;
+        }
+        Fixture f;
+        if (!setupFixture(&f, n, LOT_MODEL_STACK, true)) {
+            teardownFixture(&f);
+            continue;
+        }
+        fillLot(&f);
+        if (selected("saveSystemState")) {
+            runCase("saveSystemState", "fsync", n, -1, benchSave, &f);
+        }
+        if (selected("loadSystemState") && benchSave(&f) == 1) {
+            runCase("loadSystemState", "indexed", n, -1, benchLoad, &f);
+        }
+        teardownFixture(&f);
+    }
+    remove(statePath);
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+            reps = 3;
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+            if (reps < 1 || reps > MAX_REPS) {
+                fprintf(stderr, "--reps 取值范围 1-%d\n", MAX_REPS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--state-file") == 0 && i + 1 < argc) {
+            statePath = argv[++i];
+        } else if (strcmp(argv[i], "--verify-plates") == 0) {
+            return verifyPlates();
+        } else if (strcmp(argv[i], "--verify-timers") == 0) {
+            return verifyTimers();
+        } else if (strcmp(argv[i], "--verify-lane") == 0) {
+            return verifyLane();
+        } else {
+            fprintf(stderr, "用法: %s [--quick] [--reps N] [--filter 名称] [--state-file 路径] [--verify-plates] [--verify-timers] [--verify-lane]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    runStackQueue();
+    runCommandRing();
+    runLookups();
+    runLeaveCar();
+    runPlateValidation();
+    runPlateOps();
+    runCalculateFee();
+    runTimerWheel();
+    runLanePriority();
+    runPersistence();
+    return 0;
+}
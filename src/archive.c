@@ -0,0 +1,1099 @@
+#include "archive.h"
+#include "byte_order.h"
+#include "crc32.h"
+#include "plate_index.h"
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// 归档目录中的文件：
+//   current.bpt          当天的追加文件：文件头16字节 + 每条会话64字节
+//   segment-NNNNNN.bpa   封存的段文件，编号从1开始连续递增，一天一个段
+//
+// 追加文件头：标识 8字节 "BPTAIL\r\n"，段编号 u32（这些会话封存后使用的编号），文件头CRC32 u32
+// 追加文件记录（小端序）：
+//   0  日志序列号  u64        24  费用（分）  i32
+//   8  到达时间    i64        28  车牌长度    u8，之后为车牌号（不含结尾0）
+//  16  离开时间    i64        60  CRC32       u32，覆盖前60字节
+//
+// 段文件头（64字节）：
+//   0  标识          8字节 "BPARCH\r\n"
+//   8  版本          u16
+//  10  文件头长度    u16
+//  12  会话数        u32
+//  16  最早离开时间  i64
+//  24  最晚离开时间  i64
+//  32  最大日志序列号 u64
+//  40  总费用（分）  i64
+//  48  车牌前缀数    u32
+//  52  日期          u32，YYYYMMDD
+//  56  数据区CRC32   u32，覆盖文件头之后的全部字节
+//  60  文件头CRC32   u32，覆盖前60字节
+//
+// 数据区：各列的字节数（每列一个 u32，版本1为6列，版本2为7列），之后依次是各列：
+//   前缀字典  每项为长度 u8 + 字节（车牌开头的省份简称和发牌机关字母，如“京A”）
+//   离开时间  与上一条的差值（第一条与最早离开时间的差值），zigzag变长整数
+//   停车时长  离开时间减到达时间（秒），zigzag变长整数
+//   费用      定点数（分），zigzag变长整数
+//   前缀编号  字典下标，变长整数
+//   车牌后缀  长度 u8 + 前缀之后的字节
+//   车牌过滤器（版本2起）  布隆过滤器位图，每条会话10位，7个哈希位置由车牌的两个FNV-1a哈希
+//             按 h1 + i*h2 生成；查询某个车牌时不含它的段只读取这一列
+//
+// 同一天的离开时间基本递增，差值通常只占1-2个字节；统计收入和时长只需要解码前三个数值列，
+// 不触及车牌列。封存后的段只读，查询时先看文件头中的时间范围，不相交的段不读取数据区。
+#define TAIL_FILE "current.bpt"
+#define TAIL_HEADER_SIZE 16
+
+#define SEG_OFF_VERSION      8
+#define SEG_OFF_HEADER_SIZE  10
+#define SEG_OFF_ROW_COUNT    12
+#define SEG_OFF_MIN_LEAVE    16
+#define SEG_OFF_MAX_LEAVE    24
+#define SEG_OFF_MAX_SEQ      32
+#define SEG_OFF_TOTAL_FEE    40
+#define SEG_OFF_DICT_COUNT   48
+#define SEG_OFF_DAY          52
+#define SEG_OFF_BODY_CRC     56
+#define SEG_OFF_HEADER_CRC   60
+
+// 数据区中的列
+enum {
+    COLUMN_DICT = 0,
+    COLUMN_LEAVE,
+    COLUMN_DWELL,
+    COLUMN_FEE,
+    COLUMN_PREFIX,
+    COLUMN_SUFFIX,
+    COLUMN_FILTER,
+    COLUMN_COUNT
+};
+
+// 版本1的段没有车牌过滤器列
+static int columnCount(uint16_t version) {
+    return version >= 2 ? COLUMN_COUNT : COLUMN_FILTER;
+}
+
+#define FILTER_BITS_PER_ROW 10
+#define FILTER_HASHES 7
+
+#define VARINT_MAX 10
+
+// 创建归档目录（已存在时成功）
+static bool makeArchiveDir(const char *path) {
+#ifdef _WIN32
+    int result = _mkdir(path);
+#else
+    int result = mkdir(path, 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+static void segmentPath(const char *dir, int number, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s/segment-%06d.bpa", dir, number);
+}
+
+static void tailPath(const char *dir, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s/%s", dir, TAIL_FILE);
+}
+
+// 日期（本地时间）YYYYMMDD
+int archiveDayOf(time_t t) {
+    struct tm info;
+#ifdef _WIN32
+    localtime_s(&info, &t);
+#else
+    localtime_r(&t, &info);
+#endif
+    return (info.tm_year + 1900) * 10000 + (info.tm_mon + 1) * 100 + info.tm_mday;
+}
+
+// 车牌前缀的字节数：开头的非ASCII字符（省份简称）及其后的一个字母；ASCII开头时为第一个字符
+static size_t platePrefixLength(const char *plate, size_t length) {
+    unsigned char lead = (unsigned char)plate[0];
+    size_t prefix = 1;
+    if (lead >= 0xF0) {
+        prefix = 4;
+    } else if (lead >= 0xE0) {
+        prefix = 3;
+    } else if (lead >= 0xC0) {
+        prefix = 2;
+    }
+    if (lead >= 0x80 && prefix < length && ((plate[prefix] >= 'A' && plate[prefix] <= 'Z') ||
+                                            (plate[prefix] >= 'a' && plate[prefix] <= 'z'))) {
+        prefix++;
+    }
+    return prefix < length ? prefix : length;
+}
+
+// ---- 车牌过滤器 ----
+
+static size_t filterBytes(uint32_t rows) {
+    size_t bits = (size_t)rows * FILTER_BITS_PER_ROW;
+    return (bits < 64 ? 64 : bits + 7) / 8;
+}
+
+// 两个不同初值的FNV-1a哈希（属于磁盘格式，不能随车牌索引的哈希函数改变）
+static void filterHashes(const char *plateNumber, uint32_t *h1, uint32_t *h2) {
+    uint32_t a = 2166136261u;
+    uint32_t b = 0x9747B28Cu;
+    for (const unsigned char *p = (const unsigned char *)plateNumber; *p != '\0'; p++) {
+        a = (a ^ *p) * 16777619u;
+        b = (b ^ *p) * 16777619u;
+    }
+    *h1 = a;
+    *h2 = b | 1u;
+}
+
+static void filterAdd(unsigned char *bits, size_t bytes, const char *plateNumber) {
+    uint32_t h1, h2;
+    filterHashes(plateNumber, &h1, &h2);
+    uint64_t m = (uint64_t)bytes * 8;
+    for (uint32_t i = 0; i < FILTER_HASHES; i++) {
+        uint64_t bit = (h1 + (uint64_t)i * h2) % m;
+        bits[bit / 8] |= (unsigned char)(1u << (bit % 8));
+    }
+}
+
+static bool filterMayContain(const unsigned char *bits, size_t bytes, const char *plateNumber) {
+    uint32_t h1, h2;
+    filterHashes(plateNumber, &h1, &h2);
+    uint64_t m = (uint64_t)bytes * 8;
+    for (uint32_t i = 0; i < FILTER_HASHES; i++) {
+        uint64_t bit = (h1 + (uint64_t)i * h2) % m;
+        if ((bits[bit / 8] & (1u << (bit % 8))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---- 追加文件 ----
+
+static int64_t feeToFen(double fee) {
+    return (int64_t)(fee * 100.0 + (fee >= 0 ? 0.5 : -0.5));
+}
+
+static void encodeTailRow(unsigned char *p, const ArchivedSession *session) {
+    memset(p, 0, ARCHIVE_ROW_SIZE);
+    size_t len = strnlen(session->car.plateNumber, MAX_PLATE_LEN - 1);
+    putU64(p, session->seq);
+    putU64(p + 8, (uint64_t)(int64_t)session->car.arriveTime);
+    putU64(p + 16, (uint64_t)(int64_t)session->car.leaveTime);
+    putU32(p + 24, (uint32_t)(int32_t)session->feeFen);
+    p[28] = (unsigned char)len;
+    memcpy(p + 29, session->car.plateNumber, len);
+    putU32(p + 60, crc32Update(0, p, 60));
+}
+
+static bool decodeTailRow(const unsigned char *p, ArchivedSession *session) {
+    if (getU32(p + 60) != crc32Update(0, p, 60) || p[28] == 0 || p[28] >= MAX_PLATE_LEN) {
+        return false;
+    }
+    memset(session, 0, sizeof(ArchivedSession));
+    session->seq = getU64(p);
+    session->car.arriveTime = (time_t)(int64_t)getU64(p + 8);
+    session->car.leaveTime = (time_t)(int64_t)getU64(p + 16);
+    session->feeFen = (int32_t)getU32(p + 24);
+    memcpy(session->car.plateNumber, p + 29, p[28]);
+    return true;
+}
+
+static void encodeTailHeader(unsigned char *p, int segmentNumber) {
+    memcpy(p, ARCHIVE_TAIL_MAGIC, 8);
+    putU32(p + 8, (uint32_t)segmentNumber);
+    putU32(p + 12, crc32Update(0, p, 12));
+}
+
+// 读取追加文件：返回文件头中的段编号（无效时为0），有效记录交给visitor，trailing 表示末尾有残缺或损坏的数据
+static int readTail(const char *path, ArchiveVisitor visitor, void *context, bool *trailing) {
+    *trailing = false;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    unsigned char buf[ARCHIVE_ROW_SIZE];
+    int segmentNumber = 0;
+    if (fread(buf, 1, TAIL_HEADER_SIZE, file) == TAIL_HEADER_SIZE && memcmp(buf, ARCHIVE_TAIL_MAGIC, 8) == 0 &&
+        getU32(buf + 12) == crc32Update(0, buf, 12)) {
+        segmentNumber = (int)getU32(buf + 8);
+    }
+    if (segmentNumber <= 0) {
+        *trailing = true;
+        fclose(file);
+        return 0;
+    }
+    ArchivedSession session;
+    size_t n;
+    while ((n = fread(buf, 1, ARCHIVE_ROW_SIZE, file)) > 0) {
+        if (n != ARCHIVE_ROW_SIZE || !decodeTailRow(buf, &session)) {
+            *trailing = true;
+            break;
+        }
+        if (visitor != NULL && !visitor(&session, context)) {
+            break;
+        }
+    }
+    fclose(file);
+    return segmentNumber;
+}
+
+// 用内存中的会话重写追加文件（写临时文件再替换），然后以追加方式重新打开
+static int rewriteTail(SessionArchive *archive) {
+    char path[300];
+    char tempPath[310];
+    tailPath(archive->dir, path, sizeof(path));
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    if (archive->tail != NULL) {
+        fclose(archive->tail);
+        archive->tail = NULL;
+    }
+    FILE *file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        return ERR_IO;
+    }
+    unsigned char buf[ARCHIVE_ROW_SIZE];
+    encodeTailHeader(buf, archive->segmentNumber);
+    bool ok = fwrite(buf, 1, TAIL_HEADER_SIZE, file) == TAIL_HEADER_SIZE;
+    for (int i = 0; ok && i < archive->rowCount; i++) {
+        encodeTailRow(buf, &archive->rows[i]);
+        ok = fwrite(buf, 1, ARCHIVE_ROW_SIZE, file) == ARCHIVE_ROW_SIZE;
+    }
+    ok = flushFileToDisk(file) && ok;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || !replaceFile(tempPath, path)) {
+        return ERR_IO;
+    }
+    archive->tail = fopen(path, "ab");
+    return archive->tail != NULL ? SUCCESS : ERR_IO;
+}
+
+// ---- 段文件 ----
+
+// 读取段文件头，校验后填写摘要；day 可为NULL
+static bool decodeSegmentHeader(const unsigned char *p, ArchiveSegmentInfo *info, int *day) {
+    if (memcmp(p, ARCHIVE_SEGMENT_MAGIC, 8) != 0 || getU32(p + SEG_OFF_HEADER_CRC) != crc32Update(0, p, 60) ||
+        getU16(p + SEG_OFF_VERSION) > ARCHIVE_VERSION || getU16(p + SEG_OFF_HEADER_SIZE) != ARCHIVE_HEADER_SIZE) {
+        return false;
+    }
+    info->version = getU16(p + SEG_OFF_VERSION);
+    info->rowCount = getU32(p + SEG_OFF_ROW_COUNT);
+    info->minLeave = (int64_t)getU64(p + SEG_OFF_MIN_LEAVE);
+    info->maxLeave = (int64_t)getU64(p + SEG_OFF_MAX_LEAVE);
+    info->maxSeq = getU64(p + SEG_OFF_MAX_SEQ);
+    info->totalFeeFen = (int64_t)getU64(p + SEG_OFF_TOTAL_FEE);
+    if (day != NULL) {
+        *day = (int)getU32(p + SEG_OFF_DAY);
+    }
+    return true;
+}
+
+// 只读取段文件头（文件不存在返回false，损坏时 corrupt 为true）
+static bool readSegmentHeader(const char *path, ArchiveSegmentInfo *info, bool *corrupt) {
+    *corrupt = false;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    unsigned char header[ARCHIVE_HEADER_SIZE];
+    *corrupt = fread(header, 1, ARCHIVE_HEADER_SIZE, file) != ARCHIVE_HEADER_SIZE ||
+               !decodeSegmentHeader(header, info, NULL);
+    fclose(file);
+    return true;
+}
+
+// 整体读入段文件
+static unsigned char *readSegmentFile(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        length = ftell(file);
+    }
+    unsigned char *data = NULL;
+    if (length >= ARCHIVE_HEADER_SIZE && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char *)malloc((size_t)length);
+        if (data != NULL && fread(data, 1, (size_t)length, file) != (size_t)length) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+}
+
+// 解码中的段：各列的读取位置
+typedef struct {
+    ArchiveSegmentInfo info;
+    int day;
+    const unsigned char *column[COLUMN_COUNT];
+    const unsigned char *columnEnd[COLUMN_COUNT];
+    char (*dict)[MAX_PLATE_LEN];     // 前缀字典（只在需要车牌时解码）
+    uint8_t *dictLength;
+    uint32_t dictCount;
+} SegmentReader;
+
+// 校验整个段并定位各列
+static bool openSegment(const unsigned char *data, size_t size, SegmentReader *reader) {
+    memset(reader, 0, sizeof(SegmentReader));
+    if (size < ARCHIVE_HEADER_SIZE || !decodeSegmentHeader(data, &reader->info, &reader->day)) {
+        return false;
+    }
+    int columns = columnCount(reader->info.version);
+    if (size < ARCHIVE_HEADER_SIZE + (size_t)columns * 4 ||
+        getU32(data + SEG_OFF_BODY_CRC) != crc32Update(0, data + ARCHIVE_HEADER_SIZE, size - ARCHIVE_HEADER_SIZE)) {
+        return false;
+    }
+    reader->dictCount = getU32(data + SEG_OFF_DICT_COUNT);
+    const unsigned char *p = data + ARCHIVE_HEADER_SIZE + columns * 4;
+    const unsigned char *end = data + size;
+    for (int c = 0; c < columns; c++) {
+        uint32_t length = getU32(data + ARCHIVE_HEADER_SIZE + c * 4);
+        if (length > (size_t)(end - p)) {
+            return false;
+        }
+        reader->column[c] = p;
+        reader->columnEnd[c] = p + length;
+        p += length;
+    }
+    return p == end;
+}
+
+// 解码前缀字典
+static bool loadSegmentDict(SegmentReader *reader) {
+    if (reader->dictCount == 0) {
+        return true;
+    }
+    reader->dict = malloc((size_t)reader->dictCount * MAX_PLATE_LEN);
+    reader->dictLength = malloc(reader->dictCount);
+    if (reader->dict == NULL || reader->dictLength == NULL) {
+        return false;
+    }
+    const unsigned char *p = reader->column[COLUMN_DICT];
+    const unsigned char *end = reader->columnEnd[COLUMN_DICT];
+    for (uint32_t i = 0; i < reader->dictCount; i++) {
+        if (p >= end || *p >= MAX_PLATE_LEN || (size_t)(end - p) < 1u + *p) {
+            return false;
+        }
+        reader->dictLength[i] = *p;
+        memcpy(reader->dict[i], p + 1, *p);
+        p += 1 + *p;
+    }
+    return true;
+}
+
+static void closeSegment(SegmentReader *reader) {
+    free(reader->dict);
+    free(reader->dictLength);
+    reader->dict = NULL;
+    reader->dictLength = NULL;
+}
+
+// 解码下一条会话；withPlate 为false时跳过车牌列（统计收入和时长时不需要）
+static bool nextSession(SegmentReader *reader, int64_t *previousLeave, bool withPlate, ArchivedSession *session) {
+    uint64_t delta, dwell, fee;
+    if (!getVarint(&reader->column[COLUMN_LEAVE], reader->columnEnd[COLUMN_LEAVE], &delta) ||
+        !getVarint(&reader->column[COLUMN_DWELL], reader->columnEnd[COLUMN_DWELL], &dwell) ||
+        !getVarint(&reader->column[COLUMN_FEE], reader->columnEnd[COLUMN_FEE], &fee)) {
+        return false;
+    }
+    *previousLeave += unzigzag(delta);
+    session->seq = 0;
+    session->car.leaveTime = (time_t)*previousLeave;
+    session->car.arriveTime = (time_t)(*previousLeave - unzigzag(dwell));
+    session->feeFen = unzigzag(fee);
+    if (!withPlate) {
+        return true;
+    }
+
+    uint64_t id;
+    const unsigned char **suffix = &reader->column[COLUMN_SUFFIX];
+    if (!getVarint(&reader->column[COLUMN_PREFIX], reader->columnEnd[COLUMN_PREFIX], &id) || id >= reader->dictCount ||
+        *suffix >= reader->columnEnd[COLUMN_SUFFIX]) {
+        return false;
+    }
+    size_t prefixLength = reader->dictLength[id];
+    size_t suffixLength = **suffix;
+    if (prefixLength + suffixLength >= MAX_PLATE_LEN ||
+        (size_t)(reader->columnEnd[COLUMN_SUFFIX] - *suffix) < 1 + suffixLength) {
+        return false;
+    }
+    memcpy(session->car.plateNumber, reader->dict[id], prefixLength);
+    memcpy(session->car.plateNumber + prefixLength, *suffix + 1, suffixLength);
+    session->car.plateNumber[prefixLength + suffixLength] = '\0';
+    *suffix += 1 + suffixLength;
+    return true;
+}
+
+// 把会话按列编码为段文件内容
+static unsigned char *encodeSegment(const ArchivedSession *rows, int count, int day, size_t *size) {
+    size_t limits[COLUMN_COUNT] = {
+        (size_t)count * MAX_PLATE_LEN, (size_t)count * VARINT_MAX, (size_t)count * VARINT_MAX,
+        (size_t)count * VARINT_MAX, (size_t)count * VARINT_MAX, (size_t)count * MAX_PLATE_LEN,
+        filterBytes((uint32_t)count)
+    };
+    size_t total = 0;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        total += limits[c];
+    }
+    unsigned char *scratch = malloc(total);
+    PlateIndex dict;
+    if (scratch == NULL || initPlateIndex(&dict, 64) != SUCCESS) {
+        free(scratch);
+        return NULL;
+    }
+
+    unsigned char *column[COLUMN_COUNT];
+    size_t used[COLUMN_COUNT] = {0};
+    column[0] = scratch;
+    for (int c = 1; c < COLUMN_COUNT; c++) {
+        column[c] = column[c - 1] + limits[c - 1];
+    }
+    memset(column[COLUMN_FILTER], 0, limits[COLUMN_FILTER]);
+    used[COLUMN_FILTER] = limits[COLUMN_FILTER];
+
+    int64_t minLeave = (int64_t)rows[0].car.leaveTime;
+    int64_t maxLeave = minLeave;
+    uint64_t maxSeq = 0;
+    int64_t totalFee = 0;
+    for (int i = 0; i < count; i++) {
+        int64_t leave = (int64_t)rows[i].car.leaveTime;
+        minLeave = leave < minLeave ? leave : minLeave;
+        maxLeave = leave > maxLeave ? leave : maxLeave;
+        maxSeq = rows[i].seq > maxSeq ? rows[i].seq : maxSeq;
+        totalFee += rows[i].feeFen;
+    }
+
+    int64_t previousLeave = minLeave;
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        const ArchivedCar *car = &rows[i].car;
+        int64_t leave = (int64_t)car->leaveTime;
+        used[COLUMN_LEAVE] += putVarint(column[COLUMN_LEAVE] + used[COLUMN_LEAVE], zigzag(leave - previousLeave));
+        used[COLUMN_DWELL] += putVarint(column[COLUMN_DWELL] + used[COLUMN_DWELL], zigzag(leave - (int64_t)car->arriveTime));
+        used[COLUMN_FEE] += putVarint(column[COLUMN_FEE] + used[COLUMN_FEE], zigzag(rows[i].feeFen));
+        previousLeave = leave;
+
+        // 前缀查字典，没有时追加一项（字典项的 slot 即编号）
+        size_t length = strnlen(car->plateNumber, MAX_PLATE_LEN - 1);
+        size_t prefixLength = platePrefixLength(car->plateNumber, length);
+        char prefix[MAX_PLATE_LEN];
+        memcpy(prefix, car->plateNumber, prefixLength);
+        prefix[prefixLength] = '\0';
+        PackedPlate key = encodePlate(prefix, prefixLength);
+        PlateIndexEntry *entry = key != PLATE_NONE ? plateIndexFind(&dict, key) : NULL;
+        int id;
+        if (entry != NULL) {
+            id = entry->slot;
+        } else {
+            id = dict.count;
+            ok = key != PLATE_NONE && plateIndexPut(&dict, key, PLATE_IN_LOT, id) == SUCCESS;
+            column[COLUMN_DICT][used[COLUMN_DICT]++] = (unsigned char)prefixLength;
+            memcpy(column[COLUMN_DICT] + used[COLUMN_DICT], prefix, prefixLength);
+            used[COLUMN_DICT] += prefixLength;
+        }
+        used[COLUMN_PREFIX] += putVarint(column[COLUMN_PREFIX] + used[COLUMN_PREFIX], (uint64_t)id);
+        column[COLUMN_SUFFIX][used[COLUMN_SUFFIX]++] = (unsigned char)(length - prefixLength);
+        memcpy(column[COLUMN_SUFFIX] + used[COLUMN_SUFFIX], car->plateNumber + prefixLength, length - prefixLength);
+        used[COLUMN_SUFFIX] += length - prefixLength;
+        filterAdd(column[COLUMN_FILTER], used[COLUMN_FILTER], car->plateNumber);
+    }
+    uint32_t dictCount = (uint32_t)dict.count;
+    freePlateIndex(&dict);
+
+    size_t bodySize = COLUMN_COUNT * 4;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        bodySize += used[c];
+    }
+    unsigned char *data = ok ? malloc(ARCHIVE_HEADER_SIZE + bodySize) : NULL;
+    if (data == NULL) {
+        free(scratch);
+        return NULL;
+    }
+
+    unsigned char *p = data + ARCHIVE_HEADER_SIZE;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        putU32(p + c * 4, (uint32_t)used[c]);
+    }
+    p += COLUMN_COUNT * 4;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        memcpy(p, column[c], used[c]);
+        p += used[c];
+    }
+    free(scratch);
+
+    memset(data, 0, ARCHIVE_HEADER_SIZE);
+    memcpy(data, ARCHIVE_SEGMENT_MAGIC, 8);
+    putU16(data + SEG_OFF_VERSION, ARCHIVE_VERSION);
+    putU16(data + SEG_OFF_HEADER_SIZE, ARCHIVE_HEADER_SIZE);
+    putU32(data + SEG_OFF_ROW_COUNT, (uint32_t)count);
+    putU64(data + SEG_OFF_MIN_LEAVE, (uint64_t)minLeave);
+    putU64(data + SEG_OFF_MAX_LEAVE, (uint64_t)maxLeave);
+    putU64(data + SEG_OFF_MAX_SEQ, maxSeq);
+    putU64(data + SEG_OFF_TOTAL_FEE, (uint64_t)totalFee);
+    putU32(data + SEG_OFF_DICT_COUNT, dictCount);
+    putU32(data + SEG_OFF_DAY, (uint32_t)day);
+    putU32(data + SEG_OFF_BODY_CRC, crc32Update(0, data + ARCHIVE_HEADER_SIZE, bodySize));
+    putU32(data + SEG_OFF_HEADER_CRC, crc32Update(0, data, 60));
+    *size = ARCHIVE_HEADER_SIZE + bodySize;
+    return data;
+}
+
+// ---- 写入 ----
+
+static bool appendRow(SessionArchive *archive, const ArchivedSession *session) {
+    if (archive->rowCount == archive->rowCapacity) {
+        int capacity = archive->rowCapacity > 0 ? archive->rowCapacity * 2 : 256;
+        ArchivedSession *rows = realloc(archive->rows, (size_t)capacity * sizeof(ArchivedSession));
+        if (rows == NULL) {
+            return false;
+        }
+        archive->rows = rows;
+        archive->rowCapacity = capacity;
+    }
+    archive->rows[archive->rowCount++] = *session;
+    if (archive->rowCount == 1) {
+        archive->day = archiveDayOf(session->car.leaveTime);
+    }
+    if (session->seq > archive->lastSeq) {
+        archive->lastSeq = session->seq;
+    }
+    return true;
+}
+
+static bool loadTailRow(const ArchivedSession *session, void *context) {
+    return appendRow((SessionArchive *)context, session);
+}
+
+// 打开归档：找到下一个段编号，载入当天的追加文件（已封存或损坏的部分丢弃）
+int openArchive(SessionArchive *archive, const char *dir) {
+    memset(archive, 0, sizeof(SessionArchive));
+    snprintf(archive->dir, sizeof(archive->dir), "%s", dir);
+    if (!makeArchiveDir(dir)) {
+        printf("无法创建归档目录 %s！\n", dir);
+        return ERR_IO;
+    }
+
+    char path[300];
+    ArchiveSegmentInfo info;
+    bool corrupt;
+    int number = 1;
+    for (;; number++) {
+        segmentPath(dir, number, path, sizeof(path));
+        if (!readSegmentHeader(path, &info, &corrupt)) {
+            break;
+        }
+        if (corrupt) {
+            printf("归档段 %s 已损坏\n", path);
+        } else if (info.maxSeq > archive->lastSeq) {
+            archive->lastSeq = info.maxSeq;
+        }
+    }
+    archive->segmentNumber = number;
+
+    // 追加文件头中的段编号小于下一个编号，说明封存后还没来得及清空，其中的会话已在段中
+    tailPath(dir, path, sizeof(path));
+    bool trailing;
+    int tailSegment = readTail(path, loadTailRow, archive, &trailing);
+    if (tailSegment != 0 && tailSegment < number) {
+        archive->rowCount = 0;
+        trailing = true;
+    }
+    if (tailSegment == 0 || trailing) {
+        return rewriteTail(archive);
+    }
+    archive->tail = fopen(path, "ab");
+    return archive->tail != NULL ? SUCCESS : ERR_IO;
+}
+
+// 归档一次会话；seq 不大于已归档的序列号时视为重复（重放日志）并忽略
+int archiveAppend(SessionArchive *archive, const Car *car, double fee, uint64_t seq) {
+    if (archive == NULL || archive->tail == NULL) {
+        return ERR_EMPTY;
+    }
+    if (seq != 0 && seq <= archive->lastSeq) {
+        return SUCCESS;
+    }
+    // 日期变化：把前一天的会话封存为段
+    if (archive->rowCount > 0 && archiveDayOf(car->leaveTime) != archive->day && archiveSeal(archive) != SUCCESS) {
+        printf("归档段封存失败，会话继续写入 %s/%s\n", archive->dir, TAIL_FILE);
+    }
+
+    ArchivedSession session;
+    session.seq = seq;
+    formatPlate(car->plate, session.car.plateNumber, sizeof(session.car.plateNumber));
+    session.car.arriveTime = car->arriveTime;
+    session.car.leaveTime = car->leaveTime;
+    session.feeFen = feeToFen(fee);
+    if (!appendRow(archive, &session)) {
+        return ERR_MEMORY;
+    }
+    unsigned char buf[ARCHIVE_ROW_SIZE];
+    encodeTailRow(buf, &session);
+    return fwrite(buf, 1, ARCHIVE_ROW_SIZE, archive->tail) == ARCHIVE_ROW_SIZE ? SUCCESS : ERR_IO;
+}
+
+// 把当天的会话封存为段文件（写临时文件、刷盘、改名），然后清空追加文件
+int archiveSeal(SessionArchive *archive) {
+    if (archive == NULL || archive->rowCount == 0) {
+        return SUCCESS;
+    }
+    size_t size;
+    unsigned char *data = encodeSegment(archive->rows, archive->rowCount, archive->day, &size);
+    if (data == NULL) {
+        return ERR_MEMORY;
+    }
+    char path[300];
+    char tempPath[310];
+    segmentPath(archive->dir, archive->segmentNumber, path, sizeof(path));
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    FILE *file = fopen(tempPath, "wb");
+    bool ok = file != NULL && fwrite(data, 1, size, file) == size && flushFileToDisk(file);
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    }
+    free(data);
+    if (!ok || !replaceFile(tempPath, path)) {
+        return ERR_IO;
+    }
+
+    // 段已落盘；此时崩溃的话，重新打开时根据追加文件头中的段编号丢弃已封存的会话
+    archive->segmentNumber++;
+    archive->rowCount = 0;
+    archive->day = 0;
+    return rewriteTail(archive);
+}
+
+// 把缓冲的会话写入追加文件（不刷盘；进程崩溃不丢失，掉电丢失的部分由日志重放补上）
+int archiveFlush(SessionArchive *archive) {
+    if (archive == NULL || archive->tail == NULL) {
+        return ERR_EMPTY;
+    }
+    return fflush(archive->tail) == 0 ? SUCCESS : ERR_IO;
+}
+
+// 追加文件落盘（压缩日志前调用，保证被清除的日志记录对应的会话都已归档）
+int archiveSync(SessionArchive *archive) {
+    if (archive == NULL || archive->tail == NULL) {
+        return ERR_EMPTY;
+    }
+    return flushFileToDisk(archive->tail) ? SUCCESS : ERR_IO;
+}
+
+void closeArchive(SessionArchive *archive) {
+    if (archive->tail != NULL) {
+        flushFileToDisk(archive->tail);
+        fclose(archive->tail);
+        archive->tail = NULL;
+    }
+    free(archive->rows);
+    archive->rows = NULL;
+    archive->rowCount = 0;
+    archive->rowCapacity = 0;
+}
+
+// ---- 读取 ----
+
+static bool inRange(int64_t leave, time_t from, time_t to) {
+    return leave >= (int64_t)from && (to == 0 || leave < (int64_t)to);
+}
+
+// 与 [from, to) 是否相交
+static bool segmentOverlaps(const ArchiveSegmentInfo *info, time_t from, time_t to) {
+    return info->maxLeave >= (int64_t)from && (to == 0 || info->minLeave < (int64_t)to);
+}
+
+// 遍历 [from, to) 内离开的会话（to 为0表示不设上限），返回访问的会话数，目录不存在返回-1
+typedef struct {
+    time_t from;
+    time_t to;
+    ArchiveVisitor visitor;
+    void *context;
+    long visited;
+    bool stopped;
+} ScanState;
+
+static bool scanTailRow(const ArchivedSession *session, void *context) {
+    ScanState *state = (ScanState *)context;
+    if (!inRange((int64_t)session->car.leaveTime, state->from, state->to)) {
+        return true;
+    }
+    state->visited++;
+    if (!state->visitor(session, state->context)) {
+        state->stopped = true;
+        return false;
+    }
+    return true;
+}
+
+// 依次遍历各段和追加文件；withPlate 为false时不解码车牌列
+static long scanArchive(const char *dir, time_t from, time_t to, bool withPlate, ArchiveVisitor visitor, void *context,
+                        ArchiveReport *report) {
+    struct stat st;
+    if (stat(dir, &st) != 0) {
+        return -1;
+    }
+    ScanState state = {from, to, visitor, context, 0, false};
+    char path[300];
+    int number = 1;
+    for (;; number++) {
+        segmentPath(dir, number, path, sizeof(path));
+        ArchiveSegmentInfo info;
+        bool corrupt;
+        if (!readSegmentHeader(path, &info, &corrupt)) {
+            break;
+        }
+        if (report != NULL && stat(path, &st) == 0) {
+            report->bytes += (long long)st.st_size;
+        }
+        if (corrupt) {
+            printf("归档段 %s 已损坏，已跳过\n", path);
+            continue;
+        }
+        if (state.stopped || !segmentOverlaps(&info, from, to)) {
+            if (report != NULL) {
+                report->segmentsSkipped++;
+            }
+            continue;
+        }
+
+        size_t size;
+        unsigned char *data = readSegmentFile(path, &size);
+        SegmentReader reader;
+        memset(&reader, 0, sizeof(reader));
+        if (data == NULL || !openSegment(data, size, &reader) || (withPlate && !loadSegmentDict(&reader))) {
+            printf("归档段 %s 已损坏，已跳过\n", path);
+            closeSegment(&reader);
+            free(data);
+            continue;
+        }
+        if (report != NULL) {
+            report->segmentsScanned++;
+        }
+        int64_t previousLeave = reader.info.minLeave;
+        ArchivedSession session;
+        memset(&session, 0, sizeof(session));
+        for (uint32_t i = 0; i < reader.info.rowCount && !state.stopped; i++) {
+            if (!nextSession(&reader, &previousLeave, withPlate, &session)) {
+                printf("归档段 %s 第 %u 条会话损坏，已跳过该段其余部分\n", path, i + 1);
+                break;
+            }
+            scanTailRow(&session, &state);
+        }
+        closeSegment(&reader);
+        free(data);
+    }
+
+    // 追加文件（已封存但还没清空的不再重复计入）
+    tailPath(dir, path, sizeof(path));
+    if (report != NULL && stat(path, &st) == 0) {
+        report->bytes += (long long)st.st_size;
+    }
+    if (!state.stopped) {
+        bool trailing;
+        FILE *probe = fopen(path, "rb");
+        if (probe != NULL) {
+            unsigned char header[TAIL_HEADER_SIZE];
+            bool sealed = fread(header, 1, TAIL_HEADER_SIZE, probe) == TAIL_HEADER_SIZE &&
+                          (int)getU32(header + 8) < number;
+            fclose(probe);
+            if (!sealed) {
+                readTail(path, scanTailRow, &state, &trailing);
+            }
+        }
+    }
+    return state.visited;
+}
+
+long archiveScan(const char *dir, time_t from, time_t to, ArchiveVisitor visitor, void *context) {
+    return scanArchive(dir, from, to, true, visitor, context, NULL);
+}
+
+// ---- 段索引与列式解码 ----
+
+// 建立段索引：只读取各段的文件头和列目录，不读取数据
+int loadArchiveIndex(ArchiveIndex *index, const char *dir) {
+    memset(index, 0, sizeof(ArchiveIndex));
+    snprintf(index->dir, sizeof(index->dir), "%s", dir);
+    struct stat st;
+    if (stat(dir, &st) != 0) {
+        return ERR_NOT_FOUND;
+    }
+
+    char path[300];
+    int capacity = 0;
+    int number = 1;
+    for (;; number++) {
+        segmentPath(dir, number, path, sizeof(path));
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) {
+            break;
+        }
+        unsigned char header[ARCHIVE_HEADER_SIZE + COLUMN_COUNT * 4];
+        ArchiveSegmentEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.number = number;
+        size_t got = fread(header, 1, sizeof(header), file);
+        bool ok = got >= ARCHIVE_HEADER_SIZE && decodeSegmentHeader(header, &entry.info, &entry.day);
+        int columns = ok ? columnCount(entry.info.version) : 0;
+        ok = ok && got >= ARCHIVE_HEADER_SIZE + (size_t)columns * 4;
+        if (ok && columns > COLUMN_FILTER) {
+            long offset = ARCHIVE_HEADER_SIZE + columns * 4;
+            for (int c = 0; c < COLUMN_FILTER; c++) {
+                offset += (long)getU32(header + ARCHIVE_HEADER_SIZE + c * 4);
+            }
+            entry.filterOffset = offset;
+            entry.filterSize = getU32(header + ARCHIVE_HEADER_SIZE + COLUMN_FILTER * 4);
+        }
+        if (fseek(file, 0, SEEK_END) == 0) {
+            entry.bytes = ftell(file);
+        }
+        fclose(file);
+        if (!ok) {
+            printf("归档段 %s 已损坏，已跳过\n", path);
+            continue;
+        }
+
+        if (index->segmentCount == capacity) {
+            capacity = capacity > 0 ? capacity * 2 : 64;
+            ArchiveSegmentEntry *segments = realloc(index->segments, (size_t)capacity * sizeof(ArchiveSegmentEntry));
+            if (segments == NULL) {
+                freeArchiveIndex(index);
+                return ERR_MEMORY;
+            }
+            index->segments = segments;
+        }
+        index->segments[index->segmentCount++] = entry;
+    }
+
+    // 追加文件头中的段编号小于下一个编号时，其中的会话已经封存在段中
+    tailPath(dir, path, sizeof(path));
+    FILE *file = fopen(path, "rb");
+    if (file != NULL) {
+        unsigned char header[TAIL_HEADER_SIZE];
+        index->hasTail = fread(header, 1, TAIL_HEADER_SIZE, file) == TAIL_HEADER_SIZE &&
+                         (int)getU32(header + 8) >= number;
+        if (fseek(file, 0, SEEK_END) == 0) {
+            index->tailBytes = ftell(file);
+        }
+        fclose(file);
+    }
+    return SUCCESS;
+}
+
+void freeArchiveIndex(ArchiveIndex *index) {
+    free(index->segments);
+    index->segments = NULL;
+    index->segmentCount = 0;
+}
+
+// 段中是否可能有该车牌（只读取车牌过滤器列；没有过滤器或读取失败时返回true）
+bool archiveSegmentMayContain(const ArchiveIndex *index, int segment, const char *plateNumber) {
+    if (segment < 0 || segment >= index->segmentCount || index->segments[segment].filterSize == 0) {
+        return true;
+    }
+    const ArchiveSegmentEntry *entry = &index->segments[segment];
+    char path[300];
+    segmentPath(index->dir, entry->number, path, sizeof(path));
+    FILE *file = fopen(path, "rb");
+    unsigned char *bits = malloc(entry->filterSize);
+    bool result = true;
+    if (file != NULL && bits != NULL && fseek(file, entry->filterOffset, SEEK_SET) == 0 &&
+        fread(bits, 1, entry->filterSize, file) == entry->filterSize) {
+        result = filterMayContain(bits, entry->filterSize, plateNumber);
+    }
+    free(bits);
+    if (file != NULL) {
+        fclose(file);
+    }
+    return result;
+}
+
+static bool reserveColumns(ArchiveColumns *columns, uint32_t count, bool withPlates) {
+    if (count <= columns->capacity) {
+        return true;
+    }
+    uint32_t capacity = columns->capacity > 0 ? columns->capacity : 256;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    int64_t *leave = realloc(columns->leave, capacity * sizeof(int64_t));
+    if (leave != NULL) {
+        columns->leave = leave;
+    }
+    int64_t *dwell = realloc(columns->dwell, capacity * sizeof(int64_t));
+    if (dwell != NULL) {
+        columns->dwell = dwell;
+    }
+    int64_t *fee = realloc(columns->fee, capacity * sizeof(int64_t));
+    if (fee != NULL) {
+        columns->fee = fee;
+    }
+    bool ok = leave != NULL && dwell != NULL && fee != NULL;
+    if (withPlates) {
+        char (*plates)[MAX_PLATE_LEN] = realloc(columns->plates, (size_t)capacity * MAX_PLATE_LEN);
+        if (plates != NULL) {
+            columns->plates = plates;
+        }
+        ok = ok && plates != NULL;
+    }
+    if (ok) {
+        columns->capacity = capacity;
+    }
+    return ok;
+}
+
+static void storeSession(ArchiveColumns *columns, const ArchivedSession *session) {
+    uint32_t i = columns->count++;
+    columns->leave[i] = (int64_t)session->car.leaveTime;
+    columns->dwell[i] = (int64_t)(session->car.leaveTime - session->car.arriveTime);
+    columns->fee[i] = session->feeFen;
+    if (columns->plates != NULL) {
+        memcpy(columns->plates[i], session->car.plateNumber, MAX_PLATE_LEN);
+    }
+}
+
+static bool collectTailRow(const ArchivedSession *session, void *context) {
+    ArchiveColumns *columns = (ArchiveColumns *)context;
+    if (!reserveColumns(columns, columns->count + 1, columns->plates != NULL)) {
+        return false;
+    }
+    storeSession(columns, session);
+    return true;
+}
+
+// 把一个段（或追加文件）解码为列数组；withPlates 为false时不解码车牌列
+int archiveLoadColumns(const ArchiveIndex *index, int segment, bool withPlates, ArchiveColumns *columns) {
+    memset(columns, 0, sizeof(ArchiveColumns));
+    char path[300];
+    if (segment == ARCHIVE_TAIL_SEGMENT) {
+        if (!index->hasTail) {
+            return SUCCESS;
+        }
+        if (!reserveColumns(columns, 256, withPlates)) {
+            return ERR_MEMORY;
+        }
+        bool trailing;
+        tailPath(index->dir, path, sizeof(path));
+        readTail(path, collectTailRow, columns, &trailing);
+        return SUCCESS;
+    }
+    if (segment < 0 || segment >= index->segmentCount) {
+        return ERR_NOT_FOUND;
+    }
+
+    segmentPath(index->dir, index->segments[segment].number, path, sizeof(path));
+    size_t size;
+    unsigned char *data = readSegmentFile(path, &size);
+    SegmentReader reader;
+    memset(&reader, 0, sizeof(reader));
+    int result = SUCCESS;
+    if (data == NULL || !openSegment(data, size, &reader) || (withPlates && !loadSegmentDict(&reader))) {
+        printf("归档段 %s 已损坏，已跳过\n", path);
+        result = ERR_NOT_FOUND;
+    } else if (!reserveColumns(columns, reader.info.rowCount > 0 ? reader.info.rowCount : 1, withPlates)) {
+        result = ERR_MEMORY;
+    } else {
+        int64_t previousLeave = reader.info.minLeave;
+        ArchivedSession session;
+        memset(&session, 0, sizeof(session));
+        for (uint32_t i = 0; i < reader.info.rowCount; i++) {
+            if (!nextSession(&reader, &previousLeave, withPlates, &session)) {
+                printf("归档段 %s 第 %u 条会话损坏，已跳过该段其余部分\n", path, i + 1);
+                break;
+            }
+            storeSession(columns, &session);
+        }
+    }
+    closeSegment(&reader);
+    free(data);
+    return result;
+}
+
+void freeArchiveColumns(ArchiveColumns *columns) {
+    free(columns->leave);
+    free(columns->dwell);
+    free(columns->fee);
+    free(columns->plates);
+    memset(columns, 0, sizeof(ArchiveColumns));
+}
+
+// 报表中某一天的汇总项（按日期升序插入）
+static ArchiveDay *reportDay(ArchiveReport *report, int day, int *capacity) {
+    if (report->dayCount > 0 && report->days[report->dayCount - 1].day == day) {
+        return &report->days[report->dayCount - 1];
+    }
+    int low = 0;
+    int high = report->dayCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (report->days[mid].day < day) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < report->dayCount && report->days[low].day == day) {
+        return &report->days[low];
+    }
+    if (report->dayCount == *capacity) {
+        int newCapacity = *capacity > 0 ? *capacity * 2 : 64;
+        ArchiveDay *days = realloc(report->days, (size_t)newCapacity * sizeof(ArchiveDay));
+        if (days == NULL) {
+            return NULL;
+        }
+        report->days = days;
+        *capacity = newCapacity;
+    }
+    memmove(&report->days[low + 1], &report->days[low], (size_t)(report->dayCount - low) * sizeof(ArchiveDay));
+    report->dayCount++;
+    memset(&report->days[low], 0, sizeof(ArchiveDay));
+    report->days[low].day = day;
+    return &report->days[low];
+}
+
+typedef struct {
+    ArchiveReport *report;
+    int capacity;
+    bool failed;
+} ReportState;
+
+static bool addToReport(const ArchivedSession *session, void *context) {
+    ReportState *state = (ReportState *)context;
+    ArchiveDay *day = reportDay(state->report, archiveDayOf(session->car.leaveTime), &state->capacity);
+    if (day == NULL) {
+        state->failed = true;
+        return false;
+    }
+    int64_t dwell = (int64_t)(session->car.leaveTime - session->car.arriveTime);
+    day->sessions++;
+    day->revenueFen += session->feeFen;
+    day->dwellSeconds += dwell;
+    state->report->sessions++;
+    state->report->revenueFen += session->feeFen;
+    state->report->dwellSeconds += dwell;
+    return true;
+}
+
+// 按日汇总 [from, to) 内离开的会话：只解码时间和费用列
+int archiveReport(const char *dir, time_t from, time_t to, ArchiveReport *report) {
+    memset(report, 0, sizeof(ArchiveReport));
+    ReportState state = {report, 0, false};
+    if (scanArchive(dir, from, to, false, addToReport, &state, report) < 0) {
+        return ERR_NOT_FOUND;
+    }
+    return state.failed ? ERR_MEMORY : SUCCESS;
+}
+
+void freeArchiveReport(ArchiveReport *report) {
+    free(report->days);
+    report->days = NULL;
+    report->dayCount = 0;
+}
@@ -0,0 +1,129 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdint.h>
+#include "parking.h"
+
+// 默认归档目录（交互模式；服务模式为 <状态目录>/archive-<设施编号>）
+#define ARCHIVE_DIR "parking_archive"
+
+// 追加文件中每条会话记录的固定长度（字节）
+#define ARCHIVE_ROW_SIZE 64
+
+// 段文件标识与版本
+#define ARCHIVE_SEGMENT_MAGIC "BPARCH\r\n"
+#define ARCHIVE_TAIL_MAGIC "BPTAIL\r\n"
+#define ARCHIVE_VERSION 2
+#define ARCHIVE_HEADER_SIZE 64
+
+// 归档中的车辆（车牌号以字符串存放：归档要跨进程长期保存，按列编码时还要按前缀拆分）
+typedef struct {
+    char plateNumber[MAX_PLATE_LEN]; // 车牌号
+    time_t arriveTime;               // 到达时间
+    time_t leaveTime;                // 离开时间
+} ArchivedCar;
+
+// 一次完整的停车会话（车辆离开时归档）
+typedef struct {
+    uint64_t seq;          // 对应的离开日志记录序列号（没有日志时为0）
+    ArchivedCar car;       // 车牌号、到达时间、离开时间
+    int64_t feeFen;        // 停车费用（分）
+} ArchivedSession;
+
+// 已完成会话的归档：当天的会话逐条追加到 current.bpt，日期变化时把整天的会话
+// 封存为一个按列编码的段文件 segment-NNNNNN.bpa（格式见 archive.c），之后只读。
+typedef struct SessionArchive {
+    char dir[256];               // 归档目录
+    FILE *tail;                  // 当天的追加文件
+    int segmentNumber;           // 当天的会话封存后使用的段编号
+    ArchivedSession *rows;       // 当天的会话（追加文件的内存副本，封存时按列编码）
+    int rowCount;
+    int rowCapacity;
+    int day;                     // 当天日期 YYYYMMDD（0表示还没有会话）
+    uint64_t lastSeq;            // 已归档的最大日志序列号，重放日志时跳过不大于它的离开记录
+} SessionArchive;
+
+// 段文件头中的摘要（查询时据此跳过时间范围不相交的段）
+typedef struct {
+    uint16_t version;
+    uint32_t rowCount;
+    int64_t minLeave;            // 最早离开时间
+    int64_t maxLeave;            // 最晚离开时间
+    uint64_t maxSeq;
+    int64_t totalFeeFen;
+} ArchiveSegmentInfo;
+
+// 按日汇总
+typedef struct {
+    int day;                     // YYYYMMDD
+    long sessions;
+    int64_t revenueFen;
+    int64_t dwellSeconds;
+} ArchiveDay;
+
+// 收入报表
+typedef struct {
+    ArchiveDay *days;            // 按日期升序
+    int dayCount;
+    long sessions;
+    int64_t revenueFen;
+    int64_t dwellSeconds;
+    int segmentsScanned;
+    int segmentsSkipped;         // 时间范围不相交、没有解码的段
+    long long bytes;             // 归档占用的字节数（段文件和追加文件）
+} ArchiveReport;
+
+// 段索引项：查询前只读取各段的文件头和列目录，按时间范围和车牌过滤器决定要解码哪些段
+typedef struct {
+    int number;                  // 段编号
+    ArchiveSegmentInfo info;
+    int day;                     // YYYYMMDD
+    long long bytes;             // 文件大小
+    long filterOffset;           // 车牌过滤器列在文件中的位置
+    uint32_t filterSize;         // 车牌过滤器列的字节数（版本1的段为0）
+} ArchiveSegmentEntry;
+
+typedef struct {
+    char dir[256];
+    ArchiveSegmentEntry *segments;   // 按段编号升序
+    int segmentCount;
+    bool hasTail;                    // 追加文件中有尚未封存的会话
+    long long tailBytes;
+} ArchiveIndex;
+
+// 列式解码结果（同一段内的会话按写入顺序排列）
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    int64_t *leave;                  // 离开时间
+    int64_t *dwell;                  // 停车时长（秒）
+    int64_t *fee;                    // 费用（分）
+    char (*plates)[MAX_PLATE_LEN];   // 车牌号（没有要求解码车牌列时为NULL）
+} ArchiveColumns;
+
+// 表示追加文件的段下标
+#define ARCHIVE_TAIL_SEGMENT (-1)
+
+// 逐条访问会话，返回false时停止
+typedef bool (*ArchiveVisitor)(const ArchivedSession *session, void *context);
+
+// 写入（读写文件失败返回 ERR_IO，内存不足返回 ERR_MEMORY）
+int openArchive(SessionArchive *archive, const char *dir);
+int archiveAppend(SessionArchive *archive, const Car *car, double fee, uint64_t seq);
+int archiveSeal(SessionArchive *archive);
+int archiveFlush(SessionArchive *archive);
+int archiveSync(SessionArchive *archive);
+void closeArchive(SessionArchive *archive);
+
+// 读取（不需要打开归档，可以在服务运行时读取）
+int archiveDayOf(time_t t);
+int loadArchiveIndex(ArchiveIndex *index, const char *dir);
+void freeArchiveIndex(ArchiveIndex *index);
+bool archiveSegmentMayContain(const ArchiveIndex *index, int segment, const char *plateNumber);
+int archiveLoadColumns(const ArchiveIndex *index, int segment, bool withPlates, ArchiveColumns *columns);
+void freeArchiveColumns(ArchiveColumns *columns);
+long archiveScan(const char *dir, time_t from, time_t to, ArchiveVisitor visitor, void *context);
+int archiveReport(const char *dir, time_t from, time_t to, ArchiveReport *report);
+void freeArchiveReport(ArchiveReport *report);
+
+#endif /* ARCHIVE_H */
@@ -0,0 +1,160 @@
+#include "checkpoint.h"
+#include "snapshot.h"
+
+static double nowSeconds(void) {
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void initCheckpointSlot(CheckpointSlot *slot) {
+    atomic_init(&slot->inFlight, false);
+    atomic_init(&slot->lastOk, true);
+    atomic_init(&slot->completed, 0);
+    atomic_init(&slot->failed, 0);
+    slot->dirtyEvents = 0;
+    slot->lastStarted = time(NULL);
+}
+
+// 处理一个任务：写临时文件并刷盘，改名发布（replaceFile 会刷写状态目录，改名落盘后才返回成功）；
+// 快照发布且归档落盘后，旧日志中的记录都已包含在快照中，可以删除。任何一步失败都保留旧日志，重启时照常重放。
+static bool runJob(CheckpointJob *job) {
+    char tempPath[sizeof(job->statePath) + 4];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", job->statePath);
+    bool ok = writeSnapshotData(tempPath, job->data, job->length) && replaceFile(tempPath, job->statePath);
+    if (!ok) {
+        printf("无法写入快照文件 %s！\n", job->statePath);
+    }
+    if (job->archiveFd >= 0 && !syncDescriptor(job->archiveFd)) {
+        printf("无法写入会话归档！\n");
+        ok = false;
+    }
+    if (ok && job->oldJournalPath[0] != '\0') {
+        remove(job->oldJournalPath);
+    }
+    return ok;
+}
+
+// 完成任务：更新统计和设施状态并释放任务（线程运行时调用方已持有锁）
+static void finishJob(Checkpointer *checkpointer, CheckpointJob *job, bool ok, double elapsed) {
+    CheckpointSlot *slot = job->slot;
+    if (ok) {
+        checkpointer->written++;
+        checkpointer->bytesWritten += job->length;
+        checkpointer->lastMilliseconds = elapsed * 1000.0;
+    }
+    checkpointer->outstanding--;
+    atomic_store(&slot->lastOk, ok);
+    atomic_fetch_add(ok ? &slot->completed : &slot->failed, 1);
+    atomic_store(&slot->inFlight, false);
+    free(job->data);
+    free(job);
+}
+
+// 检查点线程主循环
+static void *checkpointMain(void *arg) {
+    Checkpointer *checkpointer = (Checkpointer *)arg;
+    pthread_mutex_lock(&checkpointer->mutex);
+    while (1) {
+        while (checkpointer->head == NULL && !checkpointer->stopping) {
+            pthread_cond_wait(&checkpointer->work, &checkpointer->mutex);
+        }
+        CheckpointJob *job = checkpointer->head;
+        if (job == NULL) {
+            break; // 已请求停止且没有待处理的任务
+        }
+        checkpointer->head = job->next;
+        if (checkpointer->head == NULL) {
+            checkpointer->tail = NULL;
+        }
+        pthread_mutex_unlock(&checkpointer->mutex);
+
+        double start = nowSeconds();
+        bool ok = runJob(job);
+        double elapsed = nowSeconds() - start;
+
+        pthread_mutex_lock(&checkpointer->mutex);
+        finishJob(checkpointer, job, ok, elapsed);
+        pthread_cond_broadcast(&checkpointer->finished);
+    }
+    pthread_mutex_unlock(&checkpointer->mutex);
+    return NULL;
+}
+
+// 启动检查点线程
+int startCheckpointer(Checkpointer *checkpointer) {
+    memset(checkpointer, 0, sizeof(Checkpointer));
+    pthread_mutex_init(&checkpointer->mutex, NULL);
+    pthread_cond_init(&checkpointer->work, NULL);
+    pthread_cond_init(&checkpointer->finished, NULL);
+    if (pthread_create(&checkpointer->thread, NULL, checkpointMain, checkpointer) != 0) {
+        printf("无法创建检查点线程！\n");
+        return ERR_MEMORY;
+    }
+    checkpointer->running = true;
+    return SUCCESS;
+}
+
+// 停止检查点线程（先写完已提交的任务）
+void stopCheckpointer(Checkpointer *checkpointer) {
+    if (!checkpointer->running) {
+        return;
+    }
+    pthread_mutex_lock(&checkpointer->mutex);
+    checkpointer->stopping = true;
+    pthread_cond_signal(&checkpointer->work);
+    pthread_mutex_unlock(&checkpointer->mutex);
+    pthread_join(checkpointer->thread, NULL);
+    checkpointer->running = false;
+    pthread_mutex_destroy(&checkpointer->mutex);
+    pthread_cond_destroy(&checkpointer->work);
+    pthread_cond_destroy(&checkpointer->finished);
+}
+
+// 提交任务
+void submitCheckpoint(Checkpointer *checkpointer, CheckpointJob *job) {
+    atomic_store(&job->slot->inFlight, true);
+    job->next = NULL;
+    if (!checkpointer->running) {
+        checkpointer->outstanding++;
+        double start = nowSeconds();
+        bool ok = runJob(job);
+        finishJob(checkpointer, job, ok, nowSeconds() - start);
+        return;
+    }
+
+    pthread_mutex_lock(&checkpointer->mutex);
+    if (checkpointer->tail != NULL) {
+        checkpointer->tail->next = job;
+    } else {
+        checkpointer->head = job;
+    }
+    checkpointer->tail = job;
+    checkpointer->outstanding++;
+    pthread_cond_signal(&checkpointer->work);
+    pthread_mutex_unlock(&checkpointer->mutex);
+}
+
+// 某个任务是否还没完成
+static bool pending(Checkpointer *checkpointer, CheckpointSlot *slot) {
+    if (slot != NULL) {
+        return atomic_load(&slot->inFlight);
+    }
+    return checkpointer->outstanding > 0;
+}
+
+// 等待检查点完成
+void waitCheckpoint(Checkpointer *checkpointer, CheckpointSlot *slot) {
+    if (!checkpointer->running) {
+        return; // 提交时已直接处理
+    }
+    pthread_mutex_lock(&checkpointer->mutex);
+    while (pending(checkpointer, slot)) {
+        pthread_cond_wait(&checkpointer->finished, &checkpointer->mutex);
+    }
+    pthread_mutex_unlock(&checkpointer->mutex);
+}
@@ -0,0 +1,59 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "parking.h"
+
+// 设施的检查点状态：由设施所在的引擎线程（或交互菜单线程）发起，检查点线程完成。
+// 脏状态只按事件计数跟踪，不区分停车场、便道和统计：快照的车辆记录跨部分差分编码且整体校验，
+// 无法只重编码变化的部分，因此每次检查点都在发起线程中编码整个快照，只有写文件和刷盘在后台进行
+typedef struct CheckpointSlot {
+    atomic_bool inFlight;         // 有检查点正在后台写出
+    atomic_bool lastOk;           // 最近一次检查点是否成功
+    atomic_long completed;        // 成功的检查点数
+    atomic_long failed;           // 失败的检查点数
+    long dirtyEvents;             // 自上次发起检查点以来改变了状态的事件数（只由发起方读写）
+    time_t lastStarted;           // 最近一次发起检查点的时间（只由发起方读写）
+} CheckpointSlot;
+
+// 一次检查点：发起方已在内存中编码好的快照，以及快照落盘后的收尾工作
+typedef struct CheckpointJob {
+    struct CheckpointJob *next;
+    unsigned char *data;          // 编码好的快照（由检查点线程释放）
+    size_t length;
+    char statePath[256];          // 快照文件（先写 <快照>.tmp，刷盘后改名）
+    char oldJournalPath[264];     // 快照落盘后删除的旧日志（空串表示没有）
+    int archiveFd;                // 删除旧日志前刷盘的归档追加文件句柄（-1表示没有）
+    CheckpointSlot *slot;         // 完成后更新的设施状态
+} CheckpointJob;
+
+// 检查点线程：按提交顺序写临时文件、刷盘、原子改名，再删除已被快照包含的旧日志。
+// 一个线程可以服务多个设施；提交方只在入队时短暂加锁，不等待磁盘。
+typedef struct Checkpointer {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t work;          // 有新任务或请求停止
+    pthread_cond_t finished;      // 有任务完成
+    CheckpointJob *head;          // 待处理的任务（先进先出）
+    CheckpointJob *tail;
+    int outstanding;              // 已提交、还没完成的任务数
+    bool stopping;
+    bool running;
+    long written;                 // 写出的快照数
+    uint64_t bytesWritten;        // 写出的快照字节数
+    double lastMilliseconds;      // 最近一次写出、刷盘和改名的耗时
+} Checkpointer;
+
+void initCheckpointSlot(CheckpointSlot *slot);
+
+// 检查点线程生命周期；停止前先处理完已提交的任务
+int startCheckpointer(Checkpointer *checkpointer);
+void stopCheckpointer(Checkpointer *checkpointer);
+
+// 提交任务（线程未运行时在调用线程中直接处理）
+void submitCheckpoint(Checkpointer *checkpointer, CheckpointJob *job);
+// 等待某个设施进行中的检查点完成；slot 为NULL时等待全部任务完成
+void waitCheckpoint(Checkpointer *checkpointer, CheckpointSlot *slot);
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,76 @@
+#include "command_ring.h"
+#include "parking.h"
+
+// 每个单元的序号：等于写入位置时可写，等于写入位置+1时可读；
+// 消费者读取后把序号推进一圈（+容量），该单元在下一圈重新变为可写。
+
+// 初始化队列
+int initCommandRing(CommandRing *ring, size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+    memset(ring, 0, sizeof(CommandRing));
+    ring->cells = (CommandRingCell *)malloc(size * sizeof(CommandRingCell));
+    if (ring->cells == NULL) {
+        return ERR_MEMORY;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&ring->cells[i].sequence, i);
+        ring->cells[i].item = NULL;
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->enqueuePos, 0);
+    ring->dequeuePos = 0;
+    return SUCCESS;
+}
+
+// 释放队列
+void freeCommandRing(CommandRing *ring) {
+    free(ring->cells);
+    ring->cells = NULL;
+}
+
+// 放入一项
+bool commandRingPush(CommandRing *ring, void *item) {
+    size_t pos = atomic_load_explicit(&ring->enqueuePos, memory_order_relaxed);
+    CommandRingCell *cell;
+
+    while (1) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            // 单元可写，抢占这个位置；失败时 pos 被更新为最新的写入位置
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // 消费者还没有读走上一圈的数据：队列已满
+        } else {
+            pos = atomic_load_explicit(&ring->enqueuePos, memory_order_relaxed);
+        }
+    }
+
+    cell->item = item;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+// 一次取出最多max项
+int commandRingDrain(CommandRing *ring, void **items, int max) {
+    int count = 0;
+    while (count < max) {
+        CommandRingCell *cell = &ring->cells[ring->dequeuePos & ring->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        if (sequence != ring->dequeuePos + 1) {
+            break; // 队列为空，或生产者已抢占位置但还没写完
+        }
+        items[count++] = cell->item;
+        atomic_store_explicit(&cell->sequence, ring->dequeuePos + ring->mask + 1, memory_order_release);
+        ring->dequeuePos++;
+    }
+    return count;
+}
+
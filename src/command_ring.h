@@ -0,0 +1,38 @@
+#ifndef COMMAND_RING_H
+#define COMMAND_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// 缓存行大小（用于把生产者和消费者的位置分开，避免伪共享）
+#define COMMAND_RING_CACHE_LINE 64
+
+// 环形缓冲区的一个单元：序号表示该单元当前可写还是可读
+typedef struct {
+    atomic_size_t sequence;
+    void *item;
+} CommandRingCell;
+
+// 有界无锁多生产者单消费者环形队列（Vyukov算法）。生产者用CAS抢占写入位置，
+// 消费者独占读取位置，不需要任何锁；队列满时 push 返回false，由调用者决定等待方式。
+typedef struct {
+    CommandRingCell *cells;
+    size_t mask;                                              // 容量-1（容量为2的幂）
+    char padding0[COMMAND_RING_CACHE_LINE];
+    atomic_size_t enqueuePos;                                 // 生产者共享
+    char padding1[COMMAND_RING_CACHE_LINE - sizeof(atomic_size_t)];
+    size_t dequeuePos;                                        // 只由消费者访问
+    char padding2[COMMAND_RING_CACHE_LINE - sizeof(size_t)];
+} CommandRing;
+
+// 队列管理（capacity 会向上取整为2的幂）
+int initCommandRing(CommandRing *ring, size_t capacity);
+void freeCommandRing(CommandRing *ring);
+
+// 生产者：放入一项，队列满时返回false
+bool commandRingPush(CommandRing *ring, void *item);
+// 消费者：一次取出最多max项，返回取出的数量
+int commandRingDrain(CommandRing *ring, void **items, int max);
+
+#endif /* COMMAND_RING_H */
@@ -0,0 +1,45 @@
+#include "crc32.h"
+#include <pthread.h>
+
+// 查表计算（slicing-by-8：每次处理8个字节），表在第一次调用时生成；引擎线程和检查点线程
+// 都会调用，用 pthread_once 保证只生成一次且生成完才可见
+static uint32_t crcTable[8][256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+static void buildCrcTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+        }
+        crcTable[0][i] = c;
+    }
+    // crcTable[k][i]：字节i后面再跟k个0字节时的CRC
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t prev = crcTable[k - 1][i];
+            crcTable[k][i] = crcTable[0][prev & 0xFF] ^ (prev >> 8);
+        }
+    }
+}
+
+// 计算CRC32校验和
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len) {
+    pthread_once(&crcTableOnce, buildCrcTable);
+
+    const unsigned char *p = (const unsigned char *)data;
+    crc = ~crc;
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        crc = crcTable[7][lo & 0xFF] ^ crcTable[6][(lo >> 8) & 0xFF] ^
+              crcTable[5][(lo >> 16) & 0xFF] ^ crcTable[4][lo >> 24] ^
+              crcTable[3][p[4]] ^ crcTable[2][p[5]] ^
+              crcTable[1][p[6]] ^ crcTable[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0) {
+        crc = crcTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
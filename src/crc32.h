@@ -0,0 +1,11 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 计算CRC32校验和（IEEE 802.3多项式），crc传入0开始新的计算，
+// 传入上一次的返回值可以分段累计
+uint32_t crc32Update(uint32_t crc, const void *data, size_t len);
+
+#endif /* CRC32_H */
@@ -0,0 +1,627 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // pthread_setaffinity_np
+#endif
+#include "facility.h"
+#include "plate_directory.h"
+#include "snapshot.h"
+#include <sched.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// 单写者引擎：道闸线程把命令指针放入有界无锁队列，引擎线程每次取走队列中的全部命令
+// 依次执行，整批执行完后再统一置完成标志。停车场、便道、索引、统计和日志只在引擎线程中
+// 访问，不需要加锁；提交和取命令也不加锁，只有引擎空闲或提交方等待较久时才通过条件变量休眠。
+// 一个引擎可以服务多个设施（分片），同一设施的命令总是由同一个引擎线程执行。
+//
+// 休眠与唤醒：休眠方先置标志（sleeping/waiters）再检查条件，唤醒方先改变条件再检查标志，
+// 两边之间都有顺序一致的内存栅栏，所以至少有一方能看到对方，不会丢失唤醒。
+
+// 多CPU时休眠前自旋检查的次数；只有一个CPU时自旋只会占用对方需要的时间，直接休眠
+#define ENGINE_SPIN 64
+
+// 初始化设施（初始化后不能再移动，停车场和便道保存了指向索引和日志的指针）；
+// 内存不足时返回 ERR_MEMORY，给出了日志路径但日志无法打开时返回 ERR_IO
+int initFacility(ParkingFacility *facility, int id, const SystemConfig *config, const char *statePath,
+                 const char *journalPath, const JournalConfig *journalConfig) {
+    memset(facility, 0, sizeof(ParkingFacility));
+    facility->id = id;
+    snprintf(facility->statePath, sizeof(facility->statePath), "%s", statePath);
+
+    if (initStack(&facility->lot, config->parkingCapacity) != SUCCESS ||
+        setLotModel(&facility->lot, config->lotModel) != SUCCESS ||
+        initStack(&facility->tempLot, config->parkingCapacity) != SUCCESS ||
+        initPlateIndex(&facility->index, config->parkingCapacity * 2) != SUCCESS) {
+        freeStack(&facility->lot);
+        freeStack(&facility->tempLot);
+        return ERR_MEMORY;
+    }
+    if (initTimerWheel(&facility->timers, time(NULL), config->parkingCapacity * 2) != SUCCESS) {
+        freePlateIndex(&facility->index);
+        freeStack(&facility->lot);
+        freeStack(&facility->tempLot);
+        return ERR_MEMORY;
+    }
+    facility->timers.maxStaySeconds = config->maxStayMinutes * 60;
+    facility->timers.laneTimeoutSeconds = config->laneTimeoutMinutes * 60;
+    facility->timers.graceAlerts = true;
+    initQueue(&facility->lane);
+    attachPlateIndex(&facility->lot, &facility->lane, &facility->index);
+    attachTimerWheel(&facility->lot, &facility->lane, &facility->timers);
+    initSystem(NULL, &facility->stats);
+    initCheckpointSlot(&facility->checkpoint);
+    if (journalConfig != NULL) {
+        facility->checkpointEvery = journalConfig->compactThreshold;
+        facility->checkpointInterval = journalConfig->checkpointInterval;
+    }
+
+    // 要求了日志却打不开时不能接受车辆：没有日志的变更在崩溃后会丢失
+    if (journalPath != NULL) {
+        int result = journalOpen(&facility->journal, journalPath, statePath, journalConfig);
+        if (result != SUCCESS) {
+            freeFacility(facility);
+            return result;
+        }
+        facility->hasJournal = true;
+        facility->lot.journal = &facility->journal;
+    }
+
+    if (initEngine(&facility->ownEngine, -1) != SUCCESS) {
+        freeFacility(facility);
+        return ERR_MEMORY;
+    }
+    return SUCCESS;
+}
+
+// 打开会话归档（需在加载状态之前，重放日志时补归档崩溃前未写入的会话）
+int openFacilityArchive(ParkingFacility *facility, const char *dir) {
+    int result = openArchive(&facility->archive, dir);
+    if (result != SUCCESS) {
+        closeArchive(&facility->archive);
+        return result;
+    }
+    facility->hasArchive = true;
+    facility->lot.archive = &facility->archive;
+    return SUCCESS;
+}
+
+// 加载状态：有日志时加载快照并重放日志，否则只加载快照
+bool loadFacility(ParkingFacility *facility) {
+    bool loaded;
+    // 重放日志时不设置计时器，加载完成后按在场车辆的到达时间统一设置
+    attachTimerWheel(&facility->lot, &facility->lane, NULL);
+    if (facility->hasJournal) {
+        loaded = loadSystemState(&facility->lot, &facility->lane, &facility->stats);
+    } else {
+        uint64_t journalSeq;
+        clearStack(&facility->lot);
+        clearQueue(&facility->lane);
+        clearPlateIndex(&facility->index);
+        loaded = loadSystemStateFrom(facility->statePath, &facility->lot, &facility->lane, &facility->stats, &journalSeq);
+    }
+    // 重放的日志和旧格式文件要在下一次检查点时写成新快照
+    facility->checkpoint.dirtyEvents = loaded ? 1 : 0;
+    attachTimerWheel(&facility->lot, &facility->lane, &facility->timers);
+    return loaded;
+}
+
+// 保存状态并等待落盘（只在设施的引擎线程或没有引擎时的调用线程中调用）：
+// 有检查点线程时发起检查点并等它完成，否则在调用线程中压缩日志或写临时文件再替换
+bool saveFacility(ParkingFacility *facility) {
+    if (facility->checkpointer != NULL) {
+        waitCheckpoint(facility->checkpointer, &facility->checkpoint);
+        int result = checkpointFacility(facility);
+        waitCheckpoint(facility->checkpointer, &facility->checkpoint);
+        return result == SUCCESS && atomic_load(&facility->checkpoint.lastOk);
+    }
+
+    bool ok;
+    if (facility->hasJournal) {
+        ok = journalCompact(&facility->journal, &facility->lot, &facility->lane, &facility->stats);
+    } else {
+        if (facility->hasArchive) {
+            archiveSync(&facility->archive);
+        }
+        char tempPath[300];
+        snprintf(tempPath, sizeof(tempPath), "%s.tmp", facility->statePath);
+        ok = saveSystemStateTo(tempPath, &facility->lot, &facility->lane, &facility->stats, 0) &&
+             replaceFile(tempPath, facility->statePath);
+    }
+    if (ok) {
+        facility->checkpoint.dirtyEvents = 0;
+        facility->checkpoint.lastStarted = time(NULL);
+    }
+    return ok;
+}
+
+// 发起后台检查点：在发起线程中轮换日志、编码快照（只访问内存），写文件、刷盘、改名和删除旧日志
+// 都交给检查点线程，调用方不等待磁盘。返回 SUCCESS（已发起，或已发起的检查点包含了全部变化）、
+// ERR_FULL（上一次检查点还没完成，之后又有新的变化）、ERR_IO（日志写出失败）或 ERR_MEMORY
+int checkpointFacility(ParkingFacility *facility) {
+    CheckpointSlot *slot = &facility->checkpoint;
+    if (facility->checkpointer == NULL) {
+        return saveFacility(facility) ? SUCCESS : ERR_MEMORY;
+    }
+    if (atomic_load(&slot->inFlight)) {
+        return slot->dirtyEvents == 0 ? SUCCESS : ERR_FULL; // 进行中的检查点已包含全部变化
+    }
+    if (slot->dirtyEvents == 0 && atomic_load(&slot->lastOk)) {
+        return SUCCESS;
+    }
+
+    CheckpointJob *job = (CheckpointJob *)calloc(1, sizeof(CheckpointJob));
+    if (job == NULL) {
+        return ERR_MEMORY;
+    }
+    job->slot = slot;
+    job->archiveFd = -1;
+    snprintf(job->statePath, sizeof(job->statePath), "%s", facility->statePath);
+
+    // 快照包含到当前最后一条日志记录为止的状态；之前的记录轮换到旧日志，快照落盘后删除。
+    // 上一个旧日志还没删除时不轮换，记录留在当前日志中，重放时按序列号跳过
+    uint64_t snapshotSeq = 0;
+    if (facility->hasJournal) {
+        int flushed = journalFlush(&facility->journal);
+        if (flushed != SUCCESS) {
+            free(job);
+            return flushed;
+        }
+        journalRotate(&facility->journal);
+        journalOldPath(&facility->journal, job->oldJournalPath, sizeof(job->oldJournalPath));
+        snapshotSeq = facility->journal.nextSeq - 1;
+    }
+    // 删除旧日志前归档必须已落盘，否则崩溃后无法从日志补上对应的会话；刷盘在检查点线程中进行
+    if (facility->hasArchive) {
+        job->archiveFd = duplicateForSync(facility->archive.tail);
+        if (job->archiveFd < 0) {
+            job->oldJournalPath[0] = '\0';
+        }
+    }
+
+    job->data = encodeSnapshot(&facility->lot, &facility->lane, &facility->stats, snapshotSeq, &job->length);
+    if (job->data == NULL) {
+        if (job->archiveFd >= 0) {
+            syncDescriptor(job->archiveFd);
+        }
+        free(job);
+        return ERR_MEMORY;
+    }
+    slot->dirtyEvents = 0;
+    slot->lastStarted = time(NULL);
+    submitCheckpoint(facility->checkpointer, job);
+    return SUCCESS;
+}
+
+// 检查是否需要检查点（批次结束时，或没有引擎时每条命令之后）：脏事件数或距上次检查点的时间超出预算
+static void maybeCheckpoint(ParkingFacility *facility) {
+    CheckpointSlot *slot = &facility->checkpoint;
+    if (facility->checkpointer == NULL) {
+        if (journalNeedsCompaction(facility->lot.journal)) {
+            saveFacility(facility);
+        }
+        return;
+    }
+    if (slot->dirtyEvents == 0 || atomic_load(&slot->inFlight)) {
+        return;
+    }
+    if ((facility->checkpointEvery > 0 && slot->dirtyEvents >= facility->checkpointEvery) ||
+        (facility->checkpointInterval > 0 && time(NULL) - slot->lastStarted >= facility->checkpointInterval)) {
+        checkpointFacility(facility);
+    }
+}
+
+// 释放设施（共享的分片引擎需已由管理者停止）
+void freeFacility(ParkingFacility *facility) {
+    stopFacility(facility);
+    if (facility->checkpointer != NULL) {
+        waitCheckpoint(facility->checkpointer, &facility->checkpoint);
+        facility->checkpointer = NULL;
+    }
+    if (facility->hasJournal) {
+        journalClose(&facility->journal);
+        facility->hasJournal = false;
+        facility->lot.journal = NULL;
+    }
+    if (facility->hasArchive) {
+        closeArchive(&facility->archive);
+        facility->hasArchive = false;
+        facility->lot.archive = NULL;
+    }
+    attachPlateIndex(&facility->lot, &facility->lane, NULL);
+    attachTimerWheel(&facility->lot, &facility->lane, NULL);
+    clearQueue(&facility->lane);
+    freePlateIndex(&facility->index);
+    freeTimerWheel(&facility->timers);
+    freeStack(&facility->lot);
+    freeStack(&facility->tempLot);
+    freeEngine(&facility->ownEngine);
+}
+
+// 执行一条命令（只在引擎线程或未启动引擎时的调用线程中执行）
+static void applyCommand(ParkingFacility *facility, FacilityCommand *command) {
+    // 先触发命令时间之前到期的计时器（命令时间早于时钟时不推进）
+    timerWheelAdvance(&facility->timers, command->time);
+    switch (command->type) {
+        case FACILITY_PARK: {
+            bool lotFull = isStackFull(&facility->lot);
+            command->result = parkCarAt(&facility->lot, &facility->lane, command->plateNumber, &facility->stats, command->time);
+            command->queued = command->result == SUCCESS && lotFull;
+            facility->checkpoint.dirtyEvents += command->result == SUCCESS;
+            if (command->result == SUCCESS && facility->directory != NULL &&
+                plateDirectoryClaim(facility->directory, command->plateNumber, facility->id) > 0) {
+                command->elsewhere = true;
+                facility->conflicts++;
+            }
+            break;
+        }
+        case FACILITY_LEAVE: {
+            double revenue = facility->stats.totalRevenue;
+            command->result = leaveCarAt(&facility->lot, &facility->tempLot, &facility->lane,
+                                         command->plateNumber, &facility->stats, command->time);
+            command->fee = facility->stats.totalRevenue - revenue;
+            command->moves = command->result == SUCCESS ? facility->lot.lastMoves : 0;
+            facility->checkpoint.dirtyEvents += command->result == SUCCESS;
+            if (command->result == SUCCESS && facility->directory != NULL) {
+                plateDirectoryRelease(facility->directory, command->plateNumber, facility->id);
+            }
+            break;
+        }
+        case FACILITY_CANCEL:
+            command->result = cancelWaitingCar(&facility->lot, &facility->lane, command->plateNumber, command->time);
+            facility->checkpoint.dirtyEvents += command->result == SUCCESS;
+            if (command->result == SUCCESS && facility->directory != NULL) {
+                plateDirectoryRelease(facility->directory, command->plateNumber, facility->id);
+            }
+            break;
+        case FACILITY_QUERY: {
+            PackedPlate plate = lookupPlate(command->plateNumber, MAX_PLATE_LEN - 1);
+            PlateIndexEntry *entry = plate != PLATE_NONE ? plateIndexFind(&facility->index, plate) : NULL;
+            command->result = entry != NULL ? entry->location : 0;
+            break;
+        }
+        case FACILITY_SAVE:
+            command->result = checkpointFacility(facility);
+            break;
+        case FACILITY_STATS:
+            command->totalCars = facility->stats.totalCars;
+            command->totalRevenue = facility->stats.totalRevenue;
+            summarizeStreamStats(&facility->stats.stream, command->time, &command->summary);
+            command->lotCount = getStackCount(&facility->lot);
+            command->laneCount = getQueueCount(&facility->lane);
+            command->capacity = facility->lot.capacity;
+            memcpy(command->timerAlerts, facility->timers.fired, sizeof(command->timerAlerts));
+            command->result = SUCCESS;
+            break;
+        case FACILITY_TICK:
+            command->result = SUCCESS;
+            break;
+        default:
+            command->result = ERR_NOT_FOUND;
+            break;
+    }
+}
+
+// 日志写出失败时，把本批中该设施已成功的变更命令改为 ERR_IO：它们的事件没有落盘，
+// 不能向道闸报告成功
+static void failBatchCommands(FacilityCommand **batch, int n, const ParkingFacility *facility, int error) {
+    for (int i = 0; i < n; i++) {
+        FacilityCommand *command = batch[i];
+        if (command->facility != facility || command->result != SUCCESS) {
+            continue;
+        }
+        if (command->type == FACILITY_PARK || command->type == FACILITY_LEAVE || command->type == FACILITY_CANCEL) {
+            command->result = error;
+            command->queued = false;
+            command->elsewhere = false;
+        }
+    }
+}
+
+// 一批命令执行完后写出涉及设施的日志（在置完成标志之前，失败会反映到命令结果中）
+static void finishBatch(FacilityCommand **batch, int n) {
+    for (int i = 0; i < n; i++) {
+        ParkingFacility *facility = batch[i]->facility;
+        if (!facility->touched) {
+            continue;
+        }
+        facility->touched = false;
+        // 整批命令的日志一起写出，结果返回给道闸前已经落盘
+        if (facility->hasJournal && facility->journal.pendingCount > 0) {
+            int result = journalFlush(&facility->journal);
+            if (result != SUCCESS) {
+                failBatchCommands(batch, n, facility, result);
+            }
+        }
+        if (facility->hasArchive) {
+            archiveFlush(&facility->archive);
+        }
+        maybeCheckpoint(facility);
+    }
+}
+
+// 自旋等待时让出执行单元
+static void spinPause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    sched_yield();
+#endif
+}
+
+// 取一批命令；队列为空时先自旋，再休眠到有新命令或请求停止。返回0表示已停止且队列已空
+static int takeBatch(FacilityEngine *engine, FacilityCommand **batch) {
+    for (int spin = 0; spin < engine->spin; spin++) {
+        int n = commandRingDrain(&engine->ring, (void **)batch, FACILITY_QUEUE_SIZE);
+        if (n > 0) {
+            return n;
+        }
+        spinPause();
+    }
+
+    int n;
+    pthread_mutex_lock(&engine->mutex);
+    atomic_store(&engine->sleeping, true);
+    atomic_thread_fence(memory_order_seq_cst);
+    while ((n = commandRingDrain(&engine->ring, (void **)batch, FACILITY_QUEUE_SIZE)) == 0 &&
+           !atomic_load(&engine->stopping)) {
+        pthread_cond_wait(&engine->notEmpty, &engine->mutex);
+    }
+    atomic_store(&engine->sleeping, false);
+    pthread_mutex_unlock(&engine->mutex);
+    return n;
+}
+
+// 引擎线程主循环
+static void *engineMain(void *arg) {
+    FacilityEngine *engine = (FacilityEngine *)arg;
+    FacilityCommand *batch[FACILITY_QUEUE_SIZE];
+
+    while (1) {
+        int n = takeBatch(engine, batch);
+        if (n == 0) {
+            break; // 已请求停止且队列已清空
+        }
+
+        for (int i = 0; i < n; i++) {
+            applyCommand(batch[i]->facility, batch[i]);
+            batch[i]->facility->touched = true;
+        }
+        finishBatch(batch, n);
+        engine->batches++;
+        engine->commandsProcessed += n;
+        if (n > engine->largestBatch) {
+            engine->largestBatch = n;
+        }
+
+        // 置完成标志后命令可能立即被提交方释放，之后不能再访问
+        for (int i = 0; i < n; i++) {
+            atomic_store_explicit(&batch[i]->done, true, memory_order_release);
+        }
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load(&engine->waiters) > 0) {
+            pthread_mutex_lock(&engine->mutex);
+            pthread_cond_broadcast(&engine->completed);
+            pthread_mutex_unlock(&engine->mutex);
+        }
+    }
+    return NULL;
+}
+
+// 初始化引擎，cpu为绑定的CPU编号，-1表示不绑定
+int initEngine(FacilityEngine *engine, int cpu) {
+    memset(engine, 0, sizeof(FacilityEngine));
+    if (initCommandRing(&engine->ring, FACILITY_QUEUE_SIZE) != SUCCESS) {
+        return ERR_MEMORY;
+    }
+    engine->cpu = cpu;
+    engine->spin = onlineCpuCount() > 1 ? ENGINE_SPIN : 0;
+    atomic_init(&engine->sleeping, false);
+    atomic_init(&engine->waiters, 0);
+    atomic_init(&engine->stopping, false);
+    atomic_init(&engine->fullWaits, 0);
+    atomic_init(&engine->wakeups, 0);
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->notEmpty, NULL);
+    pthread_cond_init(&engine->completed, NULL);
+    return SUCCESS;
+}
+
+// 启动引擎线程
+int startEngine(FacilityEngine *engine) {
+    if (engine->running) {
+        return SUCCESS;
+    }
+    atomic_store(&engine->stopping, false);
+    if (pthread_create(&engine->thread, NULL, engineMain, engine) != 0) {
+        printf("无法创建引擎线程！\n");
+        return ERR_MEMORY;
+    }
+#ifdef __linux__
+    if (engine->cpu >= 0) {
+        // 绑定失败不影响正确性，只是失去缓存亲和性
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(engine->cpu, &cpus);
+        pthread_setaffinity_np(engine->thread, sizeof(cpus), &cpus);
+    }
+#endif
+    engine->running = true;
+    return SUCCESS;
+}
+
+// 停止引擎线程（先执行完队列中已有的命令）
+void stopEngine(FacilityEngine *engine) {
+    if (!engine->running) {
+        return;
+    }
+    pthread_mutex_lock(&engine->mutex);
+    atomic_store(&engine->stopping, true);
+    pthread_cond_signal(&engine->notEmpty);
+    pthread_mutex_unlock(&engine->mutex);
+    pthread_join(engine->thread, NULL);
+    engine->running = false;
+}
+
+// 释放引擎（需已停止）
+void freeEngine(FacilityEngine *engine) {
+    if (engine->ring.cells == NULL) {
+        return; // 未初始化或已释放
+    }
+    stopEngine(engine);
+    freeCommandRing(&engine->ring);
+    pthread_mutex_destroy(&engine->mutex);
+    pthread_cond_destroy(&engine->notEmpty);
+    pthread_cond_destroy(&engine->completed);
+}
+
+// 在线CPU数量
+int onlineCpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// 设置执行命令的引擎（NULL表示在调用线程中执行）。由引擎执行时日志在每批命令结束时写出一次，
+// 否则按组提交策略在提交时写出
+void attachFacilityEngine(ParkingFacility *facility, FacilityEngine *engine) {
+    facility->engine = engine;
+    facility->journal.deferFlush = engine != NULL && facility->hasJournal;
+}
+
+// 用独占引擎启动设施
+int startFacility(ParkingFacility *facility) {
+    int result = startEngine(&facility->ownEngine);
+    if (result == SUCCESS) {
+        attachFacilityEngine(facility, &facility->ownEngine);
+    }
+    return result;
+}
+
+// 停止设施的独占引擎（共享的分片引擎由管理者停止）
+void stopFacility(ParkingFacility *facility) {
+    if (facility->engine == &facility->ownEngine) {
+        stopEngine(&facility->ownEngine);
+        attachFacilityEngine(facility, NULL);
+    }
+}
+
+// 提交命令（队列满时让出CPU等待引擎取走命令）
+void facilitySubmit(ParkingFacility *facility, FacilityCommand *command) {
+    FacilityEngine *engine = facility->engine;
+    command->facility = facility;
+    atomic_store_explicit(&command->done, false, memory_order_relaxed);
+    if (engine == NULL || !engine->running) {
+        applyCommand(facility, command);
+        // 挂接的引擎没有运行时没有批次结束，日志在这里写出
+        if (facility->journal.deferFlush && facility->journal.pendingCount > 0) {
+            int result = journalFlush(&facility->journal);
+            if (result != SUCCESS) {
+                failBatchCommands(&command, 1, facility, result);
+            }
+        }
+        maybeCheckpoint(facility);
+        atomic_store_explicit(&command->done, true, memory_order_relaxed);
+        return;
+    }
+
+    if (!commandRingPush(&engine->ring, command)) {
+        atomic_fetch_add_explicit(&engine->fullWaits, 1, memory_order_relaxed);
+        do {
+            sched_yield();
+        } while (!commandRingPush(&engine->ring, command));
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&engine->sleeping)) {
+        atomic_fetch_add_explicit(&engine->wakeups, 1, memory_order_relaxed);
+        pthread_mutex_lock(&engine->mutex);
+        pthread_cond_signal(&engine->notEmpty);
+        pthread_mutex_unlock(&engine->mutex);
+    }
+}
+
+// 等待命令执行完毕：先短暂自旋，仍未完成时休眠
+void facilityWait(ParkingFacility *facility, FacilityCommand *command) {
+    FacilityEngine *engine = facility->engine;
+    if (engine == NULL || !engine->running) {
+        return; // 已在提交时直接执行
+    }
+    for (int spin = 0; spin < engine->spin; spin++) {
+        if (atomic_load_explicit(&command->done, memory_order_acquire)) {
+            return;
+        }
+        spinPause();
+    }
+
+    pthread_mutex_lock(&engine->mutex);
+    atomic_fetch_add(&engine->waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (!atomic_load_explicit(&command->done, memory_order_acquire)) {
+        pthread_cond_wait(&engine->completed, &engine->mutex);
+    }
+    atomic_fetch_sub(&engine->waiters, 1);
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+// 提交命令并等待结果
+int facilityExecute(ParkingFacility *facility, FacilityCommand *command) {
+    facilitySubmit(facility, command);
+    facilityWait(facility, command);
+    return command->result;
+}
+
+// 填写一条命令
+static void makeCommand(FacilityCommand *command, FacilityCommandType type, const char *plateNumber, time_t now) {
+    memset(command, 0, sizeof(FacilityCommand));
+    command->type = type;
+    command->time = now;
+    if (plateNumber != NULL) {
+        strncpy(command->plateNumber, plateNumber, MAX_PLATE_LEN - 1);
+    }
+}
+
+// 车辆到达
+int facilityPark(ParkingFacility *facility, const char *plateNumber, time_t now) {
+    FacilityCommand command;
+    makeCommand(&command, FACILITY_PARK, plateNumber, now);
+    return facilityExecute(facility, &command);
+}
+
+// 车辆离开，fee可为NULL
+int facilityLeave(ParkingFacility *facility, const char *plateNumber, time_t now, double *fee) {
+    FacilityCommand command;
+    makeCommand(&command, FACILITY_LEAVE, plateNumber, now);
+    int result = facilityExecute(facility, &command);
+    if (fee != NULL) {
+        *fee = command.fee;
+    }
+    return result;
+}
+
+// 查询车辆位置：PLATE_IN_LOT、PLATE_IN_LANE，不在场内时返回0
+int facilityQuery(ParkingFacility *facility, const char *plateNumber) {
+    FacilityCommand command;
+    makeCommand(&command, FACILITY_QUERY, plateNumber, 0);
+    return facilityExecute(facility, &command);
+}
+
+// 推进计时器时钟，触发到期的提醒
+int facilityTick(ParkingFacility *facility, time_t now) {
+    FacilityCommand command;
+    makeCommand(&command, FACILITY_TICK, NULL, now);
+    return facilityExecute(facility, &command);
+}
+
+// 便道上的车辆未入场离开（不收费），不在便道上时返回 ERR_NOT_FOUND
+int facilityCancel(ParkingFacility *facility, const char *plateNumber, time_t now) {
+    FacilityCommand command;
+    makeCommand(&command, FACILITY_CANCEL, plateNumber, now);
+    return facilityExecute(facility, &command);
+}
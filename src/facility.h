@@ -0,0 +1,133 @@
+#ifndef FACILITY_H
+#define FACILITY_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "parking.h"
+#include "archive.h"
+#include "checkpoint.h"
+#include "command_ring.h"
+#include "journal.h"
+#include "plate_index.h"
+#include "timer_wheel.h"
+
+// 命令队列长度（队列满时提交方等待），也是引擎一批最多处理的命令数
+#define FACILITY_QUEUE_SIZE 1024
+
+// 命令类型
+typedef enum {
+    FACILITY_PARK = 1,    // 车辆到达
+    FACILITY_LEAVE = 2,   // 车辆离开
+    FACILITY_QUERY = 3,   // 查询车辆位置
+    FACILITY_SAVE = 4,    // 发起后台检查点（上一次检查点未完成时结果为 ERR_FULL）
+    FACILITY_STATS = 5,   // 读取统计信息和占用情况
+    FACILITY_TICK = 6,    // 推进计时器时钟（每条命令都会推进到命令时间，空闲时由调用方定期提交）
+    FACILITY_CANCEL = 7   // 便道上的车辆未入场直接离开
+} FacilityCommandType;
+
+struct ParkingFacility;
+struct PlateDirectory;
+
+// 一条命令及其执行结果
+typedef struct {
+    struct ParkingFacility *facility;  // 目标设施（提交时填写）
+    FacilityCommandType type;
+    char plateNumber[MAX_PLATE_LEN];
+    time_t time;            // 事件时间
+    int result;             // SUCCESS 或 ERR_*；查询时为 PlateLocation（0表示不在场内）
+    bool queued;            // 到达时停车场已满，进入了便道
+    double fee;             // 离开时收取的费用
+    int moves;              // 离开时为让路挪动的车辆次数
+    bool elsewhere;         // 到达时该车牌已在其他设施中（车牌目录报警）
+    int totalCars;          // 累计处理车辆数（STATS）
+    double totalRevenue;    // 累计收入（STATS）
+    StatsSummary summary;   // 百分位数、峰值和最近24小时计数（STATS）
+    int lotCount;           // 停车场中的车辆数（STATS）
+    int laneCount;          // 便道上的车辆数（STATS）
+    int capacity;           // 停车场容量（STATS）
+    long timerAlerts[TIMER_KIND_COUNT]; // 超时、免费时长结束、便道等候超时的累计提醒次数（STATS）
+    atomic_bool done;       // 引擎已执行完毕
+} FacilityCommand;
+
+// 引擎：一个工作线程和它的无锁命令队列，可以服务一个或多个设施。
+// 提交和取命令都不加锁；互斥锁和条件变量只在引擎空闲休眠、提交方等待结果休眠时使用。
+typedef struct FacilityEngine {
+    CommandRing ring;                  // 多道闸线程写入、引擎线程读取的命令队列
+    pthread_mutex_t mutex;             // 只用于休眠和唤醒
+    pthread_cond_t notEmpty;           // 引擎休眠时等待新命令
+    pthread_cond_t completed;          // 提交方休眠时等待命令执行完毕
+    atomic_bool sleeping;              // 引擎正在（或即将）休眠
+    atomic_int waiters;                // 正在休眠等待结果的提交方数量
+    atomic_bool stopping;
+    pthread_t thread;
+    int cpu;                           // 绑定的CPU编号（-1表示不绑定）
+    bool running;
+    int spin;                          // 休眠前自旋检查的次数（单CPU时为0）
+
+    long batches;                      // 处理的批次数
+    long commandsProcessed;            // 处理的命令数
+    int largestBatch;                  // 一批最多处理的命令数
+    atomic_long fullWaits;             // 提交时队列已满、需要等待的次数（背压）
+    atomic_long wakeups;               // 提交方唤醒休眠引擎的次数
+} FacilityEngine;
+
+// 停车设施：一个停车场及其便道、索引、统计和持久化文件。
+// 挂接到运行中的引擎后，所有状态只由引擎线程修改，各道闸线程通过命令队列提交操作；
+// 没有引擎时命令在调用线程中直接执行（单操作员的交互菜单）。
+typedef struct ParkingFacility {
+    int id;                            // 设施编号
+    ParkingStack lot;                  // 停车场
+    ParkingStack tempLot;              // 让路用的临时栈
+    WaitingQueue lane;                 // 便道
+    PlateIndex index;                  // 车牌号索引
+    TimerWheel timers;                 // 超时、免费时长和便道等候计时器（按命令时间推进）
+    SystemStats stats;                 // 统计信息
+    Journal journal;                   // 事件日志
+    bool hasJournal;
+    SessionArchive archive;            // 已完成会话的归档
+    bool hasArchive;
+    char statePath[256];               // 状态快照文件
+    Checkpointer *checkpointer;        // 后台检查点线程（NULL表示在调用线程中同步保存）
+    CheckpointSlot checkpoint;         // 检查点状态和脏事件计数
+    int checkpointEvery;               // 脏事件达到该数量时发起检查点（0表示不按事件数）
+    int checkpointInterval;            // 有脏事件且距上次检查点超过该秒数时发起检查点（0表示不按时间）
+
+    FacilityEngine *engine;            // 执行命令的引擎（NULL表示在调用线程中执行）
+    FacilityEngine ownEngine;          // startFacility 使用的独占引擎
+    bool touched;                      // 本批次执行过命令，批次结束时需要写出日志
+    struct PlateDirectory *directory;  // 跨设施车牌目录（可为NULL）
+    long conflicts;                    // 到达时车牌已在其他设施中的次数
+} ParkingFacility;
+
+// 设施管理
+int initFacility(ParkingFacility *facility, int id, const SystemConfig *config, const char *statePath,
+                 const char *journalPath, const JournalConfig *journalConfig);
+int openFacilityArchive(ParkingFacility *facility, const char *dir);
+bool loadFacility(ParkingFacility *facility);
+bool saveFacility(ParkingFacility *facility);
+int checkpointFacility(ParkingFacility *facility);
+void freeFacility(ParkingFacility *facility);
+
+// 引擎线程
+int initEngine(FacilityEngine *engine, int cpu);
+int startEngine(FacilityEngine *engine);
+void stopEngine(FacilityEngine *engine);
+void freeEngine(FacilityEngine *engine);
+void attachFacilityEngine(ParkingFacility *facility, FacilityEngine *engine);
+int startFacility(ParkingFacility *facility);
+int onlineCpuCount(void);
+void stopFacility(ParkingFacility *facility);
+
+// 提交命令：submit 只入队，wait 等待执行完毕；execute 相当于两者连用
+void facilitySubmit(ParkingFacility *facility, FacilityCommand *command);
+void facilityWait(ParkingFacility *facility, FacilityCommand *command);
+int facilityExecute(ParkingFacility *facility, FacilityCommand *command);
+
+// 常用操作
+int facilityPark(ParkingFacility *facility, const char *plateNumber, time_t now);
+int facilityLeave(ParkingFacility *facility, const char *plateNumber, time_t now, double *fee);
+int facilityQuery(ParkingFacility *facility, const char *plateNumber);
+int facilityTick(ParkingFacility *facility, time_t now);
+int facilityCancel(ParkingFacility *facility, const char *plateNumber, time_t now);
+
+#endif /* FACILITY_H */
@@ -0,0 +1,194 @@
+#include "facility_manager.h"
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// 创建状态文件目录（已存在时成功）
+static bool makeStateDir(const char *path) {
+#ifdef _WIN32
+    int result = _mkdir(path);
+#else
+    int result = mkdir(path, 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+// 初始化管理者：创建各设施及其状态文件路径（<stateDir>/facility-<id>.dat/.journal）和会话归档目录（<stateDir>/archive-<id>）
+int initFacilityManager(FacilityManager *manager, int facilityCount, int shardCount, const SystemConfig *config,
+                        const char *stateDir, const JournalConfig *journalConfig) {
+    memset(manager, 0, sizeof(FacilityManager));
+    if (facilityCount <= 0) {
+        return ERR_EMPTY;
+    }
+    if (shardCount <= 0) {
+        shardCount = onlineCpuCount();
+    }
+    if (shardCount > facilityCount) {
+        shardCount = facilityCount; // 多出的分片没有设施可服务
+    }
+    snprintf(manager->stateDir, sizeof(manager->stateDir), "%s", stateDir);
+    if (!makeStateDir(stateDir)) {
+        printf("无法创建状态目录 %s！\n", stateDir);
+        return ERR_NOT_FOUND;
+    }
+
+    manager->facilities = (ParkingFacility *)calloc((size_t)facilityCount, sizeof(ParkingFacility));
+    manager->shards = (FacilityEngine *)calloc((size_t)shardCount, sizeof(FacilityEngine));
+    if (manager->facilities == NULL || manager->shards == NULL ||
+        initPlateDirectory(&manager->directory, facilityCount * config->parkingCapacity) != SUCCESS) {
+        free(manager->facilities);
+        free(manager->shards);
+        manager->facilities = NULL;
+        manager->shards = NULL;
+        return ERR_MEMORY;
+    }
+
+    int cpus = onlineCpuCount();
+    for (int i = 0; i < shardCount; i++) {
+        if (initEngine(&manager->shards[i], i % cpus) != SUCCESS) {
+            manager->shardCount = i;
+            freeFacilityManager(manager);
+            return ERR_MEMORY;
+        }
+    }
+    manager->shardCount = shardCount;
+
+    if (startCheckpointer(&manager->checkpointer) != SUCCESS) {
+        freeFacilityManager(manager);
+        return ERR_MEMORY;
+    }
+
+    for (int id = 0; id < facilityCount; id++) {
+        char statePath[300];
+        char journalPath[300];
+        snprintf(statePath, sizeof(statePath), "%s/facility-%d.dat", stateDir, id);
+        snprintf(journalPath, sizeof(journalPath), "%s/facility-%d.journal", stateDir, id);
+
+        ParkingFacility *facility = &manager->facilities[id];
+        int result = initFacility(facility, id, config, statePath, journalConfig != NULL ? journalPath : NULL,
+                                  journalConfig);
+        if (result != SUCCESS) {
+            manager->facilityCount = id;
+            freeFacilityManager(manager);
+            return result;
+        }
+        facility->directory = &manager->directory;
+        facility->checkpointer = &manager->checkpointer;
+        manager->facilityCount = id + 1;
+
+        char archiveDir[300];
+        snprintf(archiveDir, sizeof(archiveDir), "%s/archive-%d", stateDir, id);
+        if (openFacilityArchive(facility, archiveDir) != SUCCESS) {
+            printf("设施 %d 的会话归档不可用，离场记录不会归档\n", id);
+        }
+    }
+    return SUCCESS;
+}
+
+// 加载各设施的状态，并把在场车辆登记到车牌目录（需在启动分片前调用）
+void loadFacilityManager(FacilityManager *manager) {
+    for (int id = 0; id < manager->facilityCount; id++) {
+        ParkingFacility *facility = &manager->facilities[id];
+        loadFacility(facility);
+
+        char plateNumber[MAX_PLATE_LEN];
+        int cursor = 0;
+        PlateIndexEntry *entry;
+        while ((entry = plateIndexNext(&facility->index, &cursor)) != NULL) {
+            formatPlate(entry->plate, plateNumber, sizeof(plateNumber));
+            if (plateDirectoryClaim(&manager->directory, plateNumber, id) > 0) {
+                facility->conflicts++;
+            }
+        }
+    }
+}
+
+// 保存各设施的状态并等待落盘（分片运行时作为命令提交，由各自的引擎线程发起检查点）
+bool saveFacilityManager(FacilityManager *manager) {
+    bool ok = true;
+    for (int id = 0; id < manager->facilityCount; id++) {
+        ParkingFacility *facility = &manager->facilities[id];
+        int result;
+        do {
+            FacilityCommand command;
+            memset(&command, 0, sizeof(command));
+            command.type = FACILITY_SAVE;
+            result = facilityExecute(facility, &command);
+            if (result == ERR_FULL) {
+                waitCheckpoint(&manager->checkpointer, &facility->checkpoint); // 上一次检查点完成后重试
+            }
+        } while (result == ERR_FULL);
+        ok = result == SUCCESS && ok;
+    }
+    waitCheckpoint(&manager->checkpointer, NULL);
+    for (int id = 0; id < manager->facilityCount; id++) {
+        ok = atomic_load(&manager->facilities[id].checkpoint.lastOk) && ok;
+    }
+    return ok;
+}
+
+// 启动分片引擎，设施 id 由分片 id % shardCount 服务
+int startFacilityManager(FacilityManager *manager) {
+    for (int i = 0; i < manager->shardCount; i++) {
+        if (startEngine(&manager->shards[i]) != SUCCESS) {
+            stopFacilityManager(manager);
+            return ERR_MEMORY;
+        }
+    }
+    for (int id = 0; id < manager->facilityCount; id++) {
+        attachFacilityEngine(&manager->facilities[id], &manager->shards[id % manager->shardCount]);
+    }
+    return SUCCESS;
+}
+
+// 停止分片引擎（先执行完各队列中已有的命令），之后命令在调用线程中直接执行
+void stopFacilityManager(FacilityManager *manager) {
+    for (int i = 0; i < manager->shardCount; i++) {
+        stopEngine(&manager->shards[i]);
+    }
+    for (int id = 0; id < manager->facilityCount; id++) {
+        attachFacilityEngine(&manager->facilities[id], NULL);
+    }
+}
+
+// 释放管理者
+void freeFacilityManager(FacilityManager *manager) {
+    stopFacilityManager(manager);
+    stopCheckpointer(&manager->checkpointer); // 先写完已提交的检查点
+    for (int id = 0; id < manager->facilityCount; id++) {
+        freeFacility(&manager->facilities[id]);
+    }
+    for (int i = 0; i < manager->shardCount; i++) {
+        freeEngine(&manager->shards[i]);
+    }
+    if (manager->facilities != NULL) {
+        freePlateDirectory(&manager->directory);
+    }
+    free(manager->facilities);
+    free(manager->shards);
+    manager->facilities = NULL;
+    manager->shards = NULL;
+    manager->facilityCount = 0;
+    manager->shardCount = 0;
+}
+
+// 按设施编号找到设施
+ParkingFacility *managerFacility(FacilityManager *manager, int facilityId) {
+    if (facilityId < 0 || facilityId >= manager->facilityCount) {
+        return NULL;
+    }
+    return &manager->facilities[facilityId];
+}
+
+// 把命令路由到设施所属的分片并等待结果
+int managerExecute(FacilityManager *manager, int facilityId, FacilityCommand *command) {
+    ParkingFacility *facility = managerFacility(manager, facilityId);
+    if (facility == NULL) {
+        command->result = ERR_NOT_FOUND;
+        return ERR_NOT_FOUND;
+    }
+    return facilityExecute(facility, command);
+}
@@ -0,0 +1,33 @@
+#ifndef FACILITY_MANAGER_H
+#define FACILITY_MANAGER_H
+
+#include "facility.h"
+#include "plate_directory.h"
+
+// 多设施管理：一个进程托管多个相互独立的设施。设施按编号分配到分片，
+// 每个分片是一个绑定CPU的引擎线程；命令按设施编号路由到所属分片执行。
+// 每个设施有自己的快照和日志文件，所有设施共用一个跨设施车牌目录和一个后台检查点线程。
+typedef struct {
+    int facilityCount;
+    int shardCount;
+    ParkingFacility *facilities;   // 设施数组（初始化后不能移动）
+    FacilityEngine *shards;        // 分片引擎数组
+    PlateDirectory directory;      // 跨设施车牌目录
+    Checkpointer checkpointer;     // 所有设施共用的后台检查点线程
+    char stateDir[256];            // 状态文件目录
+} FacilityManager;
+
+// 管理者生命周期；shardCount 为0时按CPU数量取值，journalConfig 为NULL时不记录日志
+int initFacilityManager(FacilityManager *manager, int facilityCount, int shardCount, const SystemConfig *config,
+                        const char *stateDir, const JournalConfig *journalConfig);
+void loadFacilityManager(FacilityManager *manager);
+bool saveFacilityManager(FacilityManager *manager);
+int startFacilityManager(FacilityManager *manager);
+void stopFacilityManager(FacilityManager *manager);
+void freeFacilityManager(FacilityManager *manager);
+
+// 路由：按设施编号找到设施，编号无效时返回NULL
+ParkingFacility *managerFacility(FacilityManager *manager, int facilityId);
+int managerExecute(FacilityManager *manager, int facilityId, FacilityCommand *command);
+
+#endif /* FACILITY_MANAGER_H */
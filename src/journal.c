@@ -0,0 +1,444 @@
+#include "journal.h"
+#include "archive.h"
+#include "crc32.h"
+#include "byte_order.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// 日志记录的磁盘布局（小端序，共64字节）：
+//   0  序列号      u64
+//   8  事件时间    i64
+//  16  费用        f64
+//  24  事件类型    u8
+//  25  车牌长度    u8
+//  26  车牌号      30字节，不足补0
+//  56  保留        u32
+//  60  CRC32       u32，覆盖前60字节
+#define REC_OFF_SEQ    0
+#define REC_OFF_TIME   8
+#define REC_OFF_FEE    16
+#define REC_OFF_TYPE   24
+#define REC_OFF_LEN    25
+#define REC_OFF_PLATE  26
+#define REC_OFF_CRC    60
+
+// 将日志记录编码为磁盘格式
+static void encodeRecord(unsigned char *buf, const JournalRecord *record) {
+    memset(buf, 0, JOURNAL_RECORD_SIZE);
+
+    uint64_t feeBits;
+    memcpy(&feeBits, &record->fee, sizeof(feeBits));
+
+    size_t len = strlen(record->plateNumber);
+    if (len > MAX_PLATE_LEN) {
+        len = MAX_PLATE_LEN;
+    }
+
+    putU64(buf + REC_OFF_SEQ, record->seq);
+    putU64(buf + REC_OFF_TIME, (uint64_t)(int64_t)record->time);
+    putU64(buf + REC_OFF_FEE, feeBits);
+    buf[REC_OFF_TYPE] = (unsigned char)record->type;
+    buf[REC_OFF_LEN] = (unsigned char)len;
+    memcpy(buf + REC_OFF_PLATE, record->plateNumber, len);
+    putU32(buf + REC_OFF_CRC, crc32Update(0, buf, REC_OFF_CRC));
+}
+
+// 解码并校验一条日志记录，校验失败返回false
+static bool decodeRecord(const unsigned char *buf, JournalRecord *record) {
+    if (crc32Update(0, buf, REC_OFF_CRC) != getU32(buf + REC_OFF_CRC)) {
+        return false;
+    }
+
+    size_t len = buf[REC_OFF_LEN];
+    if (len >= MAX_PLATE_LEN) {
+        return false;
+    }
+
+    uint64_t feeBits = getU64(buf + REC_OFF_FEE);
+    record->seq = getU64(buf + REC_OFF_SEQ);
+    record->time = (time_t)(int64_t)getU64(buf + REC_OFF_TIME);
+    memcpy(&record->fee, &feeBits, sizeof(feeBits));
+    record->type = (JournalEventType)buf[REC_OFF_TYPE];
+    memcpy(record->plateNumber, buf + REC_OFF_PLATE, len);
+    record->plateNumber[len] = '\0';
+
+    return record->type == JOURNAL_ARRIVE || record->type == JOURNAL_LEAVE || record->type == JOURNAL_PROMOTE ||
+           record->type == JOURNAL_CANCEL;
+}
+
+// 将文件截断到指定长度，用于丢弃崩溃时写了一半的尾部记录
+static bool truncateFile(const char *path, long length) {
+#ifdef _WIN32
+    FILE *file = fopen(path, "r+b");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = _chsize(_fileno(file), length) == 0;
+    fclose(file);
+    return ok;
+#else
+    return truncate(path, (off_t)length) == 0;
+#endif
+}
+
+// 初始化日志配置为默认值
+void initJournalConfig(JournalConfig *config) {
+    config->groupCommitSize = 1;
+    config->fsyncPolicy = FSYNC_BATCH;
+    config->compactThreshold = 1000;
+    config->checkpointInterval = 60;
+}
+
+// 解析刷盘策略名称（never/batch/always）
+bool parseFsyncPolicy(const char *name, FsyncPolicy *policy) {
+    if (strcmp(name, "never") == 0) {
+        *policy = FSYNC_NEVER;
+    } else if (strcmp(name, "batch") == 0) {
+        *policy = FSYNC_BATCH;
+    } else if (strcmp(name, "always") == 0) {
+        *policy = FSYNC_ALWAYS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 打开日志：扫描已有记录确定下一个序列号，并截掉损坏的尾部
+int journalOpen(Journal *journal, const char *journalPath, const char *snapshotPath, const JournalConfig *config) {
+    memset(journal, 0, sizeof(Journal));
+    snprintf(journal->journalPath, sizeof(journal->journalPath), "%s", journalPath);
+    snprintf(journal->snapshotPath, sizeof(journal->snapshotPath), "%s", snapshotPath);
+    if (config != NULL) {
+        journal->config = *config;
+    } else {
+        initJournalConfig(&journal->config);
+    }
+    if (journal->config.groupCommitSize < 1) {
+        journal->config.groupCommitSize = 1;
+    }
+    journal->nextSeq = 1;
+
+    // 上次检查点轮换出的日志（检查点完成前进程退出时留下），其中的序列号都比当前日志小
+    char oldPath[sizeof(journal->journalPath) + 4];
+    journalOldPath(journal, oldPath, sizeof(oldPath));
+    FILE *file = fopen(oldPath, "rb");
+    if (file != NULL) {
+        unsigned char buf[JOURNAL_RECORD_SIZE];
+        JournalRecord record;
+        while (fread(buf, JOURNAL_RECORD_SIZE, 1, file) == 1 && decodeRecord(buf, &record) &&
+               record.seq >= journal->nextSeq) {
+            journal->nextSeq = record.seq + 1;
+        }
+        fclose(file);
+    }
+
+    file = fopen(journalPath, "rb");
+    if (file != NULL) {
+        unsigned char buf[JOURNAL_RECORD_SIZE];
+        long validBytes = 0;
+        bool torn = false;
+        JournalRecord record;
+
+        while (1) {
+            size_t n = fread(buf, 1, JOURNAL_RECORD_SIZE, file);
+            if (n == 0) {
+                break;
+            }
+            if (n != JOURNAL_RECORD_SIZE || !decodeRecord(buf, &record) || record.seq < journal->nextSeq) {
+                torn = true;
+                break;
+            }
+            journal->nextSeq = record.seq + 1;
+            journal->recordCount++;
+            validBytes += JOURNAL_RECORD_SIZE;
+        }
+        fclose(file);
+
+        if (torn && !truncateFile(journalPath, validBytes)) {
+            printf("无法修复日志文件！\n");
+            return ERR_IO;
+        }
+    }
+
+    journal->file = fopen(journalPath, "ab");
+    if (journal->file == NULL) {
+        printf("无法打开日志文件！\n");
+        return ERR_IO;
+    }
+    return SUCCESS;
+}
+
+// 追加一条事件记录到组提交缓冲区
+int journalAppend(Journal *journal, JournalEventType type, const Car *car, time_t when, double fee) {
+    if (journal != NULL && journal->failed) {
+        return ERR_IO;
+    }
+    if (journal == NULL || journal->file == NULL) {
+        return ERR_EMPTY;
+    }
+
+    if (journal->pendingCount == JOURNAL_MAX_PENDING && journalFlush(journal) != SUCCESS) {
+        return ERR_IO;
+    }
+
+    JournalRecord record;
+    record.seq = journal->nextSeq++;
+    record.type = type;
+    record.time = when;
+    record.fee = fee;
+    formatPlate(car->plate, record.plateNumber, sizeof(record.plateNumber));
+
+    encodeRecord(journal->pending[journal->pendingCount++], &record);
+    journal->recordCount++;
+    return SUCCESS;
+}
+
+// 提交一个完整事件（一个事件可能包含多条记录），按组提交策略决定是否写出（由引擎按批写出时
+// 不写出）；写出或刷盘失败时返回 ERR_IO，事件没有持久化
+int journalCommit(Journal *journal) {
+    if (journal == NULL) {
+        return SUCCESS;
+    }
+    if (journal->failed) {
+        return ERR_IO;
+    }
+
+    journal->uncommittedEvents++;
+    if (journal->deferFlush) {
+        return SUCCESS;
+    }
+    if (journal->config.fsyncPolicy == FSYNC_ALWAYS ||
+        journal->uncommittedEvents >= journal->config.groupCommitSize) {
+        return journalFlush(journal);
+    }
+    return SUCCESS;
+}
+
+// 将缓冲区中的记录一次性写出，并按策略刷盘；失败时返回 ERR_IO，之后的写入都失败
+int journalFlush(Journal *journal) {
+    if (journal != NULL && journal->failed) {
+        return ERR_IO;
+    }
+    if (journal == NULL || journal->file == NULL) {
+        return ERR_EMPTY;
+    }
+
+    if (journal->pendingCount > 0) {
+        // 写了一半的记录可能已经进入文件，重试会在中间留下残缺记录，所以失败后不再写入
+        size_t n = fwrite(journal->pending, JOURNAL_RECORD_SIZE, (size_t)journal->pendingCount, journal->file);
+        bool ok = n == (size_t)journal->pendingCount;
+        if (ok) {
+            ok = journal->config.fsyncPolicy != FSYNC_NEVER ? flushFileToDisk(journal->file) : fflush(journal->file) == 0;
+        }
+        if (!ok) {
+            printf("写入日志文件失败！\n");
+            journal->failed = true;
+            return ERR_IO;
+        }
+        journal->pendingCount = 0;
+        journal->flushes++;
+    }
+
+    journal->uncommittedEvents = 0;
+    return SUCCESS;
+}
+
+// 关闭日志，写出缓冲区中剩余的记录
+void journalClose(Journal *journal) {
+    if (journal == NULL || journal->file == NULL) {
+        return;
+    }
+    journalFlush(journal);
+    fclose(journal->file);
+    journal->file = NULL;
+}
+
+// 将一条日志记录重新作用到内存状态上
+static bool applyRecord(const JournalRecord *record, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats) {
+    switch (record->type) {
+        case JOURNAL_ARRIVE: {
+            if (isCarExists(parkingLot, waitingLane, record->plateNumber)) {
+                return false;
+            }
+            Car car = createCar(record->plateNumber);
+            car.arriveTime = record->time;
+            bool ok = !isStackFull(parkingLot) ? push(parkingLot, car) == SUCCESS : enqueue(waitingLane, car) == SUCCESS;
+            if (ok && stats != NULL) {
+                streamRecordArrival(&stats->stream, record->time, getStackCount(parkingLot), getQueueCount(waitingLane));
+            }
+            return ok;
+        }
+
+        case JOURNAL_LEAVE: {
+            int position = findCarPosition(parkingLot, record->plateNumber);
+            if (position == -1) {
+                return false;
+            }
+            Car car = removeCarAt(parkingLot, position);
+            if (stats != NULL) {
+                stats->totalCars++;
+                stats->totalRevenue += record->fee;
+                streamRecordDeparture(&stats->stream, record->time, car.arriveTime, record->fee);
+            }
+            // 归档中已有的会话按序列号跳过，崩溃前没来得及写入归档的会话在这里补上
+            if (parkingLot->archive != NULL) {
+                car.leaveTime = record->time;
+                archiveAppend(parkingLot->archive, &car, record->fee, record->seq);
+            }
+            return true;
+        }
+
+        case JOURNAL_PROMOTE: {
+            // 按车牌号取出：优先级策略在重启前后改变时，入场的车辆不一定在队头
+            int position = findQueuePosition(waitingLane, lookupPlate(record->plateNumber, MAX_PLATE_LEN - 1));
+            if (position == -1 || isStackFull(parkingLot)) {
+                return false;
+            }
+            Car car = removeQueueAt(waitingLane, position);
+            car.arriveTime = record->time;
+            return push(parkingLot, car) == SUCCESS;
+        }
+
+        case JOURNAL_CANCEL: {
+            int position = findQueuePosition(waitingLane, lookupPlate(record->plateNumber, MAX_PLATE_LEN - 1));
+            if (position == -1) {
+                return false;
+            }
+            removeQueueAt(waitingLane, position);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 重放一个日志文件中快照之后的记录，返回重放的记录数
+static int replayFile(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t snapshotSeq) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    unsigned char buf[JOURNAL_RECORD_SIZE];
+    JournalRecord record;
+    int replayed = 0;
+
+    while (fread(buf, JOURNAL_RECORD_SIZE, 1, file) == 1) {
+        if (!decodeRecord(buf, &record)) {
+            break;
+        }
+        if (record.seq <= snapshotSeq) {
+            continue; // 已包含在快照中
+        }
+        if (!applyRecord(&record, parkingLot, waitingLane, stats)) {
+            printf("日志记录 #%llu 与当前状态不一致，已跳过\n", (unsigned long long)record.seq);
+            continue;
+        }
+        replayed++;
+    }
+
+    fclose(file);
+    return replayed;
+}
+
+// 重放快照之后的日志记录（先重放轮换出的旧日志），返回重放的记录数，失败返回-1
+int journalReplay(Journal *journal, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t snapshotSeq) {
+    if (journal == NULL) {
+        return -1;
+    }
+
+    if (journal->nextSeq <= snapshotSeq) {
+        journal->nextSeq = snapshotSeq + 1;
+    }
+
+    char oldPath[sizeof(journal->journalPath) + 4];
+    journalOldPath(journal, oldPath, sizeof(oldPath));
+    int replayed = replayFile(oldPath, parkingLot, waitingLane, stats, snapshotSeq);
+    return replayed + replayFile(journal->journalPath, parkingLot, waitingLane, stats, snapshotSeq);
+}
+
+// 日志是否已经足够长，需要压缩为快照
+bool journalNeedsCompaction(Journal *journal) {
+    return journal != NULL && journal->config.compactThreshold > 0 &&
+           journal->recordCount >= journal->config.compactThreshold;
+}
+
+// 压缩：把当前状态写成快照（临时文件+原子替换），然后清空日志
+bool journalCompact(Journal *journal, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats) {
+    if (journal == NULL || journal->file == NULL) {
+        return false;
+    }
+
+    // 先写出缓冲记录，这样即使快照写入失败日志也是完整的
+    if (journalFlush(journal) != SUCCESS) {
+        return false;
+    }
+    uint64_t snapshotSeq = journal->nextSeq - 1;
+
+    // 清空日志前归档必须已落盘，否则崩溃后无法从日志补上被清除记录对应的会话
+    if (parkingLot->archive != NULL && archiveSync(parkingLot->archive) != SUCCESS) {
+        printf("无法写入会话归档！\n");
+        return false;
+    }
+
+    char tempPath[sizeof(journal->snapshotPath) + 4];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", journal->snapshotPath);
+    if (!saveSystemStateTo(tempPath, parkingLot, waitingLane, stats, snapshotSeq) ||
+        !replaceFile(tempPath, journal->snapshotPath)) {
+        printf("无法写入快照文件！\n");
+        return false;
+    }
+
+    // 快照已落盘，此时即使在清空日志前崩溃，重放也会跳过快照已包含的记录
+    char oldPath[sizeof(journal->journalPath) + 4];
+    journalOldPath(journal, oldPath, sizeof(oldPath));
+    remove(oldPath);
+    fclose(journal->file);
+    journal->file = fopen(journal->journalPath, "wb");
+    if (journal->file == NULL) {
+        // 没有日志文件后的变更都无法持久化，之后的写入都要失败
+        printf("无法重建日志文件！\n");
+        journal->failed = true;
+        return false;
+    }
+    journal->recordCount = 0;
+    return true;
+}
+
+// 轮换出的旧日志路径
+void journalOldPath(const Journal *journal, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s" JOURNAL_OLD_SUFFIX, journal->journalPath);
+}
+
+// 轮换：写出缓冲记录后把日志改名为旧日志，之后的记录写入新的日志文件。
+// 只做改名，不刷盘；旧日志要等包含其全部记录的快照落盘后才能删除。
+// 上一个旧日志还没删除时不轮换（返回false），记录继续追加到当前日志，由下一次检查点处理。
+bool journalRotate(Journal *journal) {
+    if (journal == NULL || journal->file == NULL || journalFlush(journal) != SUCCESS) {
+        return false;
+    }
+    char oldPath[sizeof(journal->journalPath) + 4];
+    journalOldPath(journal, oldPath, sizeof(oldPath));
+    FILE *existing = fopen(oldPath, "rb");
+    if (existing != NULL) {
+        fclose(existing);
+        return false;
+    }
+
+    fclose(journal->file);
+    bool rotated = rename(journal->journalPath, oldPath) == 0;
+    journal->file = fopen(journal->journalPath, "ab");
+    if (journal->file == NULL) {
+        // 与压缩相同：没有日志文件后的变更都无法持久化，之后的写入都要失败
+        printf("无法重建日志文件！\n");
+        journal->failed = true;
+        return false;
+    }
+    if (rotated) {
+        journal->recordCount = 0;
+    }
+    return rotated;
+}
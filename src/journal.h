@@ -0,0 +1,84 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include "parking.h"
+
+// 默认文件名
+#define JOURNAL_FILE "parking_state.journal"
+#define JOURNAL_OLD_SUFFIX ".old"   // 检查点轮换出、等待快照落盘后删除的旧日志
+
+// 日志记录在磁盘上的固定长度（字节）
+#define JOURNAL_RECORD_SIZE 64
+
+// 内存中最多缓存的未写出记录数
+#define JOURNAL_MAX_PENDING 256
+
+// 日志事件类型
+typedef enum {
+    JOURNAL_ARRIVE = 1,   // 车辆到达（进入停车场或便道）
+    JOURNAL_LEAVE = 2,    // 车辆离开停车场
+    JOURNAL_PROMOTE = 3,  // 便道车辆进入停车场
+    JOURNAL_CANCEL = 4    // 便道车辆未入场离开
+} JournalEventType;
+
+// 刷盘策略
+typedef enum {
+    FSYNC_NEVER = 0,      // 只写入文件，由操作系统决定何时落盘
+    FSYNC_BATCH = 1,      // 每次组提交写出后执行一次fsync
+    FSYNC_ALWAYS = 2      // 每个事件提交后立即写出并fsync
+} FsyncPolicy;
+
+// 日志配置
+typedef struct {
+    int groupCommitSize;        // 组提交：累计多少个事件写出一次
+    FsyncPolicy fsyncPolicy;    // 刷盘策略
+    int compactThreshold;       // 日志中的记录数超过该值时建议压缩为快照
+    int checkpointInterval;     // 距上次检查点超过该秒数且有新事件时写检查点（0表示只按记录数）
+} JournalConfig;
+
+// 单条日志记录
+typedef struct {
+    uint64_t seq;                      // 序列号（单调递增）
+    JournalEventType type;             // 事件类型
+    time_t time;                       // 事件发生时间
+    double fee;                        // 离开事件的停车费用
+    char plateNumber[MAX_PLATE_LEN];   // 车牌号
+} JournalRecord;
+
+// 追加式事件日志
+typedef struct Journal {
+    FILE *file;                                   // 以追加方式打开的日志文件
+    char journalPath[256];                        // 日志文件路径
+    char snapshotPath[256];                       // 快照文件路径
+    JournalConfig config;                         // 日志配置
+    uint64_t nextSeq;                             // 下一条记录的序列号
+    int recordCount;                              // 日志文件中（含缓冲）的记录数
+    int uncommittedEvents;                        // 自上次写出以来提交的事件数
+    unsigned char pending[JOURNAL_MAX_PENDING][JOURNAL_RECORD_SIZE]; // 组提交缓冲区
+    int pendingCount;                             // 缓冲区中的记录数
+    bool failed;                                  // 写出或刷盘失败过：文件中的内容不再可信，之后的写入都失败，
+                                                  // 重启后从磁盘上的快照和日志恢复
+    bool deferFlush;                              // 由引擎在一批命令结束时统一写出，提交时只追加不写出
+    long flushes;                                 // 写出（并按策略刷盘）的次数
+} Journal;
+
+// 日志配置
+void initJournalConfig(JournalConfig *config);
+bool parseFsyncPolicy(const char *name, FsyncPolicy *policy);
+
+// 日志操作
+int journalOpen(Journal *journal, const char *journalPath, const char *snapshotPath, const JournalConfig *config);
+int journalAppend(Journal *journal, JournalEventType type, const Car *car, time_t when, double fee);
+int journalCommit(Journal *journal);
+int journalFlush(Journal *journal);
+void journalClose(Journal *journal);
+
+// 恢复与压缩
+int journalReplay(Journal *journal, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t snapshotSeq);
+bool journalNeedsCompaction(Journal *journal);
+bool journalCompact(Journal *journal, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats);
+void journalOldPath(const Journal *journal, char *buffer, size_t size);
+bool journalRotate(Journal *journal);
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,204 @@
+#include "lane_policy.h"
+#include "tariff.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+
+// 便道优先级文件格式：
+//   [boost]                    # 各类车辆的提前量（分钟）
+//   permit = 30
+//   charger = 15
+//   accessible = 60
+//   new_energy = charger       # 未登记的新能源车辆的类别（normal 表示不优先）
+//   [vehicles]                 # 登记的车辆：车牌号 = permit|charger|accessible|normal
+//   京A12345 = permit
+
+static const char *laneClassNames[LANE_CLASS_COUNT] = { "normal", "permit", "charger", "accessible" };
+
+void initLanePolicy(LanePolicy *policy) {
+    policy->boostSeconds[LANE_CLASS_NORMAL] = 0;
+    policy->boostSeconds[LANE_CLASS_PERMIT] = 30 * 60;
+    policy->boostSeconds[LANE_CLASS_CHARGER] = 15 * 60;
+    policy->boostSeconds[LANE_CLASS_ACCESSIBLE] = 60 * 60;
+    policy->newEnergyClass = LANE_CLASS_CHARGER;
+    policy->registrations = NULL;
+    policy->count = 0;
+    policy->capacity = 0;
+}
+
+void freeLanePolicy(LanePolicy *policy) {
+    free(policy->registrations);
+    policy->registrations = NULL;
+    policy->count = 0;
+    policy->capacity = 0;
+}
+
+bool parseLaneClass(const char *name, LaneClass *laneClass) {
+    for (int c = 0; c < LANE_CLASS_COUNT; c++) {
+        if (strcmp(name, laneClassNames[c]) == 0) {
+            *laneClass = (LaneClass)c;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *laneClassName(LaneClass laneClass) {
+    return laneClass >= 0 && laneClass < LANE_CLASS_COUNT ? laneClassNames[laneClass] : "normal";
+}
+
+// 去掉首尾空白和行尾注释
+static char *trimLine(char *str) {
+    char *comment = strchr(str, '#');
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+    while (isspace((unsigned char)*str)) {
+        str++;
+    }
+    size_t len = strlen(str);
+    while (len > 0 && isspace((unsigned char)str[len - 1])) {
+        str[--len] = '\0';
+    }
+    return str;
+}
+
+// 解析提前量（分钟），整个字符串都必须是数字，换算成秒后不能溢出
+static bool parseBoostMinutes(const char *text, int *seconds) {
+    char *end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || parsed < 0 || parsed > INT_MAX / 60) {
+        return false;
+    }
+    *seconds = (int)parsed * 60;
+    return true;
+}
+
+static int compareRegistrations(const void *a, const void *b) {
+    PackedPlate x = ((const LaneRegistration *)a)->plate;
+    PackedPlate y = ((const LaneRegistration *)b)->plate;
+    return x < y ? -1 : x > y;
+}
+
+// 登记一辆车（按需倍增）
+static int addRegistration(LanePolicy *policy, PackedPlate plate, LaneClass laneClass) {
+    if (policy->count == policy->capacity) {
+        int capacity = policy->capacity > 0 ? policy->capacity * 2 : 64;
+        LaneRegistration *registrations =
+            (LaneRegistration *)realloc(policy->registrations, (size_t)capacity * sizeof(LaneRegistration));
+        if (registrations == NULL) {
+            printf("内存分配失败！\n");
+            return ERR_MEMORY;
+        }
+        policy->registrations = registrations;
+        policy->capacity = capacity;
+    }
+    policy->registrations[policy->count].plate = plate;
+    policy->registrations[policy->count].laneClass = laneClass;
+    policy->count++;
+    return SUCCESS;
+}
+
+bool loadLanePolicy(LanePolicy *policy, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("无法打开便道优先级文件: %s\n", path);
+        return false;
+    }
+
+    enum { SECTION_NONE, SECTION_BOOST, SECTION_VEHICLES } section = SECTION_NONE;
+    bool ok = true;
+    char line[256];
+    int lineNumber = 0;
+
+    while (ok && fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *text = trimLine(line);
+        if (text[0] == '\0') {
+            continue;
+        }
+
+        if (text[0] == '[') {
+            if (strcmp(text, "[boost]") == 0) {
+                section = SECTION_BOOST;
+            } else if (strcmp(text, "[vehicles]") == 0) {
+                section = SECTION_VEHICLES;
+            } else {
+                printf("便道优先级文件 %s 第 %d 行：未知的小节 %s\n", path, lineNumber, text);
+                ok = false;
+            }
+            continue;
+        }
+
+        char *eq = strchr(text, '=');
+        if (eq == NULL || section == SECTION_NONE) {
+            printf("便道优先级文件 %s 第 %d 行格式错误\n", path, lineNumber);
+            ok = false;
+            continue;
+        }
+        *eq = '\0';
+        char *key = trimLine(text);
+        char *value = trimLine(eq + 1);
+        LaneClass laneClass;
+
+        if (section == SECTION_BOOST) {
+            if (strcmp(key, "new_energy") == 0) {
+                if (!parseLaneClass(value, &policy->newEnergyClass)) {
+                    printf("便道优先级文件 %s 第 %d 行：未知的类别 %s\n", path, lineNumber, value);
+                    ok = false;
+                }
+            } else if (!parseLaneClass(key, &laneClass) || laneClass == LANE_CLASS_NORMAL ||
+                       !parseBoostMinutes(value, &policy->boostSeconds[laneClass])) {
+                printf("便道优先级文件 %s 第 %d 行：无效的提前量 %s = %s\n", path, lineNumber, key, value);
+                ok = false;
+            }
+        } else {
+            if (!isValidPlateNumber(key) || !parseLaneClass(value, &laneClass)) {
+                printf("便道优先级文件 %s 第 %d 行：无效的登记 %s = %s\n", path, lineNumber, key, value);
+                ok = false;
+            } else if (addRegistration(policy, encodePlate(key, MAX_PLATE_LEN - 1), laneClass) != SUCCESS) {
+                ok = false;
+            }
+        }
+    }
+    fclose(file);
+
+    if (ok && policy->count > 0) {
+        qsort(policy->registrations, (size_t)policy->count, sizeof(LaneRegistration), compareRegistrations);
+        for (int i = 1; i < policy->count; i++) {
+            if (policy->registrations[i].plate == policy->registrations[i - 1].plate) {
+                char plateNumber[MAX_PLATE_LEN];
+                formatPlate(policy->registrations[i].plate, plateNumber, sizeof(plateNumber));
+                printf("便道优先级文件 %s：车辆 %s 重复登记\n", path, plateNumber);
+                ok = false;
+                break;
+            }
+        }
+    }
+    if (!ok) {
+        freeLanePolicy(policy);
+    }
+    return ok;
+}
+
+LaneClass laneClassOf(const LanePolicy *policy, PackedPlate plate) {
+    int low = 0;
+    int high = policy->count - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        PackedPlate current = policy->registrations[mid].plate;
+        if (current == plate) {
+            return policy->registrations[mid].laneClass;
+        }
+        if (current < plate) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    if (policy->newEnergyClass != LANE_CLASS_NORMAL && classifyPlate(plate) == VEHICLE_NEW_ENERGY) {
+        return policy->newEnergyClass;
+    }
+    return LANE_CLASS_NORMAL;
+}
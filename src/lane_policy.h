@@ -0,0 +1,45 @@
+#ifndef LANE_POLICY_H
+#define LANE_POLICY_H
+
+#include "parking.h"
+
+// 便道排队类别
+typedef enum {
+    LANE_CLASS_NORMAL = 0,      // 普通车辆
+    LANE_CLASS_PERMIT = 1,      // 月租或通行证车辆
+    LANE_CLASS_CHARGER = 2,     // 分配了充电车位的新能源车辆
+    LANE_CLASS_ACCESSIBLE = 3,  // 无障碍车辆
+    LANE_CLASS_COUNT
+} LaneClass;
+
+// 登记的车辆
+typedef struct {
+    PackedPlate plate;
+    LaneClass laneClass;
+} LaneRegistration;
+
+// 便道优先级策略：每类车辆有一个提前量，便道按“到达时间 - 提前量”排序，相同时按入队顺序。
+// 便道上所有车辆的等候时间同时增长，所以这等价于按“提前量 + 已等候时间”老化：优先车辆
+// 最多比普通车辆提前这么久，普通车辆等得足够久之后排在新到的优先车辆前面，不会一直被插队。
+typedef struct LanePolicy {
+    int boostSeconds[LANE_CLASS_COUNT]; // 各类车辆的提前量（秒）
+    LaneClass newEnergyClass;           // 未登记的新能源车辆的类别
+    LaneRegistration *registrations;    // 登记的车辆（按车牌编码排序，二分查找）
+    int count;
+    int capacity;
+} LanePolicy;
+
+// 默认提前量：月租30分钟，充电15分钟，无障碍60分钟；新能源车辆按充电车辆排队
+void initLanePolicy(LanePolicy *policy);
+void freeLanePolicy(LanePolicy *policy);
+
+// 读取便道优先级文件（[boost] 小节设置提前量，[vehicles] 小节登记车辆），格式错误时返回false
+bool loadLanePolicy(LanePolicy *policy, const char *path);
+
+bool parseLaneClass(const char *name, LaneClass *laneClass);
+const char *laneClassName(LaneClass laneClass);
+
+// 车辆的排队类别：先查登记表，未登记的新能源车辆按 newEnergyClass，其余为普通车辆
+LaneClass laneClassOf(const LanePolicy *policy, PackedPlate plate);
+
+#endif /* LANE_POLICY_H */
@@ -1,20 +1,32 @@
 #include "parking.h"
 #include "colors.h"
+#include "facility.h"
+#include "replay.h"
+#include "query.h"
+#include "render.h"
+#include "server.h"
+#include "simulate.h"
+#include "tariff.h"
+#include "lane_policy.h"
 
-// 打印菜单
+// 打印菜单（整个菜单写入缓冲后一次输出）
 void printMenu() {
-    printf("\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s║              %s停车场管理系统 - 主菜单%s%s                          ║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_YELLOW, COLOR_CYAN, STYLE_BOLD, COLOR_RESET);
-    printf("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s║%s  %s1.%s 车辆进入停车场                                            %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s║%s  %s2.%s 车辆离开停车场                                            %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s║%s  %s3.%s 显示停车场当前状态                                        %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s║%s  %s4.%s 显示系统统计信息                                          %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s║%s  %s5.%s 保存系统状态                                              %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s║%s  %s6.%s 显示使用帮助                                              %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s║%s  %s0.%s 退出系统                                                  %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_RED, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
-    printf("%s请输入操作命令 [0-6]:%s ", COLOR_YELLOW, COLOR_RESET);
+    RenderBuffer buffer;
+    initRenderBuffer(&buffer);
+    renderAppend(&buffer, "\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s║              %s停车场管理系统 - 主菜单%s%s                          ║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_YELLOW, COLOR_CYAN, STYLE_BOLD, COLOR_RESET);
+    renderAppend(&buffer, "%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s║%s  %s1.%s 车辆进入停车场                                            %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s║%s  %s2.%s 车辆离开停车场                                            %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s║%s  %s3.%s 显示停车场当前状态                                        %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s║%s  %s4.%s 显示系统统计信息                                          %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s║%s  %s5.%s 保存系统状态                                              %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s║%s  %s6.%s 显示使用帮助                                              %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_GREEN, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s║%s  %s0.%s 退出系统                                                  %s%s║%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET, COLOR_RED, COLOR_BRIGHT_WHITE, STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s%s╚═══════════════════════════════════════════════════════════════╝%s\n", STYLE_BOLD, COLOR_CYAN, COLOR_RESET);
+    renderAppend(&buffer, "%s请输入操作命令 [0-6]:%s ", COLOR_YELLOW, COLOR_RESET);
+    renderFlush(&buffer);
+    freeRenderBuffer(&buffer);
 }
 
 // 清空输入缓冲区
@@ -54,6 +66,31 @@ int getMenuChoice() {
     return choice;
 }
 
+// 分页显示停车场状态：回车显示下一页（最后一页时返回菜单），输入页码跳转，输入 q 返回菜单
+static void showParkingStatus(ParkingFacility *facility) {
+    char buffer[32];
+    int page = 0;
+    int pages = displayParkingStatus(&facility->lot, &facility->lane, &facility->stats, page);
+    while (pages > 1) {
+        if (page + 1 < pages) {
+            printf("%s回车显示下一页，输入页码跳转，输入 q 返回菜单:%s ", COLOR_YELLOW, COLOR_RESET);
+        } else {
+            printf("%s输入页码跳转，回车返回菜单:%s ", COLOR_YELLOW, COLOR_RESET);
+        }
+        if (fgets(buffer, sizeof(buffer), stdin) == NULL || buffer[0] == 'q' || buffer[0] == 'Q') {
+            break;
+        }
+        if (atoi(buffer) > 0) {
+            page = atoi(buffer) < pages ? atoi(buffer) - 1 : pages - 1;
+        } else if (page + 1 < pages) {
+            page++;
+        } else {
+            break; // 已是最后一页
+        }
+        pages = displayParkingStatus(&facility->lot, &facility->lane, &facility->stats, page);
+    }
+}
+
 // 获取车牌号
 char* getPlateNumber(char *buffer, size_t size) {
     printf("%s请输入车牌号 (例如: 京A12345):%s ", COLOR_CYAN, COLOR_RESET);
@@ -84,23 +121,280 @@ char* getPlateNumber(char *buffer, size_t size) {
     return buffer;
 }
 
+// 计时器到期提醒（在调用线程中触发，交互模式下显示在菜单之前）
+static void printTimerAlert(void *context, TimerKind kind, PackedPlate plate, time_t expires) {
+    (void)context;
+    char plateNumber[MAX_PLATE_LEN];
+    char timeStr[30];
+    formatPlate(plate, plateNumber, sizeof(plateNumber));
+    formatTime(expires, timeStr, sizeof(timeStr));
+    const char *message = kind == TIMER_MAX_STAY    ? "停车已超过最长时长"
+                          : kind == TIMER_GRACE_END ? "免费时长已结束，开始计费"
+                                                    : "在便道等候已超过时限";
+    printf("\n%s%s⏰ %s 车辆 %s%s%s %s%s\n", STYLE_BOLD, COLOR_YELLOW, timeStr, COLOR_BRIGHT_WHITE, plateNumber,
+           COLOR_YELLOW, message, COLOR_RESET);
+}
+
+// 在命令行参数中查找配置文件路径
+static const char *findConfigPath(int argc, char *argv[]) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0) {
+            return argv[i + 1];
+        }
+    }
+    return CONFIG_FILE;
+}
+
+// 解析命令行参数（命令行优先于配置文件）
+static bool parseArguments(int argc, char *argv[], SystemConfig *config, JournalConfig *journalConfig, const char **replayPath,
+                           ReplayLiveOptions *live, ServerOptions *server, bool *serve, QueryOptions *query, SimulationOptions *simulation) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            i++; // 已在加载配置文件时处理
+        } else if ((strcmp(argv[i], "--capacity") == 0 || strcmp(argv[i], "-c") == 0) && i + 1 < argc) {
+            config->parkingCapacity = atoi(argv[++i]);
+            if (config->parkingCapacity < 1 || config->parkingCapacity > MAX_CAPACITY) {
+                printf("无效的停车场容量: %s（1-%d）\n", argv[i], MAX_CAPACITY);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--tariff") == 0 && i + 1 < argc) {
+            snprintf(config->tariffPath, sizeof(config->tariffPath), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--lot-model") == 0 && i + 1 < argc) {
+            if (!parseLotModel(argv[++i], &config->lotModel)) {
+                printf("未知的停车场模型: %s（可选 stack/bays）\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--max-stay") == 0 && i + 1 < argc) {
+            config->maxStayMinutes = atoi(argv[++i]);
+            if (config->maxStayMinutes < 0) {
+                printf("无效的最长停车时长: %s（分钟）\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--lane-timeout") == 0 && i + 1 < argc) {
+            config->laneTimeoutMinutes = atoi(argv[++i]);
+            if (config->laneTimeoutMinutes < 0) {
+                printf("无效的便道等候时限: %s（分钟）\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--lane-policy") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "fifo") != 0 && strcmp(argv[i], "priority") != 0) {
+                printf("未知的便道策略: %s（可选 fifo/priority）\n", argv[i]);
+                return false;
+            }
+            config->lanePriority = strcmp(argv[i], "priority") == 0;
+        } else if (strcmp(argv[i], "--lane-priority") == 0 && i + 1 < argc) {
+            snprintf(config->lanePolicyPath, sizeof(config->lanePolicyPath), "%s", argv[++i]);
+            config->lanePriority = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            *replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--live") == 0) {
+            live->enabled = true;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                live->speed = atof(argv[++i]);
+                if (live->speed < 0) {
+                    printf("无效的重放倍速: %s\n", argv[i]);
+                    return false;
+                }
+            }
+        } else if (strcmp(argv[i], "--serve") == 0) {
+            *serve = true;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                snprintf(server->socketPath, sizeof(server->socketPath), "%s", argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--facilities") == 0 && i + 1 < argc) {
+            server->facilities = atoi(argv[++i]);
+            if (server->facilities < 1) {
+                printf("无效的设施数量: %s\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            server->shards = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--state-dir") == 0 && i + 1 < argc) {
+            snprintf(server->stateDir, sizeof(server->stateDir), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--fsync") == 0 && i + 1 < argc) {
+            if (!parseFsyncPolicy(argv[++i], &journalConfig->fsyncPolicy)) {
+                printf("未知的刷盘策略: %s（可选 never/batch/always）\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--group-commit") == 0 && i + 1 < argc) {
+            journalConfig->groupCommitSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--compact-every") == 0 && i + 1 < argc) {
+            journalConfig->compactThreshold = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint-interval") == 0 && i + 1 < argc) {
+            journalConfig->checkpointInterval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--query") == 0 && i + 1 < argc) {
+            if (!parseQueryType(argv[++i], &query->type)) {
+                printf("未知的查询: %s（可选 plate/revenue/long/daily）\n", argv[i]);
+                return false;
+            }
+            if (query->type == QUERY_PLATE) {
+                if (i + 1 >= argc || !isValidPlateNumber(argv[i + 1])) {
+                    printf("--query plate 需要一个有效的车牌号\n");
+                    return false;
+                }
+                snprintf(query->plateNumber, sizeof(query->plateNumber), "%s", argv[++i]);
+            } else if (query->type == QUERY_LONG_STAY && i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                query->hours = atof(argv[++i]);
+                if (query->hours <= 0) {
+                    printf("无效的停车时长: %s（小时）\n", argv[i]);
+                    return false;
+                }
+            }
+        } else if ((strcmp(argv[i], "--from") == 0 || strcmp(argv[i], "--to") == 0) && i + 1 < argc) {
+            time_t *bound = strcmp(argv[i], "--from") == 0 ? &query->from : &query->to;
+            if (!parseTimestamp(argv[++i], bound)) {
+                printf("无效的时间: %s（格式 YYYY-MM-DD 或 YYYY-MM-DD HH:MM:SS）\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            query->limit = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--archive-dir") == 0 && i + 1 < argc) {
+            snprintf(query->archiveDir, sizeof(query->archiveDir), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--simulate") == 0) {
+            simulation->replications = 1000;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                simulation->replications = atoi(argv[++i]);
+                if (simulation->replications < 1) {
+                    printf("无效的重复次数: %s\n", argv[i]);
+                    return false;
+                }
+            }
+        } else if (strcmp(argv[i], "--capacities") == 0 && i + 1 < argc) {
+            if (!parseSimulationList(argv[++i], simulation->capacities, &simulation->capacityCount, false)) {
+                printf("无效的停车场容量列表: %s（逗号分隔，最多 %d 个）\n", argv[i], SIM_MAX_VARIANTS);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--lane") == 0 && i + 1 < argc) {
+            if (!parseSimulationList(argv[++i], simulation->laneLimits, &simulation->laneCount, true)) {
+                printf("无效的便道长度列表: %s（逗号分隔，unlimited 表示不限，最多 %d 个）\n", argv[i], SIM_MAX_VARIANTS);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            simulation->threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            simulation->traffic.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--vehicles") == 0 && i + 1 < argc) {
+            simulation->traffic.vehicles = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            simulation->traffic.arrivalsPerHour = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--rush") == 0 && i + 1 < argc) {
+            simulation->traffic.rushFactor = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--dwell") == 0 && i + 1 < argc) {
+            if (!parseDwellDistribution(argv[++i], &simulation->traffic.dwell)) {
+                printf("未知的停车时长分布: %s（可选 exp/lognormal/uniform/fixed）\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--dwell-mean") == 0 && i + 1 < argc) {
+            simulation->traffic.dwellMeanMinutes = atof(argv[++i]);
+        } else {
+            printf("用法: %s [--config 文件] [--capacity N] [--tariff 收费方案] [--lot-model stack|bays] [--max-stay 分钟] [--lane-timeout 分钟] [--lane-policy fifo|priority] [--lane-priority 优先级文件] [--fsync never|batch|always] [--group-commit N] [--compact-every N] [--checkpoint-interval 秒] [--replay 事件文件 [--live [倍速]]] [--serve [套接字]] [--facilities N] [--shards N] [--state-dir 目录] [--query plate 车牌|revenue|long [小时]|daily] [--from 时间] [--to 时间] [--limit N] [--archive-dir 目录] [--simulate [重复次数]] [--capacities N,N...] [--lane N,N...|unlimited] [--threads N] [--seed N] [--vehicles N] [--rate 辆/小时] [--rush 倍数] [--dwell exp|lognormal|uniform|fixed] [--dwell-mean 分钟]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
 // 主函数
-int main() {
-    ParkingStack parkingLot, tempLot;
-    WaitingQueue waitingLane;
+int main(int argc, char *argv[]) {
+    ParkingFacility facility;
+    Checkpointer checkpointer;
     SystemConfig config;
-    SystemStats stats;
+    JournalConfig journalConfig;
+    Tariff tariff;
+    LanePolicy lanePolicy;
     char plateBuffer[MAX_PLATE_LEN];
     int result;
+    const char *replayPath = NULL;
+    ReplayLiveOptions replayLive;
+    ServerOptions serverOptions;
+    bool serve = false;
+    QueryOptions queryOptions;
+    SimulationOptions simulationOptions;
+    
+    // 初始化系统，依次应用配置文件和命令行参数
+    initSystem(&config, NULL);
+    initJournalConfig(&journalConfig);
+    initServerOptions(&serverOptions);
+    initQueryOptions(&queryOptions);
+    initSimulationOptions(&simulationOptions);
+    initReplayLiveOptions(&replayLive);
+    loadSystemConfig(&config, findConfigPath(argc, argv));
+    if (!parseArguments(argc, argv, &config, &journalConfig, &replayPath, &replayLive, &serverOptions, &serve, &queryOptions, &simulationOptions)) {
+        return 1;
+    }
+    
+    // 历史查询模式：只读取会话归档，不加载停车场状态
+    if (queryOptions.type != QUERY_NONE) {
+        return runQuery(&queryOptions);
+    }
+    
+    // 加载收费方案：有方案文件时按时段计费，否则按统一费率计费
+    if (config.tariffPath[0] != '\0') {
+        if (!loadTariff(&tariff, config.tariffPath, config.hourlyRate)) {
+            return 1;
+        }
+    } else if (initFlatTariff(&tariff, config.hourlyRate) != SUCCESS) {
+        return 1;
+    }
+    setActiveTariff(&tariff);
+    
+    // 便道优先级策略：未启用时便道先进先出
+    initLanePolicy(&lanePolicy);
+    if (config.lanePriority) {
+        if (config.lanePolicyPath[0] != '\0' && !loadLanePolicy(&lanePolicy, config.lanePolicyPath)) {
+            freeTariff(&tariff);
+            return 1;
+        }
+        setActiveLanePolicy(&lanePolicy);
+    }
+    
+    // 容量规划模拟模式：只用内存中的停车场，不读写状态文件
+    if (simulationOptions.replications > 0) {
+        result = runSimulation(&simulationOptions, &config);
+        freeTariff(&tariff);
+        freeLanePolicy(&lanePolicy);
+        return result;
+    }
+    
+    // 批量重放模式：不进入交互菜单
+    if (replayPath != NULL) {
+        result = runReplay(replayPath, &config, &replayLive);
+        freeTariff(&tariff);
+        freeLanePolicy(&lanePolicy);
+        return result;
+    }
+    
+    // 服务模式：道闸通过Unix域套接字提交请求，不进入交互菜单
+    if (serve) {
+        result = runServer(&serverOptions, &config, &journalConfig);
+        freeTariff(&tariff);
+        freeLanePolicy(&lanePolicy);
+        return result;
+    }
     
-    // 初始化系统
-    initSystem(&config, &stats);
-    initStack(&parkingLot);
-    initStack(&tempLot);
-    initQueue(&waitingLane);
+    // 停车场、便道、车牌号索引和事件日志；车辆进出只追加日志记录，不再整体重写状态文件
+    int initResult = initFacility(&facility, 0, &config, STATE_FILE, JOURNAL_FILE, &journalConfig);
+    if (initResult != SUCCESS) {
+        if (initResult == ERR_IO) {
+            printf("\n%s%s❌ 无法打开事件日志 %s！%s\n", STYLE_BOLD, COLOR_RED, JOURNAL_FILE, COLOR_RESET);
+        } else {
+            printf("\n%s%s❌ 无法分配 %d 个车位！%s\n", STYLE_BOLD, COLOR_RED, config.parkingCapacity, COLOR_RESET);
+        }
+        freeTariff(&tariff);
+        freeLanePolicy(&lanePolicy);
+        return 1;
+    }
+    if (openFacilityArchive(&facility, ARCHIVE_DIR) != SUCCESS) {
+        printf("\n%s%s⚠️ 会话归档不可用，离场记录不会归档！%s\n", STYLE_BOLD, COLOR_YELLOW, COLOR_RESET);
+    }
+    // 快照在后台线程中写出，菜单操作不等待磁盘
+    if (startCheckpointer(&checkpointer) == SUCCESS) {
+        facility.checkpointer = &checkpointer;
+    }
     
     // 尝试加载之前的系统状态
-    if (loadSystemState(&parkingLot, &waitingLane, &stats)) {
+    if (loadFacility(&facility)) {
         printf("\n%s%s✅ 成功加载之前的系统状态！%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
     } else {
         printf("\n%s%s🆕 初始化新的停车场系统！%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
@@ -109,11 +403,14 @@ int main() {
     // 显示欢迎标题
     printf("\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
     printf("%s%s║%s     %s%s🚗 欢迎使用BParking停车场管理系统 v2.0！%s     %s%s             ║%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET, STYLE_BOLD, COLOR_YELLOW, COLOR_RESET, STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
-    printf("%s%s║%s     %s📊 停车场容量: %s%d%s 辆车%s                        %s%s            ║%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, STACKSIZE, COLOR_CYAN, COLOR_RESET, STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+    printf("%s%s║%s     %s📊 停车场容量: %s%d%s 辆车%s                        %s%s            ║%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, facility.lot.capacity, COLOR_CYAN, COLOR_RESET, STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
     printf("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
     
+    facility.timers.callback = printTimerAlert;
+    
     // 主循环
     while (1) {
+        facilityTick(&facility, time(NULL)); // 显示到期的超时提醒
         printMenu();
         
         int choice = getMenuChoice();
@@ -127,7 +424,7 @@ int main() {
         switch (choice) {
             case 1: // 车辆进入
                 if (getPlateNumber(plateBuffer, sizeof(plateBuffer)) != NULL) {
-                    result = parkCar(&parkingLot, &waitingLane, plateBuffer);
+                    result = facilityPark(&facility, plateBuffer, time(NULL));
                     
                     switch (result) {
                         case SUCCESS:
@@ -142,6 +439,10 @@ int main() {
                             printf("\n%s%s⚠️ 车牌号 %s%s%s %s已存在于停车场或便道中！%s\n", 
                                 STYLE_BOLD, COLOR_YELLOW, COLOR_BRIGHT_WHITE, plateBuffer, COLOR_YELLOW, STYLE_BOLD, COLOR_RESET);
                             break;
+                        case ERR_IO:
+                            printf("\n%s%s❌ 事件日志写入失败，本次进场未能保存！%s\n", 
+                                STYLE_BOLD, COLOR_RED, COLOR_RESET);
+                            break;
                         default:
                             printf("\n%s%s❌ 未知错误，车辆无法进入！%s\n", 
                                 STYLE_BOLD, COLOR_RED, COLOR_RESET);
@@ -151,17 +452,36 @@ int main() {
                 
             case 2: // 车辆离开
                 if (getPlateNumber(plateBuffer, sizeof(plateBuffer)) != NULL) {
-                    result = leaveCar(&parkingLot, &tempLot, &waitingLane, plateBuffer, &stats);
+                    result = facilityLeave(&facility, plateBuffer, time(NULL), NULL);
                     
                     switch (result) {
                         case SUCCESS:
                             printf("\n%s%s✅ 车辆 %s%s%s %s已成功离开停车场！%s\n", 
                                 STYLE_BOLD, COLOR_GREEN, COLOR_BRIGHT_WHITE, plateBuffer, COLOR_GREEN, STYLE_BOLD, COLOR_RESET);
+                            if (facility.lot.lastMoves > 0) {
+                                printf("%s为让路挪动车辆 %d 次%s\n", COLOR_CYAN, facility.lot.lastMoves, COLOR_RESET);
+                            }
                             break;
                         case ERR_NOT_FOUND:
+                            // 不在停车场中时，便道上的车辆直接离开便道
+                            result = facilityCancel(&facility, plateBuffer, time(NULL));
+                            if (result == SUCCESS) {
+                                printf("\n%s%s✅ 车辆 %s%s%s %s已离开便道（未入场，不收费）！%s\n", 
+                                    STYLE_BOLD, COLOR_GREEN, COLOR_BRIGHT_WHITE, plateBuffer, COLOR_GREEN, STYLE_BOLD, COLOR_RESET);
+                                break;
+                            }
+                            if (result == ERR_IO) {
+                                printf("\n%s%s❌ 事件日志写入失败，本次离场未能保存！%s\n", 
+                                    STYLE_BOLD, COLOR_RED, COLOR_RESET);
+                                break;
+                            }
                             printf("\n%s%s⚠️ 车牌号 %s%s%s %s不在停车场中！%s\n", 
                                 STYLE_BOLD, COLOR_YELLOW, COLOR_BRIGHT_WHITE, plateBuffer, COLOR_YELLOW, STYLE_BOLD, COLOR_RESET);
                             break;
+                        case ERR_IO:
+                            printf("\n%s%s❌ 事件日志写入失败，本次离场未能保存！%s\n", 
+                                STYLE_BOLD, COLOR_RED, COLOR_RESET);
+                            break;
                         default:
                             printf("\n%s%s❌ 未知错误，车辆无法离开！%s\n", 
                                 STYLE_BOLD, COLOR_RED, COLOR_RESET);
@@ -170,16 +490,22 @@ int main() {
                 break;
                 
             case 3: // 显示停车场状态
-                displayParkingStatus(&parkingLot, &waitingLane, &stats);
+                showParkingStatus(&facility);
                 break;
                 
             case 4: // 显示系统统计信息
-                displaySystemStats(&stats);
+                displaySystemStats(&facility.stats);
                 break;
                 
-            case 5: // 保存系统状态
-                saveSystemState(&parkingLot, &waitingLane, &stats);
-                printf("\n%s%s✅ 系统状态已成功保存！%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
+            case 5: // 保存系统状态（后台写出）
+                result = checkpointFacility(&facility);
+                if (result == SUCCESS) {
+                    printf("\n%s%s✅ 系统状态正在后台保存！%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
+                } else if (result == ERR_FULL) {
+                    printf("\n%s%s⚠️ 上一次保存尚未完成，请稍后再试！%s\n", STYLE_BOLD, COLOR_YELLOW, COLOR_RESET);
+                } else {
+                    printf("\n%s%s❌ 无法保存系统状态！%s\n", STYLE_BOLD, COLOR_RED, COLOR_RESET);
+                }
                 break;
                 
             case 6: // 显示帮助信息
@@ -192,8 +518,13 @@ int main() {
     }
     
     // 保存系统状态并释放资源
-    saveSystemState(&parkingLot, &waitingLane, &stats);
-    clearQueue(&waitingLane);
+    if (!saveFacility(&facility)) {
+        printf("无法保存系统状态！\n");
+    }
+    freeFacility(&facility);
+    stopCheckpointer(&checkpointer);
+    freeTariff(&tariff);
+    freeLanePolicy(&lanePolicy);
     
     return 0;
 }
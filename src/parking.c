@@ -1,61 +1,341 @@
 #include "parking.h"
 #include "colors.h"
+#include "archive.h"
+#include "journal.h"
+#include "plate_index.h"
+#include "tariff.h"
+#include "snapshot.h"
+#include "timer_wheel.h"
+#include "render.h"
+#include "lane_policy.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// 最低位的1所在的位置（x不能为0）
+static int lowestSetBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// 位图需要的64位字数
+static int bitmapWords(int capacity) {
+    return (capacity + 63) / 64;
+}
 
 // 初始化停车场栈
-void initStack(ParkingStack *stack) {
+int initStack(ParkingStack *stack, int capacity) {
+    stack->top = -1;
+    stack->count = 0;
+    stack->model = LOT_MODEL_STACK;
+    stack->freeBays = NULL;
+    stack->freeHint = 0;
+    stack->lastMoves = 0;
+    stack->totalMoves = 0;
+    stack->index = NULL;
+    stack->journal = NULL;
+    stack->archive = NULL;
+    stack->timers = NULL;
+    stack->capacity = 0;
+    stack->data = NULL;
+    return resizeStack(stack, capacity);
+}
+
+// 切换停车场模型（只能在停车场为空时切换）
+int setLotModel(ParkingStack *stack, LotModel model) {
+    if (!isStackEmpty(stack)) {
+        return ERR_EXISTS;
+    }
+    
+    free(stack->freeBays);
+    stack->freeBays = NULL;
+    stack->model = LOT_MODEL_STACK;
+    
+    if (model == LOT_MODEL_BAYS) {
+        stack->model = LOT_MODEL_BAYS;
+        int capacity = stack->capacity;
+        stack->capacity = 0;
+        return resizeStack(stack, capacity);
+    }
+    return SUCCESS;
+}
+
+// 解析停车场模型名称（stack 或 bays）
+bool parseLotModel(const char *name, LotModel *model) {
+    if (strcmp(name, "stack") == 0) {
+        *model = LOT_MODEL_STACK;
+    } else if (strcmp(name, "bays") == 0) {
+        *model = LOT_MODEL_BAYS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 调整停车场容量（不能小于当前占用的最高车位）
+int resizeStack(ParkingStack *stack, int capacity) {
+    if (capacity < stack->top + 1 || capacity < 1 || capacity > MAX_CAPACITY) {
+        return ERR_FULL;
+    }
+    
+    Car *data = (Car *)realloc(stack->data, (size_t)capacity * sizeof(Car));
+    if (data == NULL) {
+        printf("内存分配失败！\n");
+        return ERR_MEMORY;
+    }
+    stack->data = data;
+    
+    // 独立车位模式：同步调整空闲车位位图，新增的车位标记为空闲
+    if (stack->model == LOT_MODEL_BAYS) {
+        int oldWords = bitmapWords(stack->capacity);
+        int words = bitmapWords(capacity);
+        uint64_t *freeBays = (uint64_t *)realloc(stack->freeBays, (size_t)words * sizeof(uint64_t));
+        if (freeBays == NULL) {
+            printf("内存分配失败！\n");
+            return ERR_MEMORY;
+        }
+        for (int w = oldWords; w < words; w++) {
+            freeBays[w] = 0;
+        }
+        for (int slot = stack->capacity; slot < capacity; slot++) {
+            freeBays[slot / 64] |= (uint64_t)1 << (slot % 64);
+        }
+        if (capacity % 64 != 0) {
+            freeBays[words - 1] &= ((uint64_t)1 << (capacity % 64)) - 1;
+        }
+        stack->freeBays = freeBays;
+        stack->freeHint = 0;
+    }
+    
+    stack->capacity = capacity;
+    return SUCCESS;
+}
+
+// 释放停车场车位数组
+void freeStack(ParkingStack *stack) {
+    free(stack->data);
+    free(stack->freeBays);
+    stack->data = NULL;
+    stack->freeBays = NULL;
+    stack->capacity = 0;
+    stack->count = 0;
+    stack->top = -1;
+}
+
+// 清空停车场（保留车位数组）
+void clearStack(ParkingStack *stack) {
+    if (stack->model == LOT_MODEL_BAYS) {
+        int capacity = stack->capacity;
+        stack->capacity = 0;
+        stack->top = -1;
+        resizeStack(stack, capacity); // 重新把所有车位标记为空闲
+    }
     stack->top = -1;
+    stack->count = 0;
 }
 
 // 检查栈是否为空
 bool isStackEmpty(ParkingStack *stack) {
-    return stack->top == -1;
+    return stack->count == 0;
 }
 
 // 检查栈是否已满
 bool isStackFull(ParkingStack *stack) {
-    return stack->top == STACKSIZE - 1;
+    return stack->count == stack->capacity;
+}
+
+// 获取停车场中的车辆数量
+int getStackCount(ParkingStack *stack) {
+    return stack->count;
+}
+
+// 车位上是否有车（栈模式下0..top都有车，独立车位模式查位图）
+bool isSlotOccupied(ParkingStack *stack, int slot) {
+    if (slot < 0 || slot > stack->top) {
+        return false;
+    }
+    if (stack->model == LOT_MODEL_BAYS) {
+        return (stack->freeBays[slot / 64] & ((uint64_t)1 << (slot % 64))) == 0;
+    }
+    return true;
+}
+
+// 独立车位模式：用位扫描找到编号最小的空闲车位并占用
+static int claimFreeBay(ParkingStack *stack) {
+    int words = bitmapWords(stack->capacity);
+    for (int w = stack->freeHint; w < words; w++) {
+        if (stack->freeBays[w] != 0) {
+            int bit = lowestSetBit(stack->freeBays[w]);
+            stack->freeBays[w] &= stack->freeBays[w] - 1;
+            stack->freeHint = w;
+            return w * 64 + bit;
+        }
+    }
+    return -1;
 }
 
-// 入栈操作
+// 独立车位模式：释放车位
+static void releaseBay(ParkingStack *stack, int slot) {
+    stack->freeBays[slot / 64] |= (uint64_t)1 << (slot % 64);
+    if (slot / 64 < stack->freeHint) {
+        stack->freeHint = slot / 64;
+    }
+    // 释放的是最高车位时，把top下移到仍有车的车位
+    while (stack->top >= 0 && !isSlotOccupied(stack, stack->top)) {
+        stack->top--;
+    }
+}
+
+// 入栈操作（独立车位模式下停入编号最小的空闲车位）
 int push(ParkingStack *stack, Car car) {
     if (isStackFull(stack)) {
         return ERR_FULL; // 栈满，无法入栈
     }
-    stack->data[++(stack->top)] = car;
+    
+    int slot;
+    if (stack->model == LOT_MODEL_BAYS) {
+        slot = claimFreeBay(stack);
+        if (slot > stack->top) {
+            stack->top = slot;
+        }
+    } else {
+        slot = ++(stack->top);
+    }
+    stack->data[slot] = car;
+    stack->count++;
+    
+    if (stack->index != NULL &&
+        plateIndexPut(stack->index, car.plate, PLATE_IN_LOT, slot) != SUCCESS) {
+        removeCarAt(stack, slot);
+        return ERR_MEMORY;
+    }
     return SUCCESS; // 入栈成功
 }
 
-// 出栈操作
+// 把车辆停入指定车位（用于恢复快照）；栈模式或车位不可用时按普通入栈处理
+int placeCar(ParkingStack *stack, int slot, Car car) {
+    if (stack->model != LOT_MODEL_BAYS || slot < 0 || slot >= stack->capacity ||
+        isSlotOccupied(stack, slot) || isStackFull(stack)) {
+        return push(stack, car);
+    }
+    
+    stack->freeBays[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    if (slot > stack->top) {
+        stack->top = slot;
+    }
+    stack->data[slot] = car;
+    stack->count++;
+    
+    if (stack->index != NULL &&
+        plateIndexPut(stack->index, car.plate, PLATE_IN_LOT, slot) != SUCCESS) {
+        removeCarAt(stack, slot);
+        return ERR_MEMORY;
+    }
+    return SUCCESS;
+}
+
+// 出栈操作（取出编号最大的车位上的车）
 Car pop(ParkingStack *stack) {
     Car emptyCar = {0};
     if (isStackEmpty(stack)) {
         return emptyCar; // 栈空，返回空车
     }
+    if (stack->model == LOT_MODEL_BAYS) {
+        return removeCarAt(stack, stack->top);
+    }
+    if (stack->index != NULL) {
+        plateIndexRemove(stack->index, stack->data[stack->top].plate);
+    }
+    stack->count--;
     return stack->data[(stack->top)--];
 }
 
+// 移除指定位置的车辆：栈模式下上方车辆依次下移，独立车位模式下直接空出车位
+Car removeCarAt(ParkingStack *stack, int position) {
+    Car emptyCar = {0};
+    if (!isSlotOccupied(stack, position)) {
+        return emptyCar;
+    }
+
+    Car car = stack->data[position];
+    if (stack->index != NULL) {
+        plateIndexRemove(stack->index, car.plate);
+    }
+    stack->count--;
+    
+    if (stack->model == LOT_MODEL_BAYS) {
+        releaseBay(stack, position);
+        return car;
+    }
+    
+    memmove(&stack->data[position], &stack->data[position + 1],
+            (size_t)(stack->top - position) * sizeof(Car));
+    stack->top--;
+    
+    // 下移车辆的位置减一
+    if (stack->index != NULL) {
+        for (int i = position; i <= stack->top; i++) {
+            plateIndexPut(stack->index, stack->data[i].plate, PLATE_IN_LOT, i);
+        }
+    }
+    return car;
+}
+
 // 显示停车场栈内容
 void displayStack(ParkingStack *stack) {
-    printf("停车场内车辆（从北到南）：\n");
+    RenderBuffer buffer;
+    initRenderBuffer(&buffer);
+    renderAppend(&buffer, "停车场内车辆（从北到南）：\n");
     if (isStackEmpty(stack)) {
-        printf("停车场内没有车辆\n");
-        return;
+        renderAppend(&buffer, "停车场内没有车辆\n");
     }
-    
     for (int i = 0; i <= stack->top; i++) {
-        printf("位置 %d: 车牌号 %s\n", i + 1, stack->data[i].plateNumber);
+        if (isSlotOccupied(stack, i)) {
+            char plateNumber[MAX_PLATE_LEN];
+            formatPlate(stack->data[i].plate, plateNumber, sizeof(plateNumber));
+            renderAppend(&buffer, "位置 %d: 车牌号 %s\n", i + 1, plateNumber);
+        }
     }
+    renderFlush(&buffer);
+    freeRenderBuffer(&buffer);
+}
+
+// 新建的便道使用的优先级策略（为NULL时先进先出），与收费方案一样在启动时设置一次
+static const LanePolicy *activeLanePolicy = NULL;
+
+void setActiveLanePolicy(const LanePolicy *policy) {
+    activeLanePolicy = policy;
 }
 
 // 初始化便道队列
 void initQueue(WaitingQueue *queue) {
-    queue->front = queue->rear = NULL;
+    queue->slots = NULL;
+    queue->capacity = 0;
+    queue->head = 0;
     queue->count = 0;
+    queue->index = NULL;
+    queue->policy = activeLanePolicy;
+    queue->keys = NULL;
+    queue->nextSeq = 0;
 }
 
 // 检查队列是否为空
 bool isQueueEmpty(WaitingQueue *queue) {
-    return queue->front == NULL;
+    return queue->count == 0;
 }
 
 // 获取队列中的车辆数量
@@ -63,25 +343,120 @@ int getQueueCount(WaitingQueue *queue) {
     return queue->count;
 }
 
-// 入队操作
-int enqueue(WaitingQueue *queue, Car car) {
-    QueueNode *newNode = (QueueNode *)malloc(sizeof(QueueNode));
-    if (newNode == NULL) {
+// 获取队列中第position辆车（从0开始，队头为0）；优先级模式下按堆中的下标，除队头外不是出队顺序
+Car *queueAt(WaitingQueue *queue, int position) {
+    int i = queue->head + position;
+    if (i >= queue->capacity) {
+        i -= queue->capacity;
+    }
+    return &queue->slots[i];
+}
+
+// 缓冲区已满时扩容为原来的两倍，并把车辆按队列顺序搬到开头
+static int growQueue(WaitingQueue *queue) {
+    int capacity = queue->capacity > 0 ? queue->capacity * 2 : 16;
+    Car *slots = (Car *)malloc((size_t)capacity * sizeof(Car));
+    LaneKey *keys = queue->policy != NULL ? (LaneKey *)malloc((size_t)capacity * sizeof(LaneKey)) : NULL;
+    if (slots == NULL || (queue->policy != NULL && keys == NULL)) {
         printf("内存分配失败！\n");
+        free(slots);
+        free(keys);
         return ERR_MEMORY;
     }
     
-    newNode->car = car;
-    newNode->next = NULL;
+    int firstRun = queue->capacity - queue->head;
+    if (firstRun > queue->count) {
+        firstRun = queue->count;
+    }
+    if (queue->count > 0) {
+        memcpy(slots, &queue->slots[queue->head], (size_t)firstRun * sizeof(Car));
+        memcpy(slots + firstRun, queue->slots, (size_t)(queue->count - firstRun) * sizeof(Car));
+    }
+    if (keys != NULL && queue->count > 0) {
+        memcpy(keys, queue->keys, (size_t)queue->count * sizeof(LaneKey)); // 堆的 head 始终为0
+    }
     
-    if (isQueueEmpty(queue)) {
-        queue->front = queue->rear = newNode;
-    } else {
-        queue->rear->next = newNode;
-        queue->rear = newNode;
+    free(queue->slots);
+    free(queue->keys);
+    queue->slots = slots;
+    queue->keys = keys;
+    queue->capacity = capacity;
+    queue->head = 0;
+    return SUCCESS;
+}
+
+// ---- 优先级模式的二叉堆 ----
+
+static bool laneKeyBefore(const LaneKey *a, const LaneKey *b) {
+    return a->key < b->key || (a->key == b->key && a->seq < b->seq);
+}
+
+// 把车辆放到堆的下标 i，并更新索引中记录的下标
+static void placeInHeap(WaitingQueue *queue, int i, Car car, LaneKey key) {
+    queue->slots[i] = car;
+    queue->keys[i] = key;
+    if (queue->index != NULL) {
+        PlateIndexEntry *entry = plateIndexFind(queue->index, car.plate);
+        if (entry != NULL) {
+            entry->slot = i;
+        }
+    }
+}
+
+// 下标 i 处的车辆向上移动到合适的位置（空出的位置逐层下移，每层只写一次索引）
+static void siftUp(WaitingQueue *queue, int i) {
+    Car car = queue->slots[i];
+    LaneKey key = queue->keys[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!laneKeyBefore(&key, &queue->keys[parent])) {
+            break;
+        }
+        placeInHeap(queue, i, queue->slots[parent], queue->keys[parent]);
+        i = parent;
+    }
+    placeInHeap(queue, i, car, key);
+}
+
+static void siftDown(WaitingQueue *queue, int i) {
+    Car car = queue->slots[i];
+    LaneKey key = queue->keys[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= queue->count) {
+            break;
+        }
+        if (child + 1 < queue->count && laneKeyBefore(&queue->keys[child + 1], &queue->keys[child])) {
+            child++;
+        }
+        if (!laneKeyBefore(&queue->keys[child], &key)) {
+            break;
+        }
+        placeInHeap(queue, i, queue->slots[child], queue->keys[child]);
+        i = child;
+    }
+    placeInHeap(queue, i, car, key);
+}
+
+// 入队操作（缓冲区足够时不分配内存）
+int enqueue(WaitingQueue *queue, Car car) {
+    if (queue->count == queue->capacity && growQueue(queue) != SUCCESS) {
+        return ERR_MEMORY;
+    }
+    
+    if (queue->index != NULL &&
+        plateIndexPut(queue->index, car.plate, PLATE_IN_LANE, queue->policy != NULL ? queue->count : 0) != SUCCESS) {
+        return ERR_MEMORY;
     }
     
     queue->count++;
+    *queueAt(queue, queue->count - 1) = car;
+    if (queue->policy != NULL) {
+        LaneKey *key = &queue->keys[queue->count - 1];
+        key->key = (int64_t)car.arriveTime - queue->policy->boostSeconds[laneClassOf(queue->policy, car.plate)];
+        key->seq = queue->nextSeq++;
+        siftUp(queue, queue->count - 1);
+    }
     return SUCCESS;
 }
 
@@ -91,65 +466,184 @@ Car dequeue(WaitingQueue *queue) {
     if (isQueueEmpty(queue)) {
         return emptyCar; // 队列为空，返回空车
     }
+    if (queue->policy != NULL) {
+        return removeQueueAt(queue, 0);
+    }
+    
+    Car car = queue->slots[queue->head];
+    if (queue->index != NULL) {
+        plateIndexRemove(queue->index, car.plate);
+    }
     
-    QueueNode *temp = queue->front;
-    Car car = temp->car;
+    queue->head++;
+    if (queue->head == queue->capacity) {
+        queue->head = 0;
+    }
+    queue->count--;
+    return car;
+}
+
+// 把刚出队的车辆放回便道队头（补位入场失败时使用），key 为它出队前的优先级键，
+// 这样它仍是下一辆出队的车辆
+static int restoreLaneHead(WaitingQueue *queue, Car car, LaneKey key) {
+    if (queue->count == queue->capacity && growQueue(queue) != SUCCESS) {
+        return ERR_MEMORY;
+    }
+    if (queue->index != NULL && plateIndexPut(queue->index, car.plate, PLATE_IN_LANE, 0) != SUCCESS) {
+        return ERR_MEMORY;
+    }
+    
+    if (queue->policy != NULL) {
+        queue->count++;
+        queue->slots[queue->count - 1] = car;
+        queue->keys[queue->count - 1] = key;
+        siftUp(queue, queue->count - 1);
+        return SUCCESS;
+    }
+    queue->head = queue->head == 0 ? queue->capacity - 1 : queue->head - 1;
+    queue->slots[queue->head] = car;
+    queue->count++;
+    return SUCCESS;
+}
+
+// 查找便道上车辆的位置（queueAt 的下标），不在便道上时返回-1。
+// 优先级模式下直接从索引取得堆中的下标，否则逐个比较
+int findQueuePosition(WaitingQueue *queue, PackedPlate plate) {
+    if (plate == PLATE_NONE) {
+        return -1;
+    }
+    if (queue->policy != NULL && queue->index != NULL) {
+        PlateIndexEntry *entry = plateIndexFind(queue->index, plate);
+        return entry != NULL && entry->location == PLATE_IN_LANE ? entry->slot : -1;
+    }
+    for (int i = 0; i < queue->count; i++) {
+        if (queueAt(queue, i)->plate == plate) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 取出便道上任意位置的车辆：优先级模式下用堆尾的车辆填补空位再调整，O(log n)；
+// 先进先出模式下把较短一侧的车辆依次挪过来，保持其余车辆的顺序
+Car removeQueueAt(WaitingQueue *queue, int position) {
+    Car car = *queueAt(queue, position);
+    if (queue->index != NULL) {
+        plateIndexRemove(queue->index, car.plate);
+    }
     
-    queue->front = queue->front->next;
-    if (queue->front == NULL) {
-        queue->rear = NULL;
+    if (queue->policy != NULL) {
+        queue->count--;
+        if (position < queue->count) {
+            queue->slots[position] = queue->slots[queue->count];
+            queue->keys[position] = queue->keys[queue->count];
+            if (position > 0 && laneKeyBefore(&queue->keys[position], &queue->keys[(position - 1) / 2])) {
+                siftUp(queue, position);
+            } else {
+                siftDown(queue, position);
+            }
+        }
+        return car;
     }
     
-    free(temp);
+    if (position < queue->count / 2) {
+        for (int i = position; i > 0; i--) {
+            *queueAt(queue, i) = *queueAt(queue, i - 1);
+        }
+        queue->head++;
+        if (queue->head == queue->capacity) {
+            queue->head = 0;
+        }
+    } else {
+        for (int i = position; i < queue->count - 1; i++) {
+            *queueAt(queue, i) = *queueAt(queue, i + 1);
+        }
+    }
     queue->count--;
     return car;
 }
 
+// 排序用的键和下标
+typedef struct {
+    LaneKey key;
+    int position;
+} QueueOrderItem;
+
+static int compareQueueOrder(const void *a, const void *b) {
+    const LaneKey *x = &((const QueueOrderItem *)a)->key;
+    const LaneKey *y = &((const QueueOrderItem *)b)->key;
+    return laneKeyBefore(x, y) ? -1 : laneKeyBefore(y, x);
+}
+
+// 优先级模式下按出队顺序排列的下标（调用方负责 free），先进先出模式、空队列或内存不足时返回NULL（即按下标顺序）
+int *queuePromotionOrder(WaitingQueue *queue) {
+    if (queue->policy == NULL || queue->count == 0) {
+        return NULL;
+    }
+    QueueOrderItem *items = (QueueOrderItem *)malloc((size_t)queue->count * sizeof(QueueOrderItem));
+    int *order = (int *)malloc((size_t)queue->count * sizeof(int));
+    if (items == NULL || order == NULL) {
+        free(items);
+        free(order);
+        return NULL;
+    }
+    for (int i = 0; i < queue->count; i++) {
+        items[i].key = queue->keys[i];
+        items[i].position = i;
+    }
+    qsort(items, (size_t)queue->count, sizeof(QueueOrderItem), compareQueueOrder);
+    for (int i = 0; i < queue->count; i++) {
+        order[i] = items[i].position;
+    }
+    free(items);
+    return order;
+}
+
 // 清空队列并释放所有内存
 void clearQueue(WaitingQueue *queue) {
     if (queue == NULL) {
         return;
     }
     
-    // 优化：直接遍历并释放所有节点，而不是通过dequeue函数
-    // 这样可以减少函数调用开销，提高效率
-    QueueNode *current = queue->front;
-    QueueNode *next;
-    
-    while (current != NULL) {
-        next = current->next;
-        free(current);
-        current = next;
+    if (queue->index != NULL) {
+        for (int i = 0; i < queue->count; i++) {
+            plateIndexRemove(queue->index, queueAt(queue, i)->plate);
+        }
     }
     
     // 重置队列状态
-    queue->front = NULL;
-    queue->rear = NULL;
+    free(queue->slots);
+    free(queue->keys);
+    queue->slots = NULL;
+    queue->keys = NULL;
+    queue->capacity = 0;
+    queue->head = 0;
     queue->count = 0;
 }
 
 // 显示便道队列内容
 void displayQueue(WaitingQueue *queue) {
-    printf("便道等候车辆：\n");
+    RenderBuffer buffer;
+    initRenderBuffer(&buffer);
+    renderAppend(&buffer, "便道等候车辆：\n");
     if (isQueueEmpty(queue)) {
-        printf("便道上没有等候车辆\n");
-        return;
+        renderAppend(&buffer, "便道上没有等候车辆\n");
     }
-    
-    QueueNode *current = queue->front;
-    int position = 1;
-    
-    while (current != NULL) {
-        printf("位置 %d: 车牌号 %s\n", position++, current->car.plateNumber);
-        current = current->next;
+    int *order = queuePromotionOrder(queue); // 按出队顺序
+    for (int i = 0; i < queue->count; i++) {
+        char plateNumber[MAX_PLATE_LEN];
+        formatPlate(queueAt(queue, order != NULL ? order[i] : i)->plate, plateNumber, sizeof(plateNumber));
+        renderAppend(&buffer, "位置 %d: 车牌号 %s\n", i + 1, plateNumber);
     }
+    free(order);
+    renderFlush(&buffer);
+    freeRenderBuffer(&buffer);
 }
 
-// 创建车辆
+// 创建车辆（车牌表已满时 plate 为 PLATE_NONE）
 Car createCar(const char *plateNumber) {
     Car newCar;
-    strncpy(newCar.plateNumber, plateNumber, MAX_PLATE_LEN - 1);
-    newCar.plateNumber[MAX_PLATE_LEN - 1] = '\0'; // 确保结尾
+    newCar.plate = encodePlate(plateNumber, MAX_PLATE_LEN - 1);
     newCar.arriveTime = time(NULL);
     newCar.leaveTime = 0;
     return newCar;
@@ -157,8 +651,8 @@ Car createCar(const char *plateNumber) {
 
 // 验证车牌号格式
 bool isValidPlateNumber(const char *plateNumber) {
-    // 检查长度
-    size_t len = strlen(plateNumber);
+    // 检查长度（最多读到 MAX_PLATE_LEN 个字节，过长的输入不必完整扫描）
+    size_t len = strnlen(plateNumber, MAX_PLATE_LEN);
     if (len < 7 || len > MAX_PLATE_LEN - 1) {
         return false;
     }
@@ -166,46 +660,26 @@ bool isValidPlateNumber(const char *plateNumber) {
     // 中国车牌号格式验证
     // 标准格式：一个汉字省份简称（如京、沪、粤等）+ 一个字母 + 5个字符（字母或数字）
     
-    // 检查第一个字符是否为中文省份简称
-    // 使用UTF-8编码检查首个字符是否为中文字符
-    unsigned char firstByte = (unsigned char)plateNumber[0];
-    if ((firstByte & 0x80) == 0) { // 不是多字节字符
+    // 检查第一个字符是否为编码表中的省份简称（UTF-8中为3个字节）。编码表外的首字符
+    // 和过长的尾部无法压缩，要登记到进程内的车牌表，任意输入都接受会让车牌表无限增长
+    if (!isPlateProvince(plateNumber, len)) {
         return false;
     }
-    
-    // 检查第二个字符开始是否为大写英文字母
-    // 首先跳过第一个中文字符（UTF-8中文字符通常是3个字节）
-    int offset = 0;
-    if ((firstByte & 0xE0) == 0xC0) { // 2字节字符
-        offset = 2;
-    } else if ((firstByte & 0xF0) == 0xE0) { // 3字节字符（大多数中文）
-        offset = 3;
-    } else if ((firstByte & 0xF8) == 0xF0) { // 4字节字符
-        offset = 4;
-    } else {
-        return false; // 无效的UTF-8字符
-    }
+    size_t offset = 3;
     
     // 检查第二个字符（省份简称后的字符）是否为大写英文字母 A-Z
     if (offset >= len || plateNumber[offset] < 'A' || plateNumber[offset] > 'Z') {
         return false;
     }
     
-    // 检查剩余字符是否为字母或数字
-    for (size_t i = offset + 1; i < len; i++) {
-        char c = plateNumber[i];
-        if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z'))) {
-            return false;
-        }
-    }
-    
-    // 检查总长度是否符合要求（省份简称 + 字母 + 5个字符）
-    int remainingChars = len - offset - 1; // 减去省份简称和地区字母
-    if (remainingChars < 5) {
+    // 检查总长度是否符合要求（省份简称 + 字母 + 5到9个字符）
+    size_t remainingChars = len - offset - 1; // 减去省份简称和地区字母
+    if (remainingChars < 5 || remainingChars + 1 > PLATE_PACKED_MAX_TAIL) {
         return false;
     }
     
-    return true;
+    // 检查剩余字符是否为字母或数字（按块做区间检查，见 plate.c）
+    return plateTailIsAlnum(plateNumber + offset + 1, remainingChars);
 }
 
 // 比较两个车牌号
@@ -215,146 +689,305 @@ bool comparePlateNumbers(const char *plate1, const char *plate2) {
         return false;
     }
     
-    // 快速检查长度是否一致（可以提前判断不相等的情况）
-    size_t len1 = strlen(plate1);
-    size_t len2 = strlen(plate2);
-    if (len1 != len2) {
-        return false;
-    }
-    
-    // 使用二进制比较确保中文字符完全匹配
-    // 这比使用strcmp更安全，因为它会比较每个字节
-    return memcmp(plate1, plate2, len1) == 0;
+    // 一次扫描同时比较内容和结尾，不需要先分别求长度；逐字节比较保证中文字符完全匹配。
+    // 停车场和便道中的车辆按压缩编码比较，这里只用于任意字符串（如归档中的车牌号）
+    return strncmp(plate1, plate2, MAX_PLATE_LEN) == 0;
 }
 
-// 计算停车费用
-double calculateFee(Car car) {
-    if (car.leaveTime == 0 || car.arriveTime == 0) {
+// 是否在车辆离开时打印收费单（批量重放时关闭）
+static bool receiptOutput = true;
+
+// 开启或关闭收费单输出
+void setReceiptOutput(bool enabled) {
+    receiptOutput = enabled;
+}
+
+// 当前使用的收费方案（为NULL时按HOURLY_RATE统一计费）
+static const Tariff *activeTariff = NULL;
+
+// 设置收费方案（在处理车辆之前设置，之后只读）
+void setActiveTariff(const Tariff *tariff) {
+    activeTariff = tariff;
+}
+
+// 按指定收费方案计算停车费用（只用到车牌编码和进出时间，不读全局状态、不加锁）；
+// tariff 为NULL时按HOURLY_RATE统一计费
+double calculateFeeWith(const Tariff *tariff, Car car) {
+    if (car.leaveTime == 0 || car.arriveTime == 0 || car.leaveTime <= car.arriveTime) {
         return 0.0;
     }
     
-    // 计算停车时间（秒）
-    double parkingTime = difftime(car.leaveTime, car.arriveTime);
-    
-    // 优化：使用静态缓冲区存储时间字符串
-    static char arriveTimeStr[30];
-    static char leaveTimeStr[30];
-    
-    // 使用Windows兼容的时间转换函数
-    struct tm *arriveInfo = localtime(&car.arriveTime);
-    struct tm *leaveInfo = localtime(&car.leaveTime);
-    
-    strftime(arriveTimeStr, sizeof(arriveTimeStr), "%Y-%m-%d %H:%M:%S", arriveInfo);
-    strftime(leaveTimeStr, sizeof(leaveTimeStr), "%Y-%m-%d %H:%M:%S", leaveInfo);
-    
-    // 优化：使用更高效的时间计算方式
-    int totalSeconds = (int)parkingTime;
-    int hours = totalSeconds / 3600;
-    int minutes = (totalSeconds % 3600) / 60;
-    int seconds = totalSeconds % 60;
-    
-    // 优化计费算法：将小时数向上取整，更符合停车场收费惯例
-    double fee;
-    if (minutes > 0 || seconds > 0) {
-        fee = (hours + 1) * HOURLY_RATE; // 不足一小时的部分按一小时收费
-    } else {
-        fee = hours * HOURLY_RATE;
+    if (tariff != NULL) {
+        return tariffPrice(tariff, classifyPlate(car.plate), car.arriveTime, car.leaveTime);
     }
     
-    // 使用颜色打印停车费用信息
-    printf("\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
-    printf("%s%s║%s                  %s%s停车费用计算单%s%s                             ║%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET, STYLE_BOLD, COLOR_BRIGHT_WHITE, COLOR_GREEN, STYLE_BOLD, COLOR_RESET);
-    printf("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
+    // 将小时数向上取整，不足一小时的部分按一小时收费
+    long long totalSeconds = (long long)(car.leaveTime - car.arriveTime);
+    long long hours = (totalSeconds + 3599) / 3600;
+    return (double)hours * HOURLY_RATE;
+}
+
+// 按当前收费方案计算停车费用
+double calculateFee(Car car) {
+    return calculateFeeWith(activeTariff, car);
+}
+
+// 把时间格式化为 "YYYY-MM-DD HH:MM:SS"（使用可重入的时间转换函数）
+void formatTime(time_t t, char *buffer, size_t size) {
+    struct tm info;
+#ifdef _WIN32
+    localtime_s(&info, &t);
+#else
+    localtime_r(&t, &info);
+#endif
+    strftime(buffer, size, "%Y-%m-%d %H:%M:%S", &info);
+}
+
+// 解析时间："YYYY-MM-DD HH:MM:SS"、"YYYY-MM-DDTHH:MM:SS"、"YYYY-MM-DD"（当天0点，本地时间）或Unix秒数
+bool parseTimestamp(const char *text, time_t *result) {
+    char *end;
+    long long seconds = strtoll(text, &end, 10);
+    if (end != text && *end == '\0') {
+        *result = (time_t)seconds;
+        return true;
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    char sep;
+    int fields = sscanf(text, "%d-%d-%d%c%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &sep,
+                        &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    if (fields != 3 && (fields != 7 || (sep != ' ' && sep != 'T'))) {
+        return false;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+
+    *result = mktime(&tm);
+    return *result != (time_t)-1;
+}
+
+// 把收费单渲染到缓冲区，返回写入的字节数（不含结尾的'\0'）
+int formatReceipt(char *buffer, size_t size, const Car *car, double fee) {
+    char arriveTimeStr[30];
+    char leaveTimeStr[30];
+    formatTime(car->arriveTime, arriveTimeStr, sizeof(arriveTimeStr));
+    formatTime(car->leaveTime, leaveTimeStr, sizeof(leaveTimeStr));
+    char plateNumber[MAX_PLATE_LEN];
+    formatPlate(car->plate, plateNumber, sizeof(plateNumber));
+    
+    long long totalSeconds = car->leaveTime > car->arriveTime ? (long long)(car->leaveTime - car->arriveTime) : 0;
+    int hours = (int)(totalSeconds / 3600);
+    int minutes = (int)((totalSeconds % 3600) / 60);
+    int seconds = (int)(totalSeconds % 60);
+    
+    size_t used = 0;
+#define APPEND(...) do { \
+        int n = snprintf(buffer + used, used < size ? size - used : 0, __VA_ARGS__); \
+        if (n > 0) used += (size_t)n; \
+    } while (0)
+    
+    APPEND("\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
+    APPEND("%s%s║%s                  %s%s停车费用计算单%s%s                             ║%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET, STYLE_BOLD, COLOR_BRIGHT_WHITE, COLOR_GREEN, STYLE_BOLD, COLOR_RESET);
+    APPEND("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
     
     // 车牌号信息
-    printf("%s%s║%s %s车牌号:%s %s%-50s%s        %s%s║%s\n", 
+    APPEND("%s%s║%s %s车牌号:%s %s%-50s%s        %s%s║%s\n", 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET, 
            COLOR_CYAN, COLOR_RESET, 
-           COLOR_BRIGHT_WHITE, car.plateNumber, COLOR_RESET, 
+           COLOR_BRIGHT_WHITE, plateNumber, COLOR_RESET, 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
     
     // 时间信息
-    printf("%s%s║%s %s进入时间:%s %s%-48s%s        %s%s║%s\n", 
+    APPEND("%s%s║%s %s进入时间:%s %s%-48s%s        %s%s║%s\n", 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET, 
            COLOR_CYAN, COLOR_RESET, 
            COLOR_BRIGHT_WHITE, arriveTimeStr, COLOR_RESET, 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
-    printf("%s%s║%s %s离开时间:%s %s%-48s%s        %s%s║%s\n", 
+    APPEND("%s%s║%s %s离开时间:%s %s%-48s%s        %s%s║%s\n", 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET, 
            COLOR_CYAN, COLOR_RESET, 
            COLOR_BRIGHT_WHITE, leaveTimeStr, COLOR_RESET, 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
     
     // 停车时长
-    printf("%s%s║%s %s停车时长:%s %s%d 小时 %d 分钟 %d 秒%s%33s        %s%s║%s\n", 
+    APPEND("%s%s║%s %s停车时长:%s %s%d 小时 %d 分钟 %d 秒%s%33s        %s%s║%s\n", 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET, 
            COLOR_CYAN, COLOR_RESET, 
            COLOR_BRIGHT_WHITE, hours, minutes, seconds, COLOR_RESET, "", 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
     
     // 收费信息
-    printf("%s%s║%s %s收费标准:%s %s%.2f 元/小时%s%41s        %s%s║%s\n", 
-           STYLE_BOLD, COLOR_GREEN, COLOR_RESET, 
-           COLOR_CYAN, COLOR_RESET, 
-           COLOR_BRIGHT_WHITE, HOURLY_RATE, COLOR_RESET, "", 
-           STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
-    printf("%s%s║%s %s应收费用:%s %s%.2f 元%s%44s        %s%s║%s\n", 
+    if (activeTariff == NULL || activeTariff->flatRate > 0) {
+        APPEND("%s%s║%s %s收费标准:%s %s%.2f 元/小时%s%41s        %s%s║%s\n", 
+               STYLE_BOLD, COLOR_GREEN, COLOR_RESET, 
+               COLOR_CYAN, COLOR_RESET, 
+               COLOR_BRIGHT_WHITE, activeTariff != NULL ? activeTariff->flatRate : HOURLY_RATE, COLOR_RESET, "", 
+               STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
+    } else {
+        APPEND("%s%s║%s %s收费标准:%s %s%-48s%s        %s%s║%s\n", 
+               STYLE_BOLD, COLOR_GREEN, COLOR_RESET, 
+               COLOR_CYAN, COLOR_RESET, 
+               COLOR_BRIGHT_WHITE, activeTariff->description, COLOR_RESET, 
+               STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
+    }
+    APPEND("%s%s║%s %s应收费用:%s %s%.2f 元%s%44s        %s%s║%s\n", 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET, 
            COLOR_CYAN, COLOR_RESET, 
            COLOR_YELLOW, fee, COLOR_RESET, "", 
            STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
     
-    printf("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
+    APPEND("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n", STYLE_BOLD, COLOR_GREEN, COLOR_RESET);
+#undef APPEND
     
-    return fee;
+    return (int)used;
+}
+
+// 打印收费单：先整体渲染到缓冲区，再一次性写出
+void printReceipt(const Car *car, double fee) {
+    char buffer[RECEIPT_BUFFER_SIZE];
+    formatReceipt(buffer, sizeof(buffer), car, fee);
+    fputs(buffer, stdout);
 }
 
 // 检查车牌号是否已存在于停车场或便道中
 bool isCarExists(ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *plateNumber) {
+    // 先换成压缩编码（不登记），之后都按整数比较；车牌表中没有的车牌一定不在场
+    PackedPlate plate = lookupPlate(plateNumber, MAX_PLATE_LEN - 1);
+    if (plate == PLATE_NONE) {
+        return false;
+    }
+    
+    // 有索引时直接查表
+    if (parkingLot->index != NULL) {
+        return plateIndexFind(parkingLot->index, plate) != NULL;
+    }
+    
     // 检查停车场
     for (int i = 0; i <= parkingLot->top; i++) {
-        if (comparePlateNumbers(parkingLot->data[i].plateNumber, plateNumber)) {
+        if (isSlotOccupied(parkingLot, i) && parkingLot->data[i].plate == plate) {
             return true; // 车牌号已存在于停车场
         }
     }
     
     // 检查便道
-    QueueNode *current = waitingLane->front;
-    while (current != NULL) {
-        if (comparePlateNumbers(current->car.plateNumber, plateNumber)) {
+    for (int i = 0; i < waitingLane->count; i++) {
+        if (queueAt(waitingLane, i)->plate == plate) {
             return true; // 车牌号已存在于便道
         }
-        current = current->next;
     }
     
     return false; // 车牌号不存在
 }
 
+// 为停车场和便道挂接共用的车牌号索引，并把已有车辆加入索引
+void attachPlateIndex(ParkingStack *parkingLot, WaitingQueue *waitingLane, PlateIndex *index) {
+    parkingLot->index = index;
+    waitingLane->index = index;
+    if (index == NULL) {
+        return;
+    }
+    
+    clearPlateIndex(index);
+    for (int i = 0; i <= parkingLot->top; i++) {
+        if (isSlotOccupied(parkingLot, i)) {
+            plateIndexPut(index, parkingLot->data[i].plate, PLATE_IN_LOT, i);
+        }
+    }
+    for (int i = 0; i < waitingLane->count; i++) {
+        plateIndexPut(index, queueAt(waitingLane, i)->plate, PLATE_IN_LANE, waitingLane->policy != NULL ? i : 0);
+    }
+}
+
+// 车辆进入停车场后设置最长停车时长和免费时长结束的计时器
+static void armParkedTimers(TimerWheel *timers, const Car *car) {
+    if (timers->maxStaySeconds > 0) {
+        timerWheelArm(timers, car->plate, TIMER_MAX_STAY, car->arriveTime + timers->maxStaySeconds);
+    }
+    if (timers->graceAlerts && activeTariff != NULL &&
+        (activeTariff->classes[VEHICLE_STANDARD].freeMinutes > 0 || activeTariff->classes[VEHICLE_NEW_ENERGY].freeMinutes > 0)) {
+        int freeMinutes = activeTariff->classes[classifyPlate(car->plate)].freeMinutes;
+        if (freeMinutes > 0) {
+            timerWheelArm(timers, car->plate, TIMER_GRACE_END, car->arriveTime + (time_t)freeMinutes * 60);
+        }
+    }
+}
+
+// 车辆进入便道后设置等候超时的计时器
+static void armLaneTimer(TimerWheel *timers, const Car *car) {
+    if (timers->laneTimeoutSeconds > 0) {
+        timerWheelArm(timers, car->plate, TIMER_LANE_TIMEOUT, car->arriveTime + timers->laneTimeoutSeconds);
+    }
+}
+
+// 为停车场和便道挂接共用的计时器，并按已有车辆的到达时间重新设置（已经超时的在下一次推进时触发）
+void attachTimerWheel(ParkingStack *parkingLot, WaitingQueue *waitingLane, TimerWheel *timers) {
+    parkingLot->timers = timers;
+    if (timers == NULL) {
+        return;
+    }
+    
+    clearTimerWheel(timers);
+    for (int i = 0; i <= parkingLot->top; i++) {
+        if (isSlotOccupied(parkingLot, i)) {
+            armParkedTimers(timers, &parkingLot->data[i]);
+        }
+    }
+    for (int i = 0; i < waitingLane->count; i++) {
+        armLaneTimer(timers, queueAt(waitingLane, i));
+    }
+}
+
 // 车辆进入停车场
 int parkCar(ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *plateNumber) {
+    return parkCarAt(parkingLot, waitingLane, plateNumber, NULL, time(NULL));
+}
+
+// 车辆在指定时间进入停车场（重放日志时使用事件自带的时间）
+int parkCarAt(ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *plateNumber, SystemStats *stats, time_t now) {
+    if (parkingLot->journal != NULL && parkingLot->journal->failed) {
+        return ERR_IO; // 日志已不可写，不再接受变更
+    }
     if (isCarExists(parkingLot, waitingLane, plateNumber)) {
         return ERR_EXISTS; // 车牌号已存在
     }
     
     Car newCar = createCar(plateNumber);
+    if (newCar.plate == PLATE_NONE) {
+        return ERR_MEMORY; // 车牌表已满
+    }
+    newCar.arriveTime = now;
+    int result;
+    bool queued = isStackFull(parkingLot);
     
-    if (!isStackFull(parkingLot)) {
+    if (!queued) {
         // 停车场有空位，直接进入
-        int result = push(parkingLot, newCar);
-        if (result == SUCCESS) {
-            SystemStats stats = {0}; // 创建一个空的统计信息结构体
-            saveSystemState(parkingLot, waitingLane, &stats);
-        }
-        return result;
+        result = push(parkingLot, newCar);
     } else {
         // 停车场已满，进入便道等候
-        int result = enqueue(waitingLane, newCar);
-        if (result == SUCCESS) {
-            SystemStats stats = {0}; // 创建一个空的统计信息结构体
-            saveSystemState(parkingLot, waitingLane, &stats);
+        result = enqueue(waitingLane, newCar);
+    }
+    
+    // 记录到事件日志（写出失败时车辆已在内存中，但事件没有持久化，返回 ERR_IO）
+    int logged = SUCCESS;
+    if (result == SUCCESS && parkingLot->journal != NULL) {
+        logged = journalAppend(parkingLot->journal, JOURNAL_ARRIVE, &newCar, newCar.arriveTime, 0.0) == SUCCESS
+                     ? journalCommit(parkingLot->journal)
+                     : ERR_IO;
+    }
+    if (result == SUCCESS && parkingLot->timers != NULL) {
+        if (queued) {
+            armLaneTimer(parkingLot->timers, &newCar);
+        } else {
+            armParkedTimers(parkingLot->timers, &newCar);
         }
-        return result;
     }
+    if (result == SUCCESS && stats != NULL) {
+        streamRecordArrival(&stats->stream, now, getStackCount(parkingLot), getQueueCount(waitingLane));
+    }
+    
+    return result == SUCCESS ? logged : result;
 }
 
 // 查找车辆在停车场中的位置
@@ -363,10 +996,24 @@ int findCarPosition(ParkingStack *parkingLot, const char *plateNumber) {
         return -1;
     }
     
+    PackedPlate plate = lookupPlate(plateNumber, MAX_PLATE_LEN - 1);
+    if (plate == PLATE_NONE) {
+        return -1;
+    }
+    
+    // 有索引时直接查表
+    if (parkingLot->index != NULL) {
+        PlateIndexEntry *entry = plateIndexFind(parkingLot->index, plate);
+        if (entry == NULL || entry->location != PLATE_IN_LOT) {
+            return -1;
+        }
+        return entry->slot;
+    }
+    
     // 优化：从栈顶开始搜索，因为最近停车的车辆更可能离开
     // 这种方式可以减少平均搜索时间
     for (int i = parkingLot->top; i >= 0; i--) {
-        if (comparePlateNumbers(parkingLot->data[i].plateNumber, plateNumber)) {
+        if (isSlotOccupied(parkingLot, i) && parkingLot->data[i].plate == plate) {
             return i;
         }
     }
@@ -376,6 +1023,14 @@ int findCarPosition(ParkingStack *parkingLot, const char *plateNumber) {
 
 // 车辆离开停车场
 int leaveCar(ParkingStack *parkingLot, ParkingStack *tempLot, WaitingQueue *waitingLane, const char *plateNumber, SystemStats *stats) {
+    return leaveCarAt(parkingLot, tempLot, waitingLane, plateNumber, stats, time(NULL));
+}
+
+// 车辆在指定时间离开停车场
+int leaveCarAt(ParkingStack *parkingLot, ParkingStack *tempLot, WaitingQueue *waitingLane, const char *plateNumber, SystemStats *stats, time_t now) {
+    if (parkingLot->journal != NULL && parkingLot->journal->failed) {
+        return ERR_IO; // 日志已不可写，不再接受变更
+    }
     if (isStackEmpty(parkingLot)) {
         return ERR_EMPTY; // 停车场为空
     }
@@ -387,24 +1042,57 @@ int leaveCar(ParkingStack *parkingLot, ParkingStack *tempLot, WaitingQueue *wait
         return ERR_NOT_FOUND; // 未找到车辆
     }
     
-    // 计算需要移动的车辆数量
-    int carsToMove = parkingLot->top - position;
-    
-    // 将车辆上方的车辆移到临时栈
-    for (int i = 0; i < carsToMove; i++) {
-        Car car = pop(parkingLot);
-        push(tempLot, car);
+    // 独立车位模式下车辆直接驶出，不需要挪车
+    int carsToMove = parkingLot->model == LOT_MODEL_BAYS ? 0 : parkingLot->top - position;
+    if (carsToMove > tempLot->capacity && resizeStack(tempLot, parkingLot->capacity) != SUCCESS) {
+        return ERR_MEMORY;
+    }
+    // 挪开的车辆移回和便道补位都要重新写入索引；先预留空间，开始挪车后就不会因内存不足丢车
+    if (parkingLot->index != NULL && plateIndexReserve(parkingLot->index, carsToMove + 1) != SUCCESS) {
+        return ERR_MEMORY;
     }
+    Car leavingCar;
+    if (parkingLot->model == LOT_MODEL_BAYS) {
+        leavingCar = removeCarAt(parkingLot, position);
+    } else {
+        // 将车辆上方的车辆移到临时栈
+        for (int i = 0; i < carsToMove; i++) {
+            Car car = pop(parkingLot);
+            push(tempLot, car);
+        }
+        
+        // 移除要离开的车辆
+        leavingCar = pop(parkingLot);
+    }
+    leavingCar.leaveTime = now;
     
-    // 移除要离开的车辆
-    Car leavingCar = pop(parkingLot);
-    leavingCar.leaveTime = time(NULL);
+    // 记录为让路而挪动的车辆数（每辆车出去再回来算两次挪动）
+    parkingLot->lastMoves = carsToMove * 2;
+    parkingLot->totalMoves += carsToMove * 2;
     
     // 计算费用并更新统计信息
     double fee = calculateFee(leavingCar);
+    if (receiptOutput) {
+        printReceipt(&leavingCar, fee);
+    }
     if (stats != NULL) {
         stats->totalCars++;
         stats->totalRevenue += fee;
+        streamRecordDeparture(&stats->stream, leavingCar.leaveTime, leavingCar.arriveTime, fee);
+    }
+    uint64_t seq = 0;
+    int logged = SUCCESS;
+    if (parkingLot->journal != NULL) {
+        logged = journalAppend(parkingLot->journal, JOURNAL_LEAVE, &leavingCar, leavingCar.leaveTime, fee);
+        if (logged == SUCCESS) {
+            seq = parkingLot->journal->nextSeq - 1;
+        }
+    }
+    if (parkingLot->archive != NULL) {
+        archiveAppend(parkingLot->archive, &leavingCar, fee, seq);
+    }
+    if (parkingLot->timers != NULL) {
+        timerWheelCancelAll(parkingLot->timers, leavingCar.plate);
     }
     
     // 将临时栈中的车辆移回停车场
@@ -414,85 +1102,70 @@ int leaveCar(ParkingStack *parkingLot, ParkingStack *tempLot, WaitingQueue *wait
     }
     
     // 如果便道上有等候的车辆，让其进入停车场
+    bool laneCarLost = false;
     if (!isQueueEmpty(waitingLane) && !isStackFull(parkingLot)) {
-        Car waitingCar = dequeue(waitingLane);
-        waitingCar.arriveTime = time(NULL); // 更新进入停车场的时间
-        push(parkingLot, waitingCar);
+        LaneKey headKey = waitingLane->policy != NULL ? waitingLane->keys[0] : (LaneKey){0};
+        Car queuedCar = dequeue(waitingLane);
+        Car waitingCar = queuedCar;
+        waitingCar.arriveTime = leavingCar.leaveTime; // 更新进入停车场的时间
+        if (push(parkingLot, waitingCar) != SUCCESS) {
+            // 索引内存不足，无法入场：放回便道队头，等下一次离开时再补位
+            laneCarLost = restoreLaneHead(waitingLane, queuedCar, headKey) != SUCCESS;
+            if (laneCarLost) {
+                char plateNumber[MAX_PLATE_LEN];
+                formatPlate(queuedCar.plate, plateNumber, sizeof(plateNumber));
+                printf("内存不足，车辆 %s 无法补位也无法放回便道！\n", plateNumber);
+            }
+        } else {
+            if (parkingLot->timers != NULL) {
+                timerWheelCancel(parkingLot->timers, waitingCar.plate, TIMER_LANE_TIMEOUT);
+                armParkedTimers(parkingLot->timers, &waitingCar);
+            }
+            if (parkingLot->journal != NULL && logged == SUCCESS) {
+                logged = journalAppend(parkingLot->journal, JOURNAL_PROMOTE, &waitingCar, waitingCar.arriveTime, 0.0);
+            }
+        }
     }
     
-    // 自动保存系统状态
-    saveSystemState(parkingLot, waitingLane, stats);
+    // 离开与补位作为一个事件提交到日志；写出失败时返回 ERR_IO（内存中已离开，但事件没有持久化）
+    if (parkingLot->journal != NULL) {
+        logged = logged == SUCCESS ? journalCommit(parkingLot->journal) : ERR_IO;
+    }
     
-    return SUCCESS;
+    return logged == SUCCESS && laneCarLost ? ERR_MEMORY : logged;
 }
 
-// 显示停车场状态
-void displayParkingStatus(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats) {
-    time_t now = time(NULL);
-    struct tm *timeinfo = localtime(&now);
-    char timeStr[30];
-    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
-    
-    printf("\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    printf("%s%s║%s                %s%s停车场管理系统当前状态%s%s                         ║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, STYLE_BOLD, COLOR_BRIGHT_WHITE, COLOR_BLUE, STYLE_BOLD, COLOR_RESET);
-    printf("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    printf("%s%s║%s %s时间:%s %-52s    %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, timeStr, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    printf("%s%s║%s %s停车场容量:%s %-46d    %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, STACKSIZE, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    
-    // 车辆数量信息显示
-    int currentCars = parkingLot->top + 1;
-    int remainingSpaces = STACKSIZE - currentCars;
-    int waitingCars = getQueueCount(waitingLane);
-    
-    printf("%s%s║%s %s停车场当前车辆数:%s %-40d    %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, currentCars, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    printf("%s%s║%s %s停车场剩余空位:%s %-42d    %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, remainingSpaces, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    printf("%s%s║%s %s便道等候车辆数:%s %-42d    %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, waitingCars, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    
-    if (stats != NULL) {
-        double runTime = difftime(now, stats->startTime) / 3600.0; // 运行时间（小时）
-        printf("%s%s║%s %s系统运行时间:%s %.1f 小时%39s %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, runTime, "", STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-        printf("%s%s║%s %s总处理车辆数:%s %-44d    %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, stats->totalCars, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-        printf("%s%s║%s %s总收入:%s %-50.2f    %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_CYAN, COLOR_BRIGHT_WHITE, stats->totalRevenue, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
+// 便道上的车辆不再等候、直接离开（未入场，不收费）：按车牌号取出，取消计时器并写日志
+int cancelWaitingCar(ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *plateNumber, time_t now) {
+    if (parkingLot->journal != NULL && parkingLot->journal->failed) {
+        return ERR_IO; // 日志已不可写，不再接受变更
     }
-    
-    printf("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    
-    // 显示停车场内车辆
-    printf("%s%s║%s %s停车场内车辆（从北到南）:%s                                     %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_YELLOW, COLOR_RESET, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    if (isStackEmpty(parkingLot)) {
-        printf("%s%s║%s %s停车场内没有车辆%s                                            %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_BRIGHT_WHITE, COLOR_RESET, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    } else {
-        for (int i = 0; i <= parkingLot->top; i++) {
-            printf("%s%s║%s %s位置 %2d:%s %s车牌号%s %s%-42s%s    %s%s║%s\n", 
-                   STYLE_BOLD, COLOR_BLUE, COLOR_RESET, 
-                   COLOR_GREEN, i + 1, COLOR_RESET, 
-                   COLOR_YELLOW, COLOR_RESET, 
-                   COLOR_BRIGHT_WHITE, parkingLot->data[i].plateNumber, COLOR_RESET, 
-                   STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-        }
+    int position = findQueuePosition(waitingLane, lookupPlate(plateNumber, MAX_PLATE_LEN - 1));
+    if (position == -1) {
+        return ERR_NOT_FOUND;
     }
     
-    printf("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    
-    // 显示便道等候车辆
-    printf("%s%s║%s %s便道等候车辆:%s                                                 %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_YELLOW, COLOR_RESET, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    if (isQueueEmpty(waitingLane)) {
-        printf("%s%s║%s %s便道上没有等候车辆%s                                            %s%s║%s\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET, COLOR_BRIGHT_WHITE, COLOR_RESET, STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-    } else {
-        QueueNode *current = waitingLane->front;
-        int position = 1;
-        while (current != NULL) {
-            printf("%s%s║%s %s位置 %2d:%s %s车牌号%s %s%-46s%s    %s%s║%s\n", 
-                   STYLE_BOLD, COLOR_BLUE, COLOR_RESET, 
-                   COLOR_GREEN, position++, COLOR_RESET, 
-                   COLOR_YELLOW, COLOR_RESET, 
-                   COLOR_BRIGHT_WHITE, current->car.plateNumber, COLOR_RESET, 
-                   STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
-            current = current->next;
-        }
+    Car car = removeQueueAt(waitingLane, position);
+    car.leaveTime = now;
+    if (parkingLot->timers != NULL) {
+        timerWheelCancelAll(parkingLot->timers, car.plate);
     }
-    
-    printf("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n\n", STYLE_BOLD, COLOR_BLUE, COLOR_RESET);
+    if (parkingLot->journal != NULL) {
+        return journalAppend(parkingLot->journal, JOURNAL_CANCEL, &car, now, 0.0) == SUCCESS
+                   ? journalCommit(parkingLot->journal)
+                   : ERR_IO;
+    }
+    return SUCCESS;
+}
+
+// 显示停车场状态的第 page 页（从0开始），整页写入缓冲后一次输出，返回总页数
+int displayParkingStatus(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, int page) {
+    RenderBuffer buffer;
+    initRenderBuffer(&buffer);
+    int pages = renderParkingStatus(&buffer, parkingLot, waitingLane, stats, page);
+    renderFlush(&buffer);
+    freeRenderBuffer(&buffer);
+    return pages;
 }
 
 // 初始化系统
@@ -500,6 +1173,12 @@ void initSystem(SystemConfig *config, SystemStats *stats) {
     if (config != NULL) {
         config->parkingCapacity = STACKSIZE;
         config->hourlyRate = HOURLY_RATE;
+        config->tariffPath[0] = '\0';
+        config->lotModel = LOT_MODEL_STACK;
+        config->maxStayMinutes = 0;
+        config->laneTimeoutMinutes = 0;
+        config->lanePriority = false;
+        config->lanePolicyPath[0] = '\0';
         config->debugMode = false;
     }
     
@@ -507,9 +1186,170 @@ void initSystem(SystemConfig *config, SystemStats *stats) {
         stats->totalCars = 0;
         stats->totalRevenue = 0.0;
         stats->startTime = time(NULL);
+        initStreamStats(&stats->stream);
     }
 }
 
+// 去掉字符串首尾的空白字符
+static char *trimSpaces(char *str) {
+    while (*str == ' ' || *str == '\t') {
+        str++;
+    }
+    size_t len = strlen(str);
+    while (len > 0 && (str[len - 1] == ' ' || str[len - 1] == '\t' ||
+                       str[len - 1] == '\n' || str[len - 1] == '\r')) {
+        str[--len] = '\0';
+    }
+    return str;
+}
+
+// 从配置文件加载系统配置（每行一个 key = value，#开头为注释）
+bool loadSystemConfig(SystemConfig *config, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *text = trimSpaces(line);
+        if (text[0] == '\0' || text[0] == '#') {
+            continue;
+        }
+        
+        char *eq = strchr(text, '=');
+        if (eq == NULL) {
+            printf("配置文件 %s 第 %d 行格式错误\n", path, lineNumber);
+            continue;
+        }
+        *eq = '\0';
+        char *key = trimSpaces(text);
+        char *value = trimSpaces(eq + 1);
+        
+        if (strcmp(key, "capacity") == 0) {
+            int capacity = atoi(value);
+            if (capacity >= 1 && capacity <= MAX_CAPACITY) {
+                config->parkingCapacity = capacity;
+            } else {
+                printf("配置文件 %s 第 %d 行：无效的停车场容量 %s\n", path, lineNumber, value);
+            }
+        } else if (strcmp(key, "hourly_rate") == 0) {
+            double rate = atof(value);
+            if (rate >= 0) {
+                config->hourlyRate = rate;
+            } else {
+                printf("配置文件 %s 第 %d 行：无效的费率 %s\n", path, lineNumber, value);
+            }
+        } else if (strcmp(key, "tariff") == 0) {
+            snprintf(config->tariffPath, sizeof(config->tariffPath), "%s", value);
+        } else if (strcmp(key, "lot_model") == 0) {
+            if (!parseLotModel(value, &config->lotModel)) {
+                printf("配置文件 %s 第 %d 行：未知的停车场模型 %s\n", path, lineNumber, value);
+            }
+        } else if (strcmp(key, "max_stay_minutes") == 0) {
+            int minutes = atoi(value);
+            if (minutes >= 0) {
+                config->maxStayMinutes = minutes;
+            } else {
+                printf("配置文件 %s 第 %d 行：无效的最长停车时长 %s\n", path, lineNumber, value);
+            }
+        } else if (strcmp(key, "lane_timeout_minutes") == 0) {
+            int minutes = atoi(value);
+            if (minutes >= 0) {
+                config->laneTimeoutMinutes = minutes;
+            } else {
+                printf("配置文件 %s 第 %d 行：无效的便道等候时限 %s\n", path, lineNumber, value);
+            }
+        } else if (strcmp(key, "lane_policy") == 0) {
+            if (strcmp(value, "fifo") == 0 || strcmp(value, "priority") == 0) {
+                config->lanePriority = strcmp(value, "priority") == 0;
+            } else {
+                printf("配置文件 %s 第 %d 行：未知的便道策略 %s\n", path, lineNumber, value);
+            }
+        } else if (strcmp(key, "lane_priority") == 0) {
+            snprintf(config->lanePolicyPath, sizeof(config->lanePolicyPath), "%s", value);
+        } else if (strcmp(key, "debug") == 0) {
+            config->debugMode = strcmp(value, "1") == 0 || strcmp(value, "true") == 0;
+        } else {
+            printf("配置文件 %s 第 %d 行：未知的配置项 %s\n", path, lineNumber, key);
+        }
+    }
+    
+    fclose(file);
+    return true;
+}
+
+// 终端显示宽度：汉字等三字节UTF-8字符占两列，ASCII占一列
+int displayWidth(const char *text) {
+    int width = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+        if (*p < 0x80) {
+            width++;
+        } else if (*p >= 0xE0) {
+            width += 2;
+        }
+    }
+    return width;
+}
+
+// 统计框中的一行：标签和取值，右侧补空格对齐边框（框内宽63列）
+void printStatsRow(const char *label, const char *value) {
+    int padding = 63 - 3 - displayWidth(label) - displayWidth(value);
+    printf("%s%s║%s %s%s:%s %s%s%s%*s%s%s║%s\n",
+           STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET,
+           COLOR_CYAN, label, COLOR_RESET,
+           COLOR_BRIGHT_WHITE, value, COLOR_RESET, padding > 0 ? padding : 0, "",
+           STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+}
+
+// 把秒数格式化为“X小时Y分”或“Y分Z秒”
+void formatDuration(uint64_t seconds, char *buffer, size_t size) {
+    if (seconds >= 3600) {
+        snprintf(buffer, size, "%llu小时%02llu分", (unsigned long long)(seconds / 3600),
+                 (unsigned long long)(seconds % 3600 / 60));
+    } else {
+        snprintf(buffer, size, "%llu分%02llu秒", (unsigned long long)(seconds / 60),
+                 (unsigned long long)(seconds % 60));
+    }
+}
+
+// 显示流式统计：停车时长和费用的百分位数、峰值、最近24小时的车流
+static void displayStreamStats(const StreamStats *stream, time_t now) {
+    StatsSummary summary;
+    summarizeStreamStats(stream, now, &summary);
+    char value[160];
+    char p50[48], p95[48], p99[48];
+
+    printf("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+    snprintf(value, sizeof(value), "%llu", (unsigned long long)summary.arrivals);
+    printStatsRow("累计到达车辆数", value);
+    if (summary.departures > 0) {
+        formatDuration(summary.dwellP50, p50, sizeof(p50));
+        formatDuration(summary.dwellP95, p95, sizeof(p95));
+        formatDuration(summary.dwellP99, p99, sizeof(p99));
+        snprintf(value, sizeof(value), "%s / %s / %s", p50, p95, p99);
+        printStatsRow("停车时长 p50/p95/p99", value);
+        snprintf(value, sizeof(value), "%.2f / %.2f / %.2f", summary.feeP50, summary.feeP95, summary.feeP99);
+        printStatsRow("停车费用 p50/p95/p99", value);
+    }
+    if (summary.peakOccupancy > 0) {
+        char timeStr[30];
+        formatTime(summary.peakOccupancyTime, timeStr, sizeof(timeStr));
+        snprintf(value, sizeof(value), "%d 辆（%s）", summary.peakOccupancy, timeStr);
+        printStatsRow("停车场最高占用", value);
+    }
+    if (summary.peakLane > 0) {
+        char timeStr[30];
+        formatTime(summary.peakLaneTime, timeStr, sizeof(timeStr));
+        snprintf(value, sizeof(value), "%d 辆（%s）", summary.peakLane, timeStr);
+        printStatsRow("便道最长排队", value);
+    }
+    snprintf(value, sizeof(value), "到达 %u 辆，离开 %u 辆", summary.arrivals24h, summary.departures24h);
+    printStatsRow("最近24小时", value);
+}
+
 // 显示系统统计信息
 void displaySystemStats(SystemStats *stats) {
     if (stats == NULL) {
@@ -518,13 +1358,11 @@ void displaySystemStats(SystemStats *stats) {
     }
     
     time_t now = time(NULL);
-    struct tm *timeinfo = localtime(&now);
     char currentTimeStr[30];
-    strftime(currentTimeStr, sizeof(currentTimeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
+    formatTime(now, currentTimeStr, sizeof(currentTimeStr));
     
-    struct tm *startTimeInfo = localtime(&stats->startTime);
     char startTimeStr[30];
-    strftime(startTimeStr, sizeof(startTimeStr), "%Y-%m-%d %H:%M:%S", startTimeInfo);
+    formatTime(stats->startTime, startTimeStr, sizeof(startTimeStr));
     
     // 计算系统运行时间
     double runningTime = difftime(now, stats->startTime);
@@ -577,69 +1415,142 @@ void displaySystemStats(SystemStats *stats) {
                COLOR_BRIGHT_WHITE, hourlyAverage, COLOR_RESET, 
                STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
     }
+
+    displayStreamStats(&stats->stream, now);
     
     printf("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
 }
 
-// 保存系统状态到文件
+// 将文件缓冲区写出并强制落盘
+bool flushFileToDisk(FILE *file) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// 复制文件句柄（先写出缓冲区），供其他线程刷盘；失败返回-1
+int duplicateForSync(FILE *file) {
+    if (fflush(file) != 0) {
+        return -1;
+    }
+#ifdef _WIN32
+    return _dup(_fileno(file));
+#else
+    return dup(fileno(file));
+#endif
+}
+
+// 把 duplicateForSync 得到的句柄刷盘并关闭
+bool syncDescriptor(int fd) {
+#ifdef _WIN32
+    bool ok = _commit(fd) == 0;
+    return _close(fd) == 0 && ok;
+#else
+    bool ok = fsync(fd) == 0;
+    return close(fd) == 0 && ok;
+#endif
+}
+
+#ifndef _WIN32
+// 把文件所在的目录刷盘，使目录中的改名、新建持久化（不支持目录刷盘的文件系统视为成功）
+static bool syncParentDirectory(const char *path) {
+    char dir[512];
+    const char *slash = strrchr(path, '/');
+    if (slash == NULL) {
+        snprintf(dir, sizeof(dir), ".");
+    } else if (slash == path) {
+        snprintf(dir, sizeof(dir), "/");
+    } else {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0 || errno == EINVAL;
+    return close(fd) == 0 && ok;
+}
+#endif
+
+// 用新文件原子地替换旧文件，返回时改名已落盘：调用方之后常会删除或清空被新文件取代的内容，
+// 目录没有刷盘时断电可能只留下删除而丢掉改名
+bool replaceFile(const char *from, const char *to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from, to) == 0 && syncParentDirectory(to);
+#endif
+}
+
+// 保存系统状态到指定文件，journalSeq为快照所包含的最后一条日志序列号（格式见 snapshot.c）
+bool saveSystemStateTo(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t journalSeq) {
+    return writeSnapshot(path, parkingLot, waitingLane, stats, journalSeq);
+}
+
+// 保存系统状态：有事件日志时压缩日志，否则直接写快照
 void saveSystemState(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats) {
-    FILE *file = fopen("parking_state.dat", "wb");
-    if (file == NULL) {
-        printf("无法创建保存文件！\n");
+    if (parkingLot != NULL && parkingLot->journal != NULL) {
+        journalCompact(parkingLot->journal, parkingLot, waitingLane, stats);
         return;
     }
     
-    // 保存统计信息
-    if (stats != NULL) {
-        fwrite(stats, sizeof(SystemStats), 1, file);
+    // 先写临时文件再替换，避免写到一半崩溃时留下空文件
+    const char *tempPath = STATE_FILE ".tmp";
+    if (!saveSystemStateTo(tempPath, parkingLot, waitingLane, stats, 0) ||
+        !replaceFile(tempPath, STATE_FILE)) {
+        printf("无法保存系统状态！\n");
     }
-    
-    // 保存停车场信息
-    if (parkingLot != NULL) {
-        // 保存停车场车辆数量
-        int carCount = parkingLot->top + 1;
-        fwrite(&carCount, sizeof(int), 1, file);
-        
-        // 保存停车场中的车辆
-        for (int i = 0; i < carCount; i++) {
-            fwrite(&parkingLot->data[i], sizeof(Car), 1, file);
-        }
-    }
-    
-    // 保存便道信息
-    if (waitingLane != NULL) {
-        // 保存便道车辆数量
-        int queueCount = getQueueCount(waitingLane);
-        fwrite(&queueCount, sizeof(int), 1, file);
-        
-        // 保存便道中的车辆
-        QueueNode *current = waitingLane->front;
-        while (current != NULL) {
-            fwrite(&current->car, sizeof(Car), 1, file);
-            current = current->next;
-        }
+}
+
+// 旧版本状态文件中的车辆（车牌号以字符串存放）
+typedef struct {
+    char plateNumber[MAX_PLATE_LEN];
+    time_t arriveTime;
+    time_t leaveTime;
+} LegacyCar;
+
+// 读入一辆旧格式的车辆并转换为压缩车牌
+static bool readLegacyCar(FILE *file, Car *car) {
+    LegacyCar legacy;
+    if (fread(&legacy, sizeof(LegacyCar), 1, file) != 1) {
+        return false;
     }
-    
-    fclose(file);
+    legacy.plateNumber[MAX_PLATE_LEN - 1] = '\0';
+    car->plate = encodePlate(legacy.plateNumber, MAX_PLATE_LEN - 1);
+    car->arriveTime = legacy.arriveTime;
+    car->leaveTime = legacy.leaveTime;
+    return car->plate != PLATE_NONE;
 }
 
-// 从文件加载系统状态
-bool loadSystemState(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats) {
-    FILE *file = fopen("parking_state.dat", "rb");
+// 加载旧版本的状态文件（SystemStats和Car结构体直接写入，布局依赖编译器和平台）
+static bool loadLegacyState(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t *journalSeq) {
+    *journalSeq = 0;
+    
+    FILE *file = fopen(path, "rb");
     if (file == NULL) {
         return false; // 文件不存在或无法打开
     }
     
-    // 清空当前状态
-    initStack(parkingLot);
-    clearQueue(waitingLane);
-    
-    // 加载统计信息
+    // 加载统计信息（旧版本的 SystemStats 只有前三个字段）
     if (stats != NULL) {
-        if (fread(stats, sizeof(SystemStats), 1, file) != 1) {
+        struct {
+            int totalCars;
+            double totalRevenue;
+            time_t startTime;
+        } legacyStats;
+        if (fread(&legacyStats, sizeof(legacyStats), 1, file) != 1) {
             fclose(file);
             return false;
         }
+        stats->totalCars = legacyStats.totalCars;
+        stats->totalRevenue = legacyStats.totalRevenue;
+        stats->startTime = legacyStats.startTime;
+        initStreamStats(&stats->stream);
     }
     
     // 加载停车场信息
@@ -649,10 +1560,19 @@ bool loadSystemState(ParkingStack *parkingLot, WaitingQueue *waitingLane, System
         return false;
     }
     
+    // 快照中的车辆多于当前容量时扩容，避免车辆丢失
+    if (carCount > parkingLot->capacity) {
+        printf("快照中有 %d 辆车，超过停车场容量 %d，已自动扩容\n", carCount, parkingLot->capacity);
+        if (resizeStack(parkingLot, carCount) != SUCCESS) {
+            fclose(file);
+            return false;
+        }
+    }
+    
     // 加载停车场中的车辆
     for (int i = 0; i < carCount; i++) {
         Car car;
-        if (fread(&car, sizeof(Car), 1, file) != 1) {
+        if (!readLegacyCar(file, &car)) {
             fclose(file);
             return false;
         }
@@ -669,17 +1589,70 @@ bool loadSystemState(ParkingStack *parkingLot, WaitingQueue *waitingLane, System
     // 加载便道中的车辆
     for (int i = 0; i < queueCount; i++) {
         Car car;
-        if (fread(&car, sizeof(Car), 1, file) != 1) {
+        if (!readLegacyCar(file, &car)) {
             fclose(file);
             return false;
         }
         enqueue(waitingLane, car);
     }
     
+    // 日志序列号（旧版本文件没有，按0处理）
+    if (fread(journalSeq, sizeof(uint64_t), 1, file) != 1) {
+        *journalSeq = 0;
+    }
+    
     fclose(file);
     return true;
 }
 
+// 从指定文件加载系统状态，不是新格式快照时按旧版本格式读取
+bool loadSystemStateFrom(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t *journalSeq) {
+    *journalSeq = 0;
+    
+    switch (readSnapshot(path, parkingLot, waitingLane, stats, journalSeq)) {
+        case SNAPSHOT_OK:
+            return true;
+        case SNAPSHOT_LEGACY:
+            return loadLegacyState(path, parkingLot, waitingLane, stats, journalSeq);
+        case SNAPSHOT_CORRUPT: {
+            // 把损坏的文件改名保留，避免退出时被新状态覆盖
+            char keepPath[300];
+            snprintf(keepPath, sizeof(keepPath), "%s.corrupt", path);
+            printf("快照文件 %s 已损坏，无法加载！已保留为 %s\n", path, keepPath);
+            replaceFile(path, keepPath);
+            return false;
+        }
+        case SNAPSHOT_UNSUPPORTED:
+            printf("快照文件 %s 由更新版本写出，无法加载！\n", path);
+            return false;
+        default:
+            return false; // 文件不存在
+    }
+}
+
+// 从文件加载系统状态：先加载快照，再重放快照之后的日志
+bool loadSystemState(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats) {
+    Journal *journal = parkingLot->journal;
+    uint64_t journalSeq = 0;
+    
+    // 清空当前状态
+    clearStack(parkingLot);
+    clearQueue(waitingLane);
+    clearPlateIndex(parkingLot->index);
+    
+    bool loaded = loadSystemStateFrom(journal != NULL ? journal->snapshotPath : STATE_FILE,
+                                      parkingLot, waitingLane, stats, &journalSeq);
+    
+    if (journal != NULL) {
+        int replayed = journalReplay(journal, parkingLot, waitingLane, stats, journalSeq);
+        if (replayed > 0) {
+            loaded = true;
+        }
+    }
+    
+    return loaded;
+}
+
 // 显示帮助信息
 void displayHelp() {
     printf("\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_YELLOW, COLOR_RESET);
@@ -749,10 +1722,17 @@ void displayHelp() {
            STYLE_BOLD, COLOR_YELLOW, COLOR_RESET, 
            COLOR_CYAN, COLOR_RESET, 
            STYLE_BOLD, COLOR_YELLOW, COLOR_RESET);
-    printf("%s%s║%s %s每小时%.2f元，不足一小时按一小时计算。%s                       %s%s║%s\n", 
-           STYLE_BOLD, COLOR_YELLOW, COLOR_RESET, 
-           COLOR_BRIGHT_WHITE, HOURLY_RATE, COLOR_RESET, 
-           STYLE_BOLD, COLOR_YELLOW, COLOR_RESET);
+    if (activeTariff == NULL || activeTariff->flatRate > 0) {
+        printf("%s%s║%s %s每小时%.2f元，不足一小时按一小时计算。%s                       %s%s║%s\n", 
+               STYLE_BOLD, COLOR_YELLOW, COLOR_RESET, 
+               COLOR_BRIGHT_WHITE, activeTariff != NULL ? activeTariff->flatRate : HOURLY_RATE, COLOR_RESET, 
+               STYLE_BOLD, COLOR_YELLOW, COLOR_RESET);
+    } else {
+        printf("%s%s║%s %s%-60s%s  %s%s║%s\n", 
+               STYLE_BOLD, COLOR_YELLOW, COLOR_RESET, 
+               COLOR_BRIGHT_WHITE, activeTariff->description, COLOR_RESET, 
+               STYLE_BOLD, COLOR_YELLOW, COLOR_RESET);
+    }
     
     printf("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n\n", STYLE_BOLD, COLOR_YELLOW, COLOR_RESET);
 }
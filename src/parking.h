@@ -6,11 +6,18 @@
 #include <time.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "stats.h"
+#include "plate.h"
 
 // 常量定义
-#define STACKSIZE 10        // 停车场容量
+#define STACKSIZE 10        // 默认停车场容量（可由配置文件或命令行修改）
+#define MAX_CAPACITY 1000000 // 停车场容量上限
 #define MAX_PLATE_LEN 30    // 最大车牌号长度
 #define HOURLY_RATE 10.0    // 每小时停车费率（元）
+#define RECEIPT_BUFFER_SIZE 2048 // 收费单渲染缓冲区大小
+#define STATE_FILE "parking_state.dat" // 默认状态快照文件
+#define CONFIG_FILE "bparking.conf"    // 默认配置文件
 
 // 错误代码
 #define SUCCESS 0
@@ -19,37 +26,74 @@
 #define ERR_EXISTS -3
 #define ERR_NOT_FOUND -4
 #define ERR_MEMORY -5
+#define ERR_IO -6     // 事件日志写出或刷盘失败
 
 // 车辆信息结构体
 typedef struct {
-    char plateNumber[MAX_PLATE_LEN]; // 车牌号（支持字母数字组合）
+    PackedPlate plate;               // 车牌号（压缩编码，见 plate.h；显示时用 formatPlate 还原）
     time_t arriveTime;               // 到达时间
     time_t leaveTime;                // 离开时间
 } Car;
 
+struct Journal;
+struct SessionArchive;
+struct PlateIndex;
+struct Tariff;
+struct TimerWheel;
+struct LanePolicy;
+
+// 停车场模型
+typedef enum {
+    LOT_MODEL_STACK = 0, // 窄长通道（栈）：离开时需先挪出后进的车辆
+    LOT_MODEL_BAYS = 1   // 独立车位：车辆停入编号最小的空位，离开时不挪车
+} LotModel;
+
 // 停车场栈结构
 typedef struct {
-    Car data[STACKSIZE];
-    int top;
+    Car *data;       // 连续存放的车位数组（堆上分配）
+    int capacity;    // 车位数量
+    int top;         // 最高的有车车位（栈模式下即栈顶）
+    int count;       // 停车场中的车辆数量
+    LotModel model;  // 停车场模型
+    uint64_t *freeBays; // 独立车位模式的空闲车位位图（1表示空闲）
+    int freeHint;       // 位图中可能有空位的第一个字，减少扫描
+    int lastMoves;      // 最近一次离场挪动的车辆次数
+    long totalMoves;    // 累计挪动的车辆次数
+    struct PlateIndex *index; // 车牌号索引（与便道共用，为NULL时线性查找）
+    struct Journal *journal;  // 事件日志（为NULL时不记录）
+    struct SessionArchive *archive; // 已完成会话的归档（为NULL时不归档）
+    struct TimerWheel *timers;      // 超时、免费时长和便道等候计时器（与便道共用，为NULL时不计时）
 } ParkingStack;
 
-// 便道队列节点
-typedef struct QueueNode {
-    Car car;
-    struct QueueNode *next;
-} QueueNode;
+// 便道优先级模式的排序键
+typedef struct {
+    int64_t key;       // 到达时间减去所属类别的提前量
+    uint64_t seq;      // 入队序号，键相同时先入队的在前
+} LaneKey;
 
-// 便道队列
+// 便道队列：默认先进先出（可增长的环形缓冲区）。设置了优先级策略时 slots[0..count) 是按 keys
+// 排序的二叉堆（head 始终为0），车辆在堆中的下标记在车牌号索引中，出队和按车牌取消都是O(log n)
 typedef struct {
-    QueueNode *front;
-    QueueNode *rear;
+    Car *slots;        // 环形缓冲区（优先级模式下为堆）
+    int capacity;      // 缓冲区容量
+    int head;          // 队头所在下标
     int count;         // 队列中的车辆数量
+    struct PlateIndex *index; // 车牌号索引（与停车场共用）
+    const struct LanePolicy *policy; // 优先级策略（为NULL时先进先出）
+    LaneKey *keys;     // 优先级模式下与 slots 一一对应的排序键
+    uint64_t nextSeq;  // 下一个入队序号
 } WaitingQueue;
 
 // 系统配置结构体
 typedef struct {
     int parkingCapacity;  // 停车场容量
-    double hourlyRate;    // 每小时费率
+    double hourlyRate;    // 统一费率（没有收费方案文件时使用，也是方案中未覆盖时段的默认费率）
+    char tariffPath[256]; // 收费方案文件（为空时按统一费率计费）
+    LotModel lotModel;    // 停车场模型
+    int maxStayMinutes;   // 最长停车时长（分钟，0表示不提醒）
+    int laneTimeoutMinutes; // 便道最长等候时间（分钟，0表示不提醒）
+    bool lanePriority;    // 便道按优先级策略排队（默认先进先出）
+    char lanePolicyPath[256]; // 便道优先级文件（为空时使用默认提前量）
     bool debugMode;       // 调试模式
 } SystemConfig;
 
@@ -58,14 +102,24 @@ typedef struct {
     int totalCars;        // 总处理车辆数
     double totalRevenue;  // 总收入
     time_t startTime;     // 系统启动时间
+    StreamStats stream;   // 流式统计：停车时长和费用直方图、逐小时计数、峰值
 } SystemStats;
 
 // 停车场栈操作
-void initStack(ParkingStack *stack);
+int initStack(ParkingStack *stack, int capacity);
+int resizeStack(ParkingStack *stack, int capacity);
+int setLotModel(ParkingStack *stack, LotModel model);
+bool parseLotModel(const char *name, LotModel *model);
+void freeStack(ParkingStack *stack);
+void clearStack(ParkingStack *stack);
 bool isStackEmpty(ParkingStack *stack);
 bool isStackFull(ParkingStack *stack);
+int getStackCount(ParkingStack *stack);
+bool isSlotOccupied(ParkingStack *stack, int slot);
 int push(ParkingStack *stack, Car car);
+int placeCar(ParkingStack *stack, int slot, Car car);
 Car pop(ParkingStack *stack);
+Car removeCarAt(ParkingStack *stack, int position);
 void displayStack(ParkingStack *stack);
 
 // 便道队列操作
@@ -73,6 +127,11 @@ void initQueue(WaitingQueue *queue);
 bool isQueueEmpty(WaitingQueue *queue);
 int enqueue(WaitingQueue *queue, Car car);
 Car dequeue(WaitingQueue *queue);
+Car *queueAt(WaitingQueue *queue, int position);
+int findQueuePosition(WaitingQueue *queue, PackedPlate plate);
+Car removeQueueAt(WaitingQueue *queue, int position);
+int *queuePromotionOrder(WaitingQueue *queue);
+void setActiveLanePolicy(const struct LanePolicy *policy);
 void clearQueue(WaitingQueue *queue);
 void displayQueue(WaitingQueue *queue);
 int getQueueCount(WaitingQueue *queue);
@@ -83,18 +142,42 @@ bool isValidPlateNumber(const char *plateNumber);
 bool comparePlateNumbers(const char *plate1, const char *plate2);
 
 // 停车场管理操作
+void attachPlateIndex(ParkingStack *parkingLot, WaitingQueue *waitingLane, struct PlateIndex *index);
+void attachTimerWheel(ParkingStack *parkingLot, WaitingQueue *waitingLane, struct TimerWheel *timers);
 bool isCarExists(ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *plateNumber);
 int parkCar(ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *plateNumber);
+int parkCarAt(ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *plateNumber, SystemStats *stats, time_t now);
 int findCarPosition(ParkingStack *parkingLot, const char *plateNumber);
 int leaveCar(ParkingStack *parkingLot, ParkingStack *tempLot, WaitingQueue *waitingLane, const char *plateNumber, SystemStats *stats);
-void displayParkingStatus(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats);
+int leaveCarAt(ParkingStack *parkingLot, ParkingStack *tempLot, WaitingQueue *waitingLane, const char *plateNumber, SystemStats *stats, time_t now);
+int cancelWaitingCar(ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *plateNumber, time_t now);
+int displayParkingStatus(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, int page);
 double calculateFee(Car car);
+double calculateFeeWith(const struct Tariff *tariff, Car car);
+void setActiveTariff(const struct Tariff *tariff);
+
+// 收费单输出
+void setReceiptOutput(bool enabled);
+void formatTime(time_t t, char *buffer, size_t size);
+bool parseTimestamp(const char *text, time_t *result);
+int formatReceipt(char *buffer, size_t size, const Car *car, double fee);
+void printReceipt(const Car *car, double fee);
 
 // 系统管理
 void initSystem(SystemConfig *config, SystemStats *stats);
+bool loadSystemConfig(SystemConfig *config, const char *path);
 void saveSystemState(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats);
 bool loadSystemState(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats);
+bool saveSystemStateTo(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t journalSeq);
+bool loadSystemStateFrom(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t *journalSeq);
+bool flushFileToDisk(FILE *file);
+int duplicateForSync(FILE *file);
+bool syncDescriptor(int fd);
+bool replaceFile(const char *from, const char *to);
 void displaySystemStats(SystemStats *stats);
+int displayWidth(const char *text);
+void printStatsRow(const char *label, const char *value);
+void formatDuration(uint64_t seconds, char *buffer, size_t size);
 
 // 显示帮助信息
 void displayHelp();
@@ -0,0 +1,334 @@
+#include "plate.h"
+#include "parking.h"
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// ---- 省份编码表 ----
+
+// 编码从1开始，按表中顺序；只能在表尾追加，否则已有快照中的编码会变
+static const char *const provinces[] = {
+    "京", "津", "沪", "渝", "冀", "豫", "云", "辽", "黑", "湘", "皖",
+    "鲁", "新", "苏", "浙", "赣", "鄂", "桂", "甘", "晋", "蒙", "陕",
+    "吉", "闽", "贵", "粤", "青", "藏", "川", "宁", "琼", "使"
+};
+#define PROVINCE_COUNT ((int)(sizeof(provinces) / sizeof(provinces[0])))
+#define PROVINCE_SLOTS 128
+
+#define PLATE_PROVINCE_SHIFT 56
+#define PLATE_VALUE_MASK (((uint64_t)1 << PLATE_LENGTH_SHIFT) - 1)
+
+// 省份简称（3字节UTF-8）到编码的哈希表，首次使用时建立
+static uint32_t provinceKeys[PROVINCE_SLOTS];
+static uint8_t provinceCodes[PROVINCE_SLOTS];
+static pthread_once_t provinceOnce = PTHREAD_ONCE_INIT;
+
+static uint32_t provinceKey(const char *text) {
+    const unsigned char *p = (const unsigned char *)text;
+    return (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+}
+
+static uint32_t provinceSlot(uint32_t key) {
+    return (key * 2654435761u) >> 25;
+}
+
+static void buildProvinceTable(void) {
+    for (int code = 1; code <= PROVINCE_COUNT; code++) {
+        uint32_t key = provinceKey(provinces[code - 1]);
+        uint32_t slot = provinceSlot(key);
+        while (provinceCodes[slot] != 0) {
+            slot = (slot + 1) % PROVINCE_SLOTS;
+        }
+        provinceKeys[slot] = key;
+        provinceCodes[slot] = (uint8_t)code;
+    }
+}
+
+// 开头3个字节的省份编码，不在表中时返回0
+static int provinceCode(const char *text, size_t length) {
+    if (length < 3 || (unsigned char)text[0] < 0xE0) {
+        return 0;
+    }
+    pthread_once(&provinceOnce, buildProvinceTable);
+    uint32_t key = provinceKey(text);
+    for (uint32_t slot = provinceSlot(key); provinceCodes[slot] != 0; slot = (slot + 1) % PROVINCE_SLOTS) {
+        if (provinceKeys[slot] == key) {
+            return provinceCodes[slot];
+        }
+    }
+    return 0;
+}
+
+bool isPlateProvince(const char *text, size_t length) {
+    return provinceCode(text, length) != 0;
+}
+
+// ---- 车牌表：无法压缩的车牌号按首次出现的顺序编号，进程退出前不释放 ----
+//
+// 字符串分块存放，块一经分配不再移动；编号到字符串、字符串到编号都在锁内进行。
+// 通过 isValidPlateNumber 的车牌都能压缩，车牌表只收录旧快照、日志和事件文件中
+// 无法压缩的车牌号，条数受这些文件限制，不随道闸输入增长。
+
+#define INTERN_CHUNK_SIZE 1024
+#define INTERN_MAX_CHUNKS 4096
+
+static char (*internChunks[INTERN_MAX_CHUNKS])[MAX_PLATE_LEN];
+static uint32_t internCount;
+static uint32_t *internBuckets;      // 编号+1，0表示空桶
+static uint32_t internBucketCount;   // 2的幂
+static pthread_mutex_t internLock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *internText(uint32_t id) {
+    return internChunks[id / INTERN_CHUNK_SIZE][id % INTERN_CHUNK_SIZE];
+}
+
+static uint32_t internHash(const char *text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 查找车牌号所在的桶（找不到时为空桶）；调用时已持有锁
+static uint32_t internProbe(const char *text, size_t length) {
+    uint32_t mask = internBucketCount - 1;
+    uint32_t i = internHash(text, length) & mask;
+    while (internBuckets[i] != 0) {
+        const char *stored = internText(internBuckets[i] - 1);
+        if (memcmp(stored, text, length) == 0 && stored[length] == '\0') {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// 负载超过一半时扩容
+static bool internGrow(void) {
+    uint32_t capacity = internBucketCount == 0 ? 1024 : internBucketCount * 2;
+    uint32_t *buckets = calloc(capacity, sizeof(uint32_t));
+    if (buckets == NULL) {
+        return false;
+    }
+    uint32_t *old = internBuckets;
+    internBuckets = buckets;
+    internBucketCount = capacity;
+    for (uint32_t id = 0; id < internCount; id++) {
+        const char *text = internText(id);
+        internBuckets[internProbe(text, strlen(text))] = id + 1;
+    }
+    free(old);
+    return true;
+}
+
+// 登记车牌的编码：编号加上开头的多字节字符之后的字符数
+static PackedPlate internCode(const char *text, size_t length, uint32_t id) {
+    size_t start = 0;
+    while (start < length && (unsigned char)text[start] >= 0x80) {
+        start++;
+    }
+    size_t tail = length - start < 15 ? length - start : 15;
+    return PLATE_INTERNED_FLAG | (PackedPlate)tail << PLATE_LENGTH_SHIFT | id;
+}
+
+// 查找（add 为true时不存在则登记）车牌号的编号，失败返回 PLATE_NONE
+static PackedPlate internPlate(const char *text, size_t length, bool add) {
+    PackedPlate plate = PLATE_NONE;
+    pthread_mutex_lock(&internLock);
+    bool ready = add ? (internCount + 1) * 2 <= internBucketCount || internGrow() : internBucketCount > 0;
+    if (!ready) {
+        pthread_mutex_unlock(&internLock);
+        return PLATE_NONE;
+    }
+    uint32_t slot = internProbe(text, length);
+    if (internBuckets[slot] != 0) {
+        plate = internCode(text, length, internBuckets[slot] - 1);
+    } else if (add) {
+        uint32_t id = internCount;
+        uint32_t chunk = id / INTERN_CHUNK_SIZE;
+        if (chunk < INTERN_MAX_CHUNKS && internChunks[chunk] == NULL) {
+            internChunks[chunk] = calloc(INTERN_CHUNK_SIZE, MAX_PLATE_LEN);
+        }
+        if (chunk < INTERN_MAX_CHUNKS && internChunks[chunk] != NULL) {
+            char *stored = internChunks[chunk][id % INTERN_CHUNK_SIZE];
+            memcpy(stored, text, length);
+            stored[length] = '\0';
+            internBuckets[slot] = id + 1;
+            internCount++;
+            plate = internCode(text, length, id);
+        }
+    }
+    pthread_mutex_unlock(&internLock);
+    return plate;
+}
+
+// ---- 编码与还原 ----
+
+static PackedPlate packPlate(const char *plateNumber, size_t maxLength, bool add) {
+    if (maxLength > MAX_PLATE_LEN - 1) {
+        maxLength = MAX_PLATE_LEN - 1;
+    }
+    size_t length = strnlen(plateNumber, maxLength);
+    int code = provinceCode(plateNumber, length);
+    size_t tailLength = length - 3;
+    if (code == 0 || tailLength > PLATE_PACKED_MAX_TAIL) {
+        return internPlate(plateNumber, length, add);
+    }
+    // 尾部最多10个字符，边检查边累加比先调用 plateTailIsAlnum 再累加少走一遍
+    uint64_t value = 0;
+    for (size_t i = 3; i < length; i++) {
+        unsigned char c = (unsigned char)plateNumber[i];
+        unsigned digit = c - (unsigned)'0';
+        unsigned letter = c - (unsigned)'A';
+        if (digit >= 10 && letter >= 26) {
+            return internPlate(plateNumber, length, add);
+        }
+        value = value * 36 + (digit < 10 ? digit : letter + 10);
+    }
+    return (PackedPlate)code << PLATE_PROVINCE_SHIFT | (PackedPlate)tailLength << PLATE_LENGTH_SHIFT | value;
+}
+
+PackedPlate encodePlate(const char *plateNumber, size_t maxLength) {
+    return packPlate(plateNumber, maxLength, true);
+}
+
+PackedPlate lookupPlate(const char *plateNumber, size_t maxLength) {
+    return packPlate(plateNumber, maxLength, false);
+}
+
+size_t formatPlate(PackedPlate plate, char *buffer, size_t size) {
+    char text[MAX_PLATE_LEN];
+    size_t length = 0;
+    if (plate & PLATE_INTERNED_FLAG) {
+        uint32_t id = (uint32_t)plate;
+        pthread_mutex_lock(&internLock);
+        if (id < internCount) {
+            length = strlen(internText(id));
+            memcpy(text, internText(id), length);
+        }
+        pthread_mutex_unlock(&internLock);
+    } else if (plate != PLATE_NONE) {
+        int code = (int)(plate >> PLATE_PROVINCE_SHIFT & 0x3F);
+        size_t tailLength = (size_t)(plate >> PLATE_LENGTH_SHIFT & 0xF);
+        uint64_t value = plate & PLATE_VALUE_MASK;
+        if (code >= 1 && code <= PROVINCE_COUNT && tailLength <= PLATE_PACKED_MAX_TAIL) {
+            memcpy(text, provinces[code - 1], 3);
+            length = 3 + tailLength;
+            for (size_t i = length; i > 3; i--) {
+                int digit = (int)(value % 36);
+                text[i - 1] = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+                value /= 36;
+            }
+        }
+    }
+    if (size == 0) {
+        return 0;
+    }
+    if (length >= size) {
+        length = size - 1;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return length;
+}
+
+// 逐字节的参考实现
+bool plateTailIsAlnumScalar(const char *text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// SWAR：一次检查8个字节。最高位为0的字节 b 加上 0x80-lo 后最高位为1当且仅当 b >= lo，
+// 且各字节之间不会进位；最高位为1的字节（UTF-8多字节字符的一部分）直接判为无效。
+#define SWAR_ONES 0x0101010101010101ull
+#define SWAR_HIGH 0x8080808080808080ull
+
+static bool swarWordIsAlnum(uint64_t x) {
+    uint64_t low = x & ~SWAR_HIGH;
+    uint64_t atLeast0 = low + SWAR_ONES * (0x80 - '0');
+    uint64_t above9 = low + SWAR_ONES * (0x80 - '9' - 1);
+    uint64_t atLeastA = low + SWAR_ONES * (0x80 - 'A');
+    uint64_t aboveZ = low + SWAR_ONES * (0x80 - 'Z' - 1);
+    uint64_t ok = ((atLeast0 & ~above9) | (atLeastA & ~aboveZ)) & ~x & SWAR_HIGH;
+    return ok == SWAR_HIGH;
+}
+
+// 把不超过8个字节读成一个字：4-8个字节用两次可能重叠的4字节读取（重复检查同一字节不影响结果），
+// 更短的逐字节读入并用 '0' 补齐。不会读到 text[length] 之后，也不需要可变长度的 memcpy。
+static uint64_t loadShortTail(const char *text, size_t length) {
+    if (length >= 4) {
+        uint32_t low;
+        uint32_t high;
+        memcpy(&low, text, 4);
+        memcpy(&high, text + length - 4, 4);
+        return (uint64_t)low | (uint64_t)high << 32;
+    }
+    uint64_t x = SWAR_ONES * '0';
+    for (size_t i = 0; i < length; i++) {
+        x = (x & ~(0xFFull << (8 * i))) | (uint64_t)(unsigned char)text[i] << (8 * i);
+    }
+    return x;
+}
+
+// 长度不小于8时按8字节一组检查，最后一组与前一组重叠，对齐到结尾
+bool plateTailIsAlnumSwar(const char *text, size_t length) {
+    if (length <= 8) {
+        return swarWordIsAlnum(loadShortTail(text, length));
+    }
+    uint64_t x;
+    for (size_t i = 0; i + 8 < length; i += 8) {
+        memcpy(&x, text + i, 8);
+        if (!swarWordIsAlnum(x)) {
+            return false;
+        }
+    }
+    memcpy(&x, text + length - 8, 8);
+    return swarWordIsAlnum(x);
+}
+
+#ifdef __SSE2__
+// SSE2：一次检查16个字节。按有符号字节比较，最高位为1的字节是负数，不落在任何区间内
+static bool sse2BlockIsAlnum(__m128i b) {
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(b, _mm_set1_epi8('9' + 1)));
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(b, _mm_set1_epi8('Z' + 1)));
+    return _mm_movemask_epi8(_mm_or_si128(digit, upper)) == 0xFFFF;
+}
+
+// 不足16字节时拼成一个块（两次可能重叠的8字节读取），否则按16字节一组、最后一组对齐到结尾
+bool plateTailIsAlnumSse2(const char *text, size_t length) {
+    if (length < 16) {
+        uint64_t low;
+        uint64_t high;
+        if (length >= 8) {
+            memcpy(&low, text, 8);
+            memcpy(&high, text + length - 8, 8);
+        } else {
+            low = loadShortTail(text, length);
+            high = low;
+        }
+        return sse2BlockIsAlnum(_mm_set_epi64x((long long)high, (long long)low));
+    }
+    for (size_t i = 0; i + 16 < length; i += 16) {
+        if (!sse2BlockIsAlnum(_mm_loadu_si128((const __m128i *)(text + i)))) {
+            return false;
+        }
+    }
+    return sse2BlockIsAlnum(_mm_loadu_si128((const __m128i *)(text + length - 16)));
+}
+#endif
+
+bool plateTailIsAlnum(const char *text, size_t length) {
+#ifdef __SSE2__
+    return plateTailIsAlnumSse2(text, length);
+#else
+    return plateTailIsAlnumSwar(text, length);
+#endif
+}
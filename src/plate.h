@@ -0,0 +1,62 @@
+#ifndef PLATE_H
+#define PLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 压缩车牌号：一个64位整数，比较和哈希都按整数进行，显示时用 formatPlate 还原为字符串。
+//
+//   常规车牌（省份简称在编码表中，其后为不超过10个数字或大写字母）：
+//     bit 56-61  省份编码（1起）
+//     bit 52-55  尾部字符数
+//     bit 0-51   尾部按36进制排列的值（0-9为0-9，A-Z为10-35）
+//   其他车牌（编码表外的首字符、小写字母、过长等）登记到进程内的车牌表：
+//     bit 63     登记标志
+//     bit 52-55  开头的多字节字符之后的字符数（超过15记为15），与常规车牌的尾部字符数含义相同
+//     bit 0-31   车牌表中的编号
+//
+// 0 不是任何车牌的编码，表示“没有车牌”。同一字符串总是得到同一编码，还原后与原字符串逐字节相同。
+typedef uint64_t PackedPlate;
+
+#define PLATE_NONE ((PackedPlate)0)
+#define PLATE_INTERNED_FLAG ((PackedPlate)1 << 63)
+#define PLATE_PACKED_MAX_TAIL 10
+#define PLATE_LENGTH_SHIFT 52
+
+// 编码车牌号（超出 maxLength 字节的部分截断）；需要登记而车牌表已满或内存不足时返回 PLATE_NONE
+PackedPlate encodePlate(const char *plateNumber, size_t maxLength);
+// 只查找不登记：需要登记而车牌表中没有的车牌号返回 PLATE_NONE（这样的车牌一定不在场）
+PackedPlate lookupPlate(const char *plateNumber, size_t maxLength);
+// 还原为字符串，返回写入的字节数（不含结尾0）
+size_t formatPlate(PackedPlate plate, char *buffer, size_t size);
+// 开头是否为编码表中的省份简称（3字节UTF-8）
+bool isPlateProvince(const char *text, size_t length);
+
+// 省份简称之后的字符数（含地区字母），用于推断车辆类别，不需要还原字符串
+static inline int plateTailLength(PackedPlate plate) {
+    return (int)(plate >> PLATE_LENGTH_SHIFT & 0xF);
+}
+
+// 车牌号哈希值（用于索引选桶和分段）
+static inline uint32_t hashPackedPlate(PackedPlate plate) {
+    uint64_t h = plate;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+// 检查车牌号尾部（省份简称和地区字母之后的部分）是否全为数字或大写字母。
+// plateTailIsAlnum 按编译目标选择 SSE2 或 SWAR（8字节一组的整数运算）实现；
+// 另外两个实现和逐字节的参考实现一起导出，供 bench --verify-plates 核对结果是否一致。
+bool plateTailIsAlnum(const char *text, size_t length);
+bool plateTailIsAlnumScalar(const char *text, size_t length);
+bool plateTailIsAlnumSwar(const char *text, size_t length);
+#ifdef __SSE2__
+bool plateTailIsAlnumSse2(const char *text, size_t length);
+#endif
+
+#endif /* PLATE_H */
@@ -0,0 +1,186 @@
+#include "plate_directory.h"
+
+// 车牌所在的分段（分段内用哈希低位选桶，这里用高位选分段）
+static PlateDirectoryStripe *stripeFor(PlateDirectory *directory, PackedPlate plate) {
+    return &directory->stripes[hashPackedPlate(plate) >> 26 & (PLATE_DIRECTORY_STRIPES - 1)];
+}
+
+// 分配指定数量的空桶
+static int allocEntries(PlateDirectoryStripe *stripe, int capacity) {
+    PlateDirectoryEntry *entries = (PlateDirectoryEntry *)calloc((size_t)capacity, sizeof(PlateDirectoryEntry));
+    if (entries == NULL) {
+        printf("内存分配失败！\n");
+        return ERR_MEMORY;
+    }
+    stripe->entries = entries;
+    stripe->capacity = capacity;
+    stripe->count = 0;
+    stripe->tombstones = 0;
+    return SUCCESS;
+}
+
+// 查找车牌号所在的桶；找不到时返回可插入的位置（优先复用已删除的桶）
+static int probe(const PlateDirectoryStripe *stripe, PackedPlate plate, bool *found) {
+    int mask = stripe->capacity - 1;
+    int i = (int)(hashPackedPlate(plate) & (uint32_t)mask);
+    int firstDeleted = -1;
+
+    while (1) {
+        const PlateDirectoryEntry *entry = &stripe->entries[i];
+        if (entry->plate == PLATE_NONE) {
+            *found = false;
+            return firstDeleted >= 0 ? firstDeleted : i;
+        }
+        if (entry->count == 0) {
+            if (firstDeleted < 0) {
+                firstDeleted = i;
+            }
+        } else if (entry->plate == plate) {
+            *found = true;
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// 扩容（或在删除标记过多时原地重建）
+static int rehash(PlateDirectoryStripe *stripe, int newCapacity) {
+    PlateDirectoryEntry *old = stripe->entries;
+    int oldCapacity = stripe->capacity;
+
+    if (allocEntries(stripe, newCapacity) != SUCCESS) {
+        stripe->entries = old;
+        stripe->capacity = oldCapacity;
+        return ERR_MEMORY;
+    }
+
+    int mask = newCapacity - 1;
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i].plate == PLATE_NONE || old[i].count == 0) {
+            continue;
+        }
+        int j = (int)(hashPackedPlate(old[i].plate) & (uint32_t)mask);
+        while (stripe->entries[j].plate != PLATE_NONE) {
+            j = (j + 1) & mask;
+        }
+        stripe->entries[j] = old[i];
+        stripe->count++;
+    }
+
+    free(old);
+    return SUCCESS;
+}
+
+// 查找车牌号的目录项，不存在时返回NULL
+static PlateDirectoryEntry *findEntry(PlateDirectoryStripe *stripe, PackedPlate plate) {
+    bool found;
+    int i = probe(stripe, plate, &found);
+    return found ? &stripe->entries[i] : NULL;
+}
+
+// 初始化目录
+int initPlateDirectory(PlateDirectory *directory, int expectedCount) {
+    int capacity = 16;
+    while (capacity < (expectedCount / PLATE_DIRECTORY_STRIPES + 1) * 2) {
+        capacity *= 2;
+    }
+    for (int i = 0; i < PLATE_DIRECTORY_STRIPES; i++) {
+        if (allocEntries(&directory->stripes[i], capacity) != SUCCESS) {
+            for (int j = 0; j < i; j++) {
+                free(directory->stripes[j].entries);
+                pthread_mutex_destroy(&directory->stripes[j].lock);
+            }
+            return ERR_MEMORY;
+        }
+        pthread_mutex_init(&directory->stripes[i].lock, NULL);
+    }
+    return SUCCESS;
+}
+
+// 释放目录
+void freePlateDirectory(PlateDirectory *directory) {
+    for (int i = 0; i < PLATE_DIRECTORY_STRIPES; i++) {
+        free(directory->stripes[i].entries);
+        directory->stripes[i].entries = NULL;
+        directory->stripes[i].capacity = 0;
+        pthread_mutex_destroy(&directory->stripes[i].lock);
+    }
+}
+
+// 车辆进入某设施
+int plateDirectoryClaim(PlateDirectory *directory, const char *plateNumber, int facilityId) {
+    PackedPlate plate = encodePlate(plateNumber, MAX_PLATE_LEN - 1);
+    if (plate == PLATE_NONE) {
+        return ERR_FULL;
+    }
+    PlateDirectoryStripe *stripe = stripeFor(directory, plate);
+    int others = 0;
+
+    pthread_mutex_lock(&stripe->lock);
+    PlateDirectoryEntry *entry = findEntry(stripe, plate);
+    if (entry != NULL) {
+        others = entry->count++;
+    } else {
+        // 负载（含删除标记）超过3/4时重建
+        if ((stripe->count + stripe->tombstones + 1) * 4 > stripe->capacity * 3) {
+            int newCapacity = (stripe->count + 1) * 2 > stripe->capacity ? stripe->capacity * 2 : stripe->capacity;
+            if (rehash(stripe, newCapacity) != SUCCESS) {
+                pthread_mutex_unlock(&stripe->lock);
+                return ERR_MEMORY;
+            }
+        }
+        bool found;
+        entry = &stripe->entries[probe(stripe, plate, &found)];
+        if (entry->plate != PLATE_NONE) {
+            stripe->tombstones--; // 复用已删除的桶
+        }
+        entry->plate = plate;
+        entry->count = 1;
+        entry->facility = facilityId;
+        stripe->count++;
+    }
+    pthread_mutex_unlock(&stripe->lock);
+    return others;
+}
+
+// 车辆离开某设施
+void plateDirectoryRelease(PlateDirectory *directory, const char *plateNumber, int facilityId) {
+    PackedPlate plate = lookupPlate(plateNumber, MAX_PLATE_LEN - 1);
+    if (plate == PLATE_NONE) {
+        return;
+    }
+    PlateDirectoryStripe *stripe = stripeFor(directory, plate);
+
+    pthread_mutex_lock(&stripe->lock);
+    PlateDirectoryEntry *entry = findEntry(stripe, plate);
+    if (entry != NULL) {
+        if (--entry->count == 0) {
+            stripe->count--;
+            stripe->tombstones++;
+        } else if (entry->facility == facilityId) {
+            entry->facility = -1; // 不记录其他设施的编号，不知道剩下的是哪一个
+        }
+    }
+    pthread_mutex_unlock(&stripe->lock);
+}
+
+// 查询车牌所在设施数量
+int plateDirectoryLookup(PlateDirectory *directory, const char *plateNumber, int *facilityId) {
+    PackedPlate plate = lookupPlate(plateNumber, MAX_PLATE_LEN - 1);
+    if (plate == PLATE_NONE) {
+        return 0;
+    }
+    PlateDirectoryStripe *stripe = stripeFor(directory, plate);
+    int sites = 0;
+
+    pthread_mutex_lock(&stripe->lock);
+    PlateDirectoryEntry *entry = findEntry(stripe, plate);
+    if (entry != NULL) {
+        sites = entry->count;
+        if (facilityId != NULL) {
+            *facilityId = entry->facility;
+        }
+    }
+    pthread_mutex_unlock(&stripe->lock);
+    return sites;
+}
@@ -0,0 +1,44 @@
+#ifndef PLATE_DIRECTORY_H
+#define PLATE_DIRECTORY_H
+
+#include <pthread.h>
+#include "parking.h"
+
+// 分段数量（2的幂）
+#define PLATE_DIRECTORY_STRIPES 64
+
+// 目录项（16字节）：plate 为 PLATE_NONE 表示空桶，count 为0表示已删除
+typedef struct {
+    PackedPlate plate;      // 车牌号（压缩编码）
+    int count;              // 该车牌所在的设施数量
+    int facility;           // 最先登记且仍在场的设施编号；该设施已离开而其他设施仍在场时为-1
+} PlateDirectoryEntry;
+
+// 一个分段：一把锁保护一张开放寻址哈希表（线性探测）
+typedef struct {
+    pthread_mutex_t lock;
+    PlateDirectoryEntry *entries;
+    int capacity;      // 桶数量，始终为2的幂
+    int count;         // 使用中的目录项数量
+    int tombstones;    // 已删除的目录项数量
+} PlateDirectoryStripe;
+
+// 跨设施车牌目录：记录每辆在场车辆所在的设施，发现同一车牌同时出现在两个设施时报警。
+// 按车牌哈希的高位分段加锁，不同设施的引擎线程很少争用同一把锁。
+typedef struct PlateDirectory {
+    PlateDirectoryStripe stripes[PLATE_DIRECTORY_STRIPES];
+} PlateDirectory;
+
+// 目录管理
+int initPlateDirectory(PlateDirectory *directory, int expectedCount);
+void freePlateDirectory(PlateDirectory *directory);
+
+// 车辆进入某设施，返回此前已在场的其他设施数量（大于0即为重复车牌）；
+// 车牌表已满时返回 ERR_FULL，内存不足时返回 ERR_MEMORY，这两种情况下车牌没有登记
+int plateDirectoryClaim(PlateDirectory *directory, const char *plateNumber, int facilityId);
+// 车辆离开某设施
+void plateDirectoryRelease(PlateDirectory *directory, const char *plateNumber, int facilityId);
+// 查询车牌所在设施数量，facilityId 返回最先登记且仍在场的设施（不确定时为-1，可为NULL）
+int plateDirectoryLookup(PlateDirectory *directory, const char *plateNumber, int *facilityId);
+
+#endif /* PLATE_DIRECTORY_H */
@@ -0,0 +1,175 @@
+#include "plate_index.h"
+
+#define ENTRY_EMPTY   0
+#define ENTRY_USED    1
+#define ENTRY_DELETED 2
+
+// 分配指定数量的空桶
+static int allocEntries(PlateIndex *index, int capacity) {
+    PlateIndexEntry *entries = (PlateIndexEntry *)calloc((size_t)capacity, sizeof(PlateIndexEntry));
+    if (entries == NULL) {
+        printf("内存分配失败！\n");
+        return ERR_MEMORY;
+    }
+    index->entries = entries;
+    index->capacity = capacity;
+    index->count = 0;
+    index->tombstones = 0;
+    return SUCCESS;
+}
+
+// 初始化索引，容量按预计车辆数向上取到2的幂
+int initPlateIndex(PlateIndex *index, int expectedCount) {
+    index->entries = NULL;
+    int capacity = 16;
+    while (capacity < expectedCount * 2) {
+        capacity *= 2;
+    }
+    return allocEntries(index, capacity);
+}
+
+// 释放索引占用的内存
+void freePlateIndex(PlateIndex *index) {
+    if (index == NULL) {
+        return;
+    }
+    free(index->entries);
+    index->entries = NULL;
+    index->capacity = 0;
+    index->count = 0;
+    index->tombstones = 0;
+}
+
+// 清空索引（保留已分配的桶）
+void clearPlateIndex(PlateIndex *index) {
+    if (index == NULL) {
+        return;
+    }
+    memset(index->entries, 0, (size_t)index->capacity * sizeof(PlateIndexEntry));
+    index->count = 0;
+    index->tombstones = 0;
+}
+
+// 查找车牌号所在的桶；找不到时返回可插入的位置（优先复用已删除的桶）
+static int probe(PlateIndex *index, PackedPlate plate, bool *found) {
+    int mask = index->capacity - 1;
+    int i = (int)(hashPackedPlate(plate) & (uint32_t)mask);
+    int firstDeleted = -1;
+
+    while (1) {
+        PlateIndexEntry *entry = &index->entries[i];
+        if (entry->state == ENTRY_EMPTY) {
+            *found = false;
+            return firstDeleted >= 0 ? firstDeleted : i;
+        }
+        if (entry->state == ENTRY_DELETED) {
+            if (firstDeleted < 0) {
+                firstDeleted = i;
+            }
+        } else if (entry->plate == plate) {
+            *found = true;
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// 扩容（或在删除标记过多时原地重建）
+static int rehash(PlateIndex *index, int newCapacity) {
+    PlateIndexEntry *old = index->entries;
+    int oldCapacity = index->capacity;
+
+    if (allocEntries(index, newCapacity) != SUCCESS) {
+        index->entries = old;
+        index->capacity = oldCapacity;
+        return ERR_MEMORY;
+    }
+
+    int mask = newCapacity - 1;
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i].state != ENTRY_USED) {
+            continue;
+        }
+        int j = (int)(hashPackedPlate(old[i].plate) & (uint32_t)mask);
+        while (index->entries[j].state != ENTRY_EMPTY) {
+            j = (j + 1) & mask;
+        }
+        index->entries[j] = old[i];
+        index->count++;
+    }
+
+    free(old);
+    return SUCCESS;
+}
+
+// 插入或更新车牌号的位置
+int plateIndexPut(PlateIndex *index, PackedPlate plate, PlateLocation location, int slot) {
+    // 负载（含删除标记）超过3/4时重建
+    if ((index->count + index->tombstones + 1) * 4 > index->capacity * 3) {
+        int newCapacity = (index->count + 1) * 2 > index->capacity ? index->capacity * 2 : index->capacity;
+        if (rehash(index, newCapacity) != SUCCESS) {
+            return ERR_MEMORY;
+        }
+    }
+
+    bool found;
+    int i = probe(index, plate, &found);
+    PlateIndexEntry *entry = &index->entries[i];
+
+    if (!found) {
+        if (entry->state == ENTRY_DELETED) {
+            index->tombstones--;
+        }
+        entry->state = ENTRY_USED;
+        entry->plate = plate;
+        index->count++;
+    }
+
+    entry->location = (uint8_t)location;
+    entry->slot = slot;
+    return SUCCESS;
+}
+
+// 预留空间：之后 extra 次插入（每次插入前可以先删除一项）都不需要重建，不会因内存不足失败
+int plateIndexReserve(PlateIndex *index, int extra) {
+    if ((index->count + index->tombstones + extra) * 4 <= index->capacity * 3) {
+        return SUCCESS;
+    }
+    int newCapacity = index->capacity;
+    while ((index->count + extra) * 4 > newCapacity * 3) {
+        newCapacity *= 2;
+    }
+    return rehash(index, newCapacity);
+}
+
+// 删除车牌号，不存在时返回false
+bool plateIndexRemove(PlateIndex *index, PackedPlate plate) {
+    bool found;
+    int i = probe(index, plate, &found);
+    if (!found) {
+        return false;
+    }
+
+    index->entries[i].state = ENTRY_DELETED;
+    index->count--;
+    index->tombstones++;
+    return true;
+}
+
+// 遍历使用中的索引项（顺序为桶的顺序）
+PlateIndexEntry *plateIndexNext(PlateIndex *index, int *cursor) {
+    while (*cursor < index->capacity) {
+        PlateIndexEntry *entry = &index->entries[(*cursor)++];
+        if (entry->state == ENTRY_USED) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// 查找车牌号，不存在时返回NULL
+PlateIndexEntry *plateIndexFind(PlateIndex *index, PackedPlate plate) {
+    bool found;
+    int i = probe(index, plate, &found);
+    return found ? &index->entries[i] : NULL;
+}
@@ -0,0 +1,41 @@
+#ifndef PLATE_INDEX_H
+#define PLATE_INDEX_H
+
+#include "parking.h"
+
+// 车辆所在位置
+typedef enum {
+    PLATE_IN_LOT = 1,    // 停车场内
+    PLATE_IN_LANE = 2    // 便道上
+} PlateLocation;
+
+// 索引项（16字节）
+typedef struct {
+    PackedPlate plate;                 // 车牌号（压缩编码，选桶用 hashPackedPlate）
+    int slot;                          // 在停车场中的位置；优先级便道中为堆下标（先进先出便道不使用）
+    uint8_t state;                     // 0：空，1：使用中，2：已删除
+    uint8_t location;                  // PlateLocation
+} PlateIndexEntry;
+
+// 车牌号到车辆位置的哈希索引（开放寻址，线性探测）
+typedef struct PlateIndex {
+    PlateIndexEntry *entries;
+    int capacity;      // 桶数量，始终为2的幂
+    int count;         // 使用中的索引项数量
+    int tombstones;    // 已删除的索引项数量
+} PlateIndex;
+
+// 索引管理
+int initPlateIndex(PlateIndex *index, int expectedCount);
+void freePlateIndex(PlateIndex *index);
+void clearPlateIndex(PlateIndex *index);
+
+// 索引操作
+int plateIndexPut(PlateIndex *index, PackedPlate plate, PlateLocation location, int slot);
+int plateIndexReserve(PlateIndex *index, int extra);
+bool plateIndexRemove(PlateIndex *index, PackedPlate plate);
+PlateIndexEntry *plateIndexFind(PlateIndex *index, PackedPlate plate);
+// 遍历使用中的索引项：cursor 从0开始，返回下一项并推进 cursor，没有更多时返回NULL
+PlateIndexEntry *plateIndexNext(PlateIndex *index, int *cursor);
+
+#endif /* PLATE_INDEX_H */
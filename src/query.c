@@ -0,0 +1,339 @@
+#include "query.h"
+#include "colors.h"
+
+// 历史查询：在会话归档上回答“某车牌的全部停车记录”“一段时间内的收入”“停车超过N小时的车辆”。
+//
+// 先用段索引（各段文件头中的最早/最晚离开时间）排除时间范围不相交的段；收入查询中
+// 整段都落在范围内的段直接使用文件头中的会话数和总费用，不读取数据区；车牌查询先读取
+// 各段的车牌过滤器，不可能含有该车牌的段不解码。需要解码的段按列解码成数组，
+// 再用下面的扫描内核过滤和求和。
+
+// ---- 扫描内核 ----
+//
+// 循环体没有分支、没有跨迭代依赖（除累加外），编译器可以向量化；
+// 选择向量每行都写入下标，只在满足条件时前进，避免了难以预测的分支。
+
+// [from, to) 内离开的会话数和费用之和
+static void sumInRange(const int64_t *leave, const int64_t *fee, uint32_t n, int64_t from, int64_t to,
+                       int64_t *count, int64_t *sum) {
+    int64_t c = 0;
+    int64_t s = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        int64_t mask = -(int64_t)((leave[i] >= from) & (leave[i] < to));
+        c -= mask;
+        s += fee[i] & mask;
+    }
+    *count += c;
+    *sum += s;
+}
+
+// [from, to) 内离开的会话的下标
+static uint32_t selectInRange(const int64_t *leave, uint32_t n, int64_t from, int64_t to, uint32_t *selection) {
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        selection[k] = i;
+        k += (uint32_t)((leave[i] >= from) & (leave[i] < to));
+    }
+    return k;
+}
+
+// 在 [from, to) 内离开、停车时长超过 threshold 秒的会话的下标
+static uint32_t selectDwellOver(const int64_t *leave, const int64_t *dwell, uint32_t n, int64_t from, int64_t to,
+                                int64_t threshold, uint32_t *selection) {
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        selection[k] = i;
+        k += (uint32_t)((leave[i] >= from) & (leave[i] < to) & (dwell[i] > threshold));
+    }
+    return k;
+}
+
+// ---- 查询执行 ----
+
+void initQueryOptions(QueryOptions *options) {
+    memset(options, 0, sizeof(QueryOptions));
+    options->type = QUERY_NONE;
+    options->hours = 24.0;
+    options->limit = 50;
+    snprintf(options->archiveDir, sizeof(options->archiveDir), "%s", ARCHIVE_DIR);
+}
+
+bool parseQueryType(const char *name, QueryType *type) {
+    if (strcmp(name, "plate") == 0) {
+        *type = QUERY_PLATE;
+    } else if (strcmp(name, "revenue") == 0) {
+        *type = QUERY_REVENUE;
+    } else if (strcmp(name, "long") == 0) {
+        *type = QUERY_LONG_STAY;
+    } else if (strcmp(name, "daily") == 0) {
+        *type = QUERY_DAILY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static double nowSeconds(void) {
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 计入一条符合条件的会话，未超过列出上限时交给 visitor
+static void emitSession(const QueryOptions *options, const ArchiveColumns *columns, uint32_t i,
+                        ArchiveVisitor visitor, void *context, QueryResult *result) {
+    result->sessions++;
+    result->revenueFen += columns->fee[i];
+    result->dwellSeconds += columns->dwell[i];
+    if (visitor == NULL || (options->limit > 0 && result->sessions > options->limit)) {
+        return;
+    }
+    ArchivedSession session;
+    memset(&session, 0, sizeof(session));
+    session.car.leaveTime = (time_t)columns->leave[i];
+    session.car.arriveTime = (time_t)(columns->leave[i] - columns->dwell[i]);
+    session.feeFen = columns->fee[i];
+    if (columns->plates != NULL) {
+        memcpy(session.car.plateNumber, columns->plates[i], MAX_PLATE_LEN);
+    }
+    visitor(&session, context);
+}
+
+// 执行查询（按日汇总除外）：符合条件的会话计入结果，前 limit 条交给 visitor
+int executeQuery(const QueryOptions *options, ArchiveVisitor visitor, void *context, QueryResult *result) {
+    memset(result, 0, sizeof(QueryResult));
+    double start = nowSeconds();
+
+    ArchiveIndex index;
+    int status = loadArchiveIndex(&index, options->archiveDir);
+    if (status != SUCCESS) {
+        return status;
+    }
+    result->segmentsTotal = index.segmentCount;
+    int64_t from = (int64_t)options->from;
+    int64_t to = options->to != 0 ? (int64_t)options->to : INT64_MAX;
+    int64_t threshold = (int64_t)(options->hours * 3600.0);
+    uint32_t *selection = NULL;
+    uint32_t selectionCapacity = 0;
+
+    // 依次处理各段，最后是追加文件
+    for (int s = 0; s <= index.segmentCount && status == SUCCESS; s++) {
+        int segment = s < index.segmentCount ? s : ARCHIVE_TAIL_SEGMENT;
+        if (segment != ARCHIVE_TAIL_SEGMENT) {
+            const ArchiveSegmentInfo *info = &index.segments[s].info;
+            if (info->maxLeave < from || info->minLeave >= to) {
+                continue;
+            }
+            if (options->type == QUERY_REVENUE && info->minLeave >= from && info->maxLeave < to) {
+                result->sessions += info->rowCount;
+                result->revenueFen += info->totalFeeFen;
+                result->segmentsHeaderOnly++;
+                continue;
+            }
+            if (options->type == QUERY_PLATE && !archiveSegmentMayContain(&index, s, options->plateNumber)) {
+                result->segmentsFiltered++;
+                continue;
+            }
+        } else if (!index.hasTail) {
+            break;
+        }
+
+        ArchiveColumns columns;
+        bool withPlates = options->type == QUERY_PLATE;
+        status = archiveLoadColumns(&index, segment, withPlates, &columns);
+        if (status == ERR_NOT_FOUND) {
+            status = SUCCESS; // 损坏的段已提示并跳过
+            continue;
+        }
+        if (status != SUCCESS) {
+            break;
+        }
+        if (segment != ARCHIVE_TAIL_SEGMENT) {
+            result->segmentsDecoded++;
+        }
+        if (columns.count > selectionCapacity) {
+            uint32_t *grown = realloc(selection, columns.count * sizeof(uint32_t));
+            if (grown == NULL) {
+                freeArchiveColumns(&columns);
+                status = ERR_MEMORY;
+                break;
+            }
+            selection = grown;
+            selectionCapacity = columns.count;
+        }
+
+        if (options->type == QUERY_REVENUE) {
+            int64_t count = 0;
+            sumInRange(columns.leave, columns.fee, columns.count, from, to, &count, &result->revenueFen);
+            result->sessions += (long)count;
+        } else if (options->type == QUERY_PLATE) {
+            uint32_t k = selectInRange(columns.leave, columns.count, from, to, selection);
+            for (uint32_t j = 0; j < k; j++) {
+                if (comparePlateNumbers(columns.plates[selection[j]], options->plateNumber)) {
+                    emitSession(options, &columns, selection[j], visitor, context, result);
+                }
+            }
+        } else if (options->type == QUERY_LONG_STAY) {
+            uint32_t k = selectDwellOver(columns.leave, columns.dwell, columns.count, from, to, threshold, selection);
+            // 只有选中了会话时才解码车牌列
+            if (k > 0) {
+                freeArchiveColumns(&columns);
+                status = archiveLoadColumns(&index, segment, true, &columns);
+            }
+            for (uint32_t j = 0; j < k && status == SUCCESS && selection[j] < columns.count; j++) {
+                emitSession(options, &columns, selection[j], visitor, context, result);
+            }
+        }
+        freeArchiveColumns(&columns);
+    }
+
+    free(selection);
+    freeArchiveIndex(&index);
+    result->elapsed = nowSeconds() - start;
+    return status;
+}
+
+// ---- 输出 ----
+
+typedef struct {
+    int listed;
+} PrintState;
+
+static bool printSession(const ArchivedSession *session, void *context) {
+    PrintState *state = (PrintState *)context;
+    char arriveStr[30];
+    char leaveStr[30];
+    char duration[48];
+    formatTime(session->car.arriveTime, arriveStr, sizeof(arriveStr));
+    formatTime(session->car.leaveTime, leaveStr, sizeof(leaveStr));
+    formatDuration((uint64_t)(session->car.leaveTime - session->car.arriveTime), duration, sizeof(duration));
+    printf("  %s%-12s%s %s ~ %s %10.2f  %s\n", COLOR_BRIGHT_WHITE, session->car.plateNumber, COLOR_RESET,
+           arriveStr, leaveStr, session->feeFen / 100.0, duration);
+    state->listed++;
+    return true;
+}
+
+static void printBoxTop(const char *title) {
+    printf("\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+    int padding = 63 - 16 - displayWidth(title);
+    printf("%s%s║%s                %s%s%s%s%*s%s%s║%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET,
+           STYLE_BOLD, COLOR_BRIGHT_WHITE, title, COLOR_RESET, padding > 0 ? padding : 0, "",
+           STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+    printf("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+}
+
+static void printBoxBottom(void) {
+    printf("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+}
+
+static void describeRange(const QueryOptions *options, char *buffer, size_t size) {
+    char fromStr[30] = "最早";
+    char toStr[30] = "最新";
+    if (options->from != 0) {
+        formatTime(options->from, fromStr, sizeof(fromStr));
+    }
+    if (options->to != 0) {
+        formatTime(options->to, toStr, sizeof(toStr));
+    }
+    snprintf(buffer, size, "%s ~ %s", fromStr, toStr);
+}
+
+// 按日汇总
+static int runDailyQuery(const QueryOptions *options) {
+    ArchiveReport report;
+    double start = nowSeconds();
+    int status = archiveReport(options->archiveDir, options->from, options->to, &report);
+    double elapsed = nowSeconds() - start;
+    if (status != SUCCESS) {
+        freeArchiveReport(&report);
+        return status;
+    }
+
+    char value[160];
+    printBoxTop("历史查询：按日汇总");
+    describeRange(options, value, sizeof(value));
+    printStatsRow("时间范围", value);
+    snprintf(value, sizeof(value), "%ld 次，%d 天", report.sessions, report.dayCount);
+    printStatsRow("停车次数", value);
+    snprintf(value, sizeof(value), "%.2f", report.revenueFen / 100.0);
+    printStatsRow("总收入", value);
+    snprintf(value, sizeof(value), "%.3f 毫秒（解码 %d 段，跳过 %d 段）", elapsed * 1e3, report.segmentsScanned,
+             report.segmentsSkipped);
+    printStatsRow("耗时", value);
+    printBoxBottom();
+
+    if (report.dayCount > 0) {
+        printf("  日期             车次           收入  平均停车时长\n");
+    }
+    for (int i = 0; i < report.dayCount; i++) {
+        const ArchiveDay *day = &report.days[i];
+        char duration[48];
+        formatDuration(day->sessions > 0 ? (uint64_t)(day->dwellSeconds / day->sessions) : 0, duration, sizeof(duration));
+        printf("  %04d-%02d-%02d %10ld %14.2f  %s\n", day->day / 10000, day->day / 100 % 100, day->day % 100,
+               day->sessions, day->revenueFen / 100.0, duration);
+    }
+    freeArchiveReport(&report);
+    return SUCCESS;
+}
+
+// --query 命令
+int runQuery(const QueryOptions *options) {
+    int status;
+    if (options->type == QUERY_DAILY) {
+        status = runDailyQuery(options);
+    } else {
+        // 会话列表在汇总框之后输出，先收集到结果中再打印
+        QueryResult result;
+        PrintState state = {0};
+        bool listing = options->type != QUERY_REVENUE;
+        char value[160];
+
+        if (listing) {
+            printf("\n");
+        }
+        status = executeQuery(options, listing ? printSession : NULL, &state, &result);
+        if (status == SUCCESS) {
+            const char *title = options->type == QUERY_PLATE     ? "历史查询：车牌停车记录"
+                                : options->type == QUERY_REVENUE ? "历史查询：时段收入"
+                                                                 : "历史查询：长时停车";
+            printBoxTop(title);
+            if (options->type == QUERY_PLATE) {
+                printStatsRow("车牌号", options->plateNumber);
+            } else if (options->type == QUERY_LONG_STAY) {
+                snprintf(value, sizeof(value), "超过 %g 小时", options->hours);
+                printStatsRow("停车时长", value);
+            }
+            describeRange(options, value, sizeof(value));
+            printStatsRow("时间范围", value);
+            snprintf(value, sizeof(value), "%ld 次", result.sessions);
+            printStatsRow("停车次数", value);
+            snprintf(value, sizeof(value), "%.2f", result.revenueFen / 100.0);
+            printStatsRow(options->type == QUERY_REVENUE ? "总收入" : "累计费用", value);
+            if (listing && result.sessions > state.listed) {
+                snprintf(value, sizeof(value), "上方列出前 %d 次（--limit 调整）", state.listed);
+                printStatsRow("列表", value);
+            }
+            if (listing && result.sessions > 0) {
+                formatDuration((uint64_t)(result.dwellSeconds / result.sessions), value, sizeof(value));
+                printStatsRow("平均停车时长", value);
+            }
+            snprintf(value, sizeof(value), "%.3f 毫秒", result.elapsed * 1e3);
+            printStatsRow("耗时", value);
+            snprintf(value, sizeof(value), "共 %d 段：汇总 %d，过滤 %d，解码 %d", result.segmentsTotal,
+                     result.segmentsHeaderOnly, result.segmentsFiltered, result.segmentsDecoded);
+            printStatsRow("读取的段", value);
+            printBoxBottom();
+        }
+    }
+
+    if (status == ERR_NOT_FOUND) {
+        printf("%s%s会话归档不存在: %s%s\n", STYLE_BOLD, COLOR_RED, options->archiveDir, COLOR_RESET);
+    } else if (status != SUCCESS) {
+        printf("%s%s查询失败（内存不足）%s\n", STYLE_BOLD, COLOR_RED, COLOR_RESET);
+    }
+    return status == SUCCESS ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "parking.h"
+#include "archive.h"
+
+// 历史查询类型
+typedef enum {
+    QUERY_NONE = 0,
+    QUERY_PLATE = 1,      // 某个车牌的全部停车记录
+    QUERY_REVENUE = 2,    // 时间范围内的收入和车次
+    QUERY_LONG_STAY = 3,  // 停车时长超过阈值的会话
+    QUERY_DAILY = 4       // 按日汇总
+} QueryType;
+
+// 查询参数（时间范围按离开时间计，[from, to)，to 为0表示不设上限）
+typedef struct {
+    QueryType type;
+    char plateNumber[MAX_PLATE_LEN];
+    time_t from;
+    time_t to;
+    double hours;                 // 长时停车的阈值（小时）
+    int limit;                    // 最多列出的会话数
+    char archiveDir[256];         // 会话归档目录
+} QueryOptions;
+
+// 查询结果
+typedef struct {
+    long sessions;                // 符合条件的会话数
+    int64_t revenueFen;           // 符合条件的会话的费用之和（分）
+    int64_t dwellSeconds;         // 符合条件的会话的停车时长之和（收入查询不统计）
+    int segmentsTotal;            // 归档中的段数
+    int segmentsHeaderOnly;       // 整段都在时间范围内，直接使用文件头中的汇总
+    int segmentsFiltered;         // 车牌过滤器排除的段
+    int segmentsDecoded;          // 解码了数据列的段
+    double elapsed;               // 耗时（秒）
+} QueryResult;
+
+void initQueryOptions(QueryOptions *options);
+bool parseQueryType(const char *name, QueryType *type);
+
+// 执行查询并输出结果（列出的会话通过 visitor 逐条交给调用方，为NULL时打印）
+int executeQuery(const QueryOptions *options, ArchiveVisitor visitor, void *context, QueryResult *result);
+
+// --query 命令：执行查询并以统计信息界面的样式输出
+int runQuery(const QueryOptions *options);
+
+#endif /* QUERY_H */
@@ -0,0 +1,480 @@
+#include "render.h"
+#include "colors.h"
+#include <errno.h>
+#include <stdarg.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#define GRID_PREFIX_WIDTH 7       // 行首的车位编号 " %6d"
+#define GRID_CELL_WIDTH 11        // 一个车位：空格 + 车牌号（补足10列）
+#define COMPACT_COLUMNS 50        // 紧凑模式每行的车位数（每个车位一列）
+#define LIVE_GRID_TOP 7           // 实时视图中网格的第一行（屏幕行号从1开始）
+
+// ---- 输出缓冲 ----
+
+void initRenderBuffer(RenderBuffer *buffer) {
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+void freeRenderBuffer(RenderBuffer *buffer) {
+    free(buffer->data);
+    initRenderBuffer(buffer);
+}
+
+// 保证还能追加 extra 个字节（另留结尾的'\0'）
+static bool reserveRender(RenderBuffer *buffer, size_t extra) {
+    if (buffer->length + extra + 1 <= buffer->capacity) {
+        return true;
+    }
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+    while (capacity < buffer->length + extra + 1) {
+        capacity *= 2;
+    }
+    char *data = (char *)realloc(buffer->data, capacity);
+    if (data == NULL) {
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+void renderAppend(RenderBuffer *buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t room = buffer->capacity > buffer->length ? buffer->capacity - buffer->length : 0;
+    int needed = vsnprintf(room > 0 ? buffer->data + buffer->length : NULL, room, format, args);
+    va_end(args);
+    if (needed < 0) {
+        return;
+    }
+    if ((size_t)needed >= room) {
+        // 放不下：扩容后重新格式化
+        if (!reserveRender(buffer, (size_t)needed)) {
+            return;
+        }
+        va_start(args, format);
+        vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+        va_end(args);
+    }
+    buffer->length += (size_t)needed;
+}
+
+// 追加 count 个空格
+static void appendSpaces(RenderBuffer *buffer, int count) {
+    if (count > 0) {
+        renderAppend(buffer, "%*s", count, "");
+    }
+}
+
+// 终端显示宽度：跳过颜色控制序列，汉字等三字节UTF-8字符占两列
+static int visibleWidth(const char *text) {
+    int width = 0;
+    const unsigned char *p = (const unsigned char *)text;
+    while (*p != '\0') {
+        if (*p == 0x1b && p[1] == '[') {
+            p += 2;
+            while (*p != '\0' && (*p < 0x40 || *p > 0x7e)) {
+                p++;
+            }
+            if (*p != '\0') {
+                p++;
+            }
+            continue;
+        }
+        if (*p < 0x80 || (*p >= 0xC0 && *p < 0xE0)) {
+            width++;
+        } else if (*p >= 0xE0) {
+            width += 2;
+        }
+        p++;
+    }
+    return width;
+}
+
+void renderBoxRow(RenderBuffer *buffer, const char *borderColor, const char *text) {
+    renderAppend(buffer, "%s%s║%s%s", STYLE_BOLD, borderColor, COLOR_RESET, text);
+    appendSpaces(buffer, RENDER_BOX_WIDTH - visibleWidth(text));
+    renderAppend(buffer, "%s%s║%s\n", STYLE_BOLD, borderColor, COLOR_RESET);
+}
+
+void renderBoxLine(RenderBuffer *buffer, const char *borderColor, const char *left, const char *right) {
+    renderAppend(buffer, "%s%s%s", STYLE_BOLD, borderColor, left);
+    for (int i = 0; i < RENDER_BOX_WIDTH; i++) {
+        renderAppend(buffer, "═");
+    }
+    renderAppend(buffer, "%s%s\n", right, COLOR_RESET);
+}
+
+void renderFlush(RenderBuffer *buffer) {
+    fflush(stdout); // 之前用 printf 输出的内容先写出，保持顺序
+    size_t written = 0;
+    while (written < buffer->length) {
+#ifdef _WIN32
+        int n = _write(1, buffer->data + written, (unsigned int)(buffer->length - written));
+#else
+        ssize_t n = write(STDOUT_FILENO, buffer->data + written, buffer->length - written);
+#endif
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += (size_t)n;
+    }
+    buffer->length = 0;
+}
+
+// ---- 车位网格 ----
+
+// 一个车位：车牌号或“空”，补足到固定宽度
+static void appendPlateCell(RenderBuffer *buffer, PackedPlate plate) {
+    if (plate == PLATE_NONE) {
+        renderAppend(buffer, " %s空%s", COLOR_BRIGHT_BLACK, COLOR_RESET);
+        appendSpaces(buffer, GRID_CELL_WIDTH - 3);
+        return;
+    }
+    char plateNumber[MAX_PLATE_LEN];
+    formatPlate(plate, plateNumber, sizeof(plateNumber));
+    renderAppend(buffer, " %s%s%s", COLOR_BRIGHT_WHITE, plateNumber, COLOR_RESET);
+    appendSpaces(buffer, GRID_CELL_WIDTH - 1 - displayWidth(plateNumber));
+}
+
+// 紧凑模式的一个车位：占用为绿色的#，空位为灰色的.
+static void appendCompactCell(RenderBuffer *buffer, PackedPlate plate) {
+    if (plate == PLATE_NONE) {
+        renderAppend(buffer, "%s.%s", COLOR_BRIGHT_BLACK, COLOR_RESET);
+    } else {
+        renderAppend(buffer, "%s#%s", COLOR_GREEN, COLOR_RESET);
+    }
+}
+
+// 网格中的一行：行首是第一个车位的编号，之后是 count 个车位
+static void renderGridRow(RenderBuffer *buffer, const char *borderColor, int firstNumber, const PackedPlate *plates,
+                          int count, bool compact) {
+    renderAppend(buffer, "%s%s║%s%s %6d%s", STYLE_BOLD, borderColor, COLOR_RESET, COLOR_GREEN, firstNumber, COLOR_RESET);
+    int width = GRID_PREFIX_WIDTH;
+    if (compact) {
+        renderAppend(buffer, " ");
+        width++;
+    }
+    for (int i = 0; i < count; i++) {
+        if (compact) {
+            appendCompactCell(buffer, plates[i]);
+            width++;
+        } else {
+            appendPlateCell(buffer, plates[i]);
+            width += GRID_CELL_WIDTH;
+        }
+    }
+    appendSpaces(buffer, RENDER_BOX_WIDTH - width);
+    renderAppend(buffer, "%s%s║%s\n", STYLE_BOLD, borderColor, COLOR_RESET);
+}
+
+// 车位上的车牌号（空位为 PLATE_NONE）
+static PackedPlate bayPlate(ParkingStack *parkingLot, int bay) {
+    return isSlotOccupied(parkingLot, bay) ? parkingLot->data[bay].plate : PLATE_NONE;
+}
+
+// 网格的第 row 行：车位按编号每行 STATUS_GRID_COLUMNS 个
+static void renderLotRow(RenderBuffer *buffer, ParkingStack *parkingLot, int row) {
+    PackedPlate plates[STATUS_GRID_COLUMNS];
+    int first = row * STATUS_GRID_COLUMNS;
+    int count = 0;
+    while (count < STATUS_GRID_COLUMNS && first + count < parkingLot->capacity) {
+        plates[count] = bayPlate(parkingLot, first + count);
+        count++;
+    }
+    renderGridRow(buffer, COLOR_BLUE, first + 1, plates, count, false);
+}
+
+// 便道按出队顺序显示（order 为NULL时即下标顺序）
+static void renderLaneRow(RenderBuffer *buffer, WaitingQueue *waitingLane, const int *order, int row) {
+    PackedPlate plates[STATUS_GRID_COLUMNS];
+    int first = row * STATUS_GRID_COLUMNS;
+    int count = 0;
+    while (count < STATUS_GRID_COLUMNS && first + count < waitingLane->count) {
+        int position = first + count;
+        plates[count] = queueAt(waitingLane, order != NULL ? order[position] : position)->plate;
+        count++;
+    }
+    renderGridRow(buffer, COLOR_BLUE, first + 1, plates, count, false);
+}
+
+// ---- 状态界面 ----
+
+// 分区标题（前面带分隔线）
+static void renderSection(RenderBuffer *buffer, const char *title, bool continued) {
+    char text[160];
+    renderBoxLine(buffer, COLOR_BLUE, "╠", "╣");
+    snprintf(text, sizeof(text), " %s%s%s:%s", COLOR_YELLOW, title, continued ? "（续）" : "", COLOR_RESET);
+    renderBoxRow(buffer, COLOR_BLUE, text);
+}
+
+// 状态标签和取值
+static void renderStatusRow(RenderBuffer *buffer, const char *label, const char *value) {
+    char text[256];
+    snprintf(text, sizeof(text), " %s%s:%s %s", COLOR_CYAN, label, COLOR_BRIGHT_WHITE, value);
+    renderBoxRow(buffer, COLOR_BLUE, text);
+}
+
+int renderParkingStatus(RenderBuffer *buffer, ParkingStack *parkingLot, WaitingQueue *waitingLane,
+                        SystemStats *stats, int page) {
+    // 页面内容按行排列：停车场标题、车位行、便道标题、便道行，每页 STATUS_PAGE_ROWS 行
+    int lotRows = (parkingLot->capacity + STATUS_GRID_COLUMNS - 1) / STATUS_GRID_COLUMNS;
+    int laneRows = isQueueEmpty(waitingLane) ? 1 : (waitingLane->count + STATUS_GRID_COLUMNS - 1) / STATUS_GRID_COLUMNS;
+    int laneHeading = 1 + lotRows;
+    int totalRows = laneHeading + 1 + laneRows;
+    int pages = (totalRows + STATUS_PAGE_ROWS - 1) / STATUS_PAGE_ROWS;
+    if (page >= pages) {
+        page = pages - 1;
+    }
+    if (page < 0) {
+        page = 0;
+    }
+
+    time_t now = time(NULL);
+    char timeStr[30];
+    char value[64];
+    formatTime(now, timeStr, sizeof(timeStr));
+
+    renderAppend(buffer, "\n");
+    renderBoxLine(buffer, COLOR_BLUE, "╔", "╗");
+    renderBoxRow(buffer, COLOR_BLUE, "                " STYLE_BOLD COLOR_BRIGHT_WHITE "停车场管理系统当前状态" COLOR_RESET);
+    renderBoxLine(buffer, COLOR_BLUE, "╠", "╣");
+    renderStatusRow(buffer, "时间", timeStr);
+    snprintf(value, sizeof(value), "%d", parkingLot->capacity);
+    renderStatusRow(buffer, "停车场容量", value);
+    snprintf(value, sizeof(value), "%d", getStackCount(parkingLot));
+    renderStatusRow(buffer, "停车场当前车辆数", value);
+    snprintf(value, sizeof(value), "%d", parkingLot->capacity - getStackCount(parkingLot));
+    renderStatusRow(buffer, "停车场剩余空位", value);
+    snprintf(value, sizeof(value), "%d", getQueueCount(waitingLane));
+    renderStatusRow(buffer, "便道等候车辆数", value);
+    if (stats != NULL) {
+        snprintf(value, sizeof(value), "%.1f 小时", difftime(now, stats->startTime) / 3600.0);
+        renderStatusRow(buffer, "系统运行时间", value);
+        snprintf(value, sizeof(value), "%d", stats->totalCars);
+        renderStatusRow(buffer, "总处理车辆数", value);
+        snprintf(value, sizeof(value), "%.2f", stats->totalRevenue);
+        renderStatusRow(buffer, "总收入", value);
+    }
+
+    const char *lotTitle = parkingLot->model == LOT_MODEL_STACK ? "停车场车位（从北到南）" : "停车场车位";
+    int first = page * STATUS_PAGE_ROWS;
+    int last = first + STATUS_PAGE_ROWS < totalRows ? first + STATUS_PAGE_ROWS : totalRows;
+    int *order = last > laneHeading + 1 ? queuePromotionOrder(waitingLane) : NULL;
+    for (int row = first; row < last; row++) {
+        if (row == 0) {
+            renderSection(buffer, lotTitle, false);
+        } else if (row < laneHeading) {
+            if (row == first) {
+                renderSection(buffer, lotTitle, true);
+            }
+            renderLotRow(buffer, parkingLot, row - 1);
+        } else if (row == laneHeading) {
+            renderSection(buffer, "便道等候车辆", false);
+        } else {
+            if (row == first) {
+                renderSection(buffer, "便道等候车辆", true);
+            }
+            if (isQueueEmpty(waitingLane)) {
+                renderBoxRow(buffer, COLOR_BLUE, " " COLOR_BRIGHT_WHITE "便道上没有等候车辆" COLOR_RESET);
+            } else {
+                renderLaneRow(buffer, waitingLane, order, row - laneHeading - 1);
+            }
+        }
+    }
+
+    free(order);
+
+    if (pages > 1) {
+        renderBoxLine(buffer, COLOR_BLUE, "╠", "╣");
+        snprintf(value, sizeof(value), " 第 %d/%d 页", page + 1, pages);
+        renderBoxRow(buffer, COLOR_BLUE, value);
+    }
+    renderBoxLine(buffer, COLOR_BLUE, "╚", "╝");
+    renderAppend(buffer, "\n");
+    return pages;
+}
+
+// ---- 实时视图 ----
+
+// 终端的行数（取不到时按24行）
+static int terminalRows(void) {
+#ifndef _WIN32
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0) {
+        return size.ws_row;
+    }
+#endif
+    const char *lines = getenv("LINES");
+    if (lines != NULL && atoi(lines) > 0) {
+        return atoi(lines);
+    }
+    return 24;
+}
+
+int initLiveView(LiveView *view, int capacity) {
+    memset(view, 0, sizeof(LiveView));
+    initRenderBuffer(&view->buffer);
+    view->capacity = capacity;
+
+    // 网格上方6行、下方边框1行，最后一行留给光标
+    int available = terminalRows() - LIVE_GRID_TOP - 1;
+    if (available < 2) {
+        available = 2;
+    }
+    int plateRows = (capacity + STATUS_GRID_COLUMNS - 1) / STATUS_GRID_COLUMNS;
+    if (plateRows <= available) {
+        view->compact = false;
+        view->columns = STATUS_GRID_COLUMNS;
+        view->gridRows = plateRows;
+        view->visibleBays = capacity;
+    } else {
+        // 放不下车牌号时每个车位一列；仍然放不下时最后一行提示未显示的车位数
+        view->compact = true;
+        view->columns = COMPACT_COLUMNS;
+        view->gridRows = (capacity + COMPACT_COLUMNS - 1) / COMPACT_COLUMNS;
+        if (view->gridRows > available) {
+            view->gridRows = available - 1;
+        }
+        view->visibleBays = view->gridRows * COMPACT_COLUMNS < capacity ? view->gridRows * COMPACT_COLUMNS : capacity;
+    }
+
+    view->shown = (PackedPlate *)malloc((size_t)view->visibleBays * sizeof(PackedPlate));
+    if (view->shown == NULL) {
+        printf("内存分配失败！\n");
+        return ERR_MEMORY;
+    }
+    return SUCCESS;
+}
+
+void freeLiveView(LiveView *view) {
+    free(view->shown);
+    view->shown = NULL;
+    freeRenderBuffer(&view->buffer);
+}
+
+// 便道行：等候车辆数和排在最前面的车牌号（按出队顺序，放不下的省略）
+static void formatLaneLine(WaitingQueue *waitingLane, char *line, size_t size) {
+    int used = snprintf(line, size, " %s便道 %d 辆%s", COLOR_YELLOW, getQueueCount(waitingLane), COLOR_RESET);
+    int width = visibleWidth(line);
+    int *order = queuePromotionOrder(waitingLane);
+    for (int i = 0; i < waitingLane->count; i++) {
+        char plateNumber[MAX_PLATE_LEN];
+        formatPlate(queueAt(waitingLane, order != NULL ? order[i] : i)->plate, plateNumber, sizeof(plateNumber));
+        int plateWidth = displayWidth(plateNumber) + 1;
+        if (width + plateWidth > RENDER_BOX_WIDTH - 4 || (size_t)used + MAX_PLATE_LEN + 8 > size) {
+            snprintf(line + used, size - (size_t)used, " …");
+            break;
+        }
+        used += snprintf(line + used, size - (size_t)used, " %s", plateNumber);
+        width += plateWidth;
+    }
+    free(order);
+}
+
+// 车位 bay 在屏幕上的位置
+static void moveToBay(LiveView *view, int bay) {
+    int row = LIVE_GRID_TOP + bay / view->columns;
+    int column = view->compact ? 2 + GRID_PREFIX_WIDTH + 1 + bay % view->columns
+                               : 2 + GRID_PREFIX_WIDTH + bay % view->columns * GRID_CELL_WIDTH;
+    renderAppend(&view->buffer, "\x1b[%d;%dH", row, column);
+}
+
+// 实时视图中车位的内容：紧凑模式只区分占用和空位，车辆在栈中挪动不算变化
+static PackedPlate liveCell(LiveView *view, ParkingStack *parkingLot, int bay) {
+    PackedPlate plate = bayPlate(parkingLot, bay);
+    return view->compact && plate != PLATE_NONE ? (PackedPlate)1 : plate;
+}
+
+// 完整绘制第一帧
+static void drawLiveView(LiveView *view, ParkingStack *parkingLot) {
+    RenderBuffer *buffer = &view->buffer;
+    renderAppend(buffer, "\x1b[?25l\x1b[H\x1b[2J");
+    renderBoxLine(buffer, COLOR_BLUE, "╔", "╗");
+    renderBoxRow(buffer, COLOR_BLUE, "                " STYLE_BOLD COLOR_BRIGHT_WHITE "停车场实时状态（重放）" COLOR_RESET);
+    renderBoxLine(buffer, COLOR_BLUE, "╠", "╣");
+    renderBoxRow(buffer, COLOR_BLUE, view->statusLine);
+    renderBoxRow(buffer, COLOR_BLUE, view->laneLine);
+    renderBoxLine(buffer, COLOR_BLUE, "╠", "╣");
+    for (int row = 0; row < view->gridRows; row++) {
+        int first = row * view->columns;
+        int count = first + view->columns <= view->visibleBays ? view->columns : view->visibleBays - first;
+        for (int i = 0; i < count; i++) {
+            view->shown[first + i] = liveCell(view, parkingLot, first + i);
+        }
+        renderGridRow(buffer, COLOR_BLUE, first + 1, view->shown + first, count, view->compact);
+    }
+    if (view->visibleBays < view->capacity) {
+        char text[96];
+        snprintf(text, sizeof(text), " %s另有 %d 个车位未显示%s", COLOR_BRIGHT_BLACK, view->capacity - view->visibleBays,
+                 COLOR_RESET);
+        renderBoxRow(buffer, COLOR_BLUE, text);
+    }
+    renderBoxLine(buffer, COLOR_BLUE, "╚", "╝");
+}
+
+void renderLiveFrame(LiveView *view, ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *status) {
+    char laneLine[sizeof(view->laneLine)];
+    char statusLine[sizeof(view->statusLine)];
+    snprintf(statusLine, sizeof(statusLine), " %s", status);
+    formatLaneLine(waitingLane, laneLine, sizeof(laneLine));
+
+    if (!view->drawn) {
+        memcpy(view->statusLine, statusLine, sizeof(statusLine));
+        memcpy(view->laneLine, laneLine, sizeof(laneLine));
+        drawLiveView(view, parkingLot);
+        view->cellUpdates += view->visibleBays;
+        view->drawn = true;
+    } else {
+        // 只覆盖变化的状态行和车位
+        if (strcmp(statusLine, view->statusLine) != 0) {
+            memcpy(view->statusLine, statusLine, sizeof(statusLine));
+            renderAppend(&view->buffer, "\x1b[4;1H");
+            renderBoxRow(&view->buffer, COLOR_BLUE, statusLine);
+        }
+        if (strcmp(laneLine, view->laneLine) != 0) {
+            memcpy(view->laneLine, laneLine, sizeof(laneLine));
+            renderAppend(&view->buffer, "\x1b[5;1H");
+            renderBoxRow(&view->buffer, COLOR_BLUE, laneLine);
+        }
+        for (int bay = 0; bay < view->visibleBays; bay++) {
+            PackedPlate plate = liveCell(view, parkingLot, bay);
+            if (plate == view->shown[bay]) {
+                continue;
+            }
+            view->shown[bay] = plate;
+            moveToBay(view, bay);
+            if (view->compact) {
+                appendCompactCell(&view->buffer, plate);
+            } else {
+                appendPlateCell(&view->buffer, plate);
+            }
+            view->cellUpdates++;
+        }
+    }
+
+    view->frames++;
+    view->bytes += view->buffer.length;
+    renderFlush(&view->buffer);
+}
+
+void finishLiveView(LiveView *view) {
+    if (!view->drawn) {
+        return;
+    }
+    int bottom = LIVE_GRID_TOP + view->gridRows + (view->visibleBays < view->capacity ? 1 : 0) + 1;
+    renderAppend(&view->buffer, "\x1b[%d;1H\x1b[?25h", bottom);
+    view->bytes += view->buffer.length;
+    renderFlush(&view->buffer);
+}
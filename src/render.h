@@ -0,0 +1,57 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "parking.h"
+
+#define RENDER_BOX_WIDTH 63       // 框内宽度（列）
+#define STATUS_GRID_COLUMNS 5     // 状态界面每行的车位数
+#define STATUS_PAGE_ROWS 20       // 状态界面每页的车位行数（含分区标题）
+
+// 一帧输出的缓冲：整帧先写入内存，再用一次 write 输出，不逐行调用 printf
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} RenderBuffer;
+
+void initRenderBuffer(RenderBuffer *buffer);
+void freeRenderBuffer(RenderBuffer *buffer);
+void renderAppend(RenderBuffer *buffer, const char *format, ...)
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+// 框内一行：text 可以带颜色，右侧按显示宽度补空格对齐边框
+void renderBoxRow(RenderBuffer *buffer, const char *borderColor, const char *text);
+void renderBoxLine(RenderBuffer *buffer, const char *borderColor, const char *left, const char *right);
+// 先输出 stdio 缓冲中已有的内容，再把整个缓冲写到标准输出并清空
+void renderFlush(RenderBuffer *buffer);
+
+// 停车场状态界面：车位按网格排列，车位和便道较多时分页，返回总页数（page 超出时显示最后一页）
+int renderParkingStatus(RenderBuffer *buffer, ParkingStack *parkingLot, WaitingQueue *waitingLane,
+                        SystemStats *stats, int page);
+
+// 实时视图：第一帧完整绘制，之后只输出与上一帧不同的车位和状态行（光标定位后覆盖）
+typedef struct {
+    RenderBuffer buffer;
+    PackedPlate *shown;           // 上一帧各车位显示的车牌（PLATE_NONE 表示空位）
+    int capacity;
+    int visibleBays;              // 终端放得下的车位数
+    bool compact;                 // 车位太多时每个车位只显示一个字符
+    int columns;                  // 每行的车位数
+    int gridRows;
+    bool drawn;                   // 已完整绘制过第一帧
+    char statusLine[256];         // 上一帧的状态行和便道行
+    char laneLine[256];
+    long frames;
+    long cellUpdates;             // 重绘的车位数
+    uint64_t bytes;               // 输出的总字节数
+} LiveView;
+
+int initLiveView(LiveView *view, int capacity);
+void freeLiveView(LiveView *view);
+void renderLiveFrame(LiveView *view, ParkingStack *parkingLot, WaitingQueue *waitingLane, const char *status);
+// 光标移到视图下方并恢复显示
+void finishLiveView(LiveView *view);
+
+#endif /* RENDER_H */
@@ -0,0 +1,261 @@
+#include "replay.h"
+#include "plate_index.h"
+#include "render.h"
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// 事件文件格式（CSV，每行一个事件，#开头为注释）：
+//   时间戳,事件,车牌号
+// 时间戳可以是Unix秒数，也可以是 "YYYY-MM-DD HH:MM:SS"（本地时间）；
+// 事件为 ARRIVE、LEAVE 或 CANCEL（便道上的车辆未入场离开）。例如：
+//   1700000000,ARRIVE,京A12345
+//   2023-11-15 08:30:00,LEAVE,京A12345
+//   2023-11-15 08:31:00,CANCEL,京B67890
+
+// 去掉字段首尾空白
+static char *trimField(char *str) {
+    while (isspace((unsigned char)*str)) {
+        str++;
+    }
+    size_t len = strlen(str);
+    while (len > 0 && isspace((unsigned char)str[len - 1])) {
+        str[--len] = '\0';
+    }
+    return str;
+}
+
+// 把一行拆成三个字段，格式不对返回false
+static bool splitLine(char *line, char **timeField, char **eventField, char **plateField) {
+    char *first = strchr(line, ',');
+    if (first == NULL) {
+        return false;
+    }
+    char *second = strchr(first + 1, ',');
+    if (second == NULL) {
+        return false;
+    }
+    *first = '\0';
+    *second = '\0';
+    *timeField = trimField(line);
+    *eventField = trimField(first + 1);
+    *plateField = trimField(second + 1);
+    return true;
+}
+
+// 当前时间（秒，含小数部分），用于统计重放耗时
+static double wallClockSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 等待指定的秒数
+static void sleepSeconds(double seconds) {
+#ifdef _WIN32
+    Sleep((DWORD)(seconds * 1000));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+void initReplayLiveOptions(ReplayLiveOptions *options) {
+    options->enabled = false;
+    options->speed = 3600.0;       // 每秒重放一小时
+    options->frameInterval = 0.05; // 最多每秒20帧
+}
+
+// 实时视图的一帧：状态行显示事件时间、占用和收入
+static void renderReplayFrame(LiveView *view, ParkingStack *parkingLot, WaitingQueue *waitingLane,
+                              SystemStats *stats, time_t when) {
+    char timeStr[30];
+    char status[160];
+    formatTime(when, timeStr, sizeof(timeStr));
+    snprintf(status, sizeof(status), "%s  车位 %d/%d  收入 %.2f", timeStr, getStackCount(parkingLot),
+             parkingLot->capacity, stats->totalRevenue);
+    renderLiveFrame(view, parkingLot, waitingLane, status);
+}
+
+// 输出重放汇总
+static void printSummary(const char *path, const ReplaySummary *summary, ParkingStack *parkingLot,
+                         WaitingQueue *waitingLane, SystemStats *stats) {
+    char firstStr[30] = "-";
+    char lastStr[30] = "-";
+    if (summary->arrivals + summary->departures > 0) {
+        formatTime(summary->firstEvent, firstStr, sizeof(firstStr));
+        formatTime(summary->lastEvent, lastStr, sizeof(lastStr));
+    }
+
+    long events = summary->arrivals + summary->duplicates + summary->departures + summary->notFound +
+                  summary->cancelled;
+    double rate = summary->elapsed > 0 ? events / summary->elapsed : 0.0;
+
+    printf("重放文件:           %s\n", path);
+    printf("事件时间范围:       %s ~ %s\n", firstStr, lastStr);
+    printf("读取行数:           %ld\n", summary->lines);
+    printf("到达车辆:           %ld（其中进入便道 %ld）\n", summary->arrivals, summary->queued);
+    printf("重复到达:           %ld\n", summary->duplicates);
+    printf("离开车辆:           %ld\n", summary->departures);
+    printf("离开时未找到:       %ld\n", summary->notFound);
+    printf("未入场离开便道:     %ld\n", summary->cancelled);
+    printf("无效行:             %ld\n", summary->invalid);
+    printf("时间倒序行:         %ld\n", summary->outOfOrder);
+    printf("便道最大等候:       %d\n", summary->peakQueue);
+    printf("停车场剩余车辆:     %d / %d\n", getStackCount(parkingLot), parkingLot->capacity);
+    printf("挪车次数:           %ld\n", parkingLot->totalMoves);
+    printf("便道剩余车辆:       %d\n", getQueueCount(waitingLane));
+    printf("总处理车辆数:       %d\n", stats->totalCars);
+    printf("总收入:             %.2f\n", stats->totalRevenue);
+    if (stats->stream.dwell.count > 0) {
+        StatsSummary percentiles;
+        summarizeStreamStats(&stats->stream, summary->lastEvent, &percentiles);
+        printf("停车时长p50/p95/p99: %llu / %llu / %llu 分钟\n", (unsigned long long)percentiles.dwellP50 / 60,
+               (unsigned long long)percentiles.dwellP95 / 60, (unsigned long long)percentiles.dwellP99 / 60);
+        printf("停车费用p50/p95/p99: %.2f / %.2f / %.2f\n", percentiles.feeP50, percentiles.feeP95, percentiles.feeP99);
+    }
+    printf("耗时:               %.3f 秒（%.0f 事件/秒）\n", summary->elapsed, rate);
+}
+
+// 批量重放事件文件
+int runReplay(const char *path, const SystemConfig *config, const ReplayLiveOptions *live) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("无法打开事件文件: %s\n", path);
+        return 1;
+    }
+
+    ParkingStack parkingLot, tempLot;
+    WaitingQueue waitingLane;
+    PlateIndex plateIndex;
+    SystemStats stats;
+    ReplaySummary summary;
+
+    if (initStack(&parkingLot, config->parkingCapacity) != SUCCESS ||
+        setLotModel(&parkingLot, config->lotModel) != SUCCESS ||
+        initStack(&tempLot, config->parkingCapacity) != SUCCESS ||
+        initPlateIndex(&plateIndex, config->parkingCapacity * 2) != SUCCESS) {
+        fclose(file);
+        return 1;
+    }
+    initQueue(&waitingLane);
+    attachPlateIndex(&parkingLot, &waitingLane, &plateIndex);
+
+    LiveView view;
+    bool liveView = live != NULL && live->enabled;
+    if (liveView && initLiveView(&view, parkingLot.capacity) != SUCCESS) {
+        liveView = false;
+    }
+    double nextFrame = 0.0;
+    initSystem(NULL, &stats);
+    memset(&summary, 0, sizeof(summary));
+
+    // 不逐条打印收费单
+    setReceiptOutput(false);
+
+    char line[256];
+    long lineNumber = 0;
+    bool started = false;
+    double startClock = wallClockSeconds();
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *text = trimField(line);
+        if (text[0] == '\0' || text[0] == '#') {
+            continue;
+        }
+        summary.lines++;
+
+        char *timeField, *eventField, *plateField;
+        time_t when;
+        if (!splitLine(text, &timeField, &eventField, &plateField) ||
+            !parseTimestamp(timeField, &when) || !isValidPlateNumber(plateField)) {
+            summary.invalid++;
+            if (config->debugMode) {
+                printf("第 %ld 行无效，已跳过\n", lineNumber);
+            }
+            continue;
+        }
+
+        if (!started) {
+            summary.firstEvent = when;
+            stats.startTime = when; // 以第一条事件时间作为统计起点
+            started = true;
+        } else if (when < summary.lastEvent) {
+            summary.outOfOrder++;
+        }
+        summary.lastEvent = when;
+
+        // 实时视图：每隔 frameInterval 秒刷新一帧，按倍速等到事件时间再处理
+        if (liveView) {
+            double played = wallClockSeconds() - startClock;
+            double due = live->speed > 0 ? difftime(when, summary.firstEvent) / live->speed : played;
+            if (played >= nextFrame) {
+                renderReplayFrame(&view, &parkingLot, &waitingLane, &stats, when);
+                nextFrame = played + live->frameInterval;
+            }
+            if (due > played) {
+                sleepSeconds(due - played);
+            }
+        }
+
+        if (strcmp(eventField, "ARRIVE") == 0) {
+            bool lotFull = isStackFull(&parkingLot);
+            int result = parkCarAt(&parkingLot, &waitingLane, plateField, &stats, when);
+            if (result == SUCCESS) {
+                summary.arrivals++;
+                if (lotFull) {
+                    summary.queued++;
+                    if (getQueueCount(&waitingLane) > summary.peakQueue) {
+                        summary.peakQueue = getQueueCount(&waitingLane);
+                    }
+                }
+            } else if (result == ERR_EXISTS) {
+                summary.duplicates++;
+            } else {
+                summary.invalid++;
+            }
+        } else if (strcmp(eventField, "LEAVE") == 0) {
+            int result = leaveCarAt(&parkingLot, &tempLot, &waitingLane, plateField, &stats, when);
+            if (result == SUCCESS) {
+                summary.departures++;
+            } else {
+                summary.notFound++;
+            }
+        } else if (strcmp(eventField, "CANCEL") == 0) {
+            if (cancelWaitingCar(&parkingLot, &waitingLane, plateField, when) == SUCCESS) {
+                summary.cancelled++;
+            } else {
+                summary.notFound++;
+            }
+        } else {
+            summary.invalid++;
+        }
+    }
+
+    summary.elapsed = wallClockSeconds() - startClock;
+    fclose(file);
+    setReceiptOutput(true);
+
+    if (liveView) {
+        renderReplayFrame(&view, &parkingLot, &waitingLane, &stats, summary.lastEvent);
+        finishLiveView(&view);
+    }
+    printSummary(path, &summary, &parkingLot, &waitingLane, &stats);
+    if (liveView) {
+        printf("实时视图:           %ld 帧，重绘车位 %ld 次，输出 %.1f KB\n", view.frames, view.cellUpdates,
+               view.bytes / 1024.0);
+        freeLiveView(&view);
+    }
+
+    attachPlateIndex(&parkingLot, &waitingLane, NULL);
+    clearQueue(&waitingLane);
+    freePlateIndex(&plateIndex);
+    freeStack(&parkingLot);
+    freeStack(&tempLot);
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "parking.h"
+
+// 重放结果汇总
+typedef struct {
+    long lines;            // 读取的行数（不含空行和注释）
+    long arrivals;         // 成功到达的车辆数
+    long queued;           // 其中进入便道等候的车辆数
+    long duplicates;       // 重复到达（车牌已存在）的事件数
+    long departures;       // 成功离开的车辆数
+    long notFound;         // 离开时不在停车场中（或取消时不在便道上）的事件数
+    long cancelled;        // 未入场直接离开便道的车辆数
+    long invalid;          // 格式错误或车牌号无效的行数
+    long outOfOrder;       // 时间戳早于上一条事件的行数
+    time_t firstEvent;     // 第一条事件的时间
+    time_t lastEvent;      // 最后一条事件的时间
+    int peakQueue;         // 便道最大等候车辆数
+    double elapsed;        // 重放耗时（秒）
+} ReplaySummary;
+
+// 实时视图（--live）：重放时在终端中刷新车位网格，只重绘变化的车位
+typedef struct {
+    bool enabled;
+    double speed;          // 倍速：每秒重放的事件时间（秒），0表示不等待
+    double frameInterval;  // 两帧之间的最短间隔（秒）
+} ReplayLiveOptions;
+
+void initReplayLiveOptions(ReplayLiveOptions *options);
+
+// 批量重放事件文件，不读写系统状态文件，结束时输出一次汇总
+int runReplay(const char *path, const SystemConfig *config, const ReplayLiveOptions *live);
+
+#endif /* REPLAY_H */
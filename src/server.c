@@ -0,0 +1,598 @@
+#ifdef __linux__
+#define _GNU_SOURCE  // accept4
+#endif
+#include "server.h"
+#include "facility_manager.h"
+#include <stdarg.h>
+
+// 初始化服务模式参数
+void initServerOptions(ServerOptions *options) {
+    memset(options, 0, sizeof(ServerOptions));
+    snprintf(options->socketPath, sizeof(options->socketPath), "%s", SERVER_SOCKET_FILE);
+    snprintf(options->stateDir, sizeof(options->stateDir), "%s", SERVER_STATE_DIR);
+    options->facilities = 1;
+    options->shards = 0;
+    options->maxConnections = 256;
+}
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// 事件循环：单线程epoll，所有连接为非阻塞。每轮先读取所有就绪连接的数据，把其中完整的
+// 请求行全部解析成命令，一起提交给各设施所属的分片引擎，再按顺序等待结果、写回响应。
+// 引擎每次取走队列中的全部命令，整批执行后写出一次日志，所以同一轮里来自不同连接、
+// 不同道闸的请求共用一次日志写出；响应只经过内存缓冲区和套接字，不经过终端输出。
+//
+// 响应格式：
+//   PARK   OK LOT | OK LANE（进入便道），已在其他设施时追加 ELSEWHERE
+//   LEAVE  OK <费用> <挪车次数>
+//   QUERY  OK LOT | OK LANE
+//   CANCEL OK（便道上的车辆未入场离开，不收费）
+//   STATS  OK lot=<车辆数>/<容量> lane=<车辆数> cars=<累计车辆数> revenue=<累计收入>
+//          dwell_p50=<秒> dwell_p95=<秒> dwell_p99=<秒> fee_p50=<元> fee_p95=<元> fee_p99=<元>
+//          peak_lot=<最高占用> peak_lane=<最长排队> arrivals_24h=<数量> departures_24h=<数量>
+//          overstays=<超时提醒数> grace_ended=<免费时长结束数> lane_timeouts=<便道等候超时数>
+//          （全部在同一行；百分位数来自对数分桶直方图，相对误差不超过1.6%）
+//   失败   ERR EXISTS | NOT_FOUND | EMPTY | FULL | IO | INVALID_PLATE | NO_FACILITY | BAD_REQUEST | INTERNAL
+//          （IO：事件日志写出或刷盘失败，事件没有持久化；之后该设施拒绝所有变更，需要重启恢复）
+
+// 每轮最多处理的请求数（超出的请求留在连接缓冲区中，下一轮处理）
+#define SERVER_MAX_BATCH 4096
+// 单条响应的最大长度（STATS 的响应比请求行长）
+#define SERVER_MAX_RESPONSE 512
+// 连接的输入缓冲区大小
+#define SERVER_INPUT_SIZE 8192
+// 待发送数据超过该值时暂停读取该连接（等待客户端读取响应）
+#define SERVER_OUTPUT_LIMIT (1 << 20)
+
+// 请求类型
+typedef enum {
+    REQUEST_COMMAND = 0,   // 提交给设施的命令
+    REQUEST_ERROR = 1      // 解析失败，直接返回错误
+} RequestKind;
+
+// 客户端连接
+typedef struct {
+    int fd;                           // -1表示空闲
+    char input[SERVER_INPUT_SIZE];    // 未处理的输入
+    size_t inputLength;
+    char *output;                     // 待发送的响应
+    size_t outputLength;
+    size_t outputSent;
+    size_t outputCapacity;
+    bool readClosed;                  // 客户端已关闭写方向
+    bool broken;                      // 连接出错，丢弃剩余数据
+    uint32_t watched;                 // 当前在epoll中关注的事件
+} Connection;
+
+// 一轮中的一个请求
+typedef struct {
+    Connection *connection;
+    RequestKind kind;
+    const char *error;                // REQUEST_ERROR 的错误名
+    FacilityCommand command;
+} Request;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onStopSignal(int signal) {
+    (void)signal;
+    stopRequested = 1;
+}
+
+// 错误码对应的协议名称
+static const char *errorName(int result) {
+    switch (result) {
+        case ERR_FULL: return "FULL";
+        case ERR_EMPTY: return "EMPTY";
+        case ERR_EXISTS: return "EXISTS";
+        case ERR_NOT_FOUND: return "NOT_FOUND";
+        case ERR_IO: return "IO";
+        default: return "INTERNAL";
+    }
+}
+
+// 追加响应到连接的输出缓冲区
+static void appendOutput(Connection *connection, const char *text, size_t length) {
+    if (connection->broken) {
+        return;
+    }
+    if (connection->outputLength + length > connection->outputCapacity) {
+        size_t capacity = connection->outputCapacity > 0 ? connection->outputCapacity : 4096;
+        while (capacity < connection->outputLength + length) {
+            capacity *= 2;
+        }
+        char *output = (char *)realloc(connection->output, capacity);
+        if (output == NULL) {
+            connection->broken = true;
+            return;
+        }
+        connection->output = output;
+        connection->outputCapacity = capacity;
+    }
+    memcpy(connection->output + connection->outputLength, text, length);
+    connection->outputLength += length;
+}
+
+static void respond(Connection *connection, const char *format, ...) {
+    char line[SERVER_MAX_RESPONSE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    }
+    if (length > (int)sizeof(line) - 2) {
+        length = (int)sizeof(line) - 2;
+    }
+    line[length++] = '\n';
+    appendOutput(connection, line, (size_t)length);
+}
+
+// 解析一行请求；成功时填好命令，失败时记录错误名
+static void parseRequest(char *line, Request *request, FacilityManager *manager) {
+    char *save = NULL;
+    char *verb = strtok_r(line, " \t\r", &save);
+    char *first = strtok_r(NULL, " \t\r", &save);
+    char *second = strtok_r(NULL, " \t\r", &save);
+    char *extra = strtok_r(NULL, " \t\r", &save);
+    FacilityCommand *command = &request->command;
+
+    memset(command, 0, sizeof(FacilityCommand));
+    request->kind = REQUEST_ERROR;
+    request->error = "BAD_REQUEST";
+    if (verb == NULL || extra != NULL) {
+        return;
+    }
+
+    const char *plate = NULL;
+    const char *facilityText;
+    if (strcmp(verb, "STATS") == 0) {
+        command->type = FACILITY_STATS;
+        if (second != NULL) {
+            return;
+        }
+        facilityText = first;
+    } else {
+        if (strcmp(verb, "PARK") == 0) {
+            command->type = FACILITY_PARK;
+        } else if (strcmp(verb, "LEAVE") == 0) {
+            command->type = FACILITY_LEAVE;
+        } else if (strcmp(verb, "QUERY") == 0) {
+            command->type = FACILITY_QUERY;
+        } else if (strcmp(verb, "CANCEL") == 0) {
+            command->type = FACILITY_CANCEL;
+        } else {
+            return;
+        }
+        plate = first;
+        facilityText = second;
+        if (plate == NULL) {
+            return;
+        }
+    }
+
+    int facilityId = 0;
+    if (facilityText != NULL) {
+        char *end;
+        long value = strtol(facilityText, &end, 10);
+        if (*end != '\0' || end == facilityText) {
+            return;
+        }
+        facilityId = value >= 0 && value < manager->facilityCount ? (int)value : -1;
+    }
+    ParkingFacility *facility = managerFacility(manager, facilityId);
+    if (facility == NULL) {
+        request->error = "NO_FACILITY";
+        return;
+    }
+    if (plate != NULL) {
+        if (strlen(plate) >= MAX_PLATE_LEN || !isValidPlateNumber(plate)) {
+            request->error = "INVALID_PLATE";
+            return;
+        }
+        strcpy(command->plateNumber, plate);
+    }
+    command->facility = facility;
+    command->time = time(NULL);
+    request->kind = REQUEST_COMMAND;
+}
+
+// 按命令结果写出响应
+static void writeResponse(Request *request) {
+    Connection *connection = request->connection;
+    FacilityCommand *command = &request->command;
+
+    if (request->kind == REQUEST_ERROR) {
+        respond(connection, "ERR %s", request->error);
+        return;
+    }
+    switch (command->type) {
+        case FACILITY_PARK:
+            if (command->result != SUCCESS) {
+                respond(connection, "ERR %s", errorName(command->result));
+            } else {
+                respond(connection, "OK %s%s", command->queued ? "LANE" : "LOT",
+                        command->elsewhere ? " ELSEWHERE" : "");
+            }
+            break;
+        case FACILITY_LEAVE:
+            if (command->result != SUCCESS) {
+                respond(connection, "ERR %s", errorName(command->result));
+            } else {
+                respond(connection, "OK %.2f %d", command->fee, command->moves);
+            }
+            break;
+        case FACILITY_CANCEL:
+            if (command->result != SUCCESS) {
+                respond(connection, "ERR %s", errorName(command->result));
+            } else {
+                respond(connection, "OK");
+            }
+            break;
+        case FACILITY_QUERY:
+            if (command->result == PLATE_IN_LOT) {
+                respond(connection, "OK LOT");
+            } else if (command->result == PLATE_IN_LANE) {
+                respond(connection, "OK LANE");
+            } else {
+                respond(connection, "ERR NOT_FOUND");
+            }
+            break;
+        case FACILITY_STATS:
+            respond(connection,
+                    "OK lot=%d/%d lane=%d cars=%d revenue=%.2f dwell_p50=%llu dwell_p95=%llu dwell_p99=%llu "
+                    "fee_p50=%.2f fee_p95=%.2f fee_p99=%.2f peak_lot=%d peak_lane=%d arrivals_24h=%u departures_24h=%u "
+                    "overstays=%ld grace_ended=%ld lane_timeouts=%ld",
+                    command->lotCount, command->capacity, command->laneCount, command->totalCars, command->totalRevenue,
+                    (unsigned long long)command->summary.dwellP50, (unsigned long long)command->summary.dwellP95,
+                    (unsigned long long)command->summary.dwellP99, command->summary.feeP50, command->summary.feeP95,
+                    command->summary.feeP99, command->summary.peakOccupancy, command->summary.peakLane,
+                    command->summary.arrivals24h, command->summary.departures24h,
+                    command->timerAlerts[TIMER_MAX_STAY], command->timerAlerts[TIMER_GRACE_END],
+                    command->timerAlerts[TIMER_LANE_TIMEOUT]);
+            break;
+        default:
+            respond(connection, "ERR INTERNAL");
+            break;
+    }
+}
+
+// 待发送的响应是否已积压过多（客户端没有及时读取）
+static bool outputBacklogged(const Connection *connection) {
+    return connection->outputLength - connection->outputSent > SERVER_OUTPUT_LIMIT;
+}
+
+// 从连接读取数据直到暂时没有数据或缓冲区已满
+static void readConnection(Connection *connection) {
+    while (connection->inputLength < SERVER_INPUT_SIZE) {
+        ssize_t n = read(connection->fd, connection->input + connection->inputLength,
+                         SERVER_INPUT_SIZE - connection->inputLength);
+        if (n > 0) {
+            connection->inputLength += (size_t)n;
+        } else if (n == 0) {
+            connection->readClosed = true;
+            return;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection->broken = true;
+            }
+            return;
+        }
+    }
+}
+
+// 从连接的输入中取出完整的请求行，返回取出的数量
+static int takeRequests(Connection *connection, Request *requests, int room, FacilityManager *manager) {
+    int taken = 0;
+    size_t start = 0;
+
+    if (connection->broken || outputBacklogged(connection)) {
+        return 0;
+    }
+    while (taken < room) {
+        char *newline = memchr(connection->input + start, '\n', connection->inputLength - start);
+        if (newline == NULL) {
+            break;
+        }
+        *newline = '\0';
+        char *line = connection->input + start;
+        start = (size_t)(newline - connection->input) + 1;
+        if (line[0] == '\0' || (line[0] == '\r' && line[1] == '\0')) {
+            continue; // 空行
+        }
+        requests[taken].connection = connection;
+        parseRequest(line, &requests[taken], manager);
+        taken++;
+    }
+    memmove(connection->input, connection->input + start, connection->inputLength - start);
+    connection->inputLength -= start;
+
+    // 缓冲区满了仍没有换行：请求行过长，无法继续解析
+    if (taken < room && connection->inputLength == SERVER_INPUT_SIZE) {
+        respond(connection, "ERR BAD_REQUEST");
+        connection->inputLength = 0;
+        connection->readClosed = true;
+    }
+    return taken;
+}
+
+// 连接中是否还有本轮可以处理的完整请求行
+static bool hasPendingLine(const Connection *connection) {
+    return !connection->broken && !outputBacklogged(connection) &&
+           memchr(connection->input, '\n', connection->inputLength) != NULL;
+}
+
+// 尽量写出待发送的响应，返回false表示连接出错
+static bool flushConnection(Connection *connection) {
+    while (connection->outputSent < connection->outputLength) {
+        ssize_t n = write(connection->fd, connection->output + connection->outputSent,
+                          connection->outputLength - connection->outputSent);
+        if (n > 0) {
+            connection->outputSent += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+    connection->outputSent = 0;
+    connection->outputLength = 0;
+    return true;
+}
+
+static void closeConnection(int epollFd, Connection *connection) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+    free(connection->output);
+    memset(connection, 0, sizeof(Connection));
+    connection->fd = -1;
+}
+
+// 接受所有等待中的连接
+static void acceptConnections(int epollFd, int listenFd, Connection *connections, int maxConnections) {
+    while (1) {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return; // EAGAIN：没有更多连接
+        }
+        int slot = -1;
+        for (int i = 0; i < maxConnections; i++) {
+            if (connections[i].fd < 0) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0) {
+            const char *busy = "ERR BUSY\n";
+            ssize_t ignored = write(fd, busy, strlen(busy));
+            (void)ignored;
+            close(fd);
+            continue;
+        }
+        Connection *connection = &connections[slot];
+        memset(connection, 0, sizeof(Connection));
+        connection->fd = fd;
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = connection;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        connection->watched = event.events;
+    }
+}
+
+// 调整关注的事件：有待发送数据时关注可写；输入缓冲区已满、响应积压或对方已关闭时不再关注可读，
+// 否则水平触发的可读事件会让事件循环空转
+static void updateWatch(int epollFd, Connection *connection) {
+    uint32_t wanted = 0;
+    if (!connection->readClosed && connection->inputLength < SERVER_INPUT_SIZE && !outputBacklogged(connection)) {
+        wanted |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (connection->outputSent < connection->outputLength) {
+        wanted |= EPOLLOUT;
+    }
+    if (wanted == connection->watched) {
+        return;
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = wanted;
+    event.data.ptr = connection;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->watched = wanted;
+}
+
+// 创建并监听Unix域套接字
+static int openListener(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+    unlink(path); // 上次异常退出留下的套接字文件
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 128) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int runServer(const ServerOptions *options, const SystemConfig *config, const JournalConfig *journalConfig) {
+    FacilityManager manager;
+    Request *requests = (Request *)malloc(SERVER_MAX_BATCH * sizeof(Request));
+    Connection *connections = (Connection *)calloc((size_t)options->maxConnections, sizeof(Connection));
+    if (requests == NULL || connections == NULL) {
+        free(requests);
+        free(connections);
+        return 1;
+    }
+    for (int i = 0; i < options->maxConnections; i++) {
+        connections[i].fd = -1;
+    }
+
+    if (initFacilityManager(&manager, options->facilities, options->shards, config, options->stateDir,
+                            journalConfig) != SUCCESS) {
+        printf("无法初始化 %d 个设施！\n", options->facilities);
+        free(requests);
+        free(connections);
+        return 1;
+    }
+    loadFacilityManager(&manager);
+
+    int listenFd = openListener(options->socketPath);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (listenFd < 0 || epollFd < 0) {
+        printf("无法监听 %s：%s\n", options->socketPath, strerror(errno));
+        if (listenFd >= 0) {
+            close(listenFd);
+        }
+        freeFacilityManager(&manager);
+        free(requests);
+        free(connections);
+        return 1;
+    }
+    struct epoll_event listenEvent;
+    memset(&listenEvent, 0, sizeof(listenEvent));
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.ptr = NULL;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent);
+
+    // 不设置SA_RESTART，收到信号时epoll_wait立即返回
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onStopSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    setReceiptOutput(false);
+    startFacilityManager(&manager);
+    printf("监听 %s，设施 %d 个，分片 %d 个，状态目录 %s\n", options->socketPath, manager.facilityCount,
+           manager.shardCount, options->stateDir);
+    fflush(stdout);
+
+    // 计时器随命令时间推进；没有请求时每秒给各设施提交一条 TICK，超时提醒不会因空闲而推迟
+    FacilityCommand *ticks = (FacilityCommand *)calloc((size_t)manager.facilityCount, sizeof(FacilityCommand));
+    time_t lastTick = 0;
+
+    struct epoll_event events[64];
+    bool backlog = false;
+    long served = 0;
+    while (!stopRequested) {
+        // 还有积压的请求行时不等待
+        int ready = epoll_wait(epollFd, events, 64, backlog ? 0 : 1000);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            Connection *connection = (Connection *)events[i].data.ptr;
+            if (connection == NULL) {
+                acceptConnections(epollFd, listenFd, connections, options->maxConnections);
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                readConnection(connection);
+            }
+        }
+
+        // 收集本轮所有连接中的完整请求并提交
+        int count = 0;
+        for (int i = 0; i < options->maxConnections && count < SERVER_MAX_BATCH; i++) {
+            if (connections[i].fd >= 0) {
+                count += takeRequests(&connections[i], requests + count, SERVER_MAX_BATCH - count, &manager);
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            if (requests[i].kind == REQUEST_COMMAND) {
+                facilitySubmit(requests[i].command.facility, &requests[i].command);
+            }
+        }
+        time_t now = time(NULL);
+        bool ticking = ticks != NULL && now != lastTick;
+        if (ticking) {
+            lastTick = now;
+            for (int f = 0; f < manager.facilityCount; f++) {
+                memset(&ticks[f], 0, sizeof(FacilityCommand));
+                ticks[f].type = FACILITY_TICK;
+                ticks[f].time = now;
+                facilitySubmit(&manager.facilities[f], &ticks[f]);
+            }
+        }
+        // 按提交顺序等待并写出响应，同一连接的响应顺序与请求一致
+        for (int i = 0; i < count; i++) {
+            if (requests[i].kind == REQUEST_COMMAND) {
+                facilityWait(requests[i].command.facility, &requests[i].command);
+            }
+            writeResponse(&requests[i]);
+        }
+        for (int f = 0; ticking && f < manager.facilityCount; f++) {
+            facilityWait(&manager.facilities[f], &ticks[f]);
+        }
+        served += count;
+
+        backlog = false;
+        for (int i = 0; i < options->maxConnections; i++) {
+            Connection *connection = &connections[i];
+            if (connection->fd < 0) {
+                continue;
+            }
+            if (connection->broken || !flushConnection(connection)) {
+                closeConnection(epollFd, connection);
+                continue;
+            }
+            bool pendingLine = hasPendingLine(connection);
+            if (connection->readClosed && !pendingLine && connection->outputLength == 0) {
+                closeConnection(epollFd, connection);
+                continue;
+            }
+            updateWatch(epollFd, connection);
+            backlog = backlog || pendingLine;
+        }
+    }
+
+    for (int i = 0; i < options->maxConnections; i++) {
+        if (connections[i].fd >= 0) {
+            closeConnection(epollFd, &connections[i]);
+        }
+    }
+    close(epollFd);
+    close(listenFd);
+    unlink(options->socketPath);
+
+    bool saved = saveFacilityManager(&manager);
+    freeFacilityManager(&manager);
+    free(ticks);
+    printf("已处理 %ld 个请求，%s\n", served, saved ? "状态已保存" : "状态保存失败");
+    free(requests);
+    free(connections);
+    return saved ? 0 : 1;
+}
+
+#else
+
+int runServer(const ServerOptions *options, const SystemConfig *config, const JournalConfig *journalConfig) {
+    (void)options;
+    (void)config;
+    (void)journalConfig;
+    printf("服务模式需要 Linux（epoll 和 Unix 域套接字）。\n");
+    return 1;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "parking.h"
+#include "journal.h"
+
+// 默认套接字路径和状态目录
+#define SERVER_SOCKET_FILE "bparking.sock"
+#define SERVER_STATE_DIR "bparking_state"
+
+// 单行请求的最大长度（字节，含换行）
+#define SERVER_MAX_LINE 256
+
+// 服务模式参数
+typedef struct {
+    char socketPath[108];      // Unix域套接字路径
+    char stateDir[256];        // 各设施状态文件所在目录
+    int facilities;            // 托管的设施数量
+    int shards;                // 分片引擎数量（0表示按CPU数量）
+    int maxConnections;        // 最大同时连接数
+} ServerOptions;
+
+void initServerOptions(ServerOptions *options);
+
+// 守护进程模式：在Unix域套接字上用行协议处理道闸请求，直到收到SIGINT/SIGTERM
+//
+// 请求（每行一条，可连续发送多条不等待响应）：
+//   PARK <车牌号> [设施编号]      车辆到达
+//   LEAVE <车牌号> [设施编号]     车辆离开
+//   QUERY <车牌号> [设施编号]     查询车辆位置
+//   CANCEL <车牌号> [设施编号]    便道上的车辆未入场离开
+//   STATS [设施编号]              统计信息
+// 响应与请求一一对应、顺序相同，以 OK 或 ERR 开头，详见 server.c
+int runServer(const ServerOptions *options, const SystemConfig *config, const JournalConfig *journalConfig);
+
+#endif /* SERVER_H */
@@ -0,0 +1,377 @@
+#include "simulate.h"
+#include "colors.h"
+#include "facility.h"
+#include "plate_index.h"
+#include <math.h>
+
+// 容量规划模拟：用合成车流驱动真实的 parkCarAt / leaveCarAt，时间取自车流中的虚拟时钟，
+// 不读取系统时间。每种组合（停车场容量 × 便道长度）做多次独立重复，第i次重复使用种子 seed+i；
+// 各组合使用相同的种子（共同随机数），组合之间的差别不被车流本身的随机性淹没。
+//
+// 重复之间没有共享的可变状态：每次重复有自己的停车场、便道、索引和统计，收费方案只读，
+// 车流生成的车牌都能压缩编码，不经过车牌表。重复按下标分给工作线程，结果写入各自的位置，
+// 汇总与线程数无关，相同参数的结果完全相同。
+
+static double nowSeconds(void) {
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 默认模拟参数（不模拟；指定 --simulate 后每种组合重复1000次，每次2000辆车）
+void initSimulationOptions(SimulationOptions *options) {
+    memset(options, 0, sizeof(SimulationOptions));
+    initTrafficConfig(&options->traffic);
+    options->traffic.vehicles = 2000;
+    options->laneLimits[0] = SIM_LANE_UNLIMITED;
+    options->laneCount = 1;
+}
+
+// 解析逗号分隔的整数列表
+bool parseSimulationList(const char *text, int *values, int *count, bool allowUnlimited) {
+    int n = 0;
+    const char *p = text;
+    while (*p != '\0') {
+        if (n == SIM_MAX_VARIANTS) {
+            return false;
+        }
+        const char *comma = strchr(p, ',');
+        size_t length = comma != NULL ? (size_t)(comma - p) : strlen(p);
+        char item[24];
+        if (length == 0 || length >= sizeof(item)) {
+            return false;
+        }
+        memcpy(item, p, length);
+        item[length] = '\0';
+
+        char *end;
+        long value = strtol(item, &end, 10);
+        if (allowUnlimited && strcmp(item, "unlimited") == 0) {
+            value = SIM_LANE_UNLIMITED;
+        } else if (*end != '\0' || value > MAX_CAPACITY || value < (allowUnlimited ? -1 : 1)) {
+            return false;
+        }
+        values[n++] = (int)value;
+        p += length;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    if (n == 0) {
+        return false;
+    }
+    *count = n;
+    return true;
+}
+
+// ---- 单次重复 ----
+
+// 模拟一次车流，把各指标写入 sample
+static int runReplication(const SystemConfig *config, int capacity, int laneLimit, const TrafficConfig *traffic,
+                          double *sample) {
+    ParkingStack parkingLot, tempLot;
+    WaitingQueue waitingLane;
+    PlateIndex plateIndex;
+    SystemStats stats;
+    TrafficGenerator gen;
+
+    if (initStack(&parkingLot, capacity) != SUCCESS) {
+        return ERR_MEMORY;
+    }
+    if (setLotModel(&parkingLot, config->lotModel) != SUCCESS || initStack(&tempLot, capacity) != SUCCESS) {
+        freeStack(&parkingLot);
+        return ERR_MEMORY;
+    }
+    if (initPlateIndex(&plateIndex, capacity * 2) != SUCCESS) {
+        freeStack(&parkingLot);
+        freeStack(&tempLot);
+        return ERR_MEMORY;
+    }
+    initQueue(&waitingLane);
+    attachPlateIndex(&parkingLot, &waitingLane, &plateIndex);
+    initSystem(NULL, &stats);
+    stats.startTime = traffic->startTime;
+    initTrafficGenerator(&gen, traffic);
+
+    long admitted = 0, balked = 0, departures = 0, promoted = 0;
+    double waitSeconds = 0.0;
+    int peakLane = 0;
+    int status = SUCCESS;
+    TrafficEvent event;
+    char headPlate[MAX_PLATE_LEN];
+
+    while (status == SUCCESS && nextTrafficEvent(&gen, &event)) {
+        if (event.type == TRAFFIC_ARRIVE) {
+            bool lotFull = isStackFull(&parkingLot);
+            if (lotFull && laneLimit != SIM_LANE_UNLIMITED && getQueueCount(&waitingLane) >= laneLimit) {
+                balked++; // 便道已满，车辆离去
+                continue;
+            }
+            if (parkCarAt(&parkingLot, &waitingLane, event.plateNumber, &stats, event.time) == SUCCESS) {
+                admitted++;
+                if (!lotFull) {
+                    status = scheduleDeparture(&gen, event.plateNumber, event.time);
+                }
+            }
+            if (getQueueCount(&waitingLane) > peakLane) {
+                peakLane = getQueueCount(&waitingLane);
+            }
+        } else {
+            // 记下便道队头和它的到达时间，离开后若便道变短说明它补位进入了停车场
+            int queued = getQueueCount(&waitingLane);
+            time_t queuedSince = 0;
+            if (queued > 0) {
+                const Car *head = queueAt(&waitingLane, 0);
+                formatPlate(head->plate, headPlate, sizeof(headPlate));
+                queuedSince = head->arriveTime;
+            }
+            if (leaveCarAt(&parkingLot, &tempLot, &waitingLane, event.plateNumber, &stats, event.time) == SUCCESS) {
+                departures++;
+                if (getQueueCount(&waitingLane) < queued) {
+                    promoted++;
+                    waitSeconds += (double)(event.time - queuedSince);
+                    status = scheduleDeparture(&gen, headPlate, event.time);
+                }
+            }
+        }
+    }
+
+    long arrivals = admitted + balked;
+    sample[SIM_MEAN_WAIT] = admitted > 0 ? waitSeconds / 60.0 / admitted : 0.0;
+    sample[SIM_QUEUED_WAIT] = promoted > 0 ? waitSeconds / 60.0 / promoted : 0.0;
+    sample[SIM_MAX_LANE] = peakLane;
+    sample[SIM_MOVES_PER_DEPARTURE] = departures > 0 ? (double)parkingLot.totalMoves / departures : 0.0;
+    sample[SIM_REVENUE] = stats.totalRevenue;
+    sample[SIM_BALK_RATE] = arrivals > 0 ? (double)balked / arrivals : 0.0;
+
+    freeTrafficGenerator(&gen);
+    attachPlateIndex(&parkingLot, &waitingLane, NULL);
+    clearQueue(&waitingLane);
+    freePlateIndex(&plateIndex);
+    freeStack(&parkingLot);
+    freeStack(&tempLot);
+    return status;
+}
+
+// ---- 并行执行 ----
+
+// 工作线程共享的任务：第k个任务是第 k / replications 种组合的第 k % replications 次重复
+typedef struct {
+    const SimulationOptions *options;
+    const SystemConfig *config;
+    const SimulationResult *variants;  // 各组合的容量和便道长度
+    double (*samples)[SIM_METRIC_COUNT];
+    int total;
+    atomic_int next;
+    atomic_int failures;
+} SimulationWork;
+
+static void *simulationWorker(void *arg) {
+    SimulationWork *work = (SimulationWork *)arg;
+    int replications = work->options->replications;
+    while (1) {
+        int k = atomic_fetch_add(&work->next, 1);
+        if (k >= work->total) {
+            break;
+        }
+        const SimulationResult *variant = &work->variants[k / replications];
+        TrafficConfig traffic = work->options->traffic;
+        traffic.seed += (uint64_t)(k % replications);
+        if (runReplication(work->config, variant->capacity, variant->laneLimit, &traffic, work->samples[k]) != SUCCESS) {
+            atomic_fetch_add(&work->failures, 1);
+        }
+    }
+    return NULL;
+}
+
+// 工作线程数：默认按在线CPU数，不超过任务数
+static int workerCount(const SimulationOptions *options, int total) {
+    int threads = options->threads > 0 ? options->threads : onlineCpuCount();
+    return threads < total ? threads : total;
+}
+
+// 双侧95%置信区间的t分布分位数（自由度df）
+static double tQuantile95(int df) {
+    static const double table[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df <= 30) {
+        return table[df - 1];
+    }
+    // 自由度较大时用正态分位数的一阶修正，误差小于0.001
+    const double z = 1.959964;
+    return z + (z * z * z + z) / (4.0 * df);
+}
+
+// 执行全部重复并汇总
+int simulateCapacity(const SimulationOptions *options, const SystemConfig *config, SimulationResult **results,
+                     int *resultCount, double *elapsed) {
+    int capacityCount = options->capacityCount > 0 ? options->capacityCount : 1;
+    int variantCount = capacityCount * options->laneCount;
+    int replications = options->replications;
+    *results = NULL;
+    *resultCount = 0;
+    if (replications <= 0 || variantCount <= 0) {
+        return ERR_EMPTY;
+    }
+
+    SimulationResult *variants = (SimulationResult *)calloc((size_t)variantCount, sizeof(SimulationResult));
+    double (*samples)[SIM_METRIC_COUNT] = malloc((size_t)variantCount * (size_t)replications * sizeof(*samples));
+    if (variants == NULL || samples == NULL) {
+        free(variants);
+        free(samples);
+        return ERR_MEMORY;
+    }
+    for (int c = 0; c < capacityCount; c++) {
+        for (int l = 0; l < options->laneCount; l++) {
+            SimulationResult *variant = &variants[c * options->laneCount + l];
+            variant->capacity = options->capacityCount > 0 ? options->capacities[c] : config->parkingCapacity;
+            variant->laneLimit = options->laneLimits[l];
+        }
+    }
+
+    SimulationWork work;
+    work.options = options;
+    work.config = config;
+    work.variants = variants;
+    work.samples = samples;
+    work.total = variantCount * replications;
+    atomic_init(&work.next, 0);
+    atomic_init(&work.failures, 0);
+
+    // 调用线程也参与计算；创建失败的线程由其余线程分担
+    double start = nowSeconds();
+    int threads = workerCount(options, work.total);
+    pthread_t *workers = (pthread_t *)calloc((size_t)threads, sizeof(pthread_t));
+    int started = 0;
+    for (int i = 1; workers != NULL && i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, simulationWorker, &work) == 0) {
+            started++;
+        }
+    }
+    simulationWorker(&work);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    *elapsed = nowSeconds() - start;
+
+    if (atomic_load(&work.failures) > 0) {
+        free(variants);
+        free(samples);
+        return ERR_MEMORY;
+    }
+
+    // 各指标的样本均值和95%置信区间半宽 t·s/√n
+    for (int v = 0; v < variantCount; v++) {
+        const double (*rows)[SIM_METRIC_COUNT] = (const double (*)[SIM_METRIC_COUNT])samples + (size_t)v * replications;
+        for (int m = 0; m < SIM_METRIC_COUNT; m++) {
+            double sum = 0.0;
+            for (int r = 0; r < replications; r++) {
+                sum += rows[r][m];
+            }
+            double mean = sum / replications;
+            double squares = 0.0;
+            for (int r = 0; r < replications; r++) {
+                double d = rows[r][m] - mean;
+                squares += d * d;
+            }
+            variants[v].mean[m] = mean;
+            variants[v].halfWidth[m] = replications > 1
+                                           ? tQuantile95(replications - 1) * sqrt(squares / (replications - 1) / replications)
+                                           : 0.0;
+        }
+    }
+    free(samples);
+    *results = variants;
+    *resultCount = variantCount;
+    return SUCCESS;
+}
+
+// ---- 输出 ----
+
+static void printBoxTop(const char *title) {
+    printf("\n%s%s╔═══════════════════════════════════════════════════════════════╗%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+    int padding = 63 - 16 - displayWidth(title);
+    printf("%s%s║%s                %s%s%s%s%*s%s%s║%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET,
+           STYLE_BOLD, COLOR_BRIGHT_WHITE, title, COLOR_RESET, padding > 0 ? padding : 0, "",
+           STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+    printf("%s%s╠═══════════════════════════════════════════════════════════════╣%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+}
+
+static void printBoxBottom(void) {
+    printf("%s%s╚═══════════════════════════════════════════════════════════════╝%s\n", STYLE_BOLD, COLOR_MAGENTA, COLOR_RESET);
+}
+
+static const char *dwellName(DwellDistribution dwell) {
+    switch (dwell) {
+        case DWELL_EXPONENTIAL: return "exp";
+        case DWELL_LOGNORMAL: return "lognormal";
+        case DWELL_UNIFORM: return "uniform";
+        default: return "fixed";
+    }
+}
+
+// --simulate 命令
+int runSimulation(const SimulationOptions *options, const SystemConfig *config) {
+    SimulationResult *results;
+    int resultCount;
+    double elapsed;
+    setReceiptOutput(false);
+    int status = simulateCapacity(options, config, &results, &resultCount, &elapsed);
+    if (status != SUCCESS) {
+        printf("%s%s模拟失败（内存不足）%s\n", STYLE_BOLD, COLOR_RED, COLOR_RESET);
+        return 1;
+    }
+
+    const TrafficConfig *traffic = &options->traffic;
+    int total = resultCount * options->replications;
+    char value[160];
+    printBoxTop("容量规划模拟");
+    snprintf(value, sizeof(value), "每次 %ld 辆，%g 辆/小时，高峰 ×%g", traffic->vehicles, traffic->arrivalsPerHour,
+             traffic->rushFactor);
+    printStatsRow("车流", value);
+    snprintf(value, sizeof(value), "%s，平均 %g 分钟", dwellName(traffic->dwell), traffic->dwellMeanMinutes);
+    printStatsRow("停车时长", value);
+    printStatsRow("停车场模型", config->lotModel == LOT_MODEL_BAYS ? "独立车位" : "栈");
+    if (config->tariffPath[0] != '\0') {
+        printStatsRow("收费方案", config->tariffPath);
+    } else {
+        snprintf(value, sizeof(value), "统一费率 %.2f 元/小时", config->hourlyRate);
+        printStatsRow("收费方案", value);
+    }
+    snprintf(value, sizeof(value), "%d 种组合 × %d 次（种子 %llu 起）", resultCount, options->replications,
+             (unsigned long long)traffic->seed);
+    printStatsRow("重复次数", value);
+    snprintf(value, sizeof(value), "%.3f 秒，%d 个线程（%.0f 次重复/秒）", elapsed, workerCount(options, total),
+             elapsed > 0 ? total / elapsed : 0.0);
+    printStatsRow("耗时", value);
+    printBoxBottom();
+
+    printf("  均值 ± 95%%置信区间半宽\n");
+    printf("    车位    便道    每车平均等候(分钟)    排队车平均等候(分钟)  最长排队    每次离场挪车          总收入(元)      离去比例\n");
+    for (int i = 0; i < resultCount; i++) {
+        const SimulationResult *r = &results[i];
+        char lane[16];
+        if (r->laneLimit == SIM_LANE_UNLIMITED) {
+            snprintf(lane, sizeof(lane), "  不限"); // 按显示宽度补齐
+        } else {
+            snprintf(lane, sizeof(lane), "%6d", r->laneLimit);
+        }
+        printf("  %6d  %6s  %8.2f ± %-7.2f     %8.2f ± %-7.2f     %7.1f ± %-6.1f %6.2f ± %-6.2f %10.0f ± %-8.0f %5.1f%% ± %.1f%%\n",
+               r->capacity, lane, r->mean[SIM_MEAN_WAIT], r->halfWidth[SIM_MEAN_WAIT],
+               r->mean[SIM_QUEUED_WAIT], r->halfWidth[SIM_QUEUED_WAIT],
+               r->mean[SIM_MAX_LANE], r->halfWidth[SIM_MAX_LANE],
+               r->mean[SIM_MOVES_PER_DEPARTURE], r->halfWidth[SIM_MOVES_PER_DEPARTURE],
+               r->mean[SIM_REVENUE], r->halfWidth[SIM_REVENUE],
+               r->mean[SIM_BALK_RATE] * 100.0, r->halfWidth[SIM_BALK_RATE] * 100.0);
+    }
+    free(results);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#include "parking.h"
+#include "traffic.h"
+
+#define SIM_MAX_VARIANTS 16   // 每次最多比较的容量或便道长度取值数
+#define SIM_LANE_UNLIMITED -1 // 便道长度不限
+
+// 每次重复记录的指标
+typedef enum {
+    SIM_MEAN_WAIT = 0,        // 每辆进场车辆在便道的平均等候时间（分钟，直接进入停车场的计0）
+    SIM_MAX_LANE = 1,         // 便道最长排队
+    SIM_MOVES_PER_DEPARTURE = 2, // 每次离场的挪车次数
+    SIM_REVENUE = 3,          // 总收入（元）
+    SIM_BALK_RATE = 4,        // 到达时便道已满而离去的比例
+    SIM_QUEUED_WAIT = 5,      // 在便道排队后补位进场的车辆的平均等候时间（分钟）
+    SIM_METRIC_COUNT = 6
+} SimulationMetric;
+
+// 容量规划模拟参数：停车场容量和便道长度的每种组合各做 replications 次独立重复
+typedef struct {
+    int replications;             // 每种组合的重复次数（0表示不模拟）
+    int threads;                  // 工作线程数（0表示按在线CPU数）
+    TrafficConfig traffic;        // 车流；第i次重复使用种子 seed+i，各组合使用相同的种子
+    int capacities[SIM_MAX_VARIANTS]; // 要比较的停车场容量（为空时使用 SystemConfig 中的容量）
+    int capacityCount;
+    int laneLimits[SIM_MAX_VARIANTS]; // 要比较的便道长度（SIM_LANE_UNLIMITED 表示不限）
+    int laneCount;
+} SimulationOptions;
+
+// 一种组合的结果：各指标的均值和95%置信区间半宽
+typedef struct {
+    int capacity;
+    int laneLimit;
+    double mean[SIM_METRIC_COUNT];
+    double halfWidth[SIM_METRIC_COUNT];
+} SimulationResult;
+
+void initSimulationOptions(SimulationOptions *options);
+// 解析逗号分隔的整数列表（"不限"可写作 unlimited 或 -1），数量超出或格式错误时返回false
+bool parseSimulationList(const char *text, int *values, int *count, bool allowUnlimited);
+
+// 执行全部重复并汇总，results 按容量在外、便道长度在内的顺序排列（调用方负责 free）
+int simulateCapacity(const SimulationOptions *options, const SystemConfig *config, SimulationResult **results,
+                     int *resultCount, double *elapsed);
+
+// --simulate 命令：执行模拟并以统计信息界面的样式输出
+int runSimulation(const SimulationOptions *options, const SystemConfig *config);
+
+#endif /* SIMULATE_H */
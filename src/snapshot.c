@@ -0,0 +1,441 @@
+#include "snapshot.h"
+#include "crc32.h"
+#include "byte_order.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 快照文件格式（小端序）：
+//
+// 文件头（64字节）
+//   0  标识          8字节 "BPSNAP\r\n"
+//   8  版本          u16
+//  10  文件头长度    u16，记录区从这里开始
+//  12  标志          u32，bit0：写出时为独立车位模式
+//  16  日志序列号    u64，快照包含到这条日志记录为止的状态
+//  24  统计起始时间  i64
+//  32  总收入        f64
+//  40  总处理车辆数  u32
+//  44  停车场容量    u32
+//  48  停车场车辆数  u32
+//  52  便道车辆数    u32
+//  56  记录区CRC32   u32，覆盖文件头之后的全部字节
+//  60  文件头CRC32   u32，覆盖前60字节
+//
+// 停车场记录（按车位顺序）：车位号间隔 varint（与上一条记录的车位号之差减一，第一条为车位号本身），
+//   到达时间 zigzag varint（与上一条记录的到达时间之差，第一条与0相差），车牌 u64（压缩编码，见 plate.h），
+//   登记在车牌表中的车牌（编码的 bit 63 为1）之后再跟车牌长度 u8 和车牌号——登记编号只在本进程内有效
+// 便道记录（从队头到队尾）：到达时间 zigzag varint（接着停车场记录继续求差），车牌 u64，登记的车牌同上
+// 统计区（版本2起）：长度 u32，之后为流式统计的定长编码（见 stats.c 的 encodeStreamStats）
+//
+// 版本1、2的车辆记录为定长字段加车牌文本：
+//   停车场记录：车位号 u32，到达时间 i64，车牌长度 u8，车牌号（不含结尾0）
+//   便道记录：到达时间 i64，车牌长度 u8，车牌号
+// 版本1的快照没有统计区，加载后流式统计从零开始。
+#define HDR_OFF_VERSION      8
+#define HDR_OFF_HEADER_SIZE  10
+#define HDR_OFF_FLAGS        12
+#define HDR_OFF_JOURNAL_SEQ  16
+#define HDR_OFF_START_TIME   24
+#define HDR_OFF_REVENUE      32
+#define HDR_OFF_TOTAL_CARS   40
+#define HDR_OFF_CAPACITY     44
+#define HDR_OFF_LOT_COUNT    48
+#define HDR_OFF_LANE_COUNT   52
+#define HDR_OFF_PAYLOAD_CRC  56
+#define HDR_OFF_HEADER_CRC   60
+
+#define SNAPSHOT_FLAG_BAYS   0x1
+
+#define LOT_RECORD_FIXED     13 // 版本1、2：车位号 + 到达时间 + 车牌长度
+#define LANE_RECORD_FIXED    9  // 版本1、2：到达时间 + 车牌长度
+
+// 版本3一条记录的最大长度：车位号间隔 + 到达时间差 + 车牌编码 + 车牌长度和车牌号
+#define RECORD_MAX_SIZE      (5 + 10 + 8 + 1 + MAX_PLATE_LEN)
+
+// 编码一条记录中的车辆（到达时间相对上一条记录），返回写入的字节数
+static size_t encodeCar(unsigned char *p, const Car *car, int64_t *prevArrive) {
+    size_t n = putVarint(p, zigzag((int64_t)car->arriveTime - *prevArrive));
+    *prevArrive = (int64_t)car->arriveTime;
+    putU64(p + n, car->plate);
+    n += 8;
+    if (car->plate & PLATE_INTERNED_FLAG) {
+        char plateNumber[MAX_PLATE_LEN];
+        size_t len = formatPlate(car->plate, plateNumber, sizeof(plateNumber));
+        p[n++] = (unsigned char)len;
+        memcpy(p + n, plateNumber, len);
+        n += len;
+    }
+    return n;
+}
+
+// 把当前状态编码为快照文件的内容（只访问内存），返回 malloc 分配的缓冲区
+unsigned char *encodeSnapshot(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t journalSeq, size_t *length) {
+    int lotCount = parkingLot != NULL ? getStackCount(parkingLot) : 0;
+    int laneCount = waitingLane != NULL ? getQueueCount(waitingLane) : 0;
+
+    // 按记录最大长度估算缓冲区大小
+    size_t size = SNAPSHOT_HEADER_SIZE +
+                  (size_t)(lotCount + laneCount) * RECORD_MAX_SIZE +
+                  4 + STREAM_STATS_ENCODED_SIZE;
+    unsigned char *buffer = (unsigned char *)malloc(size);
+    if (buffer == NULL) {
+        printf("内存分配失败！\n");
+        return NULL;
+    }
+
+    unsigned char *p = buffer + SNAPSHOT_HEADER_SIZE;
+    int64_t prevArrive = 0;
+    if (parkingLot != NULL) {
+        int prevSlot = -1;
+        for (int i = 0; i <= parkingLot->top; i++) {
+            if (isSlotOccupied(parkingLot, i)) {
+                p += putVarint(p, (uint64_t)(i - prevSlot - 1));
+                p += encodeCar(p, &parkingLot->data[i], &prevArrive);
+                prevSlot = i;
+            }
+        }
+    }
+    // 便道按出队顺序保存，加载时依次入队即可恢复相同的顺序（优先级模式下堆中的下标不是出队顺序）
+    int *order = waitingLane != NULL ? queuePromotionOrder(waitingLane) : NULL;
+    for (int i = 0; i < laneCount; i++) {
+        p += encodeCar(p, queueAt(waitingLane, order != NULL ? order[i] : i), &prevArrive);
+    }
+    free(order);
+    putU32(p, STREAM_STATS_ENCODED_SIZE);
+    if (stats != NULL) {
+        encodeStreamStats(p + 4, &stats->stream);
+    } else {
+        StreamStats empty;
+        initStreamStats(&empty);
+        encodeStreamStats(p + 4, &empty);
+    }
+    p += 4 + STREAM_STATS_ENCODED_SIZE;
+    size_t used = (size_t)(p - buffer);
+
+    unsigned char *h = buffer;
+    memset(h, 0, SNAPSHOT_HEADER_SIZE);
+    memcpy(h, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    putU16(h + HDR_OFF_VERSION, SNAPSHOT_VERSION);
+    putU16(h + HDR_OFF_HEADER_SIZE, SNAPSHOT_HEADER_SIZE);
+    putU32(h + HDR_OFF_FLAGS, parkingLot != NULL && parkingLot->model == LOT_MODEL_BAYS ? SNAPSHOT_FLAG_BAYS : 0);
+    putU64(h + HDR_OFF_JOURNAL_SEQ, journalSeq);
+    if (stats != NULL) {
+        uint64_t revenueBits;
+        memcpy(&revenueBits, &stats->totalRevenue, sizeof(revenueBits));
+        putU64(h + HDR_OFF_START_TIME, (uint64_t)(int64_t)stats->startTime);
+        putU64(h + HDR_OFF_REVENUE, revenueBits);
+        putU32(h + HDR_OFF_TOTAL_CARS, (uint32_t)stats->totalCars);
+    }
+    putU32(h + HDR_OFF_CAPACITY, parkingLot != NULL ? (uint32_t)parkingLot->capacity : 0);
+    putU32(h + HDR_OFF_LOT_COUNT, (uint32_t)lotCount);
+    putU32(h + HDR_OFF_LANE_COUNT, (uint32_t)laneCount);
+    putU32(h + HDR_OFF_PAYLOAD_CRC, crc32Update(0, buffer + SNAPSHOT_HEADER_SIZE, used - SNAPSHOT_HEADER_SIZE));
+    putU32(h + HDR_OFF_HEADER_CRC, crc32Update(0, h, HDR_OFF_HEADER_CRC));
+    *length = used;
+    return buffer;
+}
+
+// 把编码好的快照写入文件并刷盘
+bool writeSnapshotData(const char *path, const unsigned char *data, size_t length) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("无法创建保存文件！\n");
+        return false;
+    }
+    bool ok = fwrite(data, 1, length, file) == length && flushFileToDisk(file);
+    return fclose(file) == 0 && ok;
+}
+
+// 写出快照
+bool writeSnapshot(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t journalSeq) {
+    size_t length;
+    unsigned char *data = encodeSnapshot(parkingLot, waitingLane, stats, journalSeq, &length);
+    if (data == NULL) {
+        return false;
+    }
+    bool ok = writeSnapshotData(path, data, length);
+    free(data);
+    return ok;
+}
+
+// 只读映射的快照文件
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+#ifdef _WIN32
+    unsigned char *buffer;   // Windows下整体读入的缓冲区
+#endif
+} MappedFile;
+
+// 映射整个文件（Windows下一次读入内存）
+static SnapshotStatus mapFile(const char *path, MappedFile *map) {
+    map->data = NULL;
+    map->size = 0;
+#ifdef _WIN32
+    map->buffer = NULL;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return SNAPSHOT_MISSING;
+    }
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return SNAPSHOT_CORRUPT;
+    }
+    if (size > 0) {
+        map->buffer = (unsigned char *)malloc((size_t)size);
+        if (map->buffer == NULL || fread(map->buffer, 1, (size_t)size, file) != (size_t)size) {
+            free(map->buffer);
+            map->buffer = NULL;
+            fclose(file);
+            return SNAPSHOT_CORRUPT;
+        }
+    }
+    fclose(file);
+    map->data = map->buffer;
+    map->size = (size_t)size;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return SNAPSHOT_MISSING;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return SNAPSHOT_CORRUPT;
+    }
+    if (st.st_size > 0) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return SNAPSHOT_CORRUPT;
+        }
+        map->data = (const unsigned char *)data;
+        map->size = (size_t)st.st_size;
+    }
+    close(fd);
+#endif
+    return SNAPSHOT_OK;
+}
+
+static void unmapFile(MappedFile *map) {
+#ifdef _WIN32
+    free(map->buffer);
+    map->buffer = NULL;
+#else
+    if (map->data != NULL) {
+        munmap((void *)map->data, map->size);
+    }
+#endif
+    map->data = NULL;
+    map->size = 0;
+}
+
+// 记录区的读取位置；版本3的车位号和到达时间按与上一条记录的差值解码
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    uint16_t version;
+    int64_t prevSlot;
+    int64_t prevArrive;
+} RecordCursor;
+
+// 读出车牌长度和车牌号；decode 为真时编码为压缩车牌（需要时登记到车牌表）
+static bool readPlateText(RecordCursor *c, PackedPlate *plate, bool decode) {
+    if (c->p >= c->end) {
+        return false;
+    }
+    size_t len = *c->p++;
+    if (len == 0 || len >= MAX_PLATE_LEN || (size_t)(c->end - c->p) < len) {
+        return false;
+    }
+    if (decode) {
+        char plateNumber[MAX_PLATE_LEN];
+        memcpy(plateNumber, c->p, len);
+        plateNumber[len] = '\0';
+        *plate = encodePlate(plateNumber, len);
+        if (*plate == PLATE_NONE) {
+            return false;
+        }
+    }
+    c->p += len;
+    return true;
+}
+
+// 读出一条记录，检查不超出记录区、车牌长度和车位号合法；car 为NULL时只检查
+static bool readRecord(RecordCursor *c, bool inLot, uint32_t *slot, Car *car) {
+    Car parsed = {0};
+    if (c->version < 3) {
+        size_t fixed = inLot ? LOT_RECORD_FIXED : LANE_RECORD_FIXED;
+        if ((size_t)(c->end - c->p) < fixed) {
+            return false;
+        }
+        if (inLot) {
+            *slot = getU32(c->p);
+            c->p += 4;
+        }
+        parsed.arriveTime = (time_t)(int64_t)getU64(c->p);
+        c->p += 8;
+        if (!readPlateText(c, &parsed.plate, car != NULL)) {
+            return false;
+        }
+    } else {
+        uint64_t value;
+        if (inLot) {
+            if (!getVarint(&c->p, c->end, &value) || value >= MAX_CAPACITY) {
+                return false;
+            }
+            c->prevSlot += (int64_t)value + 1;
+            *slot = (uint32_t)c->prevSlot;
+        }
+        if (!getVarint(&c->p, c->end, &value) || (size_t)(c->end - c->p) < 8) {
+            return false;
+        }
+        c->prevArrive += unzigzag(value);
+        parsed.arriveTime = (time_t)c->prevArrive;
+        parsed.plate = getU64(c->p);
+        c->p += 8;
+        if (parsed.plate == PLATE_NONE) {
+            return false;
+        }
+        if ((parsed.plate & PLATE_INTERNED_FLAG) && !readPlateText(c, &parsed.plate, car != NULL)) {
+            return false;
+        }
+    }
+    if (inLot && *slot >= MAX_CAPACITY) {
+        return false;
+    }
+    if (car != NULL) {
+        *car = parsed;
+    }
+    return true;
+}
+
+// 检查记录区结构，求出最大车位号和车辆记录的结束位置
+static bool checkRecords(const unsigned char *p, const unsigned char *end, uint16_t version, uint32_t lotCount, uint32_t laneCount,
+                         uint32_t *maxSlot, const unsigned char **recordsEnd) {
+    RecordCursor cursor = {p, end, version, -1, 0};
+    *maxSlot = 0;
+    for (uint32_t i = 0; i < lotCount; i++) {
+        uint32_t slot;
+        if (!readRecord(&cursor, true, &slot, NULL)) {
+            return false;
+        }
+        if (slot > *maxSlot) {
+            *maxSlot = slot;
+        }
+    }
+    for (uint32_t i = 0; i < laneCount; i++) {
+        if (!readRecord(&cursor, false, NULL, NULL)) {
+            return false;
+        }
+    }
+    *recordsEnd = cursor.p;
+    return true;
+}
+
+// 校验并解码已映射的快照
+static SnapshotStatus decodeSnapshot(const unsigned char *data, size_t size, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t *journalSeq) {
+    if (size < SNAPSHOT_HEADER_SIZE || memcmp(data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0) {
+        return SNAPSHOT_LEGACY;
+    }
+    if (crc32Update(0, data, HDR_OFF_HEADER_CRC) != getU32(data + HDR_OFF_HEADER_CRC)) {
+        return SNAPSHOT_CORRUPT;
+    }
+    uint16_t version = getU16(data + HDR_OFF_VERSION);
+    if (version > SNAPSHOT_VERSION) {
+        return SNAPSHOT_UNSUPPORTED;
+    }
+
+    size_t headerSize = getU16(data + HDR_OFF_HEADER_SIZE);
+    if (headerSize < SNAPSHOT_HEADER_SIZE || headerSize > size) {
+        return SNAPSHOT_CORRUPT;
+    }
+    const unsigned char *records = data + headerSize;
+    const unsigned char *end = data + size;
+    if (crc32Update(0, records, (size_t)(end - records)) != getU32(data + HDR_OFF_PAYLOAD_CRC)) {
+        return SNAPSHOT_CORRUPT;
+    }
+
+    uint32_t lotCount = getU32(data + HDR_OFF_LOT_COUNT);
+    uint32_t laneCount = getU32(data + HDR_OFF_LANE_COUNT);
+    uint32_t maxSlot;
+    const unsigned char *recordsEnd;
+    if (lotCount > MAX_CAPACITY || !checkRecords(records, end, version, lotCount, laneCount, &maxSlot, &recordsEnd)) {
+        return SNAPSHOT_CORRUPT;
+    }
+
+    // 统计区：版本1没有，版本2起紧跟在车辆记录之后，到文件末尾为止
+    StreamStats stream;
+    initStreamStats(&stream);
+    if (version >= 2) {
+        if ((size_t)(end - recordsEnd) < 4 || getU32(recordsEnd) != (size_t)(end - recordsEnd) - 4 ||
+            !decodeStreamStats(recordsEnd + 4, (size_t)(end - recordsEnd) - 4, &stream)) {
+            return SNAPSHOT_CORRUPT;
+        }
+    } else if (recordsEnd != end) {
+        return SNAPSHOT_CORRUPT;
+    }
+
+    // 快照中的车辆多于当前容量时扩容，避免车辆丢失；独立车位模式还要容纳原来的车位号
+    int needed = (int)lotCount;
+    if (parkingLot->model == LOT_MODEL_BAYS && lotCount > 0 && (int)maxSlot + 1 > needed) {
+        needed = (int)maxSlot + 1;
+    }
+    if (needed > parkingLot->capacity) {
+        printf("快照中有 %u 辆车，超过停车场容量 %d，已自动扩容\n", lotCount, parkingLot->capacity);
+        if (resizeStack(parkingLot, needed) != SUCCESS) {
+            return SNAPSHOT_CORRUPT;
+        }
+    }
+
+    if (stats != NULL) {
+        uint64_t revenueBits = getU64(data + HDR_OFF_REVENUE);
+        stats->startTime = (time_t)(int64_t)getU64(data + HDR_OFF_START_TIME);
+        memcpy(&stats->totalRevenue, &revenueBits, sizeof(revenueBits));
+        stats->totalCars = (int)getU32(data + HDR_OFF_TOTAL_CARS);
+        stats->stream = stream;
+    }
+    *journalSeq = getU64(data + HDR_OFF_JOURNAL_SEQ);
+
+    // 停车场：独立车位模式下回到原来的车位，栈模式下按顺序入栈
+    RecordCursor cursor = {records, recordsEnd, version, -1, 0};
+    for (uint32_t i = 0; i < lotCount; i++) {
+        Car car;
+        uint32_t slot;
+        if (!readRecord(&cursor, true, &slot, &car)) {
+            return SNAPSHOT_CORRUPT; // 车牌表已满
+        }
+        placeCar(parkingLot, (int)slot, car);
+    }
+    for (uint32_t i = 0; i < laneCount; i++) {
+        Car car;
+        if (!readRecord(&cursor, false, NULL, &car)) {
+            return SNAPSHOT_CORRUPT;
+        }
+        enqueue(waitingLane, car);
+    }
+    return SNAPSHOT_OK;
+}
+
+// 读取快照
+SnapshotStatus readSnapshot(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t *journalSeq) {
+    MappedFile map;
+    SnapshotStatus status = mapFile(path, &map);
+    if (status != SNAPSHOT_OK) {
+        return status;
+    }
+    status = decodeSnapshot(map.data, map.size, parkingLot, waitingLane, stats, journalSeq);
+    unmapFile(&map);
+    return status;
+}
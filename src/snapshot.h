@@ -0,0 +1,31 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "parking.h"
+
+// 快照文件标识与版本
+#define SNAPSHOT_MAGIC "BPSNAP\r\n"
+#define SNAPSHOT_MAGIC_SIZE 8
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_HEADER_SIZE 64
+
+// 快照读取结果
+typedef enum {
+    SNAPSHOT_OK = 0,          // 加载成功
+    SNAPSHOT_MISSING = 1,     // 文件不存在或无法打开
+    SNAPSHOT_LEGACY = 2,      // 不是本格式（旧版本的结构体直写文件）
+    SNAPSHOT_CORRUPT = 3,     // 校验失败或结构损坏
+    SNAPSHOT_UNSUPPORTED = 4  // 更新版本写出的快照
+} SnapshotStatus;
+
+// 写出快照（先在内存中编码，一次写入后刷盘）
+// 编码和写文件也可以分开进行：后台检查点在引擎线程中编码，在检查点线程中写文件
+unsigned char *encodeSnapshot(ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t journalSeq, size_t *length);
+bool writeSnapshotData(const char *path, const unsigned char *data, size_t length);
+bool writeSnapshot(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t journalSeq);
+
+// 读取快照：映射整个文件，校验后直接从映射内存解码，不逐条读取
+SnapshotStatus readSnapshot(const char *path, ParkingStack *parkingLot, WaitingQueue *waitingLane, SystemStats *stats, uint64_t *journalSeq);
+
+#endif /* SNAPSHOT_H */
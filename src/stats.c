@@ -0,0 +1,245 @@
+#include "stats.h"
+#include "byte_order.h"
+#include <math.h>
+#include <string.h>
+
+// 值所在的桶（每个2的幂区间分 2^bits 个桶）：小于 2^bits 的值直接对应，之后按最高位所在的
+// 位置e和其后bits位sub分桶，超出范围的值计入最后一个桶
+static int bucketOfWith(uint64_t value, int bits, int buckets) {
+    uint64_t sub = (uint64_t)1 << bits;
+    if (value < sub) {
+        return (int)value;
+    }
+    int e = 63;
+    while (!(value >> e)) {
+        e--;
+    }
+    int bucket = (int)sub + (e - bits) * (int)sub + (int)((value >> (e - bits)) & (sub - 1));
+    return bucket < buckets ? bucket : buckets - 1;
+}
+
+static int bucketOf(uint64_t value) {
+    return bucketOfWith(value, STATS_SUB_BITS, STATS_BUCKETS);
+}
+
+// 桶的下界和上界（含）
+static void bucketRangeWith(int bucket, int bits, uint64_t *low, uint64_t *high) {
+    int sub = 1 << bits;
+    if (bucket < sub) {
+        *low = *high = (uint64_t)bucket;
+        return;
+    }
+    int e = (bucket - sub) / sub + bits;
+    uint64_t offset = (uint64_t)((bucket - sub) % sub);
+    *low = ((uint64_t)sub + offset) << (e - bits);
+    *high = (((uint64_t)sub + offset + 1) << (e - bits)) - 1;
+}
+
+// 添加一个样本
+void histogramAdd(LogHistogram *histogram, uint64_t value) {
+    histogram->counts[bucketOf(value)]++;
+    if (histogram->count == 0 || value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->count++;
+    histogram->sum += (double)value;
+}
+
+// 百分位数（q取0-1）：找到累计数达到 q*count 的桶，返回桶的中点并限制在实际最小、最大值之间
+uint64_t histogramQuantile(const LogHistogram *histogram, double q) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)ceil(q * (double)histogram->count);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += histogram->counts[b];
+        if (seen >= rank) {
+            uint64_t low, high;
+            bucketRangeWith(b, STATS_SUB_BITS, &low, &high);
+            uint64_t value = low + (high - low) / 2;
+            if (value < histogram->min) {
+                value = histogram->min;
+            }
+            if (value > histogram->max) {
+                value = histogram->max;
+            }
+            return value;
+        }
+    }
+    return histogram->max;
+}
+
+// 初始化
+void initStreamStats(StreamStats *stats) {
+    memset(stats, 0, sizeof(StreamStats));
+    for (int i = 0; i < STATS_HOURS; i++) {
+        stats->hours[i].hour = -1;
+    }
+}
+
+// 取得某一小时的计数槽，槽中是更早的小时时先清零
+static HourlyCount *hourSlot(StreamStats *stats, time_t when) {
+    int64_t hour = (int64_t)when / 3600;
+    if (hour < 0) {
+        hour = 0;
+    }
+    HourlyCount *slot = &stats->hours[hour % STATS_HOURS];
+    if (slot->hour != hour) {
+        if (slot->hour > hour) {
+            return NULL; // 比保留窗口还早的事件（时间戳乱序），不计入逐小时计数
+        }
+        slot->hour = hour;
+        slot->arrivals = 0;
+        slot->departures = 0;
+    }
+    return slot;
+}
+
+// 记录一次到达，lotCount、laneCount 为到达后停车场和便道的车辆数
+void streamRecordArrival(StreamStats *stats, time_t when, int lotCount, int laneCount) {
+    HourlyCount *slot = hourSlot(stats, when);
+    if (slot != NULL) {
+        slot->arrivals++;
+    }
+    stats->arrivals++;
+    if (lotCount > stats->peakOccupancy) {
+        stats->peakOccupancy = lotCount;
+        stats->peakOccupancyTime = when;
+    }
+    if (laneCount > stats->peakLane) {
+        stats->peakLane = laneCount;
+        stats->peakLaneTime = when;
+    }
+}
+
+// 记录一次离开
+void streamRecordDeparture(StreamStats *stats, time_t when, time_t arriveTime, double fee) {
+    HourlyCount *slot = hourSlot(stats, when);
+    if (slot != NULL) {
+        slot->departures++;
+    }
+    double dwell = difftime(when, arriveTime);
+    histogramAdd(&stats->dwell, dwell > 0 ? (uint64_t)dwell : 0);
+    histogramAdd(&stats->fee, fee > 0 ? (uint64_t)llround(fee * 100.0) : 0);
+}
+
+// 查询某一小时的计数，该小时已不在保留窗口内时返回false
+bool streamHourCount(const StreamStats *stats, time_t when, uint32_t *arrivals, uint32_t *departures) {
+    int64_t hour = (int64_t)when / 3600;
+    const HourlyCount *slot = &stats->hours[(hour < 0 ? 0 : hour) % STATS_HOURS];
+    bool found = slot->hour == hour;
+    *arrivals = found ? slot->arrivals : 0;
+    *departures = found ? slot->departures : 0;
+    return found;
+}
+
+// 统计摘要
+void summarizeStreamStats(const StreamStats *stats, time_t now, StatsSummary *summary) {
+    memset(summary, 0, sizeof(StatsSummary));
+    summary->arrivals = stats->arrivals;
+    summary->departures = stats->dwell.count;
+    summary->dwellP50 = histogramQuantile(&stats->dwell, 0.50);
+    summary->dwellP95 = histogramQuantile(&stats->dwell, 0.95);
+    summary->dwellP99 = histogramQuantile(&stats->dwell, 0.99);
+    summary->dwellMean = stats->dwell.count > 0 ? stats->dwell.sum / (double)stats->dwell.count : 0.0;
+    summary->feeP50 = histogramQuantile(&stats->fee, 0.50) / 100.0;
+    summary->feeP95 = histogramQuantile(&stats->fee, 0.95) / 100.0;
+    summary->feeP99 = histogramQuantile(&stats->fee, 0.99) / 100.0;
+    summary->peakOccupancy = stats->peakOccupancy;
+    summary->peakOccupancyTime = stats->peakOccupancyTime;
+    summary->peakLane = stats->peakLane;
+    summary->peakLaneTime = stats->peakLaneTime;
+    for (int h = 0; h < 24; h++) {
+        uint32_t arrivals, departures;
+        streamHourCount(stats, now - (time_t)h * 3600, &arrivals, &departures);
+        summary->arrivals24h += arrivals;
+        summary->departures24h += departures;
+    }
+}
+
+static unsigned char *encodeHistogram(unsigned char *p, const LogHistogram *histogram) {
+    uint64_t sumBits;
+    memcpy(&sumBits, &histogram->sum, sizeof(sumBits));
+    putU64(p, histogram->count);
+    putU64(p + 8, histogram->min);
+    putU64(p + 16, histogram->max);
+    putU64(p + 24, sumBits);
+    p += 32;
+    for (int b = 0; b < STATS_BUCKETS; b++, p += 8) {
+        putU64(p, histogram->counts[b]);
+    }
+    return p;
+}
+
+// 解码直方图；旧版的桶按桶中点（限制在实际最小、最大值之间）计入当前的桶
+static const unsigned char *decodeHistogram(const unsigned char *p, int buckets, LogHistogram *histogram) {
+    uint64_t sumBits = getU64(p + 24);
+    histogram->count = getU64(p);
+    histogram->min = getU64(p + 8);
+    histogram->max = getU64(p + 16);
+    memcpy(&histogram->sum, &sumBits, sizeof(sumBits));
+    p += 32;
+    memset(histogram->counts, 0, sizeof(histogram->counts));
+    for (int b = 0; b < buckets; b++, p += 8) {
+        if (buckets == STATS_BUCKETS) {
+            histogram->counts[b] = getU64(p);
+            continue;
+        }
+        uint64_t low, high;
+        bucketRangeWith(b, STATS_LEGACY_SUB_BITS, &low, &high);
+        uint64_t value = low + (high - low) / 2;
+        value = value < histogram->min ? histogram->min : value > histogram->max ? histogram->max : value;
+        histogram->counts[bucketOf(value)] += getU64(p);
+    }
+    return p;
+}
+
+// 编码为 STREAM_STATS_ENCODED_SIZE 字节：
+//   桶数 u16，小时数 u16，停车时长直方图，费用直方图（各为 样本数、最小值、最大值 u64，和 f64，各桶计数 u64），
+//   逐小时计数（小时序号 i64，到达 u32，离开 u32），累计到达 u64，
+//   最高占用 u32，其时间 i64，最长排队 u32，其时间 i64
+void encodeStreamStats(unsigned char *p, const StreamStats *stats) {
+    putU16(p, STATS_BUCKETS);
+    putU16(p + 2, STATS_HOURS);
+    p = encodeHistogram(p + 4, &stats->dwell);
+    p = encodeHistogram(p, &stats->fee);
+    for (int h = 0; h < STATS_HOURS; h++, p += 16) {
+        putU64(p, (uint64_t)stats->hours[h].hour);
+        putU32(p + 8, stats->hours[h].arrivals);
+        putU32(p + 12, stats->hours[h].departures);
+    }
+    putU64(p, stats->arrivals);
+    putU32(p + 8, (uint32_t)stats->peakOccupancy);
+    putU64(p + 12, (uint64_t)(int64_t)stats->peakOccupancyTime);
+    putU32(p + 20, (uint32_t)stats->peakLane);
+    putU64(p + 24, (uint64_t)(int64_t)stats->peakLaneTime);
+}
+
+// 解码（也接受旧版128桶的直方图），长度或桶数不符时返回false
+bool decodeStreamStats(const unsigned char *p, size_t size, StreamStats *stats) {
+    int buckets = getU16(p);
+    if ((buckets != STATS_BUCKETS && buckets != STATS_LEGACY_BUCKETS) ||
+        size != STREAM_STATS_SIZE_FOR(buckets) || getU16(p + 2) != STATS_HOURS) {
+        return false;
+    }
+    p = decodeHistogram(p + 4, buckets, &stats->dwell);
+    p = decodeHistogram(p, buckets, &stats->fee);
+    for (int h = 0; h < STATS_HOURS; h++, p += 16) {
+        stats->hours[h].hour = (int64_t)getU64(p);
+        stats->hours[h].arrivals = getU32(p + 8);
+        stats->hours[h].departures = getU32(p + 12);
+    }
+    stats->arrivals = getU64(p);
+    stats->peakOccupancy = (int)getU32(p + 8);
+    stats->peakOccupancyTime = (time_t)(int64_t)getU64(p + 12);
+    stats->peakLane = (int)getU32(p + 20);
+    stats->peakLaneTime = (time_t)(int64_t)getU64(p + 24);
+    return true;
+}
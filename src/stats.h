@@ -0,0 +1,81 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// 每个2的幂区间分 2^STATS_SUB_BITS 个桶
+#define STATS_SUB_BITS 5
+// 直方图桶数：0-31各占一个桶，之后每个2的幂区间分32个桶，到2^32为止（桶宽不超过下界的1/32，
+// 取桶中点时相对误差不超过1.6%）
+#define STATS_BUCKETS ((1 << STATS_SUB_BITS) * (33 - STATS_SUB_BITS))
+// 旧版快照的直方图：每个2的幂区间分4个桶，共128个桶；加载时换算到当前的桶
+#define STATS_LEGACY_SUB_BITS 2
+#define STATS_LEGACY_BUCKETS 128
+// 逐小时计数保留的小时数（一周）
+#define STATS_HOURS 168
+// 编码后的字节数（快照中的统计区）
+#define STREAM_STATS_SIZE_FOR(buckets) (4 + 2 * (32 + (size_t)(buckets) * 8) + STATS_HOURS * 16 + 32)
+#define STREAM_STATS_ENCODED_SIZE STREAM_STATS_SIZE_FOR(STATS_BUCKETS)
+
+// 对数分桶直方图：内存固定，不保存原始数据
+typedef struct {
+    uint64_t counts[STATS_BUCKETS];
+    uint64_t count;      // 样本数
+    uint64_t min;        // 最小值
+    uint64_t max;        // 最大值
+    double sum;          // 样本之和（用于求平均值）
+} LogHistogram;
+
+// 某一小时的到达和离开车辆数
+typedef struct {
+    int64_t hour;        // 自1970年起的小时序号（-1表示空）
+    uint32_t arrivals;
+    uint32_t departures;
+} HourlyCount;
+
+// 流式统计：每次到达、离开时更新，占用内存固定，查询不需要扫描历史记录
+typedef struct {
+    LogHistogram dwell;              // 停车时长（秒）
+    LogHistogram fee;                // 停车费用（分）
+    HourlyCount hours[STATS_HOURS];  // 最近一周的逐小时计数（按小时序号取模存放）
+    uint64_t arrivals;               // 累计到达车辆数
+    int peakOccupancy;               // 停车场最高占用
+    time_t peakOccupancyTime;
+    int peakLane;                    // 便道最长排队
+    time_t peakLaneTime;
+} StreamStats;
+
+// 统计摘要（百分位数、峰值和最近24小时的计数）
+typedef struct {
+    uint64_t arrivals;
+    uint64_t departures;
+    uint64_t dwellP50, dwellP95, dwellP99;   // 秒
+    double feeP50, feeP95, feeP99;           // 元
+    double dwellMean;                        // 秒
+    int peakOccupancy;
+    time_t peakOccupancyTime;
+    int peakLane;
+    time_t peakLaneTime;
+    uint32_t arrivals24h;
+    uint32_t departures24h;
+} StatsSummary;
+
+// 直方图
+void histogramAdd(LogHistogram *histogram, uint64_t value);
+uint64_t histogramQuantile(const LogHistogram *histogram, double q);
+
+// 流式统计
+void initStreamStats(StreamStats *stats);
+void streamRecordArrival(StreamStats *stats, time_t when, int lotCount, int laneCount);
+void streamRecordDeparture(StreamStats *stats, time_t when, time_t arriveTime, double fee);
+bool streamHourCount(const StreamStats *stats, time_t when, uint32_t *arrivals, uint32_t *departures);
+void summarizeStreamStats(const StreamStats *stats, time_t now, StatsSummary *summary);
+
+// 定长小端序编码（快照使用）
+void encodeStreamStats(unsigned char *p, const StreamStats *stats);
+bool decodeStreamStats(const unsigned char *p, size_t size, StreamStats *stats);
+
+#endif /* STATS_H */
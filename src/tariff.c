@@ -0,0 +1,376 @@
+#include "tariff.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+
+// 收费方案文件格式（#开头为注释）：
+//   [standard]                          车辆类别：standard 或 new_energy
+//   free_minutes = 15                   免费时长（分钟）
+//   billing_unit = 60                   计费单位（分钟）
+//   daily_cap = 80                      每24小时封顶金额
+//   rate = weekday 08:00-20:00 10       时段费率（元/小时），后面的行覆盖前面的行
+//   rate = weekday 20:00-08:00 5        结束时间早于开始时间表示跨越午夜
+//   rate = weekend 00:00-24:00 8
+// 日期可以是 all、weekday、weekend 或 mon..sun。没有出现过的车辆类别沿用 standard 的规则，
+// 没有被任何 rate 覆盖的时段按默认费率（SystemConfig.hourlyRate）计费。
+
+static const char *classNames[VEHICLE_CLASS_COUNT] = { "standard", "new_energy" };
+static const char *dayNames[7] = { "mon", "tue", "wed", "thu", "fri", "sat", "sun" };
+
+// 某一时刻在本地时间一周中的分钟数（星期一0点为0）。每次按该时刻换算，夏令时切换前后的停车
+// 都按当时的本地时间划分时段
+static long long localWeekMinute(time_t t) {
+    struct tm info;
+#ifdef _WIN32
+    localtime_s(&info, &t);
+#else
+    localtime_r(&t, &info);
+#endif
+    return (long long)((info.tm_wday + 6) % 7) * MINUTES_PER_DAY + info.tm_hour * 60 + info.tm_min;
+}
+
+// 为一个车辆类别分配前缀和表
+static int allocClass(TariffClass *tariffClass) {
+    tariffClass->prefix = (double *)malloc((MINUTES_PER_WEEK + 1) * sizeof(double));
+    if (tariffClass->prefix == NULL) {
+        printf("内存分配失败！\n");
+        return ERR_MEMORY;
+    }
+    tariffClass->freeMinutes = 0;
+    tariffClass->billingUnit = 60;
+    tariffClass->dailyCap = 0.0;
+    return SUCCESS;
+}
+
+// 把每分钟的小时费率编译成前缀和
+static void compileClass(TariffClass *tariffClass, const double *minuteRates) {
+    tariffClass->prefix[0] = 0.0;
+    for (int m = 0; m < MINUTES_PER_WEEK; m++) {
+        tariffClass->prefix[m + 1] = tariffClass->prefix[m] + minuteRates[m];
+    }
+}
+
+// 初始化统一费率方案（与原来的按小时计费完全一致）
+int initFlatTariff(Tariff *tariff, double hourlyRate) {
+    memset(tariff, 0, sizeof(Tariff));
+    for (int c = 0; c < VEHICLE_CLASS_COUNT; c++) {
+        if (allocClass(&tariff->classes[c]) != SUCCESS) {
+            freeTariff(tariff);
+            return ERR_MEMORY;
+        }
+        for (int m = 0; m <= MINUTES_PER_WEEK; m++) {
+            tariff->classes[c].prefix[m] = hourlyRate * m;
+        }
+    }
+    tariff->flatRate = hourlyRate;
+    snprintf(tariff->description, sizeof(tariff->description), "%.2f 元/小时", hourlyRate);
+    return SUCCESS;
+}
+
+// 释放收费方案
+void freeTariff(Tariff *tariff) {
+    for (int c = 0; c < VEHICLE_CLASS_COUNT; c++) {
+        free(tariff->classes[c].prefix);
+        tariff->classes[c].prefix = NULL;
+    }
+}
+
+// 解析整数，整个字符串都必须是数字（允许前导正负号）
+static bool parseInteger(const char *text, int *value) {
+    char *end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || parsed < INT_MIN || parsed > INT_MAX) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+// 解析金额或费率，整个字符串都必须是数字
+static bool parseAmount(const char *text, double *value) {
+    char *end;
+    errno = 0;
+    double parsed = strtod(text, &end);
+    if (end == text || *end != '\0' || errno != 0 || !isfinite(parsed)) {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+// 解析 HH:MM，返回一天中的分钟数（允许24:00）
+static bool parseClock(const char *text, int *minute) {
+    int h, m;
+    if (sscanf(text, "%d:%d", &h, &m) != 2 || h < 0 || m < 0 || m > 59 || h * 60 + m > MINUTES_PER_DAY) {
+        return false;
+    }
+    *minute = h * 60 + m;
+    return true;
+}
+
+// 解析日期说明，设置一周中各天是否适用
+static bool parseDays(const char *text, bool days[7]) {
+    for (int d = 0; d < 7; d++) {
+        days[d] = false;
+    }
+    if (strcmp(text, "all") == 0) {
+        for (int d = 0; d < 7; d++) days[d] = true;
+        return true;
+    }
+    if (strcmp(text, "weekday") == 0) {
+        for (int d = 0; d < 5; d++) days[d] = true;
+        return true;
+    }
+    if (strcmp(text, "weekend") == 0) {
+        days[5] = days[6] = true;
+        return true;
+    }
+    for (int d = 0; d < 7; d++) {
+        if (strcmp(text, dayNames[d]) == 0) {
+            days[d] = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 解析一条 rate 规则并写入每分钟费率表
+static bool applyRateRule(char *value, double *minuteRates) {
+    char dayText[16], rangeText[32], rateText[32];
+    double rate;
+    int consumed = 0;
+    if (sscanf(value, "%15s %31s %31s%n", dayText, rangeText, rateText, &consumed) != 3 ||
+        value[consumed] != '\0' || !parseAmount(rateText, &rate) || rate < 0) {
+        return false;
+    }
+
+    char *dash = strchr(rangeText, '-');
+    bool days[7];
+    int start, end;
+    if (dash == NULL || !parseDays(dayText, days)) {
+        return false;
+    }
+    *dash = '\0';
+    if (!parseClock(rangeText, &start) || !parseClock(dash + 1, &end) || start == MINUTES_PER_DAY) {
+        return false;
+    }
+
+    // 结束时间不晚于开始时间时跨越午夜
+    int length = end > start ? end - start : end + MINUTES_PER_DAY - start;
+    for (int d = 0; d < 7; d++) {
+        if (!days[d]) {
+            continue;
+        }
+        for (int i = 0; i < length; i++) {
+            minuteRates[(d * MINUTES_PER_DAY + start + i) % MINUTES_PER_WEEK] = rate;
+        }
+    }
+    return true;
+}
+
+// 去掉首尾空白
+static char *trimText(char *str) {
+    while (isspace((unsigned char)*str)) {
+        str++;
+    }
+    size_t len = strlen(str);
+    while (len > 0 && isspace((unsigned char)str[len - 1])) {
+        str[--len] = '\0';
+    }
+    return str;
+}
+
+// 从文件加载收费方案并编译成查找表
+bool loadTariff(Tariff *tariff, const char *path, double defaultRate) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("无法打开收费方案文件: %s\n", path);
+        return false;
+    }
+
+    double *minuteRates = (double *)malloc((size_t)VEHICLE_CLASS_COUNT * MINUTES_PER_WEEK * sizeof(double));
+    if (minuteRates == NULL || initFlatTariff(tariff, defaultRate) != SUCCESS) {
+        free(minuteRates);
+        fclose(file);
+        return false;
+    }
+    for (int i = 0; i < VEHICLE_CLASS_COUNT * MINUTES_PER_WEEK; i++) {
+        minuteRates[i] = defaultRate;
+    }
+
+    bool defined[VEHICLE_CLASS_COUNT] = { false };
+    int current = VEHICLE_STANDARD;
+    bool ok = true;
+    char line[256];
+    int lineNumber = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *text = trimText(line);
+        if (text[0] == '\0' || text[0] == '#') {
+            continue;
+        }
+
+        // 类别小节
+        if (text[0] == '[') {
+            char *close = strchr(text, ']');
+            int found = -1;
+            if (close != NULL) {
+                *close = '\0';
+                for (int c = 0; c < VEHICLE_CLASS_COUNT; c++) {
+                    if (strcmp(text + 1, classNames[c]) == 0) {
+                        found = c;
+                    }
+                }
+            }
+            if (found < 0) {
+                printf("收费方案 %s 第 %d 行：未知的车辆类别\n", path, lineNumber);
+                ok = false;
+                break;
+            }
+            current = found;
+            defined[current] = true;
+            continue;
+        }
+
+        char *eq = strchr(text, '=');
+        if (eq == NULL) {
+            printf("收费方案 %s 第 %d 行格式错误\n", path, lineNumber);
+            ok = false;
+            break;
+        }
+        *eq = '\0';
+        char *key = trimText(text);
+        char *value = trimText(eq + 1);
+        TariffClass *tariffClass = &tariff->classes[current];
+        defined[current] = true;
+
+        bool valid = true;
+        if (strcmp(key, "free_minutes") == 0) {
+            valid = parseInteger(value, &tariffClass->freeMinutes);
+        } else if (strcmp(key, "billing_unit") == 0) {
+            valid = parseInteger(value, &tariffClass->billingUnit);
+        } else if (strcmp(key, "daily_cap") == 0) {
+            valid = parseAmount(value, &tariffClass->dailyCap);
+        } else if (strcmp(key, "rate") == 0) {
+            if (!applyRateRule(value, minuteRates + (size_t)current * MINUTES_PER_WEEK)) {
+                printf("收费方案 %s 第 %d 行：无效的费率规则\n", path, lineNumber);
+                ok = false;
+                break;
+            }
+        } else {
+            printf("收费方案 %s 第 %d 行：未知的配置项 %s\n", path, lineNumber, key);
+            ok = false;
+            break;
+        }
+
+        if (!valid || tariffClass->freeMinutes < 0 || tariffClass->billingUnit < 1) {
+            printf("收费方案 %s 第 %d 行：无效的取值 %s\n", path, lineNumber, value);
+            ok = false;
+            break;
+        }
+    }
+    fclose(file);
+
+    if (ok) {
+        for (int c = 0; c < VEHICLE_CLASS_COUNT; c++) {
+            int source = defined[c] ? c : VEHICLE_STANDARD;
+            double *prefix = tariff->classes[c].prefix;
+            tariff->classes[c] = tariff->classes[source];
+            tariff->classes[c].prefix = prefix;
+            compileClass(&tariff->classes[c], minuteRates + (size_t)source * MINUTES_PER_WEEK);
+        }
+        tariff->flatRate = 0.0;
+        snprintf(tariff->description, sizeof(tariff->description), "按时段计费（%.40s）", path);
+    } else {
+        freeTariff(tariff);
+    }
+
+    free(minuteRates);
+    return ok;
+}
+
+// 由车牌号推断车辆类别：新能源车牌在地区字母后有6位字符
+VehicleClass classifyVehicle(const char *plateNumber) {
+    const unsigned char *p = (const unsigned char *)plateNumber;
+    while (*p >= 0x80) {
+        p++; // 跳过省份简称
+    }
+    size_t tail = strlen((const char *)p);
+    return tail == 7 ? VEHICLE_NEW_ENERGY : VEHICLE_STANDARD;
+}
+
+// 与 classifyVehicle 相同的规则，直接取编码中的尾部字符数，不还原字符串
+VehicleClass classifyPlate(PackedPlate plate) {
+    return plateTailLength(plate) == 7 ? VEHICLE_NEW_ENERGY : VEHICLE_STANDARD;
+}
+
+// 从一周中的第start分钟（可以超过一周）开始，连续minutes分钟的费率之和（O(1)）
+static double rangeSum(const TariffClass *tariffClass, long long start, long long minutes) {
+    long long weekMinute = start % MINUTES_PER_WEEK;
+
+    const double *prefix = tariffClass->prefix;
+    long long weeks = minutes / MINUTES_PER_WEEK;
+    long long rest = minutes % MINUTES_PER_WEEK;
+    double sum = weeks * prefix[MINUTES_PER_WEEK];
+
+    if (weekMinute + rest <= MINUTES_PER_WEEK) {
+        sum += prefix[weekMinute + rest] - prefix[weekMinute];
+    } else {
+        sum += prefix[MINUTES_PER_WEEK] - prefix[weekMinute] + prefix[weekMinute + rest - MINUTES_PER_WEEK];
+    }
+    return sum;
+}
+
+// 按小时费率之和计算金额，并考虑封顶
+static double cappedCost(const TariffClass *tariffClass, long long start, long long minutes) {
+    double cost = rangeSum(tariffClass, start, minutes) / 60.0;
+    if (tariffClass->dailyCap > 0 && cost > tariffClass->dailyCap) {
+        cost = tariffClass->dailyCap;
+    }
+    return cost;
+}
+
+// 计算一次停车的费用；多日停车按每24小时封顶，整周的部分直接乘周期，计算量与停车时长无关
+double tariffPrice(const Tariff *tariff, VehicleClass vehicleClass, time_t arriveTime, time_t leaveTime) {
+    const TariffClass *tariffClass = &tariff->classes[vehicleClass];
+    long long seconds = (long long)(leaveTime - arriveTime) - tariffClass->freeMinutes * 60LL;
+    if (seconds <= 0) {
+        return 0.0;
+    }
+
+    // 计费时长向上取整到计费单位
+    long long unitSeconds = tariffClass->billingUnit * 60LL;
+    long long minutes = (seconds + unitSeconds - 1) / unitSeconds * tariffClass->billingUnit;
+
+    // 计费起点在本地时间一周中的分钟数；统一费率各时段相同，不需要换算
+    long long start = tariff->flatRate > 0 ? 0 : localWeekMinute(arriveTime + (time_t)tariffClass->freeMinutes * 60);
+
+    double fee;
+    if (tariffClass->dailyCap <= 0) {
+        fee = rangeSum(tariffClass, start, minutes) / 60.0;
+    } else {
+        // 每个24小时段的费用以7天为周期重复
+        long long days = minutes / MINUTES_PER_DAY;
+        long long rest = minutes % MINUTES_PER_DAY;
+        double dayCost[7];
+        double weekCost = 0.0;
+        for (int d = 0; d < 7; d++) {
+            dayCost[d] = cappedCost(tariffClass, start + (long long)d * MINUTES_PER_DAY, MINUTES_PER_DAY);
+            weekCost += dayCost[d];
+        }
+
+        fee = (days / 7) * weekCost;
+        for (long long d = 0; d < days % 7; d++) {
+            fee += dayCost[d];
+        }
+        if (rest > 0) {
+            fee += cappedCost(tariffClass, start + days * MINUTES_PER_DAY, rest);
+        }
+    }
+
+    // 按分取整
+    return round(fee * 100.0) / 100.0;
+}
@@ -0,0 +1,41 @@
+#ifndef TARIFF_H
+#define TARIFF_H
+
+#include "parking.h"
+
+#define MINUTES_PER_DAY  1440
+#define MINUTES_PER_WEEK 10080
+
+// 车辆类别（由车牌号推断）
+typedef enum {
+    VEHICLE_STANDARD = 0,     // 普通车辆
+    VEHICLE_NEW_ENERGY = 1,   // 新能源车辆（地区字母后为6位）
+    VEHICLE_CLASS_COUNT
+} VehicleClass;
+
+// 单个车辆类别的计费规则（加载时编译为按周分钟的前缀和表）
+typedef struct {
+    double *prefix;       // prefix[m]：一周内第[0, m)分钟的小时费率之和，长度MINUTES_PER_WEEK+1
+    int freeMinutes;      // 免费时长（分钟），计费从免费时长结束后开始
+    int billingUnit;      // 计费单位（分钟），计费时长向上取整到该单位
+    double dailyCap;      // 每24小时封顶金额（<=0表示不封顶）
+} TariffClass;
+
+// 收费方案
+typedef struct Tariff {
+    TariffClass classes[VEHICLE_CLASS_COUNT];
+    double flatRate;      // 统一费率方案的每小时费率（按时段计费时为0）
+    char description[64]; // 方案说明，用于收费单和帮助信息
+} Tariff;
+
+// 方案管理
+int initFlatTariff(Tariff *tariff, double hourlyRate);
+bool loadTariff(Tariff *tariff, const char *path, double defaultRate);
+void freeTariff(Tariff *tariff);
+
+// 计费
+VehicleClass classifyVehicle(const char *plateNumber);
+VehicleClass classifyPlate(PackedPlate plate);
+double tariffPrice(const Tariff *tariff, VehicleClass vehicleClass, time_t arriveTime, time_t leaveTime);
+
+#endif /* TARIFF_H */
@@ -0,0 +1,307 @@
+#include "timer_wheel.h"
+
+#define SLOT_MASK ((uint64_t)TIMER_WHEEL_SLOTS - 1)
+#define WHEEL_SPAN ((uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) // 最高层能表示的最远距离
+
+// 最低位的1所在的位置（x不能为0）
+static int lowestSetBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// 初始化时间轮，节点池和哈希桶按预计的计时器数分配
+int initTimerWheel(TimerWheel *wheel, time_t now, int expectedTimers) {
+    memset(wheel, 0, sizeof(TimerWheel));
+    uint32_t capacity = 16;
+    while (capacity < (uint32_t)expectedTimers && capacity < (1u << 30)) {
+        capacity *= 2;
+    }
+    wheel->nodes = (TimerNode *)malloc(capacity * sizeof(TimerNode));
+    wheel->buckets = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    if (wheel->nodes == NULL || wheel->buckets == NULL) {
+        printf("内存分配失败！\n");
+        free(wheel->nodes);
+        free(wheel->buckets);
+        wheel->nodes = NULL;
+        wheel->buckets = NULL;
+        return ERR_MEMORY;
+    }
+    wheel->nodeCapacity = capacity;
+    wheel->bucketCount = capacity;
+    wheel->now = now;
+    clearTimerWheel(wheel);
+    return SUCCESS;
+}
+
+// 释放时间轮
+void freeTimerWheel(TimerWheel *wheel) {
+    free(wheel->nodes);
+    free(wheel->buckets);
+    wheel->nodes = NULL;
+    wheel->buckets = NULL;
+    wheel->nodeCapacity = 0;
+    wheel->bucketCount = 0;
+    wheel->count = 0;
+}
+
+// 删除全部计时器（保留已分配的内存、当前时间和设置）
+void clearTimerWheel(TimerWheel *wheel) {
+    for (uint32_t i = 0; i < wheel->nodeCapacity; i++) {
+        wheel->nodes[i].active = 0;
+        wheel->nodes[i].hashNext = i + 1 < wheel->nodeCapacity ? i + 1 : TIMER_NONE;
+    }
+    wheel->freeList = wheel->nodeCapacity > 0 ? 0 : TIMER_NONE;
+    for (uint32_t i = 0; i < wheel->bucketCount; i++) {
+        wheel->buckets[i] = TIMER_NONE;
+    }
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            wheel->slots[level][slot] = TIMER_NONE;
+        }
+        wheel->occupied[level] = 0;
+    }
+    wheel->count = 0;
+}
+
+// ---- 槽链表 ----
+
+// 按到期时间放入对应的层和槽。fireNow 为true时（级联中）到期时间等于当前时间的放入当前槽，
+// 随后立即触发；否则当前秒已处理过，放入下一秒的槽。
+static void placeNode(TimerWheel *wheel, uint32_t id, bool fireNow) {
+    TimerNode *node = &wheel->nodes[id];
+    uint64_t now = (uint64_t)wheel->now;
+    uint64_t expires = (uint64_t)node->expires;
+    if (expires < now || (expires == now && !fireNow)) {
+        expires = now + 1;
+    }
+    if (expires - now >= WHEEL_SPAN) {
+        expires = now + WHEEL_SPAN - 1; // 超出范围的先放在最远处，到时重新放置
+    }
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && expires - now >= ((uint64_t)1 << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (int)((expires >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK);
+
+    node->level = (uint8_t)level;
+    node->slot = (uint8_t)slot;
+    node->prev = TIMER_NONE;
+    node->next = wheel->slots[level][slot];
+    if (node->next != TIMER_NONE) {
+        wheel->nodes[node->next].prev = id;
+    }
+    wheel->slots[level][slot] = id;
+    wheel->occupied[level] |= (uint64_t)1 << slot;
+}
+
+// 从所在的槽中摘下
+static void unlinkNode(TimerWheel *wheel, uint32_t id) {
+    TimerNode *node = &wheel->nodes[id];
+    if (node->prev != TIMER_NONE) {
+        wheel->nodes[node->prev].next = node->next;
+    } else {
+        wheel->slots[node->level][node->slot] = node->next;
+        if (node->next == TIMER_NONE) {
+            wheel->occupied[node->level] &= ~((uint64_t)1 << node->slot);
+        }
+    }
+    if (node->next != TIMER_NONE) {
+        wheel->nodes[node->next].prev = node->prev;
+    }
+}
+
+// ---- 哈希表和节点池 ----
+
+static uint32_t bucketOf(const TimerWheel *wheel, PackedPlate plate) {
+    return hashPackedPlate(plate) & (wheel->bucketCount - 1);
+}
+
+// 查找车牌号和类型对应的节点
+static uint32_t findNode(const TimerWheel *wheel, PackedPlate plate, TimerKind kind) {
+    uint32_t id = wheel->buckets[bucketOf(wheel, plate)];
+    while (id != TIMER_NONE) {
+        const TimerNode *node = &wheel->nodes[id];
+        if (node->plate == plate && node->kind == kind) {
+            return id;
+        }
+        id = node->hashNext;
+    }
+    return TIMER_NONE;
+}
+
+// 从哈希桶中摘下节点并放回空闲链表
+static void releaseNode(TimerWheel *wheel, uint32_t id) {
+    TimerNode *node = &wheel->nodes[id];
+    uint32_t *link = &wheel->buckets[bucketOf(wheel, node->plate)];
+    while (*link != id) {
+        link = &wheel->nodes[*link].hashNext;
+    }
+    *link = node->hashNext;
+    node->active = 0;
+    node->hashNext = wheel->freeList;
+    wheel->freeList = id;
+    wheel->count--;
+}
+
+// 节点池和哈希桶倍增（节点编号不变，只重建哈希链）
+static int growWheel(TimerWheel *wheel) {
+    uint32_t capacity = wheel->nodeCapacity * 2;
+    TimerNode *nodes = (TimerNode *)realloc(wheel->nodes, capacity * sizeof(TimerNode));
+    if (nodes == NULL) {
+        printf("内存分配失败！\n");
+        return ERR_MEMORY;
+    }
+    wheel->nodes = nodes;
+    uint32_t *buckets = (uint32_t *)realloc(wheel->buckets, capacity * sizeof(uint32_t));
+    if (buckets == NULL) {
+        printf("内存分配失败！\n");
+        return ERR_MEMORY;
+    }
+    wheel->buckets = buckets;
+
+    for (uint32_t i = wheel->nodeCapacity; i < capacity; i++) {
+        nodes[i].active = 0;
+        nodes[i].hashNext = i + 1 < capacity ? i + 1 : wheel->freeList;
+    }
+    wheel->freeList = wheel->nodeCapacity;
+    wheel->nodeCapacity = capacity;
+    wheel->bucketCount = capacity;
+    for (uint32_t i = 0; i < capacity; i++) {
+        buckets[i] = TIMER_NONE;
+    }
+    for (uint32_t i = 0; i < wheel->nodeCapacity; i++) {
+        if (nodes[i].active) {
+            uint32_t *head = &buckets[bucketOf(wheel, nodes[i].plate)];
+            nodes[i].hashNext = *head;
+            *head = i;
+        }
+    }
+    return SUCCESS;
+}
+
+// ---- 设置和取消 ----
+
+int timerWheelArm(TimerWheel *wheel, PackedPlate plate, TimerKind kind, time_t expires) {
+    uint32_t id = findNode(wheel, plate, kind);
+    if (id != TIMER_NONE) {
+        unlinkNode(wheel, id);
+    } else {
+        if (wheel->freeList == TIMER_NONE && growWheel(wheel) != SUCCESS) {
+            return ERR_MEMORY;
+        }
+        id = wheel->freeList;
+        TimerNode *node = &wheel->nodes[id];
+        wheel->freeList = node->hashNext;
+        node->plate = plate;
+        node->kind = (uint8_t)kind;
+        node->active = 1;
+        uint32_t *head = &wheel->buckets[bucketOf(wheel, plate)];
+        node->hashNext = *head;
+        *head = id;
+        wheel->count++;
+    }
+    wheel->nodes[id].expires = expires;
+    placeNode(wheel, id, false);
+    return SUCCESS;
+}
+
+bool timerWheelCancel(TimerWheel *wheel, PackedPlate plate, TimerKind kind) {
+    uint32_t id = findNode(wheel, plate, kind);
+    if (id == TIMER_NONE) {
+        return false;
+    }
+    unlinkNode(wheel, id);
+    releaseNode(wheel, id);
+    return true;
+}
+
+void timerWheelCancelAll(TimerWheel *wheel, PackedPlate plate) {
+    uint32_t id = wheel->buckets[bucketOf(wheel, plate)];
+    while (id != TIMER_NONE) {
+        uint32_t next = wheel->nodes[id].hashNext;
+        if (wheel->nodes[id].plate == plate) {
+            unlinkNode(wheel, id);
+            releaseNode(wheel, id);
+        }
+        id = next;
+    }
+}
+
+// ---- 推进 ----
+
+// 把高层的一个槽整体按剩余时间重新放入低层
+static void cascade(TimerWheel *wheel, int level, int slot) {
+    uint32_t id = wheel->slots[level][slot];
+    wheel->slots[level][slot] = TIMER_NONE;
+    wheel->occupied[level] &= ~((uint64_t)1 << slot);
+    while (id != TIMER_NONE) {
+        uint32_t next = wheel->nodes[id].next;
+        placeNode(wheel, id, true);
+        id = next;
+    }
+}
+
+// 触发第0层当前槽中的计时器
+static int fireSlot(TimerWheel *wheel, int slot) {
+    int fired = 0;
+    while (wheel->slots[0][slot] != TIMER_NONE) {
+        uint32_t id = wheel->slots[0][slot];
+        TimerNode *node = &wheel->nodes[id];
+        unlinkNode(wheel, id);
+        if (node->expires > wheel->now) {
+            placeNode(wheel, id, false); // 超出范围时放在最远处的计时器，还没到期
+            continue;
+        }
+        TimerKind kind = (TimerKind)node->kind;
+        PackedPlate plate = node->plate;
+        time_t expires = node->expires;
+        releaseNode(wheel, id);
+        wheel->fired[kind]++;
+        fired++;
+        if (wheel->callback != NULL) {
+            wheel->callback(wheel->context, kind, plate, expires);
+        }
+    }
+    return fired;
+}
+
+int timerWheelAdvance(TimerWheel *wheel, time_t now) {
+    int fired = 0;
+    while (wheel->now < now) {
+        if (wheel->count == 0) {
+            wheel->now = now;
+            break;
+        }
+        // 下一个要处理的时刻：本轮第0层中下一个非空槽，或下一轮的起点（需要级联）
+        uint64_t current = (uint64_t)wheel->now;
+        uint64_t offset = current & SLOT_MASK;
+        uint64_t ahead = offset == SLOT_MASK ? 0 : wheel->occupied[0] & (~(uint64_t)0 << (offset + 1));
+        uint64_t next = current - offset + (ahead != 0 ? (uint64_t)lowestSetBit(ahead) : TIMER_WHEEL_SLOTS);
+        if (next > (uint64_t)now) {
+            wheel->now = now;
+            break;
+        }
+        wheel->now = (time_t)next;
+
+        if ((next & SLOT_MASK) == 0) {
+            for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                int slot = (int)((next >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK);
+                cascade(wheel, level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+        fired += fireSlot(wheel, (int)(next & SLOT_MASK));
+    }
+    return fired;
+}
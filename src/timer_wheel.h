@@ -0,0 +1,71 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "parking.h"
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS) // 每层64个槽
+#define TIMER_WHEEL_LEVELS 4                       // 第k层每槽 64^k 秒，共覆盖 64^4 秒（约194天）
+#define TIMER_NONE UINT32_MAX
+
+// 计时器类型（每辆车每种类型最多一个）
+typedef enum {
+    TIMER_MAX_STAY = 0,      // 停车超过最长时长
+    TIMER_GRACE_END = 1,     // 免费时长结束
+    TIMER_LANE_TIMEOUT = 2,  // 在便道等候超过时限
+    TIMER_KIND_COUNT
+} TimerKind;
+
+// 到期回调：在推进时钟的线程中调用，可以在回调中设置或取消计时器
+typedef void (*TimerCallback)(void *context, TimerKind kind, PackedPlate plate, time_t expires);
+
+// 计时器节点（32字节），按编号存放在节点池中
+typedef struct {
+    PackedPlate plate;
+    time_t expires;
+    uint32_t next;          // 所在槽的双向链表
+    uint32_t prev;
+    uint32_t hashNext;      // 同一哈希桶中的下一个节点；空闲节点用它串成空闲链表
+    uint8_t kind;           // TimerKind
+    uint8_t level;          // 所在的层和槽
+    uint8_t slot;
+    uint8_t active;
+} TimerNode;
+
+// 分层时间轮：第0层每槽1秒，第k层每槽覆盖 64^k 秒。到期时间相对当前时间越远，放在越高的层，
+// 推进到高层槽的起点时把其中的计时器按剩余时间重新放入低层（级联）。设置、取消都是O(1)；
+// 推进时每64秒最多做一次级联，空槽用占用位图一次跳过，与计时器数量无关。
+// 车牌号和类型到节点的哈希表（链地址法）使离场、补位时按车牌取消也是O(1)。
+typedef struct TimerWheel {
+    TimerNode *nodes;                  // 节点池（按需倍增）
+    uint32_t nodeCapacity;
+    uint32_t freeList;                 // 空闲节点链表
+    uint32_t count;                    // 使用中的计时器数
+    uint32_t *buckets;                 // 哈希桶（2的幂），存放链表头节点编号
+    uint32_t bucketCount;
+    uint32_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t occupied[TIMER_WHEEL_LEVELS]; // 各层非空槽的位图
+    time_t now;                        // 已推进到的时间（该秒的计时器已触发）
+
+    int maxStaySeconds;                // 最长停车时长（0表示不设）
+    int laneTimeoutSeconds;            // 便道最长等候时间（0表示不设）
+    bool graceAlerts;                  // 收费方案有免费时长时提示免费时长结束
+    TimerCallback callback;            // 到期回调（为NULL时只计数）
+    void *context;
+    long fired[TIMER_KIND_COUNT];      // 各类型已触发的次数
+} TimerWheel;
+
+// 时间轮管理
+int initTimerWheel(TimerWheel *wheel, time_t now, int expectedTimers);
+void freeTimerWheel(TimerWheel *wheel);
+void clearTimerWheel(TimerWheel *wheel);
+
+// 设置计时器（同一车牌同一类型已有计时器时改为新的到期时间）；到期时间不晚于当前时间的在下一次推进时触发
+int timerWheelArm(TimerWheel *wheel, PackedPlate plate, TimerKind kind, time_t expires);
+bool timerWheelCancel(TimerWheel *wheel, PackedPlate plate, TimerKind kind);
+void timerWheelCancelAll(TimerWheel *wheel, PackedPlate plate);
+
+// 推进到指定时间，依次触发到期的计时器，返回触发的数量（时间不晚于当前时间时不做任何事）
+int timerWheelAdvance(TimerWheel *wheel, time_t now);
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,259 @@
+#include "traffic.h"
+#include <math.h>
+
+// 合成车流：按泊松过程生成到达，车辆进入停车场后按停车时长分布安排离开。
+// 所有随机数都来自同一个由种子初始化的生成器，不读取系统时间，结果完全可复现。
+
+#define PLATE_TAIL_SPACE 45435424ULL // 34^5，车牌后5位的组合数
+
+static const char *provinces[] = {
+    "京", "津", "沪", "渝", "冀", "豫", "云", "辽", "黑", "湘", "皖",
+    "鲁", "新", "苏", "浙", "赣", "鄂", "桂", "甘", "晋", "蒙", "陕",
+    "吉", "闽", "贵", "粤", "青", "藏", "川", "宁", "琼"
+};
+#define PROVINCE_COUNT ((int)(sizeof(provinces) / sizeof(provinces[0])))
+
+// 车牌中使用的字母数字（不含容易与数字混淆的I和O）
+static const char plateChars[] = "0123456789ABCDEFGHJKLMNPQRSTUVWXYZ";
+static const char *plateLetters = plateChars + 10;
+
+// 默认车流配置
+void initTrafficConfig(TrafficConfig *config) {
+    config->seed = 1;
+    config->vehicles = 10000;
+    config->arrivalsPerHour = 120.0;
+    config->rushFactor = 1.0;
+    config->dwell = DWELL_LOGNORMAL;
+    config->dwellMeanMinutes = 90.0;
+    config->dwellSigma = 1.0;
+    config->newEnergyShare = 0.2;
+
+    // 2024-01-01 00:00（本地时间）
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = 2024 - 1900;
+    tm.tm_mday = 1;
+    tm.tm_isdst = -1;
+    config->startTime = mktime(&tm);
+}
+
+// 解析停车时长分布名称
+bool parseDwellDistribution(const char *name, DwellDistribution *dwell) {
+    if (strcmp(name, "exp") == 0 || strcmp(name, "exponential") == 0) {
+        *dwell = DWELL_EXPONENTIAL;
+    } else if (strcmp(name, "lognormal") == 0) {
+        *dwell = DWELL_LOGNORMAL;
+    } else if (strcmp(name, "uniform") == 0) {
+        *dwell = DWELL_UNIFORM;
+    } else if (strcmp(name, "fixed") == 0) {
+        *dwell = DWELL_FIXED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 64位随机数（splitmix64）
+uint64_t trafficRandom(TrafficGenerator *gen) {
+    uint64_t z = (gen->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// [0, 1) 均匀分布
+double trafficUniform(TrafficGenerator *gen) {
+    return (double)(trafficRandom(gen) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// 标准正态分布（Box-Muller）
+static double standardNormal(TrafficGenerator *gen) {
+    double u1 = 1.0 - trafficUniform(gen);
+    double u2 = trafficUniform(gen);
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+// 按配置的分布抽取一次停车时长（秒，至少1分钟）
+static long drawDwellSeconds(TrafficGenerator *gen) {
+    double mean = gen->config.dwellMeanMinutes;
+    double minutes;
+    switch (gen->config.dwell) {
+        case DWELL_EXPONENTIAL:
+            minutes = -mean * log(1.0 - trafficUniform(gen));
+            break;
+        case DWELL_LOGNORMAL: {
+            // 取 mu 使分布的均值等于配置的平均时长
+            double sigma = gen->config.dwellSigma;
+            double mu = log(mean) - sigma * sigma / 2.0;
+            minutes = exp(mu + sigma * standardNormal(gen));
+            break;
+        }
+        case DWELL_UNIFORM:
+            minutes = 2.0 * mean * trafficUniform(gen);
+            break;
+        default:
+            minutes = mean;
+            break;
+    }
+    long seconds = lround(minutes * 60.0);
+    return seconds < 60 ? 60 : seconds;
+}
+
+// 距开始时刻t秒时的到达率（辆/秒）
+static double arrivalRate(const TrafficConfig *config, double t) {
+    double rate = config->arrivalsPerHour / 3600.0;
+    int hour = (int)fmod(t / 3600.0, 24.0);
+    if ((hour >= 7 && hour < 9) || (hour >= 17 && hour < 19)) {
+        rate *= config->rushFactor;
+    }
+    return rate;
+}
+
+// 抽取下一次到达时间（非齐次泊松过程，稀疏化方法）
+static void advanceArrival(TrafficGenerator *gen) {
+    const TrafficConfig *config = &gen->config;
+    double maxRate = config->arrivalsPerHour / 3600.0 * (config->rushFactor > 1.0 ? config->rushFactor : 1.0);
+    while (1) {
+        gen->nextArrival += -log(1.0 - trafficUniform(gen)) / maxRate;
+        if (trafficUniform(gen) * maxRate < arrivalRate(config, gen->nextArrival)) {
+            return;
+        }
+    }
+}
+
+// 生成第serial辆车的车牌号：后5位由序号经一一映射得到，保证不重复
+static void makeTrafficPlate(TrafficGenerator *gen, long serial, char *buffer) {
+    const char *province = provinces[trafficRandom(gen) % PROVINCE_COUNT];
+    char letter = plateLetters[trafficRandom(gen) % 24];
+    bool newEnergy = trafficUniform(gen) < gen->config.newEnergyShare;
+
+    // 乘数与34^5互素，序号不同则后5位不同
+    uint64_t code = ((uint64_t)serial * 2654435761ULL + gen->config.seed) % PLATE_TAIL_SPACE;
+    char tail[6];
+    for (int k = 4; k >= 0; k--) {
+        tail[k] = plateChars[code % 34];
+        code /= 34;
+    }
+    tail[5] = '\0';
+
+    if (newEnergy) {
+        // 新能源车牌：地区字母后为D或F加5位
+        snprintf(buffer, MAX_PLATE_LEN, "%s%c%c%s", province, letter, (trafficRandom(gen) & 1) ? 'D' : 'F', tail);
+    } else {
+        snprintf(buffer, MAX_PLATE_LEN, "%s%c%s", province, letter, tail);
+    }
+}
+
+// 初始化生成器
+int initTrafficGenerator(TrafficGenerator *gen, const TrafficConfig *config) {
+    memset(gen, 0, sizeof(TrafficGenerator));
+    gen->config = *config;
+    gen->state = config->seed;
+    if (gen->config.vehicles > (long)PLATE_TAIL_SPACE) {
+        gen->config.vehicles = (long)PLATE_TAIL_SPACE;
+    }
+    if (gen->config.arrivalsPerHour <= 0) {
+        gen->config.vehicles = 0;
+    } else {
+        advanceArrival(gen);
+    }
+    return SUCCESS;
+}
+
+// 释放生成器
+void freeTrafficGenerator(TrafficGenerator *gen) {
+    free(gen->departures);
+    gen->departures = NULL;
+    gen->departureCount = 0;
+    gen->departureCapacity = 0;
+}
+
+// 堆中a是否应排在b之前
+static bool departsBefore(const TrafficDeparture *a, const TrafficDeparture *b) {
+    return a->time < b->time || (a->time == b->time && a->order < b->order);
+}
+
+// 安排车辆在进入停车场后按停车时长分布离开
+int scheduleDeparture(TrafficGenerator *gen, const char *plateNumber, time_t enterTime) {
+    if (gen->departureCount == gen->departureCapacity) {
+        int capacity = gen->departureCapacity < 16 ? 16 : gen->departureCapacity * 2;
+        TrafficDeparture *departures = (TrafficDeparture *)realloc(gen->departures, (size_t)capacity * sizeof(TrafficDeparture));
+        if (departures == NULL) {
+            printf("内存分配失败！\n");
+            return ERR_MEMORY;
+        }
+        gen->departures = departures;
+        gen->departureCapacity = capacity;
+    }
+
+    TrafficDeparture item;
+    item.time = enterTime + (time_t)drawDwellSeconds(gen);
+    item.order = gen->departureOrder++;
+    strncpy(item.plateNumber, plateNumber, MAX_PLATE_LEN - 1);
+    item.plateNumber[MAX_PLATE_LEN - 1] = '\0';
+
+    // 上浮
+    int i = gen->departureCount++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!departsBefore(&item, &gen->departures[parent])) {
+            break;
+        }
+        gen->departures[i] = gen->departures[parent];
+        i = parent;
+    }
+    gen->departures[i] = item;
+    return SUCCESS;
+}
+
+// 取出最早离开的车辆
+static TrafficDeparture popDeparture(TrafficGenerator *gen) {
+    TrafficDeparture first = gen->departures[0];
+    TrafficDeparture last = gen->departures[--gen->departureCount];
+
+    // 下沉
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= gen->departureCount) {
+            break;
+        }
+        if (child + 1 < gen->departureCount && departsBefore(&gen->departures[child + 1], &gen->departures[child])) {
+            child++;
+        }
+        if (!departsBefore(&gen->departures[child], &last)) {
+            break;
+        }
+        gen->departures[i] = gen->departures[child];
+        i = child;
+    }
+    if (gen->departureCount > 0) {
+        gen->departures[i] = last;
+    }
+    return first;
+}
+
+// 按时间顺序生成下一个事件（同一时刻先离开后到达），车流结束时返回false
+bool nextTrafficEvent(TrafficGenerator *gen, TrafficEvent *event) {
+    bool canArrive = gen->arrived < gen->config.vehicles;
+    time_t arriveTime = gen->config.startTime + (time_t)gen->nextArrival;
+
+    if (gen->departureCount > 0 && (!canArrive || gen->departures[0].time <= arriveTime)) {
+        TrafficDeparture departure = popDeparture(gen);
+        event->type = TRAFFIC_LEAVE;
+        event->time = departure.time;
+        memcpy(event->plateNumber, departure.plateNumber, MAX_PLATE_LEN);
+        return true;
+    }
+
+    if (!canArrive) {
+        return false;
+    }
+
+    event->type = TRAFFIC_ARRIVE;
+    event->time = arriveTime;
+    makeTrafficPlate(gen, gen->arrived, event->plateNumber);
+    gen->arrived++;
+    advanceArrival(gen);
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+
+#include <stdint.h>
+#include "parking.h"
+
+// 停车时长分布
+typedef enum {
+    DWELL_EXPONENTIAL = 0, // 指数分布
+    DWELL_LOGNORMAL = 1,   // 对数正态分布（大部分短停，少量长停）
+    DWELL_UNIFORM = 2,     // [0, 2×均值] 均匀分布
+    DWELL_FIXED = 3        // 固定时长
+} DwellDistribution;
+
+// 车流配置
+typedef struct {
+    uint64_t seed;               // 随机种子，相同种子生成完全相同的车流
+    long vehicles;               // 到达车辆总数
+    double arrivalsPerHour;      // 平均到达率（辆/小时），到达为泊松过程
+    double rushFactor;           // 早晚高峰（7-9点、17-19点）到达率倍数，1表示全天均匀
+    DwellDistribution dwell;     // 停车时长分布
+    double dwellMeanMinutes;     // 平均停车时长（分钟）
+    double dwellSigma;           // 对数正态分布的形状参数
+    double newEnergyShare;       // 新能源车辆比例
+    time_t startTime;            // 第一天0点（高峰时段按距此时刻的小时数计算）
+} TrafficConfig;
+
+// 事件类型
+typedef enum {
+    TRAFFIC_ARRIVE = 1,   // 车辆到达
+    TRAFFIC_LEAVE = 2     // 车辆离开
+} TrafficEventType;
+
+// 生成的事件
+typedef struct {
+    TrafficEventType type;             // 事件类型
+    time_t time;                       // 事件时间
+    char plateNumber[MAX_PLATE_LEN];   // 车牌号
+} TrafficEvent;
+
+// 待离开车辆（按离开时间排成最小堆）
+typedef struct {
+    time_t time;
+    uint64_t order;                    // 安排顺序，时间相同时保证结果确定
+    char plateNumber[MAX_PLATE_LEN];
+} TrafficDeparture;
+
+// 车流生成器
+typedef struct {
+    TrafficConfig config;
+    uint64_t state;                    // 随机数状态
+    long arrived;                      // 已生成的到达数
+    double nextArrival;                // 下一辆车的到达时间（秒，相对startTime）
+    TrafficDeparture *departures;      // 待离开车辆的最小堆
+    int departureCount;
+    int departureCapacity;
+    uint64_t departureOrder;
+} TrafficGenerator;
+
+// 配置
+void initTrafficConfig(TrafficConfig *config);
+bool parseDwellDistribution(const char *name, DwellDistribution *dwell);
+
+// 生成器
+int initTrafficGenerator(TrafficGenerator *gen, const TrafficConfig *config);
+void freeTrafficGenerator(TrafficGenerator *gen);
+bool nextTrafficEvent(TrafficGenerator *gen, TrafficEvent *event);
+int scheduleDeparture(TrafficGenerator *gen, const char *plateNumber, time_t enterTime);
+
+// 随机数
+uint64_t trafficRandom(TrafficGenerator *gen);
+double trafficUniform(TrafficGenerator *gen);
+
+#endif /* TRAFFIC_H */
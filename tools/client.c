@@ -0,0 +1,303 @@
+#include "../src/server.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// 服务模式的命令行客户端
+//
+// 默认模式：从标准输入读取请求行，连续发送（不等待响应），把响应逐行打印到标准输出：
+//   printf 'PARK 京A12345\nQUERY 京A12345\nLEAVE 京A12345\nSTATS\n' | client
+//
+// 压测模式（--bench）：多个连接并发，每个连接每轮发送一批请求（流水线深度）后再读取整批响应，
+// 交替让一批车辆进场、离场；输出吞吐量和每轮往返时间的p50/p99。
+//
+// 用法: client [--socket 路径] [--bench] [--connections N] [--pipeline N] [--rounds N] [--facilities N] [--json]
+
+static const char *socketPath = SERVER_SOCKET_FILE;
+static int connectionCount = 4;
+static int pipelineDepth = 32;
+static int rounds = 2000;
+static int facilityCount = 1;
+
+typedef struct {
+    int id;
+    double *roundTrips;      // 每轮往返时间（秒）
+    long okCount;
+    long errorCount;
+    bool failed;             // 连接出错或响应缺失
+} BenchConnection;
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connectServer(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", socketPath);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool writeAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+// 默认模式：标准输入和套接字双向转发，直到所有请求都收到响应
+static int runPipe(void) {
+    int fd = connectServer();
+    if (fd < 0) {
+        fprintf(stderr, "无法连接 %s：%s\n", socketPath, strerror(errno));
+        return 1;
+    }
+
+    long sent = 0;
+    long received = 0;
+    bool inputDone = false;
+    char line[SERVER_MAX_LINE];
+    char buffer[65536];
+    size_t buffered = 0;
+    struct pollfd fds[2];
+
+    while (!inputDone || received < sent) {
+        int n = 0;
+        fds[n].fd = fd;
+        fds[n].events = POLLIN;
+        n++;
+        if (!inputDone) {
+            fds[n].fd = STDIN_FILENO;
+            fds[n].events = POLLIN;
+            n++;
+        }
+        if (poll(fds, (nfds_t)n, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (!inputDone && fds[1].revents) {
+            if (fgets(line, sizeof(line), stdin) == NULL) {
+                inputDone = true;
+            } else {
+                size_t length = strlen(line);
+                if (length == 0 || line[length - 1] != '\n') {
+                    line[length++] = '\n';
+                }
+                // 空行服务端不响应，不计入等待的数量
+                if (length > 1 && !writeAll(fd, line, length)) {
+                    break;
+                }
+                sent += length > 1;
+            }
+        }
+
+        if (fds[0].revents) {
+            ssize_t got = read(fd, buffer + buffered, sizeof(buffer) - buffered);
+            if (got <= 0) {
+                break;
+            }
+            buffered += (size_t)got;
+            size_t start = 0;
+            char *newline;
+            while ((newline = memchr(buffer + start, '\n', buffered - start)) != NULL) {
+                size_t end = (size_t)(newline - buffer) + 1;
+                fwrite(buffer + start, 1, end - start, stdout);
+                start = end;
+                received++;
+            }
+            memmove(buffer, buffer + start, buffered - start);
+            buffered -= start;
+        }
+    }
+    fflush(stdout);
+    close(fd);
+    if (received < sent) {
+        fprintf(stderr, "连接中断：发送 %ld 个请求，收到 %ld 个响应\n", sent, received);
+        return 1;
+    }
+    return 0;
+}
+
+// 压测连接：每轮发送一批请求，再读取同样数量的响应
+static void *benchMain(void *arg) {
+    BenchConnection *bench = (BenchConnection *)arg;
+    int fd = connectServer();
+    if (fd < 0) {
+        bench->failed = true;
+        return NULL;
+    }
+    char *request = malloc((size_t)pipelineDepth * SERVER_MAX_LINE);
+    char response[65536];
+    if (request == NULL) {
+        bench->failed = true;
+        close(fd);
+        return NULL;
+    }
+    int facility = bench->id % facilityCount;
+
+    for (int round = 0; round < rounds && !bench->failed; round++) {
+        // 偶数轮让这批车辆进场，奇数轮让它们离场
+        size_t length = 0;
+        int batch = round / 2;
+        for (int i = 0; i < pipelineDepth; i++) {
+            int serial = (batch * pipelineDepth + i) % 100000;
+            length += (size_t)snprintf(request + length, SERVER_MAX_LINE, "%s 粤%c%05d %d\n",
+                                       round % 2 == 0 ? "PARK" : "LEAVE", 'A' + bench->id % 26, serial, facility);
+        }
+
+        double start = nowSeconds();
+        if (!writeAll(fd, request, length)) {
+            bench->failed = true;
+            break;
+        }
+        int lines = 0;
+        size_t buffered = 0;
+        while (lines < pipelineDepth) {
+            ssize_t got = read(fd, response + buffered, sizeof(response) - buffered);
+            if (got <= 0) {
+                bench->failed = true;
+                break;
+            }
+            size_t scan = buffered;
+            buffered += (size_t)got;
+            for (size_t k = scan; k < buffered; k++) {
+                if (response[k] == '\n') {
+                    lines++;
+                }
+            }
+            // 统计本次读到的完整响应的结果
+            size_t start = 0;
+            char *newline;
+            while ((newline = memchr(response + start, '\n', buffered - start)) != NULL) {
+                if (strncmp(response + start, "OK", 2) == 0) {
+                    bench->okCount++;
+                } else {
+                    bench->errorCount++;
+                }
+                start = (size_t)(newline - response) + 1;
+            }
+            memmove(response, response + start, buffered - start);
+            buffered -= start;
+        }
+        bench->roundTrips[round] = nowSeconds() - start;
+    }
+
+    free(request);
+    close(fd);
+    return NULL;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int runBench(bool json) {
+    pthread_t *threads = malloc((size_t)connectionCount * sizeof(pthread_t));
+    BenchConnection *benches = calloc((size_t)connectionCount, sizeof(BenchConnection));
+    double *roundTrips = malloc((size_t)connectionCount * rounds * sizeof(double));
+    if (threads == NULL || benches == NULL || roundTrips == NULL) {
+        return 1;
+    }
+
+    double start = nowSeconds();
+    for (int c = 0; c < connectionCount; c++) {
+        benches[c].id = c;
+        benches[c].roundTrips = roundTrips + (size_t)c * rounds;
+        pthread_create(&threads[c], NULL, benchMain, &benches[c]);
+    }
+    long ok = 0;
+    long errors = 0;
+    bool failed = false;
+    for (int c = 0; c < connectionCount; c++) {
+        pthread_join(threads[c], NULL);
+        ok += benches[c].okCount;
+        errors += benches[c].errorCount;
+        failed = failed || benches[c].failed;
+    }
+    double elapsed = nowSeconds() - start;
+
+    long total = (long)connectionCount * rounds;
+    qsort(roundTrips, (size_t)total, sizeof(double), compareDouble);
+    double p50 = roundTrips[total / 2] * 1e6;
+    double p99 = roundTrips[total * 99 / 100] * 1e6;
+    long requests = total * pipelineDepth;
+
+    if (json) {
+        printf("{\"connections\":%d,\"pipeline\":%d,\"requests\":%ld,\"seconds\":%.6f,\"requests_per_sec\":%.0f,"
+               "\"round_trip_p50_us\":%.1f,\"round_trip_p99_us\":%.1f,\"ok\":%ld,\"errors\":%ld}\n",
+               connectionCount, pipelineDepth, requests, elapsed, elapsed > 0 ? requests / elapsed : 0.0,
+               p50, p99, ok, errors);
+    } else {
+        printf("连接 %d 个，流水线深度 %d，共 %ld 个请求，耗时 %.3f 秒，%.0f 请求/秒\n", connectionCount, pipelineDepth,
+               requests, elapsed, elapsed > 0 ? requests / elapsed : 0.0);
+        printf("每轮往返时间 p50 %.1f 微秒，p99 %.1f 微秒；成功 %ld，错误响应 %ld\n", p50, p99, ok, errors);
+    }
+    if (failed) {
+        printf("错误: 有连接中断或无法连接 %s\n", socketPath);
+    }
+
+    free(threads);
+    free(benches);
+    free(roundTrips);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    bool bench = false;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--socket") == 0 && hasValue) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--connections") == 0 && hasValue) {
+            connectionCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pipeline") == 0 && hasValue) {
+            pipelineDepth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rounds") == 0 && hasValue) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--facilities") == 0 && hasValue) {
+            facilityCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            printf("用法: %s [--socket 路径] [--bench] [--connections N] [--pipeline N] [--rounds N] "
+                   "[--facilities N] [--json]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (connectionCount < 1 || pipelineDepth < 1 || pipelineDepth > 200 || rounds < 1 || facilityCount < 1) {
+        printf("参数超出范围（流水线深度1-200）\n");
+        return 1;
+    }
+    return bench ? runBench(json) : runPipe();
+}
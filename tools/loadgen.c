@@ -0,0 +1,352 @@
+#include "../src/parking.h"
+#include "../src/archive.h"
+#include "../src/plate_index.h"
+#include "../src/tariff.h"
+#include "../src/traffic.h"
+
+// 端到端负载测试：用合成车流驱动 parkCarAt / leaveCarAt
+//
+// 车流完全由种子决定（到达、车牌、停车时长），不依赖系统时间；除耗时和延迟外，
+// 同一组参数的每次运行结果都相同。车辆从进入停车场（直接进入或从便道补位）时开始计停车时长。
+//
+// 用法: loadgen [--seed N] [--vehicles N] [--rate 辆/小时] [--rush 倍数]
+//               [--dwell exp|lognormal|uniform|fixed] [--dwell-mean 分钟] [--dwell-sigma S]
+//               [--new-energy 比例] [--capacity N] [--lot-model stack|bays] [--tariff 文件]
+//               [--emit 事件文件] [--archive 目录] [--json]
+//
+// --archive 把离场会话写入会话归档（目录应为空），结束后从归档统计收入，
+// 与内存中的统计核对，并输出归档大小和扫描耗时。
+
+// 延迟样本（纳秒）
+typedef struct {
+    float *samples;
+    long count;
+    long capacity;
+} LatencyLog;
+
+static double nowNanoseconds(void) {
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void recordLatency(LatencyLog *log, double ns) {
+    if (log->count == log->capacity) {
+        long capacity = log->capacity < 1024 ? 1024 : log->capacity * 2;
+        float *samples = (float *)realloc(log->samples, (size_t)capacity * sizeof(float));
+        if (samples == NULL) {
+            return; // 内存不足时丢弃样本，不影响负载本身
+        }
+        log->samples = samples;
+        log->capacity = capacity;
+    }
+    log->samples[log->count++] = (float)ns;
+}
+
+static int compareFloats(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// 百分位数（样本需已排序）
+static double percentile(const LatencyLog *log, double p) {
+    if (log->count == 0) {
+        return 0.0;
+    }
+    long i = (long)(p * (double)(log->count - 1) + 0.5);
+    return log->samples[i];
+}
+
+// 负载测试结果
+typedef struct {
+    long events;
+    long arrivals;
+    long queued;
+    long duplicates;
+    long departures;
+    long notFound;
+    long promotions;
+    int peakQueue;
+    int peakOccupancy;
+    double elapsed;       // 秒
+} LoadSummary;
+
+static void usage(const char *program) {
+    printf("用法: %s [--seed N] [--vehicles N] [--rate 辆/小时] [--rush 倍数]\n"
+           "          [--dwell exp|lognormal|uniform|fixed] [--dwell-mean 分钟] [--dwell-sigma S]\n"
+           "          [--new-energy 比例] [--capacity N] [--lot-model stack|bays] [--tariff 文件]\n"
+           "          [--emit 事件文件] [--archive 目录] [--json]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    TrafficConfig traffic;
+    SystemConfig config;
+    const char *emitPath = NULL;
+    const char *archiveDir = NULL;
+    bool json = false;
+
+    initTrafficConfig(&traffic);
+    initSystem(&config, NULL);
+    config.parkingCapacity = 200;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--seed") == 0 && hasValue) {
+            traffic.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--vehicles") == 0 && hasValue) {
+            traffic.vehicles = atol(argv[++i]);
+        } else if (strcmp(arg, "--rate") == 0 && hasValue) {
+            traffic.arrivalsPerHour = atof(argv[++i]);
+        } else if (strcmp(arg, "--rush") == 0 && hasValue) {
+            traffic.rushFactor = atof(argv[++i]);
+        } else if (strcmp(arg, "--dwell") == 0 && hasValue) {
+            if (!parseDwellDistribution(argv[++i], &traffic.dwell)) {
+                printf("未知的停车时长分布: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--dwell-mean") == 0 && hasValue) {
+            traffic.dwellMeanMinutes = atof(argv[++i]);
+        } else if (strcmp(arg, "--dwell-sigma") == 0 && hasValue) {
+            traffic.dwellSigma = atof(argv[++i]);
+        } else if (strcmp(arg, "--new-energy") == 0 && hasValue) {
+            traffic.newEnergyShare = atof(argv[++i]);
+        } else if ((strcmp(arg, "--capacity") == 0 || strcmp(arg, "-c") == 0) && hasValue) {
+            config.parkingCapacity = atoi(argv[++i]);
+            if (config.parkingCapacity < 1 || config.parkingCapacity > MAX_CAPACITY) {
+                printf("无效的停车场容量: %s（1-%d）\n", argv[i], MAX_CAPACITY);
+                return 1;
+            }
+        } else if (strcmp(arg, "--lot-model") == 0 && hasValue) {
+            if (!parseLotModel(argv[++i], &config.lotModel)) {
+                printf("未知的停车场模型: %s（可选 stack/bays）\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--tariff") == 0 && hasValue) {
+            snprintf(config.tariffPath, sizeof(config.tariffPath), "%s", argv[++i]);
+        } else if (strcmp(arg, "--emit") == 0 && hasValue) {
+            emitPath = argv[++i];
+        } else if (strcmp(arg, "--archive") == 0 && hasValue) {
+            archiveDir = argv[++i];
+        } else if (strcmp(arg, "--json") == 0) {
+            json = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // 收费方案
+    Tariff tariff;
+    if (config.tariffPath[0] != '\0') {
+        if (!loadTariff(&tariff, config.tariffPath, config.hourlyRate)) {
+            return 1;
+        }
+    } else if (initFlatTariff(&tariff, config.hourlyRate) != SUCCESS) {
+        return 1;
+    }
+    setActiveTariff(&tariff);
+    setReceiptOutput(false);
+
+    ParkingStack parkingLot, tempLot;
+    WaitingQueue waitingLane;
+    PlateIndex plateIndex;
+    SystemStats stats;
+    TrafficGenerator gen;
+
+    if (initStack(&parkingLot, config.parkingCapacity) != SUCCESS ||
+        setLotModel(&parkingLot, config.lotModel) != SUCCESS ||
+        initStack(&tempLot, config.parkingCapacity) != SUCCESS ||
+        initPlateIndex(&plateIndex, config.parkingCapacity * 2) != SUCCESS ||
+        initTrafficGenerator(&gen, &traffic) != SUCCESS) {
+        return 1;
+    }
+    initQueue(&waitingLane);
+    attachPlateIndex(&parkingLot, &waitingLane, &plateIndex);
+    initSystem(NULL, &stats);
+    stats.startTime = traffic.startTime;
+
+    FILE *emit = NULL;
+    if (emitPath != NULL) {
+        emit = fopen(emitPath, "w");
+        if (emit == NULL) {
+            printf("无法创建事件文件: %s\n", emitPath);
+            return 1;
+        }
+        fprintf(emit, "# loadgen --seed %llu --vehicles %ld --rate %g\n",
+                (unsigned long long)traffic.seed, traffic.vehicles, traffic.arrivalsPerHour);
+    }
+
+    SessionArchive archive;
+    bool archiveWasEmpty = false;
+    if (archiveDir != NULL) {
+        if (openArchive(&archive, archiveDir) != SUCCESS) {
+            printf("无法打开会话归档: %s\n", archiveDir);
+            return 1;
+        }
+        archiveWasEmpty = archive.segmentNumber == 1 && archive.rowCount == 0;
+        parkingLot.archive = &archive;
+    }
+
+    LoadSummary summary;
+    LatencyLog arriveLatency = {0}, leaveLatency = {0}, allLatency = {0};
+    memset(&summary, 0, sizeof(summary));
+
+    TrafficEvent event;
+    char headPlate[MAX_PLATE_LEN];
+    double startClock = nowNanoseconds();
+
+    while (nextTrafficEvent(&gen, &event)) {
+        summary.events++;
+        if (emit != NULL) {
+            fprintf(emit, "%lld,%s,%s\n", (long long)event.time,
+                    event.type == TRAFFIC_ARRIVE ? "ARRIVE" : "LEAVE", event.plateNumber);
+        }
+
+        if (event.type == TRAFFIC_ARRIVE) {
+            bool lotFull = isStackFull(&parkingLot);
+            double t0 = nowNanoseconds();
+            int result = parkCarAt(&parkingLot, &waitingLane, event.plateNumber, &stats, event.time);
+            double ns = nowNanoseconds() - t0;
+            recordLatency(&arriveLatency, ns);
+            recordLatency(&allLatency, ns);
+
+            if (result == SUCCESS) {
+                summary.arrivals++;
+                if (lotFull) {
+                    summary.queued++;
+                } else {
+                    scheduleDeparture(&gen, event.plateNumber, event.time);
+                }
+            } else if (result == ERR_EXISTS) {
+                summary.duplicates++;
+            }
+        } else {
+            // 记下便道队头，离开后若便道变短说明它补位进入了停车场
+            int queued = getQueueCount(&waitingLane);
+            if (queued > 0) {
+                formatPlate(queueAt(&waitingLane, 0)->plate, headPlate, sizeof(headPlate));
+            }
+            double t0 = nowNanoseconds();
+            int result = leaveCarAt(&parkingLot, &tempLot, &waitingLane, event.plateNumber, &stats, event.time);
+            double ns = nowNanoseconds() - t0;
+            recordLatency(&leaveLatency, ns);
+            recordLatency(&allLatency, ns);
+
+            if (result == SUCCESS) {
+                summary.departures++;
+                if (getQueueCount(&waitingLane) < queued) {
+                    summary.promotions++;
+                    scheduleDeparture(&gen, headPlate, event.time);
+                }
+            } else {
+                summary.notFound++;
+            }
+        }
+
+        if (getQueueCount(&waitingLane) > summary.peakQueue) {
+            summary.peakQueue = getQueueCount(&waitingLane);
+        }
+        if (getStackCount(&parkingLot) > summary.peakOccupancy) {
+            summary.peakOccupancy = getStackCount(&parkingLot);
+        }
+    }
+
+    summary.elapsed = (nowNanoseconds() - startClock) / 1e9;
+    if (emit != NULL) {
+        fclose(emit);
+    }
+
+    // 从归档按日汇总收入（只解码时间和费用列），与内存中的统计核对
+    ArchiveReport report;
+    double scanSeconds = 0.0;
+    bool archiveOk = true;
+    memset(&report, 0, sizeof(report));
+    if (archiveDir != NULL) {
+        parkingLot.archive = NULL;
+        closeArchive(&archive);
+        double t0 = nowNanoseconds();
+        archiveOk = archiveReport(archiveDir, 0, 0, &report) == SUCCESS;
+        scanSeconds = (nowNanoseconds() - t0) / 1e9;
+        if (archiveOk && archiveWasEmpty) {
+            archiveOk = report.sessions == summary.departures &&
+                        report.revenueFen == (int64_t)(stats.totalRevenue * 100.0 + 0.5);
+        }
+    }
+
+    qsort(arriveLatency.samples, (size_t)arriveLatency.count, sizeof(float), compareFloats);
+    qsort(leaveLatency.samples, (size_t)leaveLatency.count, sizeof(float), compareFloats);
+    qsort(allLatency.samples, (size_t)allLatency.count, sizeof(float), compareFloats);
+    double throughput = summary.elapsed > 0 ? summary.events / summary.elapsed : 0.0;
+
+    if (json) {
+        printf("{\"seed\":%llu,\"vehicles\":%ld,\"capacity\":%d,\"lot_model\":\"%s\",\"events\":%ld,"
+               "\"arrivals\":%ld,\"queued\":%ld,\"duplicates\":%ld,\"departures\":%ld,\"not_found\":%ld,"
+               "\"promotions\":%ld,\"peak_lane\":%d,\"peak_occupancy\":%d,\"shuffles\":%ld,"
+               "\"revenue\":%.2f,\"elapsed_s\":%.3f,\"events_per_s\":%.0f,"
+               "\"p50_ns\":%.0f,\"p99_ns\":%.0f,\"max_ns\":%.0f,"
+               "\"arrive_p50_ns\":%.0f,\"arrive_p99_ns\":%.0f,\"leave_p50_ns\":%.0f,\"leave_p99_ns\":%.0f",
+               (unsigned long long)traffic.seed, gen.config.vehicles, parkingLot.capacity,
+               config.lotModel == LOT_MODEL_BAYS ? "bays" : "stack", summary.events,
+               summary.arrivals, summary.queued, summary.duplicates, summary.departures, summary.notFound,
+               summary.promotions, summary.peakQueue, summary.peakOccupancy, parkingLot.totalMoves,
+               stats.totalRevenue, summary.elapsed, throughput,
+               percentile(&allLatency, 0.50), percentile(&allLatency, 0.99), percentile(&allLatency, 1.0),
+               percentile(&arriveLatency, 0.50), percentile(&arriveLatency, 0.99),
+               percentile(&leaveLatency, 0.50), percentile(&leaveLatency, 0.99));
+        if (archiveDir != NULL) {
+            printf(",\"archive_sessions\":%ld,\"archive_days\":%d,\"archive_bytes\":%lld,\"archive_scan_ms\":%.3f,"
+                   "\"archive_ok\":%s", report.sessions, report.dayCount, report.bytes, scanSeconds * 1e3,
+                   archiveOk ? "true" : "false");
+        }
+        printf("}\n");
+    } else {
+        printf("随机种子:           %llu\n", (unsigned long long)traffic.seed);
+        printf("停车场:             %d 个车位（%s）\n", parkingLot.capacity,
+               config.lotModel == LOT_MODEL_BAYS ? "独立车位" : "栈");
+        printf("事件数:             %ld\n", summary.events);
+        printf("到达车辆:           %ld（其中进入便道 %ld）\n", summary.arrivals, summary.queued);
+        printf("重复到达:           %ld\n", summary.duplicates);
+        printf("离开车辆:           %ld（便道补位 %ld）\n", summary.departures, summary.promotions);
+        printf("离开时未找到:       %ld\n", summary.notFound);
+        printf("停车场最高占用:     %d\n", summary.peakOccupancy);
+        printf("便道最大等候:       %d\n", summary.peakQueue);
+        printf("挪车次数:           %ld\n", parkingLot.totalMoves);
+        printf("总收入:             %.2f\n", stats.totalRevenue);
+        printf("耗时:               %.3f 秒（%.0f 事件/秒）\n", summary.elapsed, throughput);
+        printf("单事件延迟:         p50 %.0f ns, p99 %.0f ns, 最大 %.0f ns\n",
+               percentile(&allLatency, 0.50), percentile(&allLatency, 0.99), percentile(&allLatency, 1.0));
+        printf("  到达:             p50 %.0f ns, p99 %.0f ns\n",
+               percentile(&arriveLatency, 0.50), percentile(&arriveLatency, 0.99));
+        printf("  离开:             p50 %.0f ns, p99 %.0f ns\n",
+               percentile(&leaveLatency, 0.50), percentile(&leaveLatency, 0.99));
+        if (archiveDir != NULL) {
+            printf("归档会话:           %ld（%d 天，扫描段 %d 个）\n", report.sessions, report.dayCount,
+                   report.segmentsScanned);
+            printf("归档大小:           %lld 字节（每个会话 %.1f 字节）\n", report.bytes,
+                   report.sessions > 0 ? (double)report.bytes / report.sessions : 0.0);
+            printf("归档收入:           %.2f（扫描 %.3f 毫秒）\n", report.revenueFen / 100.0, scanSeconds * 1e3);
+            if (!archiveOk) {
+                printf("错误: 归档与内存统计不一致\n");
+            }
+        }
+    }
+    freeArchiveReport(&report);
+
+    free(arriveLatency.samples);
+    free(leaveLatency.samples);
+    free(allLatency.samples);
+    freeTrafficGenerator(&gen);
+    attachPlateIndex(&parkingLot, &waitingLane, NULL);
+    clearQueue(&waitingLane);
+    freePlateIndex(&plateIndex);
+    freeStack(&parkingLot);
+    freeStack(&tempLot);
+    freeTariff(&tariff);
+    return archiveOk ? 0 : 1;
+}
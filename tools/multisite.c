@@ -0,0 +1,368 @@
+#include "../src/facility_manager.h"
+#include <stdatomic.h>
+
+// 多设施分片吞吐测试
+//
+// 一个进程托管多个设施，设施按编号分配到绑定CPU的分片引擎上。每个道闸线程负责若干设施，
+// 每轮给自己的每个设施各提交一条命令后再统一等待（流水线提交，不同设施的命令并行执行）。
+// 一部分到达使用相邻设施的车牌，用来检验跨设施车牌目录能发现同时出现在两地的车辆。
+// 结束后检查各设施的车辆与道闸记录一致，保存全部设施，再从各自的状态文件重新加载并核对。
+//
+// 用法: multisite [--facilities N] [--shards N] [--gates N] [--capacity N] [--ops N]
+//                 [--cross 百分比] [--lot-model stack|bays] [--state-dir 目录] [--journal]
+//                 [--sweep] [--json] [--seed N]
+
+typedef struct {
+    char (*plates)[MAX_PLATE_LEN];   // 候选车牌：前一半属于本设施，后一半借自相邻设施
+    bool *present;                   // 道闸记录的在场状态
+    int presentCount;
+} SiteState;
+
+static int facilityCount = 16;
+static int gates = 4;
+static int capacity = 256;
+static int platesPerSite;            // 每个设施自己的车牌数量（容量的2倍）
+static long opsPerFacility = 20000;
+static int crossPercent = 2;
+static uint64_t seed = 1;
+
+static FacilityManager manager;
+static SiteState *sites;
+static atomic_long failures;
+static atomic_long elsewhereCount;
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+// 设施 f 的第 i 个车牌：地区字母区分设施，序号在字母内错开
+static void makePlate(char *buffer, int facility, int i) {
+    snprintf(buffer, MAX_PLATE_LEN, "沪%c%05d", 'A' + facility % 26, facility / 26 * platesPerSite + i);
+}
+
+static void fail(const char *message, int facility, const char *plate, int result) {
+    if (atomic_fetch_add(&failures, 1) < 10) {
+        printf("错误: %s（设施 %d，车牌 %s，结果 %d）\n", message, facility, plate, result);
+    }
+}
+
+// 道闸线程：每轮给自己负责的每个设施提交一条命令，然后等待整轮结果
+static void *gateMain(void *arg) {
+    int gate = (int)(intptr_t)arg;
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + (uint64_t)gate + 1;
+    int owned = (facilityCount - gate + gates - 1) / gates;
+    FacilityCommand *commands = calloc((size_t)owned, sizeof(FacilityCommand));
+    int *picked = calloc((size_t)owned, sizeof(int));
+    if (commands == NULL || picked == NULL) {
+        fail("内存分配失败", -1, "-", ERR_MEMORY);
+        free(commands);
+        free(picked);
+        return NULL;
+    }
+
+    for (long op = 0; op < opsPerFacility; op++) {
+        for (int k = 0; k < owned; k++) {
+            int f = gate + k * gates;
+            SiteState *site = &sites[f];
+            FacilityCommand *command = &commands[k];
+            int i = (int)(nextRandom(&state) % (uint64_t)platesPerSite);
+            if ((int)(nextRandom(&state) % 100) < crossPercent) {
+                i += platesPerSite;
+            }
+            // 在场车辆不超过容量的3/4，减少便道上的车辆
+            bool park = site->presentCount * 4 < capacity * 3 && (nextRandom(&state) & 1);
+            memset(command, 0, sizeof(FacilityCommand));
+            command->type = park || !site->present[i] ? FACILITY_PARK : FACILITY_LEAVE;
+            command->time = time(NULL);
+            memcpy(command->plateNumber, site->plates[i], MAX_PLATE_LEN);
+            picked[k] = i;
+            facilitySubmit(managerFacility(&manager, f), command);
+        }
+
+        for (int k = 0; k < owned; k++) {
+            int f = gate + k * gates;
+            SiteState *site = &sites[f];
+            FacilityCommand *command = &commands[k];
+            int i = picked[k];
+            facilityWait(managerFacility(&manager, f), command);
+
+            if (command->type == FACILITY_PARK) {
+                if (site->present[i] ? command->result != ERR_EXISTS : command->result != SUCCESS) {
+                    fail(site->present[i] ? "重复进场没有被拒绝" : "进场失败", f, command->plateNumber,
+                         command->result);
+                }
+                if (command->result == SUCCESS) {
+                    site->present[i] = true;
+                    site->presentCount++;
+                    if (command->elsewhere) {
+                        atomic_fetch_add(&elsewhereCount, 1);
+                    }
+                }
+            } else if (command->result == SUCCESS) {
+                site->present[i] = false;
+                site->presentCount--;
+            }
+        }
+    }
+
+    free(commands);
+    free(picked);
+    return NULL;
+}
+
+// 删除上一次运行留下的状态文件
+static void removeStateFiles(const char *stateDir) {
+    for (int id = 0; id < facilityCount; id++) {
+        char path[300];
+        snprintf(path, sizeof(path), "%s/facility-%d.dat", stateDir, id);
+        remove(path);
+        snprintf(path, sizeof(path), "%s/facility-%d.journal", stateDir, id);
+        remove(path);
+    }
+}
+
+static void check(bool condition, const char *message, int facility) {
+    if (!condition) {
+        atomic_fetch_add(&failures, 1);
+        printf("错误: %s（设施 %d）\n", message, facility);
+    }
+}
+
+// 跑一轮：返回每秒命令数
+static double runOnce(int shardCount, const SystemConfig *config, const char *stateDir,
+                      const JournalConfig *journalConfig, bool json) {
+    removeStateFiles(stateDir);
+    if (initFacilityManager(&manager, facilityCount, shardCount, config, stateDir, journalConfig) != SUCCESS) {
+        atomic_fetch_add(&failures, 1);
+        return 0.0;
+    }
+    for (int f = 0; f < facilityCount; f++) {
+        memset(sites[f].present, 0, (size_t)platesPerSite * 2 * sizeof(bool));
+        sites[f].presentCount = 0;
+    }
+    atomic_store(&elsewhereCount, 0);
+    startFacilityManager(&manager);
+
+    pthread_t *threads = malloc((size_t)gates * sizeof(pthread_t));
+    double start = nowSeconds();
+    for (int g = 0; g < gates; g++) {
+        pthread_create(&threads[g], NULL, gateMain, (void *)(intptr_t)g);
+    }
+    for (int g = 0; g < gates; g++) {
+        pthread_join(threads[g], NULL);
+    }
+    double elapsed = nowSeconds() - start;
+    free(threads);
+
+    // 两个设施同时出现同一车牌时，后进入的一方必须被标记
+    long conflicts = 0;
+    for (int f = 0; f < facilityCount; f++) {
+        conflicts += manager.facilities[f].conflicts;
+    }
+    check(conflicts == atomic_load(&elsewhereCount), "设施记录的重复车牌数与道闸收到的标记不一致", -1);
+
+    saveFacilityManager(&manager);
+    stopFacilityManager(&manager);
+
+    long batches = 0;
+    for (int s = 0; s < manager.shardCount; s++) {
+        batches += manager.shards[s].batches;
+    }
+    int shards = manager.shardCount;
+
+    // 各设施的车辆数与道闸记录一致，并能从自己的状态文件原样恢复
+    int *counts = malloc((size_t)facilityCount * sizeof(int));
+    for (int f = 0; f < facilityCount; f++) {
+        ParkingFacility *facility = &manager.facilities[f];
+        counts[f] = facility->index.count;
+        check(counts[f] == sites[f].presentCount, "设施中的车辆数与道闸记录不一致", f);
+    }
+    freeFacilityManager(&manager);
+
+    if (initFacilityManager(&manager, facilityCount, shardCount, config, stateDir, journalConfig) == SUCCESS) {
+        loadFacilityManager(&manager);
+        for (int f = 0; f < facilityCount; f++) {
+            ParkingFacility *facility = &manager.facilities[f];
+            check(facility->index.count == counts[f], "重新加载后车辆数不一致", f);
+            for (int i = 0; i < platesPerSite * 2; i++) {
+                if (sites[f].present[i] && plateIndexFind(&facility->index, lookupPlate(sites[f].plates[i], MAX_PLATE_LEN - 1)) == NULL) {
+                    fail("重新加载后车辆丢失", f, sites[f].plates[i], 0);
+                }
+            }
+        }
+        freeFacilityManager(&manager);
+    } else {
+        atomic_fetch_add(&failures, 1);
+    }
+    free(counts);
+
+    long commands = (long)facilityCount * opsPerFacility;
+    double rate = elapsed > 0 ? commands / elapsed : 0.0;
+    if (json) {
+        printf("{\"facilities\":%d,\"shards\":%d,\"gates\":%d,\"commands\":%ld,\"seconds\":%.6f,"
+               "\"commands_per_sec\":%.0f,\"batches\":%ld,\"conflicts\":%ld}\n",
+               facilityCount, shards, gates, commands, elapsed, rate, batches, conflicts);
+    } else {
+        printf("分片 %2d  %9ld 条命令  %.3f 秒  %10.0f 命令/秒  平均每批 %.1f 条  重复车牌报警 %ld\n",
+               shards, commands, elapsed, rate, batches > 0 ? (double)commands / batches : 0.0, conflicts);
+    }
+    return rate;
+}
+
+// 车牌目录的基本行为：同一车牌先后进入两个设施时第二次被标记，离开后清除
+static void checkDirectory(const SystemConfig *config, const char *stateDir) {
+    removeStateFiles(stateDir);
+    if (initFacilityManager(&manager, 2, 1, config, stateDir, NULL) != SUCCESS) {
+        atomic_fetch_add(&failures, 1);
+        return;
+    }
+    const char *plate = "沪Z99999";
+    FacilityCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = FACILITY_PARK;
+    strcpy(command.plateNumber, plate);
+    managerExecute(&manager, 0, &command);
+    check(command.result == SUCCESS && !command.elsewhere, "首次进场不应报警", 0);
+    managerExecute(&manager, 1, &command);
+    check(command.result == SUCCESS && command.elsewhere, "同一车牌进入第二个设施应报警", 1);
+
+    int first = -1;
+    check(plateDirectoryLookup(&manager.directory, plate, &first) == 2 && first == 0, "目录应记录两个设施", -1);
+    command.type = FACILITY_LEAVE;
+    managerExecute(&manager, 0, &command);
+    check(plateDirectoryLookup(&manager.directory, plate, &first) == 1 && first == -1,
+          "最先登记的设施离开后目录不应再报告它", -1);
+    managerExecute(&manager, 1, &command);
+    check(plateDirectoryLookup(&manager.directory, plate, NULL) == 0, "离开后目录应清除该车牌", -1);
+    check(managerExecute(&manager, 2, &command) == ERR_NOT_FOUND, "无效的设施编号应返回 ERR_NOT_FOUND", 2);
+    freeFacilityManager(&manager);
+    removeStateFiles(stateDir);
+}
+
+int main(int argc, char *argv[]) {
+    SystemConfig config;
+    JournalConfig journalConfig;
+    const char *stateDir = "multisite_state";
+    int shardCount = 0;
+    bool useJournal = false;
+    bool sweep = false;
+    bool json = false;
+
+    initSystem(&config, NULL);
+    initJournalConfig(&journalConfig);
+    journalConfig.fsyncPolicy = FSYNC_NEVER;
+    journalConfig.groupCommitSize = FACILITY_QUEUE_SIZE;
+    journalConfig.compactThreshold = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--facilities") == 0 && hasValue) {
+            facilityCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--shards") == 0 && hasValue) {
+            shardCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--gates") == 0 && hasValue) {
+            gates = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--capacity") == 0 && hasValue) {
+            capacity = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ops") == 0 && hasValue) {
+            opsPerFacility = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--cross") == 0 && hasValue) {
+            crossPercent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--lot-model") == 0 && hasValue) {
+            if (!parseLotModel(argv[++i], &config.lotModel)) {
+                printf("未知的停车场模型: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--state-dir") == 0 && hasValue) {
+            stateDir = argv[++i];
+        } else if (strcmp(argv[i], "--journal") == 0) {
+            useJournal = true;
+        } else if (strcmp(argv[i], "--sweep") == 0) {
+            sweep = true;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            printf("用法: %s [--facilities N] [--shards N] [--gates N] [--capacity N] [--ops N] [--cross 百分比] "
+                   "[--lot-model stack|bays] [--state-dir 目录] [--journal] [--sweep] [--json] [--seed N]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    platesPerSite = capacity * 2;
+    if (facilityCount < 2 || gates < 1 || gates > facilityCount || capacity < 1 ||
+        crossPercent < 0 || crossPercent > 100 || (long)(facilityCount / 26 + 1) * platesPerSite > 99999) {
+        printf("参数超出范围（至少2个设施，道闸数不超过设施数，车牌序号不超过99999）\n");
+        return 1;
+    }
+    config.parkingCapacity = capacity;
+    setReceiptOutput(false);
+
+    sites = calloc((size_t)facilityCount, sizeof(SiteState));
+    if (sites == NULL) {
+        return 1;
+    }
+    for (int f = 0; f < facilityCount; f++) {
+        sites[f].plates = malloc((size_t)platesPerSite * 2 * sizeof(*sites[f].plates));
+        sites[f].present = calloc((size_t)platesPerSite * 2, sizeof(bool));
+        if (sites[f].plates == NULL || sites[f].present == NULL) {
+            return 1;
+        }
+        for (int i = 0; i < platesPerSite; i++) {
+            makePlate(sites[f].plates[i], f, i);
+            makePlate(sites[f].plates[platesPerSite + i], (f + 1) % facilityCount, i);
+        }
+    }
+
+    checkDirectory(&config, stateDir);
+
+    if (!json) {
+        printf("设施 %d 个（每个 %d 个车位，%s），道闸线程 %d 个，每个设施 %ld 条命令，跨设施车牌 %d%%，CPU %d 个%s\n",
+               facilityCount, capacity, config.lotModel == LOT_MODEL_BAYS ? "独立车位" : "栈", gates,
+               opsPerFacility, crossPercent, onlineCpuCount(), useJournal ? "，写事件日志" : "");
+    }
+    const JournalConfig *journal = useJournal ? &journalConfig : NULL;
+    if (sweep) {
+        // 分片数从1翻倍到CPU数量，观察吞吐随核数的伸缩
+        int maxShards = shardCount > 0 ? shardCount : onlineCpuCount();
+        double base = 0.0;
+        for (int s = 1;; s = s * 2 < maxShards ? s * 2 : maxShards) {
+            double rate = runOnce(s, &config, stateDir, journal, json);
+            if (s == 1) {
+                base = rate;
+            } else if (!json && base > 0) {
+                printf("         相对1个分片的加速比 %.2f\n", rate / base);
+            }
+            if (s == maxShards) {
+                break;
+            }
+        }
+    } else {
+        runOnce(shardCount, &config, stateDir, journal, json);
+    }
+    removeStateFiles(stateDir);
+    remove(stateDir);
+
+    for (int f = 0; f < facilityCount; f++) {
+        free(sites[f].plates);
+        free(sites[f].present);
+    }
+    free(sites);
+
+    long failed = atomic_load(&failures);
+    if (!json) {
+        printf("%s\n", failed == 0 ? "通过" : "失败");
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,415 @@
+#include "../src/facility.h"
+#include <stdatomic.h>
+#include <sched.h>
+
+// 多道闸并发压力测试
+//
+// 多个道闸线程同时向同一个设施提交到达/离开命令，检查：
+//   1. 重复检测：所有道闸同时让同一批车牌进场，每个车牌恰好成功一次；
+//   2. 便道补位：所有道闸同时让车辆离场，直到停车场和便道都清空，离场成功数等于进场数；
+//   3. 混合负载：每个道闸随机进出自己的车辆，结果必须与道闸自己记录的状态一致。
+// 最后核对停车场、便道、索引为空，统计的车辆数和收入与各道闸收到的结果相符。
+//   4. 按批写出日志：所有道闸同时让车辆进入另一个带日志的设施，日志写出次数等于引擎批次数；
+//   5. 日志写出失败：把该设施的日志文件换成 /dev/full，所有道闸的进场都不能报告成功。
+//
+// 用法: stress [--gates N] [--capacity N] [--plates N] [--ops N] [--lot-model stack|bays]
+//              [--journal 日志文件] [--seed N]
+
+static int gates = 8;
+static int platesPerGate = 512;
+static long opsPerGate = 50000;
+static uint64_t seed = 1;
+
+static ParkingFacility facility;
+static ParkingFacility side;           // 第4、5阶段使用的带日志的设施
+static int sideExpected;               // 第4、5阶段每次进场应得的结果
+static char (*pool)[MAX_PLATE_LEN];    // 第1、2阶段所有道闸共用的车牌
+static int poolSize;
+
+static atomic_long parkSuccess;
+static atomic_long parkExists;
+static atomic_long parkQueued;
+static atomic_long leaveSuccess;
+static atomic_long remainingCars;
+static atomic_long failures;
+static atomic_long sideMatches;
+static _Atomic double feeTotal;
+
+static void addFee(double fee) {
+    double old = atomic_load(&feeTotal);
+    while (!atomic_compare_exchange_weak(&feeTotal, &old, old + fee)) {
+    }
+}
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 生成车牌号：京 + 地区字母 + 5位数字
+static void makePlate(char *buffer, int gate, int i) {
+    snprintf(buffer, MAX_PLATE_LEN, "京%c%05d", 'A' + gate % 26, i);
+}
+
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void fail(const char *message, const char *plate, int result) {
+    if (atomic_fetch_add(&failures, 1) < 10) {
+        printf("错误: %s（车牌 %s，结果 %d）\n", message, plate, result);
+    }
+}
+
+// 第1阶段：每个道闸都尝试让整个车牌池进场（起点错开）
+static void *parkAllGate(void *arg) {
+    int gate = (int)(intptr_t)arg;
+    for (int k = 0; k < poolSize; k++) {
+        const char *plate = pool[(k + gate * 97) % poolSize];
+        FacilityCommand command;
+        memset(&command, 0, sizeof(command));
+        command.type = FACILITY_PARK;
+        command.time = time(NULL);
+        memcpy(command.plateNumber, plate, MAX_PLATE_LEN);
+        int result = facilityExecute(&facility, &command);
+        if (result == SUCCESS) {
+            atomic_fetch_add(&parkSuccess, 1);
+            if (command.queued) {
+                atomic_fetch_add(&parkQueued, 1);
+            }
+        } else if (result == ERR_EXISTS) {
+            atomic_fetch_add(&parkExists, 1);
+        } else {
+            fail("进场返回了意外的结果", plate, result);
+        }
+    }
+    return NULL;
+}
+
+// 第2阶段：所有道闸反复尝试让车牌池离场，直到全部离开（便道车辆补位后才能离开）
+static void *leaveAllGate(void *arg) {
+    int gate = (int)(intptr_t)arg;
+    int k = gate * 97;
+    while (atomic_load(&remainingCars) > 0) {
+        const char *plate = pool[k++ % poolSize];
+        double fee;
+        int result = facilityLeave(&facility, plate, time(NULL), &fee);
+        if (result == SUCCESS) {
+            atomic_fetch_sub(&remainingCars, 1);
+            atomic_fetch_add(&leaveSuccess, 1);
+            addFee(fee);
+        } else if (result != ERR_NOT_FOUND && result != ERR_EMPTY) {
+            fail("离场返回了意外的结果", plate, result);
+        }
+    }
+    return NULL;
+}
+
+// 第3阶段：每个道闸随机进出自己的车辆，并与自己记录的状态核对
+static void *mixedGate(void *arg) {
+    int gate = (int)(intptr_t)arg;
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + (uint64_t)gate + 1;
+    char (*plates)[MAX_PLATE_LEN] = malloc((size_t)platesPerGate * sizeof(*plates));
+    bool *present = calloc((size_t)platesPerGate, sizeof(bool));
+    if (plates == NULL || present == NULL) {
+        fail("内存分配失败", "-", ERR_MEMORY);
+        free(plates);
+        free(present);
+        return NULL;
+    }
+    for (int i = 0; i < platesPerGate; i++) {
+        makePlate(plates[i], gate + 1, i);
+    }
+
+    for (long op = 0; op < opsPerGate; op++) {
+        int i = (int)(nextRandom(&state) % (uint64_t)platesPerGate);
+        if (nextRandom(&state) & 1) {
+            int result = facilityPark(&facility, plates[i], time(NULL));
+            if (present[i] ? result != ERR_EXISTS : result != SUCCESS) {
+                fail(present[i] ? "重复进场没有被拒绝" : "进场失败", plates[i], result);
+            }
+            if (result == SUCCESS) {
+                atomic_fetch_add(&parkSuccess, 1);
+                present[i] = true;
+            }
+        } else {
+            double fee;
+            int result = facilityLeave(&facility, plates[i], time(NULL), &fee);
+            if (result == SUCCESS) {
+                if (!present[i]) {
+                    fail("不在场内的车辆离场成功", plates[i], result);
+                }
+                atomic_fetch_add(&leaveSuccess, 1);
+                addFee(fee);
+                present[i] = false;
+            } else if (present[i] && facilityQuery(&facility, plates[i]) == 0) {
+                fail("场内车辆丢失", plates[i], result);
+            }
+        }
+    }
+
+    // 清空自己的车辆；便道上的车辆要等其他车辆离开、补位进入停车场后才能离开，所以反复扫描
+    int left = 0;
+    for (int i = 0; i < platesPerGate; i++) {
+        left += present[i];
+    }
+    while (left > 0) {
+        bool progressed = false;
+        for (int i = 0; i < platesPerGate; i++) {
+            if (!present[i]) {
+                continue;
+            }
+            double fee;
+            int result = facilityLeave(&facility, plates[i], time(NULL), &fee);
+            if (result == SUCCESS) {
+                atomic_fetch_add(&leaveSuccess, 1);
+                addFee(fee);
+                present[i] = false;
+                left--;
+                progressed = true;
+            } else if (facilityQuery(&facility, plates[i]) == 0) {
+                fail("场内车辆丢失", plates[i], result);
+                present[i] = false;
+                left--;
+            }
+        }
+        if (!progressed) {
+            sched_yield();
+        }
+    }
+
+    free(plates);
+    free(present);
+    return NULL;
+}
+
+// 第4、5阶段：每个道闸让自己的车辆进入带日志的设施，结果必须是 sideExpected
+static void *sideGate(void *arg) {
+    int gate = (int)(intptr_t)arg;
+    for (int i = 0; i < platesPerGate; i++) {
+        FacilityCommand command;
+        memset(&command, 0, sizeof(command));
+        command.type = FACILITY_PARK;
+        command.time = time(NULL);
+        makePlate(command.plateNumber, gate, i);
+        int result = facilityExecute(&side, &command);
+        if (result == sideExpected) {
+            atomic_fetch_add(&sideMatches, 1);
+        } else {
+            fail(sideExpected == ERR_IO ? "日志写出失败时进场不应返回成功" : "进场结果不对", command.plateNumber, result);
+        }
+    }
+    return NULL;
+}
+
+// 用新的日志文件创建第4、5阶段的设施
+static bool openSideFacility(const SystemConfig *config, const JournalConfig *journalConfig, const char *path) {
+    char statePath[310];
+    snprintf(statePath, sizeof(statePath), "%s.dat", path);
+    remove(path);
+    remove(statePath);
+    atomic_store(&sideMatches, 0);
+    return initFacility(&side, 1, config, statePath, path, journalConfig) == SUCCESS;
+}
+
+// 释放第4、5阶段的设施并删除它的文件
+static void closeSideFacility(const char *path) {
+    char statePath[310];
+    snprintf(statePath, sizeof(statePath), "%s.dat", path);
+    freeFacility(&side);
+    remove(path);
+    remove(statePath);
+}
+
+// 启动所有道闸线程并等待结束，返回耗时（秒）
+static double runGates(void *(*gateMain)(void *)) {
+    pthread_t *threads = malloc((size_t)gates * sizeof(pthread_t));
+    if (threads == NULL) {
+        return 0.0;
+    }
+    double start = nowSeconds();
+    for (int g = 0; g < gates; g++) {
+        pthread_create(&threads[g], NULL, gateMain, (void *)(intptr_t)g);
+    }
+    for (int g = 0; g < gates; g++) {
+        pthread_join(threads[g], NULL);
+    }
+    free(threads);
+    return nowSeconds() - start;
+}
+
+static void check(bool condition, const char *message) {
+    if (!condition) {
+        atomic_fetch_add(&failures, 1);
+        printf("错误: %s\n", message);
+    }
+}
+
+static void printPhase(const char *name, long commands, double elapsed) {
+    printf("%-22s %8ld 条命令  %.3f 秒  %.0f 命令/秒\n", name, commands, elapsed,
+           elapsed > 0 ? commands / elapsed : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+    SystemConfig config;
+    JournalConfig journalConfig;
+    const char *journalPath = NULL;
+    int capacity = 256;
+    poolSize = 4096;
+
+    initSystem(&config, NULL);
+    initJournalConfig(&journalConfig);
+    journalConfig.fsyncPolicy = FSYNC_NEVER;
+    journalConfig.compactThreshold = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--gates") == 0 && hasValue) {
+            gates = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--capacity") == 0 && hasValue) {
+            capacity = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--plates") == 0 && hasValue) {
+            poolSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ops") == 0 && hasValue) {
+            opsPerGate = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--lot-model") == 0 && hasValue) {
+            if (!parseLotModel(argv[++i], &config.lotModel)) {
+                printf("未知的停车场模型: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--journal") == 0 && hasValue) {
+            journalPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            printf("用法: %s [--gates N] [--capacity N] [--plates N] [--ops N] [--lot-model stack|bays] "
+                   "[--journal 日志文件] [--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (gates < 1 || gates > 25 || capacity < 1 || poolSize < 1 || poolSize > 99999) {
+        printf("参数超出范围（道闸1-25，车牌池1-99999）\n");
+        return 1;
+    }
+    config.parkingCapacity = capacity;
+
+    char statePath[300] = "stress_state.dat";
+    if (journalPath != NULL) {
+        snprintf(statePath, sizeof(statePath), "%s.dat", journalPath);
+        remove(journalPath);
+    }
+    if (initFacility(&facility, 0, &config, statePath, journalPath, &journalConfig) != SUCCESS ||
+        startFacility(&facility) != SUCCESS) {
+        return 1;
+    }
+    setReceiptOutput(false);
+
+    pool = malloc((size_t)poolSize * sizeof(*pool));
+    if (pool == NULL) {
+        return 1;
+    }
+    for (int i = 0; i < poolSize; i++) {
+        makePlate(pool[i], 0, i);
+    }
+
+    printf("道闸 %d 个，停车场 %d 个车位（%s），车牌池 %d，每个道闸随机操作 %ld 次%s\n",
+           gates, capacity, config.lotModel == LOT_MODEL_BAYS ? "独立车位" : "栈", poolSize, opsPerGate,
+           journalPath != NULL ? "，写事件日志" : "");
+
+    // 第1阶段：并发重复进场
+    double elapsed = runGates(parkAllGate);
+    printPhase("并发进场（重复检测）", (long)gates * poolSize, elapsed);
+    long expectedQueued = poolSize > capacity ? poolSize - capacity : 0;
+    check(atomic_load(&parkSuccess) == poolSize, "每个车牌应恰好进场成功一次");
+    check(atomic_load(&parkExists) == (long)(gates - 1) * poolSize, "其余进场应被判为重复");
+    check(atomic_load(&parkQueued) == expectedQueued, "进入便道的车辆数不对");
+
+    // 第2阶段：并发离场与便道补位
+    atomic_store(&remainingCars, poolSize);
+    elapsed = runGates(leaveAllGate);
+    printPhase("并发离场（便道补位）", facility.ownEngine.commandsProcessed - (long)gates * poolSize, elapsed);
+    check(atomic_load(&leaveSuccess) == poolSize, "离场成功数应等于进场数");
+
+    // 第3阶段：混合负载
+    long before = facility.ownEngine.commandsProcessed;
+    elapsed = runGates(mixedGate);
+    printPhase("混合进出", facility.ownEngine.commandsProcessed - before, elapsed);
+
+    stopFacility(&facility);
+
+    // 最终一致性检查（引擎已停止，可以直接读取状态）
+    check(isStackEmpty(&facility.lot), "停车场应为空");
+    check(isQueueEmpty(&facility.lane), "便道应为空");
+    check(facility.index.count == 0, "车牌号索引应为空");
+    check(atomic_load(&leaveSuccess) == atomic_load(&parkSuccess), "离场数应等于进场数");
+    check(facility.stats.totalCars == atomic_load(&leaveSuccess), "统计的车辆数应等于离场数");
+    check(facility.stats.totalRevenue == atomic_load(&feeTotal), "统计的收入应等于各道闸收到的费用之和");
+
+    printf("引擎批次:             %ld（平均每批 %.1f 条命令）\n", facility.ownEngine.batches,
+           facility.ownEngine.batches > 0 ? (double)facility.ownEngine.commandsProcessed / facility.ownEngine.batches : 0.0);
+    printf("最大批次:             %d 条命令\n", facility.ownEngine.largestBatch);
+    printf("队列满等待:           %ld 次，唤醒引擎 %ld 次\n", atomic_load(&facility.ownEngine.fullWaits),
+           atomic_load(&facility.ownEngine.wakeups));
+    printf("挪车次数:             %ld\n", facility.lot.totalMoves);
+    printf("总处理车辆数:         %d\n", facility.stats.totalCars);
+
+    if (journalPath != NULL) {
+        check(facility.journal.flushes <= facility.ownEngine.batches, "日志写出次数不应超过引擎批次数");
+        printf("日志写出:             %ld 次\n", facility.journal.flushes);
+    }
+
+    char sidePath[300];
+    snprintf(sidePath, sizeof(sidePath), "%s.side", journalPath != NULL ? journalPath : "stress_journal");
+    long sideCommands = (long)gates * platesPerGate;
+
+    // 第4阶段：按批写出日志（组提交为1时也只在每批结束时写出一次）
+    if (!openSideFacility(&config, &journalConfig, sidePath)) {
+        check(false, "无法创建带日志的设施");
+    } else {
+        if (startFacility(&side) == SUCCESS) {
+            sideExpected = SUCCESS;
+            elapsed = runGates(sideGate);
+            stopFacility(&side);
+            printPhase("并发进场（按批写日志）", sideCommands, elapsed);
+            printf("日志写出:             %ld 次，引擎批次 %ld\n", side.journal.flushes, side.ownEngine.batches);
+            check(atomic_load(&sideMatches) == sideCommands, "每次进场都应成功");
+            check(side.journal.flushes == side.ownEngine.batches, "每批命令应只写出一次日志");
+        }
+        closeSideFacility(sidePath);
+    }
+
+    // 第5阶段：日志写出失败（失败要反映到整批命令的结果上）
+    FILE *full = fopen("/dev/full", "ab");
+    if (full == NULL) {
+        printf("没有 /dev/full，跳过日志写出失败测试\n");
+    } else if (!openSideFacility(&config, &journalConfig, sidePath)) {
+        check(false, "无法创建带日志的设施");
+        fclose(full);
+    } else {
+        fclose(side.journal.file);
+        side.journal.file = full;
+        if (startFacility(&side) == SUCCESS) {
+            sideExpected = ERR_IO;
+            elapsed = runGates(sideGate);
+            printPhase("日志写出失败", sideCommands, elapsed);
+            check(atomic_load(&sideMatches) == sideCommands, "日志写出失败后每次进场都应返回 ERR_IO");
+            check(side.journal.failed, "日志应标记为写出失败");
+        }
+        closeSideFacility(sidePath);
+    }
+
+    long failed = atomic_load(&failures);
+    printf("%s\n", failed == 0 ? "通过" : "失败");
+
+    freeFacility(&facility);
+    free(pool);
+    if (journalPath != NULL) {
+        remove(journalPath);
+    }
+    return failed == 0 ? 0 : 1;
+}